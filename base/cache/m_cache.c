@@ -27,20 +27,41 @@
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+/*! Number of rows (hash functions) in the frequency sketch. */
+#define M_CACHE_SKETCH_DEPTH     4
+/*! Largest value a sketch counter can reach. */
+#define M_CACHE_SKETCH_MAX       15
+/*! Upper bound on the number of counters per sketch row. */
+#define M_CACHE_SKETCH_MAX_WIDTH (1 << 20)
+/*! The sketch counters are halved after this many increments per counter in a row
+ *  so old popularity fades. */
+#define M_CACHE_SKETCH_SAMPLE    10
+
 struct M_cache {
 	M_hashtable_t          *kv_table; /* key -> llist_node. Pointers only, never copies or desroys. */
 	M_llist_t              *value_list; /* llist of cache_values. Never destroys. */
 	size_t                  max_size;
-	size_t                  size;
+	size_t                  max_weight; /* 0 means no weight limit. */
+	size_t                  weight;
+	M_uint64                ttl_ms;     /* Default time to live. 0 means entries don't expire. */
+	M_timeval_t             start_tv;   /* Expiration times are relative to this. */
+	M_uint32                flags;
+	M_hashtable_hash_func   key_hash;
 	M_cache_duplicate_func  key_duplicate;
 	M_cache_free_func       key_free;
 	M_cache_duplicate_func  value_duplicate;
 	M_cache_free_func       value_free;
+	M_uint8                *sketch;       /* TinyLFU count-min sketch. M_CACHE_SKETCH_DEPTH rows of sketch_width counters. */
+	size_t                  sketch_width; /* Power of 2. */
+	size_t                  sketch_adds;  /* Increments since the counters were last halved. */
+	M_cache_stats_t         stats;
 };
 
 typedef struct {
-	void *key; /* Key, kv_table's key points to this. */
-	void *value;
+	void     *key; /* Key, kv_table's key points to this. */
+	void     *value;
+	size_t    weight;
+	M_uint64  expires; /* ms since start_tv. 0 if it never expires. */
 } M_cache_value_t;
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
@@ -49,7 +70,7 @@ static M_cache_value_t *M_cache_value_create(const M_cache_t *c, const void *key
 {
 	M_cache_value_t *cval;
 
-	cval = M_malloc_zero(sizeof(*cval));
+	cval = M_mempool_malloc_zero(sizeof(*cval));
 	
 	if (c->key_duplicate != NULL) {
 		cval->key = c->key_duplicate(key);
@@ -57,8 +78,8 @@ static M_cache_value_t *M_cache_value_create(const M_cache_t *c, const void *key
 		cval->key = M_CAST_OFF_CONST(void *, key);
 	}
 
-	if (c->value_duplicate != NULL) {
-		cval->value = c->value_duplicate(key);
+	if (c->value_duplicate != NULL && value != NULL) {
+		cval->value = c->value_duplicate(value);
 	} else {
 		cval->value = M_CAST_OFF_CONST(void *, value);
 	}
@@ -81,14 +102,105 @@ static void M_cache_value_destroy(const M_cache_t *c, M_cache_value_t *cval, M_b
 	}
 }
 
+/*! Remove an entry and release it. */
+static void M_cache_bucket_destroy(M_cache_t *c, M_llist_node_t *bucket)
+{
+	M_cache_value_t *cval;
+
+	cval       = M_llist_take_node(bucket);
+	c->weight -= cval->weight;
+	M_hashtable_remove(c->kv_table, cval->key, M_FALSE);
+	M_cache_value_destroy(c, cval, M_TRUE);
+}
+
+static M_uint64 M_cache_now(const M_cache_t *c)
+{
+	/* Never return 0 because that means no expiration. */
+	return M_time_elapsed(&c->start_tv) + 1;
+}
+
+static M_bool M_cache_value_expired(const M_cache_t *c, const M_cache_value_t *cval)
+{
+	return cval->expires != 0 && cval->expires <= M_cache_now(c);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+/*! Size the frequency sketch for the number of entries the cache can hold. */
+static void M_cache_sketch_init(M_cache_t *c)
+{
+	size_t width = 64;
+
+	if (!(c->flags & M_CACHE_TINYLFU))
+		return;
+
+	/* A few counters per entry keeps collisions from inflating the frequency of
+	 * keys that are rarely seen. */
+	while (width / 4 < c->max_size && width < M_CACHE_SKETCH_MAX_WIDTH)
+		width <<= 1;
+
+	M_free(c->sketch);
+	c->sketch       = M_malloc_zero(width * M_CACHE_SKETCH_DEPTH);
+	c->sketch_width = width;
+	c->sketch_adds  = 0;
+}
+
+static size_t M_cache_sketch_idx(const M_cache_t *c, M_uint32 hash, size_t row)
+{
+	/* Derive an independent index for each row from the one key hash. */
+	hash += (M_uint32)row * 0x9E3779B9U;
+	hash ^= hash >> 15;
+	hash *= 0x2C1B3C6DU;
+	hash ^= hash >> 12;
+	return (row * c->sketch_width) + (hash & (c->sketch_width - 1));
+}
+
+static M_uint8 M_cache_sketch_frequency(const M_cache_t *c, const void *key)
+{
+	M_uint32 hash;
+	M_uint8  freq = M_CACHE_SKETCH_MAX;
+	size_t   i;
+
+	hash = c->key_hash(key, 0);
+	for (i=0; i<M_CACHE_SKETCH_DEPTH; i++) {
+		freq = M_MIN(freq, c->sketch[M_cache_sketch_idx(c, hash, i)]);
+	}
+	return freq;
+}
+
+static void M_cache_sketch_increment(M_cache_t *c, const void *key)
+{
+	M_uint32 hash;
+	size_t   idx;
+	size_t   i;
+
+	if (c->sketch == NULL)
+		return;
+
+	hash = c->key_hash(key, 0);
+	for (i=0; i<M_CACHE_SKETCH_DEPTH; i++) {
+		idx = M_cache_sketch_idx(c, hash, i);
+		if (c->sketch[idx] < M_CACHE_SKETCH_MAX) {
+			c->sketch[idx]++;
+		}
+	}
+
+	/* Age all counters so keys that were popular long ago don't stay that way. */
+	c->sketch_adds++;
+	if (c->sketch_adds >= c->sketch_width * M_CACHE_SKETCH_SAMPLE) {
+		for (i=0; i<c->sketch_width * M_CACHE_SKETCH_DEPTH; i++) {
+			c->sketch[i] >>= 1;
+		}
+		c->sketch_adds /= 2;
+	}
+}
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 M_cache_t *M_cache_create(size_t max_size, M_hashtable_hash_func key_hash, M_sort_compar_t key_equality, M_uint32 flags, const struct M_cache_callbacks *callbacks)
 {
 	M_cache_t *c;
 
-	(void)flags;
-
 	c = M_malloc_zero(sizeof(*c));
 
 	c->kv_table = M_hashtable_create(16, 75, key_hash, key_equality, M_HASHTABLE_NONE, NULL);
@@ -111,7 +223,14 @@ M_cache_t *M_cache_create(size_t max_size, M_hashtable_hash_func key_hash, M_sor
 		c->value_free      = callbacks->value_free;
 	}
 
+	c->key_hash = key_hash;
+	if (c->key_hash == NULL)
+		c->key_hash = M_hash_func_default_vp();
+
+	c->flags    = flags;
 	c->max_size = max_size;
+	M_time_elapsed_start(&c->start_tv);
+	M_cache_sketch_init(c);
 	return c;
 }
 
@@ -131,73 +250,130 @@ void M_cache_destroy(M_cache_t *c)
 	}
 	M_llist_destroy(c->value_list, M_FALSE);
 
+	M_free(c->sketch);
 	M_free(c);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-M_bool M_cache_insert(M_cache_t *c, const void *key, const void *value)
+/*! Check if an additional entry of the given weight would exceed the capacity. */
+static M_bool M_cache_over_capacity(const M_cache_t *c, size_t num_new, size_t weight)
+{
+	if (M_llist_len(c->value_list) + num_new > c->max_size)
+		return M_TRUE;
+	if (c->max_weight != 0 && c->weight + weight > c->max_weight)
+		return M_TRUE;
+	return M_FALSE;
+}
+
+/*! Evict the coldest entries until the capacity is satisfied. The keep
+ *  entry is never evicted. */
+static void M_cache_evict(M_cache_t *c, size_t num_new, size_t weight, M_llist_node_t *keep)
+{
+	M_llist_node_t *bucket;
+
+	while (M_cache_over_capacity(c, num_new, weight)) {
+		bucket = M_llist_last(c->value_list);
+		if (bucket == NULL || bucket == keep)
+			break;
+
+		if (M_cache_value_expired(c, M_llist_node_val(bucket))) {
+			c->stats.expirations++;
+		} else {
+			c->stats.evictions++;
+		}
+		M_cache_bucket_destroy(c, bucket);
+	}
+}
+
+/*! TinyLFU admission. A new key is only let in when it's been requested more
+ *  often than the entry it would push out. Keeps one off keys from flushing
+ *  the cache. */
+static M_bool M_cache_admit(M_cache_t *c, const void *key, size_t weight)
+{
+	M_llist_node_t  *bucket;
+	M_cache_value_t *cval;
+
+	if (c->sketch == NULL || !M_cache_over_capacity(c, 1, weight))
+		return M_TRUE;
+
+	bucket = M_llist_last(c->value_list);
+	if (bucket == NULL)
+		return M_TRUE;
+
+	cval = M_llist_node_val(bucket);
+	if (M_cache_value_expired(c, cval))
+		return M_TRUE;
+
+	return M_cache_sketch_frequency(c, key) > M_cache_sketch_frequency(c, cval->key);
+}
+
+M_bool M_cache_insert_ext(M_cache_t *c, const void *key, const void *value, size_t weight, M_uint64 ttl_ms)
 {
 	M_llist_node_t  *bucket = NULL;
 	M_cache_value_t *cval   = NULL;
-	M_bool           newval = M_FALSE;
 
 	if (c == NULL || key == NULL || c->max_size == 0)
 		return M_FALSE;
 
+	if (ttl_ms == 0)
+		ttl_ms = c->ttl_ms;
+
+	M_cache_sketch_increment(c, key);
+
 	/* Try to get an existing bucket if the key already exists. */
 	if (!M_hashtable_get(c->kv_table, key, (void **)&bucket))
 		bucket = NULL;
 
+	/* Can't store something heavier than the whole cache, or TinyLFU says the
+	 * key isn't worth keeping. The new value replaces any existing one so the
+	 * old entry needs to go too. */
+	if ((c->max_weight != 0 && weight > c->max_weight) || (bucket == NULL && !M_cache_admit(c, key, weight))) {
+		if (bucket != NULL)
+			M_cache_bucket_destroy(c, bucket);
+		/* A value that would have been duplicated is still owned by the caller. */
+		if (c->value_free != NULL && c->value_duplicate == NULL)
+			c->value_free(M_CAST_OFF_CONST(void *, value));
+		c->stats.rejections++;
+		return M_TRUE;
+	}
+
 	if (bucket == NULL) {
-		if (M_llist_len(c->value_list) == c->max_size) {
-			/* Out of space, reuse the coldest bucket. */
-			bucket = M_llist_last(c->value_list);
-			cval   = M_llist_node_val(bucket);
-
-			/* Remove the bucket for the cval from the hashtable. */
-			M_hashtable_remove(c->kv_table, cval->key, M_FALSE);
-			/* Clear the contents of the value (in bucket). */
-			M_cache_value_destroy(c, cval, M_FALSE);
-
-			/* Add the key. */
-			if (c->key_duplicate != NULL) {
-				cval->key = c->key_duplicate(key);
-			} else {
-				cval->key = M_CAST_OFF_CONST(void *, key);
-			}
-		} else {
-			/* Still have space so we need to create a new bucket. */
-			cval   = M_cache_value_create(c, key, value);
-			bucket = M_llist_insert_first(c->value_list, cval);
-			newval = M_TRUE;
-		}
+		M_cache_evict(c, 1, weight, NULL);
+		cval   = M_cache_value_create(c, key, value);
+		bucket = M_llist_insert_first(c->value_list, cval);
 		M_hashtable_insert(c->kv_table, cval->key, bucket);
 	} else {
-		/* Key matches a bucket so we only need to clear the value. */
-		cval = M_llist_node_val(bucket);
+		/* Key matches a bucket so we only need to replace the value. */
+		cval       = M_llist_node_val(bucket);
+		c->weight -= cval->weight;
 		if (c->value_free != NULL) {
 			c->value_free(cval->value);
 		}
-	}
-
-	if (!newval) {
-		/* Update bucket data value. */
 		if (c->value_duplicate != NULL && value != NULL) {
-			cval->value = c->value_duplicate(key);
+			cval->value = c->value_duplicate(value);
 		} else {
 			cval->value = M_CAST_OFF_CONST(void *, value);
 		}
+		M_llist_set_first(bucket);
+		M_cache_evict(c, 0, weight, bucket);
 	}
 
-	M_llist_set_first(bucket);
+	cval->weight  = weight;
+	cval->expires = (ttl_ms == 0) ? 0 : M_cache_now(c) + ttl_ms;
+	c->weight    += weight;
+
 	return M_TRUE;
 }
 
+M_bool M_cache_insert(M_cache_t *c, const void *key, const void *value)
+{
+	return M_cache_insert_ext(c, key, value, 0, 0);
+}
+
 M_bool M_cache_remove(M_cache_t *c, const void *key)
 {
-	M_llist_node_t  *bucket = NULL;
-	M_cache_value_t *cval   = NULL;
+	M_llist_node_t *bucket = NULL;
 
 	if (c == NULL || key == NULL)
 		return M_FALSE;
@@ -205,35 +381,77 @@ M_bool M_cache_remove(M_cache_t *c, const void *key)
 	if (!M_hashtable_get(c->kv_table, key, (void **)&bucket))
 		return M_FALSE;
 
-	cval = M_llist_take_node(bucket);
-	M_hashtable_remove(c->kv_table, key, M_FALSE);
-	M_cache_value_destroy(c, cval, M_TRUE);
+	M_cache_bucket_destroy(c, bucket);
 
 	return M_TRUE;
 }
 
 M_bool M_cache_get(const M_cache_t *c, const void *key, void **value)
 {
+	/* Lookups update the recency, frequency and statistics. */
+	M_cache_t       *myc    = M_CAST_OFF_CONST(M_cache_t *, c);
 	M_llist_node_t  *bucket = NULL;
 	M_cache_value_t *cval   = NULL;
 
+	if (value != NULL)
+		*value = NULL;
+
 	if (c == NULL || key == NULL)
 		return M_FALSE;
 
-	if (!M_hashtable_get(c->kv_table, key, (void **)&bucket))
+	M_cache_sketch_increment(myc, key);
+
+	if (!M_hashtable_get(c->kv_table, key, (void **)&bucket)) {
+		myc->stats.misses++;
+		return M_FALSE;
+	}
+
+	cval = M_llist_node_val(bucket);
+	if (M_cache_value_expired(c, cval)) {
+		M_cache_bucket_destroy(myc, bucket);
+		myc->stats.expirations++;
+		myc->stats.misses++;
 		return M_FALSE;
+	}
 
 	M_llist_set_first(bucket);
+	myc->stats.hits++;
 
 	if (value == NULL)
 		return M_TRUE;
 
-	cval = M_llist_node_val(bucket);
 	*value = cval->value;
 
 	return M_TRUE;
 }
 
+size_t M_cache_expire(M_cache_t *c)
+{
+	M_llist_node_t *bucket;
+	M_llist_node_t *prev;
+	M_uint64        now;
+	size_t          cnt = 0;
+
+	if (c == NULL)
+		return 0;
+
+	now    = M_cache_now(c);
+	bucket = M_llist_last(c->value_list);
+	while (bucket != NULL) {
+		M_cache_value_t *cval = M_llist_node_val(bucket);
+
+		prev = M_llist_node_prev(bucket);
+		if (cval->expires != 0 && cval->expires <= now) {
+			M_cache_bucket_destroy(c, bucket);
+			cnt++;
+		}
+		bucket = prev;
+	}
+
+	c->stats.expirations += cnt;
+	return cnt;
+}
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 size_t M_cache_size(const M_cache_t *c)
@@ -254,19 +472,65 @@ size_t M_cache_max_size(const M_cache_t *c)
 
 M_bool M_cache_set_max_size(M_cache_t *c, size_t max_size)
 {
-	M_llist_node_t  *bucket = NULL;
-	M_cache_value_t *cval   = NULL;
-
 	if (c == NULL)
 		return M_FALSE;
 
-	while (M_llist_len(c->value_list) > max_size) {
-		bucket = M_llist_last(c->value_list);
-		cval   = M_llist_take_node(bucket);
-		M_hashtable_remove(c->kv_table, cval->key, M_FALSE);
-		M_cache_value_destroy(c, cval, M_TRUE);
-	}
-
 	c->max_size = max_size;
+	M_cache_evict(c, 0, 0, NULL);
+	M_cache_sketch_init(c);
 	return M_TRUE;
 }
+
+size_t M_cache_weight(const M_cache_t *c)
+{
+	if (c == NULL)
+		return 0;
+
+	return c->weight;
+}
+
+size_t M_cache_max_weight(const M_cache_t *c)
+{
+	if (c == NULL)
+		return 0;
+
+	return c->max_weight;
+}
+
+M_bool M_cache_set_max_weight(M_cache_t *c, size_t max_weight)
+{
+	if (c == NULL)
+		return M_FALSE;
+
+	c->max_weight = max_weight;
+	M_cache_evict(c, 0, 0, NULL);
+	return M_TRUE;
+}
+
+void M_cache_set_ttl(M_cache_t *c, M_uint64 ttl_ms)
+{
+	if (c == NULL)
+		return;
+
+	c->ttl_ms = ttl_ms;
+}
+
+M_uint64 M_cache_ttl(const M_cache_t *c)
+{
+	if (c == NULL)
+		return 0;
+
+	return c->ttl_ms;
+}
+
+void M_cache_stats(const M_cache_t *c, M_cache_stats_t *stats)
+{
+	if (stats == NULL)
+		return;
+
+	M_mem_set(stats, 0, sizeof(*stats));
+	if (c == NULL)
+		return;
+
+	M_mem_copy(stats, &c->stats, sizeof(*stats));
+}
@@ -27,8 +27,9 @@
 
 M_cache_strvp_t *M_cache_strvp_create(size_t max_size, M_uint32 flags, void (*destroy_func)(void *))
 {
-	M_hashtable_hash_func    key_hash     = M_hash_func_hash_str;
+	M_hashtable_hash_func    key_hash     = M_hash_func_default_str(M_FALSE);
 	M_sort_compar_t          key_equality = M_sort_compar_str;
+	M_uint32                 cache_flags  = M_CACHE_NONE;
 	struct M_cache_callbacks callbacks = {
 		M_hash_void_strdup,
 		M_free,
@@ -38,11 +39,14 @@ M_cache_strvp_t *M_cache_strvp_create(size_t max_size, M_uint32 flags, void (*de
 
 	/* Key options. */
 	if (flags & M_CACHE_STRVP_CASECMP) {
-		key_hash     = M_hash_func_hash_str_casecmp;
+		key_hash     = M_hash_func_default_str(M_TRUE);
 		key_equality = M_sort_compar_str_casecmp;
 	}
+	if (flags & M_CACHE_STRVP_TINYLFU) {
+		cache_flags |= M_CACHE_TINYLFU;
+	}
 
-	return (M_cache_strvp_t *)M_cache_create(max_size, key_hash, key_equality, M_CACHE_NONE, &callbacks);
+	return (M_cache_strvp_t *)M_cache_create(max_size, key_hash, key_equality, cache_flags, &callbacks);
 }
 
 void M_cache_strvp_destroy(M_cache_strvp_t *c)
@@ -59,6 +63,13 @@ M_bool M_cache_strvp_insert(M_cache_strvp_t *c, const char *key, const void *val
 	return M_cache_insert((M_cache_t *)c, key, value);
 }
 
+M_bool M_cache_strvp_insert_ext(M_cache_strvp_t *c, const char *key, const void *value, size_t weight, M_uint64 ttl_ms)
+{
+	if (M_str_isempty(key))
+		return M_FALSE;
+	return M_cache_insert_ext((M_cache_t *)c, key, value, weight, ttl_ms);
+}
+
 M_bool M_cache_strvp_remove(M_cache_strvp_t *c, const char *key)
 {
 	return M_cache_remove((M_cache_t *)c, key);
@@ -76,6 +87,11 @@ void *M_cache_strvp_get_direct(const M_cache_strvp_t *c, const char *key)
 	return val;
 }
 
+size_t M_cache_strvp_expire(M_cache_strvp_t *c)
+{
+	return M_cache_expire((M_cache_t *)c);
+}
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 size_t M_cache_strvp_size(const M_cache_strvp_t *c)
@@ -93,3 +109,32 @@ M_bool M_cache_strvp_set_max_size(M_cache_strvp_t *c, size_t max_size)
 	return M_cache_set_max_size((M_cache_t *)c, max_size);
 }
 
+size_t M_cache_strvp_weight(const M_cache_strvp_t *c)
+{
+	return M_cache_weight((const M_cache_t *)c);
+}
+
+size_t M_cache_strvp_max_weight(const M_cache_strvp_t *c)
+{
+	return M_cache_max_weight((const M_cache_t *)c);
+}
+
+M_bool M_cache_strvp_set_max_weight(M_cache_strvp_t *c, size_t max_weight)
+{
+	return M_cache_set_max_weight((M_cache_t *)c, max_weight);
+}
+
+void M_cache_strvp_set_ttl(M_cache_strvp_t *c, M_uint64 ttl_ms)
+{
+	M_cache_set_ttl((M_cache_t *)c, ttl_ms);
+}
+
+M_uint64 M_cache_strvp_ttl(const M_cache_strvp_t *c)
+{
+	return M_cache_ttl((const M_cache_t *)c);
+}
+
+void M_cache_strvp_stats(const M_cache_strvp_t *c, M_cache_stats_t *stats)
+{
+	M_cache_stats((const M_cache_t *)c, stats);
+}
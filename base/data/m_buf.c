@@ -24,19 +24,43 @@
 #include "m_config.h"
 
 #include <mstdlib/mstdlib.h>
+#include "m_defs_int.h"
+#include "mem/m_mem_int.h"
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 #define M_BUF_INITIAL_SIZE 1024 /* Must be a multiple of 2 */
 
+/* Per thread limits for pooled buffers. Buffers that grew past the max size
+ * have their data freed before being kept. */
+#define M_BUF_POOL_MAX_CACHED 32
+#define M_BUF_POOL_MAX_SIZE   (64 * 1024)
+
+typedef enum {
+	M_BUF_INT_FLAG_NONE          = 0,
+	M_BUF_INT_FLAG_INLINE_STRUCT = 1 << 0, /*!< Buffer lives in caller memory and isn't freed. */
+	M_BUF_INT_FLAG_INLINE_DATA   = 1 << 1, /*!< Data lives in caller memory and isn't freed or realloc'd. */
+	M_BUF_INT_FLAG_POOLED        = 1 << 2  /*!< Buffer is returned to the thread pool instead of being freed. */
+} M_buf_int_flags_t;
+
 struct M_buf {
 	unsigned char *data;          /*!< Pointer to buffer */
 	size_t         data_size;     /*!< Total allocated size of buffer (minus 1 as it does not include
 	                               *   room for null terminator which is allocated but hidden) */
 	size_t         data_length;   /*!< Length of meaningful bytes in buffer */
 	size_t         data_consumed; /*!< Bytes which have been marked as consumed on the left side of the buffer */
+	M_uint32       flags;         /*!< M_buf_int_flags_t */
 };
 
+#ifdef M_THREAD_LOCAL
+typedef struct {
+	M_buf_t *bufs[M_BUF_POOL_MAX_CACHED];
+	size_t   cnt;
+} M_buf_pool_t;
+
+static M_THREAD_LOCAL M_buf_pool_t M_buf_pool;
+#endif
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 M_buf_t *M_buf_create(void)
@@ -49,15 +73,116 @@ M_buf_t *M_buf_create(void)
 	return buf;
 }
 
-void M_buf_cancel(M_buf_t *buf)
+M_buf_t *M_buf_create_inline(void *mem, size_t mem_len)
 {
-	if (buf == NULL)
+	M_buf_t *buf;
+	size_t   offset;
+
+	if (mem == NULL || mem_len < M_BUF_INLINE_OVERHEAD)
+		return M_buf_create();
+
+	/* Caller memory may not be suitably aligned for the struct. */
+	offset = (M_SAFE_ALIGNMENT - ((M_uintptr)mem % M_SAFE_ALIGNMENT)) % M_SAFE_ALIGNMENT;
+	buf    = (M_buf_t *)(void *)((unsigned char *)mem + offset);
+	M_mem_set(buf, 0, sizeof(*buf));
+	buf->flags = M_BUF_INT_FLAG_INLINE_STRUCT;
+
+	/* Anything after the struct holds data, less one byte for the NULL term. */
+	mem_len -= offset + sizeof(*buf);
+	if (mem_len > 1) {
+		buf->data       = (unsigned char *)(buf + 1);
+		buf->data_size  = mem_len - 1;
+		buf->data[0]    = 0;
+		buf->flags     |= M_BUF_INT_FLAG_INLINE_DATA;
+	}
+
+	return buf;
+}
+
+M_buf_t *M_buf_create_pooled(void)
+{
+#ifdef M_THREAD_LOCAL
+	M_buf_t *buf;
+
+	/* Arena memory is gone once the arena is reset so it must never end up
+	 * in the pool. */
+	if (M_arena_active() != NULL)
+		return M_buf_create();
+
+	if (M_buf_pool.cnt > 0) {
+		M_buf_pool.cnt--;
+		return M_buf_pool.bufs[M_buf_pool.cnt];
+	}
+
+	buf        = M_buf_create();
+	buf->flags = M_BUF_INT_FLAG_POOLED;
+	return buf;
+#else
+	return M_buf_create();
+#endif
+}
+
+void M_buf_pool_thread_flush(void)
+{
+#ifdef M_THREAD_LOCAL
+	M_buf_t *buf;
+
+	while (M_buf_pool.cnt > 0) {
+		M_buf_pool.cnt--;
+		buf = M_buf_pool.bufs[M_buf_pool.cnt];
+		M_free(buf->data);
+		M_free(buf);
+	}
+#endif
+}
+
+/*! Keep a pooled buffer for reuse. Data must either be reset or already removed. */
+static void M_buf_pool_release(M_buf_t *buf)
+{
+#ifdef M_THREAD_LOCAL
+	/* Anything allocated while an arena is active may belong to it. */
+	if (M_arena_active() != NULL) {
+		M_free(buf->data);
+		M_free(buf);
+		return;
+	}
+
+	/* Data grown while an arena was active is arena memory even though the
+	 * buffer itself is not. */
+	if (buf->data_size > M_BUF_POOL_MAX_SIZE || M_mem_is_arena(buf->data)) {
+		M_free(buf->data);
+		buf->data      = NULL;
+		buf->data_size = 0;
+	}
+
+	if (M_buf_pool.cnt < M_BUF_POOL_MAX_CACHED) {
+		M_buf_pool.bufs[M_buf_pool.cnt] = buf;
+		M_buf_pool.cnt++;
 		return;
+	}
+#endif
 
 	M_free(buf->data);
 	M_free(buf);
 }
 
+void M_buf_cancel(M_buf_t *buf)
+{
+	if (buf == NULL)
+		return;
+
+	if (buf->flags & M_BUF_INT_FLAG_POOLED) {
+		M_buf_reset(buf);
+		M_buf_pool_release(buf);
+		return;
+	}
+
+	if (!(buf->flags & M_BUF_INT_FLAG_INLINE_DATA))
+		M_free(buf->data);
+	if (!(buf->flags & M_BUF_INT_FLAG_INLINE_STRUCT))
+		M_free(buf);
+}
+
 /*! Move memory so that data_consumed becomes 0 */
 static void M_buf_consume(M_buf_t *buf)
 {
@@ -88,14 +213,26 @@ unsigned char *M_buf_finish(M_buf_t *buf, size_t *out_length)
 	/* Ensure entire buffer is the real output data */
 	M_buf_consume(buf);
 
-	out       = buf->data;
-	buf->data = NULL;
+	if (buf->flags & M_BUF_INT_FLAG_INLINE_DATA) {
+		/* Caller memory can't be handed out, it needs to be copied. */
+		out = M_malloc(buf->data_length + 1);
+		M_mem_copy(out, buf->data, buf->data_length);
+		out[buf->data_length] = 0;
+	} else {
+		out = buf->data;
+	}
+	buf->data      = NULL;
+	buf->data_size = 0;
 
 	if (out_length)
 		*out_length = buf->data_length;
 	buf->data_length = 0;
 
-	M_free(buf);
+	if (buf->flags & M_BUF_INT_FLAG_POOLED) {
+		M_buf_pool_release(buf);
+	} else if (!(buf->flags & M_BUF_INT_FLAG_INLINE_STRUCT)) {
+		M_free(buf);
+	}
 	return out;
 }
 
@@ -132,6 +269,16 @@ const char *M_buf_peek(const M_buf_t *buf)
 	return ((char *)buf->data) + buf->data_consumed;
 }
 
+void M_buf_reset(M_buf_t *buf)
+{
+	if (buf == NULL || buf->data == NULL)
+		return;
+
+	M_buf_truncate(buf, 0);
+	buf->data_consumed = 0;
+	buf->data[0]       = 0;
+}
+
 void M_buf_truncate(M_buf_t *buf, size_t length)
 {
 	if (buf == NULL || buf->data_length <= length || buf->data == NULL)
@@ -275,10 +422,24 @@ static M_bool ensure_space(M_buf_t *buf, size_t add_length)
 
 	/* See if buffer is large enough. data_consumed here is guaranteed to be 0 */
 	if (new_data_length > buf->data_size) {
-		new_data_size  = next_multiple_of_block_size(new_data_length, buf->data_size);
-		if (new_data_size == 0)
-			return M_FALSE;
-		buf->data      = M_realloc(buf->data, new_data_size + 1 /* NULL Term */);
+		if (buf->flags & M_BUF_INT_FLAG_INLINE_DATA) {
+			/* Spill out of the caller's memory. Sizing starts over so the heap
+			 * allocation follows the normal block sizes. */
+			unsigned char *data;
+
+			new_data_size = next_multiple_of_block_size(new_data_length, 0);
+			if (new_data_size == 0)
+				return M_FALSE;
+			data = M_malloc(new_data_size + 1 /* NULL Term */);
+			M_mem_copy(data, buf->data, buf->data_length);
+			buf->data   = data;
+			buf->flags &= ~((M_uint32)M_BUF_INT_FLAG_INLINE_DATA);
+		} else {
+			new_data_size = next_multiple_of_block_size(new_data_length, buf->data_size);
+			if (new_data_size == 0)
+				return M_FALSE;
+			buf->data = M_realloc(buf->data, new_data_size + 1 /* NULL Term */);
+		}
 		buf->data_size = new_data_size;
 	}
 
@@ -0,0 +1,382 @@
+/* The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Monetra Technologies, LLC.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "m_config.h"
+
+#include <mstdlib/mstdlib.h>
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define M_CHAINBUF_CHUNK_SIZE 4096
+
+typedef struct M_chainbuf_chunk {
+	struct M_chainbuf_chunk *next;      /*!< Next chunk in the chain. */
+	unsigned char           *data;      /*!< Start of the chunk's memory. */
+	size_t                   size;      /*!< Amount of memory data points to. */
+	size_t                   start;     /*!< Offset of the first byte that hasn't been dropped. */
+	size_t                   end;       /*!< Offset after the last byte of data. */
+	M_bool                   writable;  /*!< Data can be appended into the space after end. */
+	void                   (*free_func)(void *); /*!< Releases data for referenced chunks. */
+} M_chainbuf_chunk_t;
+
+struct M_chainbuf {
+	M_chainbuf_chunk_t *head;       /*!< First chunk. Data is read from here. */
+	M_chainbuf_chunk_t *tail;       /*!< Last chunk. Data is added here. */
+	size_t              len;        /*!< Total number of bytes. */
+	size_t              num_chunks; /*!< Number of chunks in the chain. */
+	size_t              chunk_size; /*!< Size of chunks allocated for copied data. */
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void M_chainbuf_chunk_destroy(M_chainbuf_chunk_t *chunk)
+{
+	if (chunk->free_func != NULL)
+		chunk->free_func(chunk->data);
+	M_free(chunk);
+}
+
+
+static void M_chainbuf_append_chunk(M_chainbuf_t *cb, M_chainbuf_chunk_t *chunk)
+{
+	if (cb->tail == NULL) {
+		cb->head = chunk;
+	} else {
+		cb->tail->next = chunk;
+	}
+	cb->tail  = chunk;
+	cb->len  += chunk->end - chunk->start;
+	cb->num_chunks++;
+}
+
+
+/*! Get a chunk with space to write at the end of the chain. */
+static M_chainbuf_chunk_t *M_chainbuf_writable_tail(M_chainbuf_t *cb, size_t want)
+{
+	M_chainbuf_chunk_t *chunk;
+	size_t              size;
+
+	if (cb->tail != NULL && cb->tail->writable && cb->tail->end < cb->tail->size)
+		return cb->tail;
+
+	/* The header and memory are one allocation. Large writes get a chunk big
+	 * enough to hold them so they aren't split up more than needed. */
+	size            = M_MAX(cb->chunk_size, want);
+	chunk           = M_malloc_zero(sizeof(*chunk) + size);
+	chunk->data     = (unsigned char *)(chunk + 1);
+	chunk->size     = size;
+	chunk->writable = M_TRUE;
+	M_chainbuf_append_chunk(cb, chunk);
+
+	return chunk;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+M_chainbuf_t *M_chainbuf_create(size_t chunk_size)
+{
+	M_chainbuf_t *cb;
+
+	cb             = M_malloc_zero(sizeof(*cb));
+	cb->chunk_size = (chunk_size == 0) ? M_CHAINBUF_CHUNK_SIZE : chunk_size;
+
+	return cb;
+}
+
+
+void M_chainbuf_destroy(M_chainbuf_t *cb)
+{
+	M_chainbuf_chunk_t *chunk;
+
+	if (cb == NULL)
+		return;
+
+	while (cb->head != NULL) {
+		chunk    = cb->head;
+		cb->head = chunk->next;
+		M_chainbuf_chunk_destroy(chunk);
+	}
+	M_free(cb);
+}
+
+
+size_t M_chainbuf_len(const M_chainbuf_t *cb)
+{
+	if (cb == NULL)
+		return 0;
+	return cb->len;
+}
+
+
+size_t M_chainbuf_num_chunks(const M_chainbuf_t *cb)
+{
+	if (cb == NULL)
+		return 0;
+	return cb->num_chunks;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+void M_chainbuf_add_bytes(M_chainbuf_t *cb, const void *bytes, size_t len)
+{
+	const unsigned char *ptr = bytes;
+	M_chainbuf_chunk_t  *chunk;
+	size_t               cnt;
+
+	if (cb == NULL || bytes == NULL)
+		return;
+
+	while (len > 0) {
+		chunk = M_chainbuf_writable_tail(cb, len);
+		cnt   = M_MIN(len, chunk->size - chunk->end);
+		M_mem_copy(chunk->data + chunk->end, ptr, cnt);
+		chunk->end += cnt;
+		cb->len    += cnt;
+		ptr        += cnt;
+		len        -= cnt;
+	}
+}
+
+
+void M_chainbuf_add_str(M_chainbuf_t *cb, const char *str)
+{
+	M_chainbuf_add_bytes(cb, str, M_str_len(str));
+}
+
+
+void M_chainbuf_add_bytes_ref(M_chainbuf_t *cb, const void *bytes, size_t len, void (*free_func)(void *))
+{
+	M_chainbuf_chunk_t *chunk;
+
+	if (cb == NULL || bytes == NULL || len == 0) {
+		if (free_func != NULL && bytes != NULL)
+			free_func(M_CAST_OFF_CONST(void *, bytes));
+		return;
+	}
+
+	chunk            = M_malloc_zero(sizeof(*chunk));
+	chunk->data      = M_CAST_OFF_CONST(unsigned char *, bytes);
+	chunk->size      = len;
+	chunk->end       = len;
+	chunk->free_func = free_func;
+	M_chainbuf_append_chunk(cb, chunk);
+}
+
+
+void M_chainbuf_add_buf(M_chainbuf_t *cb, M_buf_t *buf)
+{
+	unsigned char *data;
+	size_t         len;
+
+	if (cb == NULL) {
+		M_buf_cancel(buf);
+		return;
+	}
+
+	data = M_buf_finish(buf, &len);
+	M_chainbuf_add_bytes_ref(cb, data, len, M_free);
+}
+
+
+void M_chainbuf_add_parser(M_chainbuf_t *cb, const M_parser_t *parser)
+{
+	M_chainbuf_add_bytes_ref(cb, M_parser_peek(parser), M_parser_len(parser), NULL);
+}
+
+
+void M_chainbuf_merge(M_chainbuf_t *dest, M_chainbuf_t *source)
+{
+	if (dest == NULL || source == NULL || source->head == NULL) {
+		M_chainbuf_destroy(source);
+		return;
+	}
+
+	if (dest->tail == NULL) {
+		dest->head = source->head;
+	} else {
+		dest->tail->next = source->head;
+	}
+	dest->tail        = source->tail;
+	dest->len        += source->len;
+	dest->num_chunks += source->num_chunks;
+
+	source->head = NULL;
+	M_chainbuf_destroy(source);
+}
+
+
+unsigned char *M_chainbuf_direct_write_start(M_chainbuf_t *cb, size_t *len)
+{
+	M_chainbuf_chunk_t *chunk;
+
+	if (len != NULL)
+		*len = 0;
+
+	if (cb == NULL || len == NULL)
+		return NULL;
+
+	chunk = M_chainbuf_writable_tail(cb, 0);
+	*len  = chunk->size - chunk->end;
+	return chunk->data + chunk->end;
+}
+
+
+void M_chainbuf_direct_write_end(M_chainbuf_t *cb, size_t len)
+{
+	M_chainbuf_chunk_t *chunk;
+
+	if (cb == NULL || cb->tail == NULL || !cb->tail->writable)
+		return;
+
+	chunk       = cb->tail;
+	len         = M_MIN(len, chunk->size - chunk->end);
+	chunk->end += len;
+	cb->len    += len;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+size_t M_chainbuf_iovec(const M_chainbuf_t *cb, M_iovec_t *iov, size_t iov_cnt)
+{
+	const M_chainbuf_chunk_t *chunk;
+	size_t                    cnt = 0;
+
+	if (cb == NULL || iov == NULL)
+		return 0;
+
+	for (chunk=cb->head; chunk != NULL && cnt < iov_cnt; chunk=chunk->next) {
+		/* A writable chunk can be added for a direct write that wrote nothing. */
+		if (chunk->end == chunk->start)
+			continue;
+		iov[cnt].data = chunk->data + chunk->start;
+		iov[cnt].len  = chunk->end - chunk->start;
+		cnt++;
+	}
+
+	return cnt;
+}
+
+
+const unsigned char *M_chainbuf_peek(const M_chainbuf_t *cb, size_t *len)
+{
+	M_iovec_t iov;
+
+	if (len != NULL)
+		*len = 0;
+
+	if (M_chainbuf_iovec(cb, &iov, 1) == 0)
+		return NULL;
+
+	if (len != NULL)
+		*len = iov.len;
+	return iov.data;
+}
+
+
+void M_chainbuf_drop(M_chainbuf_t *cb, size_t num)
+{
+	M_chainbuf_chunk_t *chunk;
+	size_t              cnt;
+
+	if (cb == NULL)
+		return;
+
+	while (cb->head != NULL) {
+		chunk         = cb->head;
+		cnt           = M_MIN(num, chunk->end - chunk->start);
+		chunk->start += cnt;
+		cb->len      -= cnt;
+		num          -= cnt;
+
+		/* Keep the last chunk around if it can still be written to. */
+		if (chunk->start != chunk->end || (chunk == cb->tail && chunk->writable && chunk->end < chunk->size))
+			break;
+
+		cb->head = chunk->next;
+		if (cb->head == NULL)
+			cb->tail = NULL;
+		cb->num_chunks--;
+		M_chainbuf_chunk_destroy(chunk);
+	}
+}
+
+
+size_t M_chainbuf_read(M_chainbuf_t *cb, unsigned char *buf, size_t len)
+{
+	const M_chainbuf_chunk_t *chunk;
+	size_t                    copied = 0;
+	size_t                    cnt;
+
+	if (cb == NULL || buf == NULL)
+		return 0;
+
+	for (chunk=cb->head; chunk != NULL && copied < len; chunk=chunk->next) {
+		cnt = M_MIN(len - copied, chunk->end - chunk->start);
+		M_mem_copy(buf + copied, chunk->data + chunk->start, cnt);
+		copied += cnt;
+	}
+
+	M_chainbuf_drop(cb, copied);
+	return copied;
+}
+
+
+void M_chainbuf_to_buf(const M_chainbuf_t *cb, M_buf_t *buf)
+{
+	const M_chainbuf_chunk_t *chunk;
+
+	if (cb == NULL || buf == NULL)
+		return;
+
+	for (chunk=cb->head; chunk != NULL; chunk=chunk->next) {
+		M_buf_add_bytes(buf, chunk->data + chunk->start, chunk->end - chunk->start);
+	}
+}
+
+
+unsigned char *M_chainbuf_finish(M_chainbuf_t *cb, size_t *out_length)
+{
+	unsigned char            *out;
+	const M_chainbuf_chunk_t *chunk;
+	size_t                    len = 0;
+
+	if (out_length != NULL)
+		*out_length = 0;
+
+	if (cb == NULL)
+		return NULL;
+
+	/* Size is known up front so there's only one copy of each chunk. */
+	out = M_malloc(cb->len + 1);
+	for (chunk=cb->head; chunk != NULL; chunk=chunk->next) {
+		M_mem_copy(out + len, chunk->data + chunk->start, chunk->end - chunk->start);
+		len += chunk->end - chunk->start;
+	}
+	out[len] = '\0';
+
+	if (out_length != NULL)
+		*out_length = len;
+
+	M_chainbuf_destroy(cb);
+	return out;
+}
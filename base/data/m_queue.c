@@ -43,7 +43,7 @@ M_queue_t *M_queue_create(M_sort_compar_t sort_cb, void (*free_cb)(void *))
 	M_queue_t *queue = M_malloc_zero(sizeof(*queue));
 
 	queue->list      = M_llist_create((sort_cb || free_cb)?&callbacks:NULL, (sort_cb)?M_LLIST_SORTED:M_LLIST_NONE);
-	queue->hash      = M_hashtable_create(16, 75, M_hash_func_hash_vp, M_sort_compar_vp, M_HASHTABLE_NONE, NULL);
+	queue->hash      = M_hashtable_create(16, 75, M_hash_func_default_vp(), M_sort_compar_vp, M_HASHTABLE_NONE, NULL);
 	return queue;
 }
 
@@ -1142,7 +1142,7 @@ size_t M_vasprintf(char **ret, const char *fmt, va_list ap)
 	M_buf_t *buf;
 	size_t   len;
 
-	buf = M_buf_create();
+	buf = M_buf_create_pooled();
 	M_vbprintf(buf, fmt, ap);
 
 	if (ret != NULL) {
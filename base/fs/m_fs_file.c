@@ -332,3 +332,10 @@ M_fs_error_t M_fs_file_sync(M_fs_file_t *fd, M_uint32 type)
 
 	return res;
 }
+
+M_intptr M_fs_file_get_fd(const M_fs_file_t *fd)
+{
+	if (fd == NULL)
+		return -1;
+	return (M_intptr)fd->fd;
+}
@@ -29,7 +29,7 @@
 
 M_hash_dict_t *M_hash_dict_create(size_t size, M_uint8 fillpct, M_uint32 flags)
 {
-	M_hashtable_hash_func        key_hash     = M_hash_func_hash_str;
+	M_hashtable_hash_func        key_hash     = M_hash_func_default_str(M_FALSE);
 	M_sort_compar_t              key_equality = M_sort_compar_str;
 	M_hashtable_flags_t          hash_flags   = M_HASHTABLE_NONE;
 	struct M_hashtable_callbacks callbacks    = {
@@ -44,7 +44,7 @@ M_hash_dict_t *M_hash_dict_create(size_t size, M_uint8 fillpct, M_uint32 flags)
 
 	/* Key options. */
 	if (flags & M_HASH_DICT_CASECMP) {
-		key_hash     = M_hash_func_hash_str_casecmp;
+		key_hash     = M_hash_func_default_str(M_TRUE);
 		key_equality = M_sort_compar_str_casecmp;
 	}
 	if (flags & M_HASH_DICT_KEYS_ORDERED) {
@@ -103,6 +103,12 @@ M_hash_dict_t *M_hash_dict_create(size_t size, M_uint8 fillpct, M_uint32 flags)
 	if (flags & M_HASH_DICT_STATIC_SEED) {
 		hash_flags |= M_HASHTABLE_STATIC_SEED;
 	}
+	if (flags & M_HASH_DICT_OPEN_ADDRESSING) {
+		hash_flags |= M_HASHTABLE_OPEN_ADDRESSING;
+	}
+	if (flags & M_HASH_DICT_INCREMENTAL_REHASH) {
+		hash_flags |= M_HASHTABLE_INCREMENTAL_REHASH;
+	}
 
 	/* We are only dealing in opaque types here, and we don't have any
 	 * metadata of our own to store, so we are only casting one pointer
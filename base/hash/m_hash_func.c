@@ -25,6 +25,21 @@
 
 #include <mstdlib/mstdlib.h>
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+/* Algorithm the typed hashtable wrappers pick up when they're created. */
+static M_hash_func_type_t M_hash_func_default_type = M_HASH_FUNC_TYPE_FNV1A;
+
+/* wyhash default secret. */
+static const M_uint64 M_hash_func_wyp[4] = {
+	0xa0761d6478bd642fULL,
+	0xe7037ed1a0b428dbULL,
+	0x8ebc6af09c88c6e3ULL,
+	0x589965cc75374cc3ULL
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
 /*! Default hash algorithm. FNV1a */
 static M_uint32 M_hash_func_hash_FNV1a(const void *key, size_t key_len, M_uint32 seed)
 {
@@ -56,6 +71,168 @@ static M_uint32 M_hash_func_hash_FNV1a_casecmp(const void *key, size_t key_len,
 	return hv;
 }
 
+/*! 64x64 -> 128 bit multiply. Low bits are stored in a and high bits in b. */
+static void M_hash_func_wymum(M_uint64 *a, M_uint64 *b)
+{
+#if defined(__SIZEOF_INT128__)
+	__uint128_t r = *a;
+
+	r  *= *b;
+	*a  = (M_uint64)r;
+	*b  = (M_uint64)(r >> 64);
+#else
+	M_uint64 ha  = *a >> 32;
+	M_uint64 hb  = *b >> 32;
+	M_uint64 la  = (M_uint32)*a;
+	M_uint64 lb  = (M_uint32)*b;
+	M_uint64 rh  = ha * hb;
+	M_uint64 rm0 = ha * lb;
+	M_uint64 rm1 = hb * la;
+	M_uint64 rl  = la * lb;
+	M_uint64 t   = rl + (rm0 << 32);
+	M_uint64 c   = t < rl;
+	M_uint64 lo  = t + (rm1 << 32);
+
+	c  += lo < t;
+	*a  = lo;
+	*b  = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+
+/*! Multiply and fold the 128 bit result. */
+static M_uint64 M_hash_func_wymix(M_uint64 a, M_uint64 b)
+{
+	M_hash_func_wymum(&a, &b);
+	return a ^ b;
+}
+
+
+/*! Lower case ASCII letters in a word. Mirrors M_chr_tolower for every byte. */
+static M_uint64 M_hash_func_word_tolower(M_uint64 w)
+{
+	const M_uint64 ones  = 0x0101010101010101ULL;
+	const M_uint64 highs = 0x8080808080808080ULL;
+	M_uint64       heptets;
+	M_uint64       ge_A;
+	M_uint64       gt_Z;
+
+	/* Bytes with the high bit set are never letters so only the low 7 bits
+	 * need to be range checked. Adding to the low 7 bits can't carry into
+	 * the next byte. */
+	heptets = w & ~highs;
+	ge_A    = heptets + ((0x80 - 'A') * ones);
+	gt_Z    = heptets + ((0x7F - 'Z') * ones);
+
+	return w | ((~w & (ge_A ^ gt_Z) & highs) >> 2);
+}
+
+
+/*! Read 8 bytes in little endian order. Compilers turn this into a single load. */
+static M_uint64 M_hash_func_wyr8(const unsigned char *p, M_bool casecmp)
+{
+	M_uint64 v;
+
+	v = (M_uint64)p[0]       | ((M_uint64)p[1] << 8)  | ((M_uint64)p[2] << 16) | ((M_uint64)p[3] << 24) |
+		((M_uint64)p[4] << 32) | ((M_uint64)p[5] << 40) | ((M_uint64)p[6] << 48) | ((M_uint64)p[7] << 56);
+	if (casecmp)
+		v = M_hash_func_word_tolower(v);
+	return v;
+}
+
+
+/*! Read 4 bytes in little endian order. */
+static M_uint64 M_hash_func_wyr4(const unsigned char *p, M_bool casecmp)
+{
+	M_uint64 v;
+
+	v = (M_uint64)p[0] | ((M_uint64)p[1] << 8) | ((M_uint64)p[2] << 16) | ((M_uint64)p[3] << 24);
+	if (casecmp)
+		v = M_hash_func_word_tolower(v);
+	return v;
+}
+
+
+/*! Read 1 to 3 bytes. */
+static M_uint64 M_hash_func_wyr3(const unsigned char *p, size_t len, M_bool casecmp)
+{
+	M_uint64 v;
+
+	v = ((M_uint64)p[0] << 16) | ((M_uint64)p[len >> 1] << 8) | (M_uint64)p[len - 1];
+	if (casecmp)
+		v = M_hash_func_word_tolower(v);
+	return v;
+}
+
+
+/*! wyhash (final version 4). Processes input 8 bytes at a time.
+ *
+ * The 64 bit result is folded down to 32 bits for use with the hashtable. */
+static M_uint32 M_hash_func_hash_wyhash(const void *key, size_t key_len, M_uint32 seed32, M_bool casecmp)
+{
+	const unsigned char *p    = key;
+	M_uint64             seed = seed32;
+	M_uint64             a;
+	M_uint64             b;
+	M_uint64             see1;
+	M_uint64             see2;
+	size_t               i;
+
+	seed ^= M_hash_func_wymix(seed ^ M_hash_func_wyp[0], M_hash_func_wyp[1]);
+
+	if (key_len <= 16) {
+		if (key_len >= 4) {
+			a = (M_hash_func_wyr4(p, casecmp) << 32) | M_hash_func_wyr4(p + ((key_len >> 3) << 2), casecmp);
+			b = (M_hash_func_wyr4(p + key_len - 4, casecmp) << 32) | M_hash_func_wyr4(p + key_len - 4 - ((key_len >> 3) << 2), casecmp);
+		} else if (key_len > 0) {
+			a = M_hash_func_wyr3(p, key_len, casecmp);
+			b = 0;
+		} else {
+			a = 0;
+			b = 0;
+		}
+	} else {
+		i = key_len;
+		if (i > 48) {
+			see1 = seed;
+			see2 = seed;
+			do {
+				seed = M_hash_func_wymix(M_hash_func_wyr8(p, casecmp) ^ M_hash_func_wyp[1], M_hash_func_wyr8(p + 8, casecmp) ^ seed);
+				see1 = M_hash_func_wymix(M_hash_func_wyr8(p + 16, casecmp) ^ M_hash_func_wyp[2], M_hash_func_wyr8(p + 24, casecmp) ^ see1);
+				see2 = M_hash_func_wymix(M_hash_func_wyr8(p + 32, casecmp) ^ M_hash_func_wyp[3], M_hash_func_wyr8(p + 40, casecmp) ^ see2);
+				p   += 48;
+				i   -= 48;
+			} while (i > 48);
+			seed ^= see1 ^ see2;
+		}
+		while (i > 16) {
+			seed = M_hash_func_wymix(M_hash_func_wyr8(p, casecmp) ^ M_hash_func_wyp[1], M_hash_func_wyr8(p + 8, casecmp) ^ seed);
+			i   -= 16;
+			p   += 16;
+		}
+		a = M_hash_func_wyr8(p + i - 16, casecmp);
+		b = M_hash_func_wyr8(p + i - 8, casecmp);
+	}
+
+	a ^= M_hash_func_wyp[1];
+	b ^= seed;
+	M_hash_func_wymum(&a, &b);
+	a  = M_hash_func_wymix(a ^ M_hash_func_wyp[0] ^ (M_uint64)key_len, b ^ M_hash_func_wyp[1]);
+	return (M_uint32)(a ^ (a >> 32));
+}
+
+
+/*! Integer mixer for fixed size keys (u64 and pointers). A single 128 bit multiply. */
+static M_uint32 M_hash_func_mix_u64(M_uint64 key, M_uint32 seed)
+{
+	M_uint64 h;
+
+	h = M_hash_func_wymix(key ^ M_hash_func_wyp[0], (M_uint64)seed ^ M_hash_func_wyp[1]);
+	return (M_uint32)(h ^ (h >> 32));
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
 M_uint32 M_hash_func_hash_str(const void *key, M_uint32 seed)
 {
 	return M_hash_func_hash_FNV1a(key, M_str_len(key), seed);
@@ -76,6 +253,95 @@ M_uint32 M_hash_func_hash_u64(const void *key, M_uint32 seed)
 	return M_hash_func_hash_FNV1a(key, 8, seed);
 }
 
+M_uint32 M_hash_func_hash_str_wyhash(const void *key, M_uint32 seed)
+{
+	return M_hash_func_hash_wyhash(key, M_str_len(key), seed, M_FALSE);
+}
+
+M_uint32 M_hash_func_hash_str_casecmp_wyhash(const void *key, M_uint32 seed)
+{
+	return M_hash_func_hash_wyhash(key, M_str_len(key), seed, M_TRUE);
+}
+
+M_uint32 M_hash_func_hash_u64_wyhash(const void *key, M_uint32 seed)
+{
+	return M_hash_func_mix_u64(*((const M_uint64 *)key), seed);
+}
+
+M_uint32 M_hash_func_hash_vp_wyhash(const void *key, M_uint32 seed)
+{
+	return M_hash_func_mix_u64((M_uint64)((M_uintptr)key), seed);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+void M_hash_func_hash_bulk(M_hashtable_hash_func key_hash, const void * const *keys, size_t num_keys, M_uint32 seed, M_uint32 *hashes)
+{
+	size_t i;
+
+	if (key_hash == NULL || keys == NULL || hashes == NULL)
+		return;
+
+	/* Call the mixers directly for the fixed size hashes so the loop doesn't
+	 * need to go through a function pointer per key. */
+	if (key_hash == M_hash_func_hash_u64_wyhash) {
+		for (i=0; i<num_keys; i++)
+			hashes[i] = M_hash_func_mix_u64(*((const M_uint64 *)keys[i]), seed);
+	} else if (key_hash == M_hash_func_hash_vp_wyhash) {
+		for (i=0; i<num_keys; i++)
+			hashes[i] = M_hash_func_mix_u64((M_uint64)((M_uintptr)keys[i]), seed);
+	} else {
+		for (i=0; i<num_keys; i++)
+			hashes[i] = key_hash(keys[i], seed);
+	}
+}
+
+void M_hash_func_hash_u64_bulk_wyhash(const M_uint64 *keys, size_t num_keys, M_uint32 seed, M_uint32 *hashes)
+{
+	size_t i;
+
+	if (keys == NULL || hashes == NULL)
+		return;
+
+	for (i=0; i<num_keys; i++)
+		hashes[i] = M_hash_func_mix_u64(keys[i], seed);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+void M_hash_func_set_default_type(M_hash_func_type_t type)
+{
+	M_hash_func_default_type = type;
+}
+
+M_hash_func_type_t M_hash_func_get_default_type(void)
+{
+	return M_hash_func_default_type;
+}
+
+M_hashtable_hash_func M_hash_func_default_str(M_bool casecmp)
+{
+	if (M_hash_func_default_type == M_HASH_FUNC_TYPE_WYHASH)
+		return casecmp?M_hash_func_hash_str_casecmp_wyhash:M_hash_func_hash_str_wyhash;
+	return casecmp?M_hash_func_hash_str_casecmp:M_hash_func_hash_str;
+}
+
+M_hashtable_hash_func M_hash_func_default_u64(void)
+{
+	if (M_hash_func_default_type == M_HASH_FUNC_TYPE_WYHASH)
+		return M_hash_func_hash_u64_wyhash;
+	return M_hash_func_hash_u64;
+}
+
+M_hashtable_hash_func M_hash_func_default_vp(void)
+{
+	if (M_hash_func_default_type == M_HASH_FUNC_TYPE_WYHASH)
+		return M_hash_func_hash_vp_wyhash;
+	return M_hash_func_hash_vp;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
 void *M_hash_func_u64dup(const void *arg)
 {
 	return M_memdup(arg, 8);
@@ -227,12 +227,22 @@ static void M_hash_multi_destroy_object(M_hash_multi_object_t *o, M_hash_multi_f
 M_hash_multi_t *M_hash_multi_create(M_uint32 flags)
 {
 	M_hash_multi_t       *h;
+	M_hash_u64vp_flags_t  int_flags = M_HASH_U64VP_NONE;
 	M_hash_strvp_flags_t  str_flags = M_HASH_STRVP_NONE;
 
 	h = M_malloc(sizeof(*h));
 
-	h->table_int         = M_hash_u64vp_create(16, 75, M_HASH_U64VP_NONE, NULL);
-	h->table_int_destroy = M_hash_u64vp_create(16, 75, M_HASH_U64VP_NONE, NULL);
+	if (flags & M_HASH_MULTI_OPEN_ADDRESSING) {
+		int_flags |= M_HASH_U64VP_OPEN_ADDRESSING;
+		str_flags |= M_HASH_STRVP_OPEN_ADDRESSING;
+	}
+	if (flags & M_HASH_MULTI_INCREMENTAL_REHASH) {
+		int_flags |= M_HASH_U64VP_INCREMENTAL_REHASH;
+		str_flags |= M_HASH_STRVP_INCREMENTAL_REHASH;
+	}
+
+	h->table_int         = M_hash_u64vp_create(16, 75, int_flags, NULL);
+	h->table_int_destroy = M_hash_u64vp_create(16, 75, int_flags, NULL);
 
 	if (flags & M_HASH_MULTI_STR_CASECMP)
 		str_flags |= M_HASH_STRVP_CASECMP;
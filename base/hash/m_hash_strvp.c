@@ -30,7 +30,7 @@
 
 M_hash_strvp_t *M_hash_strvp_create(size_t size, M_uint8 fillpct, M_uint32 flags, M_hashtable_free_func destroy_func)
 {
-	M_hashtable_hash_func        key_hash     = M_hash_func_hash_str;
+	M_hashtable_hash_func        key_hash     = M_hash_func_default_str(M_FALSE);
 	M_sort_compar_t              key_equality = M_sort_compar_str;
 	M_hashtable_flags_t          hash_flags   = M_HASHTABLE_NONE;
 	struct M_hashtable_callbacks callbacks    = {
@@ -45,7 +45,7 @@ M_hash_strvp_t *M_hash_strvp_create(size_t size, M_uint8 fillpct, M_uint32 flags
 
 	/* Key options. */
 	if (flags & M_HASH_STRVP_CASECMP) {
-		key_hash     = M_hash_func_hash_str_casecmp;
+		key_hash     = M_hash_func_default_str(M_TRUE);
 		key_equality = M_sort_compar_str_casecmp;
 	}
 	if (flags & M_HASH_STRVP_KEYS_ORDERED) {
@@ -88,6 +88,12 @@ M_hash_strvp_t *M_hash_strvp_create(size_t size, M_uint8 fillpct, M_uint32 flags
 	if (flags & M_HASH_STRVP_STATIC_SEED) {
 		hash_flags |= M_HASHTABLE_STATIC_SEED;
 	}
+	if (flags & M_HASH_STRVP_OPEN_ADDRESSING) {
+		hash_flags |= M_HASHTABLE_OPEN_ADDRESSING;
+	}
+	if (flags & M_HASH_STRVP_INCREMENTAL_REHASH) {
+		hash_flags |= M_HASHTABLE_INCREMENTAL_REHASH;
+	}
 
 	/* We are only dealing in opaque types here, and we don't have any
 	 * metadata of our own to store, so we are only casting one pointer
@@ -119,6 +125,40 @@ M_bool M_hash_strvp_remove(M_hash_strvp_t *h, const char *key, M_bool destroy_va
 }
 
 
+size_t M_hash_strvp_insert_many(M_hash_strvp_t *h, const char * const *keys, void * const *values, size_t num_keys)
+{
+	const char **mykeys = NULL;
+	size_t       num_inserted;
+	size_t       i;
+
+	if (h == NULL || keys == NULL || num_keys == 0)
+		return 0;
+
+	/* Can't insert empty keys. Swap them for NULL which the base will skip. */
+	for (i=0; i<num_keys; i++) {
+		if (keys[i] == NULL || *keys[i] != '\0')
+			continue;
+
+		if (mykeys == NULL) {
+			mykeys = M_malloc(sizeof(*mykeys) * num_keys);
+			M_mem_copy(mykeys, keys, sizeof(*mykeys) * num_keys);
+		}
+		mykeys[i] = NULL;
+	}
+
+	num_inserted = M_hashtable_insert_many((M_hashtable_t *)h, (const void * const *)(mykeys != NULL ? mykeys : keys), (const void * const *)values, num_keys);
+
+	M_free(mykeys);
+	return num_inserted;
+}
+
+
+size_t M_hash_strvp_remove_many(M_hash_strvp_t *h, const char * const *keys, size_t num_keys, M_bool destroy_vals)
+{
+	return M_hashtable_remove_many((M_hashtable_t *)h, (const void * const *)keys, num_keys, destroy_vals);
+}
+
+
 M_bool M_hash_strvp_get(const M_hash_strvp_t *h, const char *key, void **value)
 {
 	return M_hashtable_get((const M_hashtable_t *)h, key, value);
@@ -133,6 +173,12 @@ void *M_hash_strvp_get_direct(const M_hash_strvp_t *h, const char *key)
 	return val;
 }
 
+
+size_t M_hash_strvp_get_many(const M_hash_strvp_t *h, const char * const *keys, size_t num_keys, void **values, M_bool *found)
+{
+	return M_hashtable_get_many((const M_hashtable_t *)h, (const void * const *)keys, num_keys, values, found);
+}
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 M_bool M_hash_strvp_is_multi(const M_hash_strvp_t *h)
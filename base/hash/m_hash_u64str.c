@@ -27,7 +27,7 @@
 
 M_hash_u64str_t *M_hash_u64str_create(size_t size, M_uint8 fillpct, M_uint32 flags)
 {
-	M_hashtable_hash_func        key_hash     = M_hash_func_hash_u64;
+	M_hashtable_hash_func        key_hash     = M_hash_func_default_u64();
 	M_sort_compar_t              key_equality = M_sort_compar_u64;
 	M_hashtable_flags_t          hash_flags   = M_HASHTABLE_NONE;
 	struct M_hashtable_callbacks callbacks    = {
@@ -80,6 +80,12 @@ M_hash_u64str_t *M_hash_u64str_create(size_t size, M_uint8 fillpct, M_uint32 fla
 	if (flags & M_HASH_U64STR_STATIC_SEED) {
 		hash_flags |= M_HASHTABLE_STATIC_SEED;
 	}
+	if (flags & M_HASH_U64STR_OPEN_ADDRESSING) {
+		hash_flags |= M_HASHTABLE_OPEN_ADDRESSING;
+	}
+	if (flags & M_HASH_U64STR_INCREMENTAL_REHASH) {
+		hash_flags |= M_HASHTABLE_INCREMENTAL_REHASH;
+	}
 
 	/* We are only dealing in opaque types here, and we don't have any
 	 * metadata of our own to store, so we are only casting one pointer
@@ -30,7 +30,7 @@
 
 M_hash_u64vp_t *M_hash_u64vp_create(size_t size, M_uint8 fillpct, M_uint32 flags, M_hashtable_free_func destroy_func)
 {
-	M_hashtable_hash_func        key_hash     = M_hash_func_hash_u64;
+	M_hashtable_hash_func        key_hash     = M_hash_func_default_u64();
 	M_sort_compar_t              key_equality = M_sort_compar_u64;
 	M_hashtable_flags_t          hash_flags   = M_HASHTABLE_NONE;
 	struct M_hashtable_callbacks callbacks    = {
@@ -67,6 +67,12 @@ M_hash_u64vp_t *M_hash_u64vp_create(size_t size, M_uint8 fillpct, M_uint32 flags
 	if (flags & M_HASH_U64VP_STATIC_SEED) {
 		hash_flags |= M_HASHTABLE_STATIC_SEED;
 	}
+	if (flags & M_HASH_U64VP_OPEN_ADDRESSING) {
+		hash_flags |= M_HASHTABLE_OPEN_ADDRESSING;
+	}
+	if (flags & M_HASH_U64VP_INCREMENTAL_REHASH) {
+		hash_flags |= M_HASHTABLE_INCREMENTAL_REHASH;
+	}
 
 	/* We are only dealing in opaque types here, and we don't have any
 	 * metadata of our own to store, so we are only casting one pointer
@@ -94,6 +100,58 @@ M_bool M_hash_u64vp_remove(M_hash_u64vp_t *h, M_uint64 key, M_bool destroy_vals)
 }
 
 
+/* The base bulk functions take an array of key pointers. Lookups and removals
+ * build them in chunks on the stack so they don't need to allocate. */
+#define M_HASH_U64VP_KEY_CHUNK 64
+
+static void M_hash_u64vp_key_ptrs(const M_uint64 *keys, size_t cnt, const void **ptrs)
+{
+	size_t i;
+
+	for (i=0; i<cnt; i++) {
+		ptrs[i] = &keys[i];
+	}
+}
+
+
+size_t M_hash_u64vp_insert_many(M_hash_u64vp_t *h, const M_uint64 *keys, void * const *values, size_t num_keys)
+{
+	const void **ptrs;
+	size_t       num_inserted;
+
+	if (h == NULL || keys == NULL || num_keys == 0)
+		return 0;
+
+	/* All keys need to be passed at once so the table is only grown once. */
+	ptrs = M_malloc(sizeof(*ptrs) * num_keys);
+	M_hash_u64vp_key_ptrs(keys, num_keys, ptrs);
+	num_inserted = M_hashtable_insert_many((M_hashtable_t *)h, ptrs, (const void * const *)values, num_keys);
+	M_free(ptrs);
+
+	return num_inserted;
+}
+
+
+size_t M_hash_u64vp_remove_many(M_hash_u64vp_t *h, const M_uint64 *keys, size_t num_keys, M_bool destroy_vals)
+{
+	const void *ptrs[M_HASH_U64VP_KEY_CHUNK];
+	size_t      num_removed = 0;
+	size_t      cnt;
+	size_t      i;
+
+	if (h == NULL || keys == NULL)
+		return 0;
+
+	for (i=0; i<num_keys; i+=cnt) {
+		cnt = M_MIN(num_keys - i, M_HASH_U64VP_KEY_CHUNK);
+		M_hash_u64vp_key_ptrs(keys+i, cnt, ptrs);
+		num_removed += M_hashtable_remove_many((M_hashtable_t *)h, ptrs, cnt, destroy_vals);
+	}
+
+	return num_removed;
+}
+
+
 M_bool M_hash_u64vp_get(const M_hash_u64vp_t *h, M_uint64 key, void **value)
 {
 	void  *outval = NULL;
@@ -116,6 +174,26 @@ void *M_hash_u64vp_get_direct(const M_hash_u64vp_t *h, M_uint64 key)
 	return val;
 }
 
+
+size_t M_hash_u64vp_get_many(const M_hash_u64vp_t *h, const M_uint64 *keys, size_t num_keys, void **values, M_bool *found)
+{
+	const void *ptrs[M_HASH_U64VP_KEY_CHUNK];
+	size_t      num_found = 0;
+	size_t      cnt;
+	size_t      i;
+
+	if (h == NULL || keys == NULL)
+		return 0;
+
+	for (i=0; i<num_keys; i+=cnt) {
+		cnt = M_MIN(num_keys - i, M_HASH_U64VP_KEY_CHUNK);
+		M_hash_u64vp_key_ptrs(keys+i, cnt, ptrs);
+		num_found += M_hashtable_get_many((const M_hashtable_t *)h, ptrs, cnt, values==NULL?NULL:values+i, found==NULL?NULL:found+i);
+	}
+
+	return num_found;
+}
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 M_bool M_hash_u64vp_is_multi(const M_hash_u64vp_t *h)
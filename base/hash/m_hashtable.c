@@ -40,7 +40,17 @@ struct M_hashtable_bucket {
 		void                  *value;       /*!< Value stored. May be NULL. */
 		M_list_t              *multi_value; /*!< A list of values. */
 	} value;
-	struct M_hashtable_bucket *next;        /*!< Chained entry.  May be NULL if no hash collisions */
+	struct M_hashtable_bucket *next;        /*!< Chained entry.  May be NULL if no hash collisions. Always
+	                                         *   NULL when using open addressing. */
+};
+
+
+/*! Per slot metadata used with open addressing. This is kept in its own array
+ *  separate from the buckets so probing only touches a small contiguous block
+ *  of memory. The key itself is only looked at when the cached hash matches. */
+struct M_hashtable_meta {
+	M_uint32 hash; /*!< Full (unreduced) hash of the key stored in the slot. */
+	M_uint32 psl;  /*!< Probe sequence length plus 1. 0 indicates the slot is empty. */
 };
 
 
@@ -62,6 +72,12 @@ struct M_hashtable {
 	M_hashtable_free_func      value_free;             /*!< Callback to free a value */
 
 	struct M_hashtable_bucket *buckets;                /*!< Bucket list */
+	struct M_hashtable_meta   *meta;                   /*!< Slot metadata when using open addressing. NULL
+	                                                        when using chaining. */
+	struct M_hashtable_bucket *old_buckets;            /*!< Bucket list being migrated from during an incremental
+	                                                        rehash. NULL when not rehashing. */
+	M_uint32                   old_size;               /*!< Number of buckets in old_buckets. */
+	M_uint32                   migrate_idx;            /*!< Next bucket in old_buckets to migrate. */
 
 	M_llist_t                 *keys;                   /*!< List of keys in the h used for ordering. */
 
@@ -146,7 +162,7 @@ M_hashtable_t *M_hashtable_create(size_t size, M_uint8 fillpct,
 
 	/* Default callbacks */
 	if (key_hash == NULL)
-		key_hash     = M_hash_func_hash_vp;
+		key_hash     = M_hash_func_default_vp();
 
 	if (key_equality == NULL)
 		key_equality = M_sort_compar_vp;
@@ -175,6 +191,11 @@ M_hashtable_t *M_hashtable_create(size_t size, M_uint8 fillpct,
 	h->buckets = M_malloc(sizeof(*h->buckets) * h->size);
 	M_mem_set(h->buckets, 0, sizeof(*h->buckets) * h->size);
 
+	if (flags & M_HASHTABLE_OPEN_ADDRESSING) {
+		h->meta = M_malloc(sizeof(*h->meta) * h->size);
+		M_mem_set(h->meta, 0, sizeof(*h->meta) * h->size);
+	}
+
 	if (flags & M_HASHTABLE_KEYS_ORDERED) {
 		M_mem_set(&llist_callbacks, 0, sizeof(llist_callbacks));
 		llist_callbacks.equality = h->key_equality;
@@ -187,17 +208,59 @@ M_hashtable_t *M_hashtable_create(size_t size, M_uint8 fillpct,
 }
 
 
+/*! Compute the full hash of a key. */
+#define HASH_VAL(h, key) h->key_hash(key, h->key_hash_seed)
+
+/*! Grabs the Hashtable index from a computed hash.  The h index is
+ *  the hash of the function reduced to the size of the bucket list.
+ *  We are doing "hash & (size - 1)" since we are guaranteeing a power of 2 for size.
+ *  This is equivalent to "hash % size", but should be more efficient */
+#define HASH_IDX(h, hash) ((hash) & (h->size - 1))
+
+/*! Number of old buckets moved into the new bucket list per modification
+ *  while an incremental rehash is in progress. */
+#define M_HASHTABLE_MIGRATE_BUCKETS 8
+
+
+/*! Searches the open addressing slots for a matching key.
+ *
+ *  Robin Hood ordering guarantees that once we hit a slot whose probe sequence
+ *  length is shorter than the distance we've traveled the key can't be present.
+ *
+ *  \param h    Pointer to the h
+ *  \param hash Full hash of the key
+ *  \param key  key being searched for
+ *  \return Pointer to h bucket containing a match, or NULL if no
+ *          match found */
+static struct M_hashtable_bucket *M_hashtable_oa_get_match(const M_hashtable_t *h, M_uint32 hash, const void *key)
+{
+	M_uint32 idx;
+	M_uint32 psl;
+
+	idx = HASH_IDX(h, hash);
+	for (psl=1; psl<=h->size && h->meta[idx].psl >= psl; psl++) {
+		if (h->meta[idx].hash == hash && h->key_equality(&h->buckets[idx].key, &key, NULL) == 0)
+			return &h->buckets[idx];
+		idx = HASH_IDX(h, idx + 1);
+	}
+
+	return NULL;
+}
+
+
 /*! Searches the chained entries of a hash index for a matching key.
- *  \param h Pointer to the h
- *  \param idx       Hash index being searched
- *  \param key       key being searched for
+ *  \param h       Pointer to the h
+ *  \param buckets Bucket list to search
+ *  \param size    Number of buckets in the list
+ *  \param hash    Full hash of the key
+ *  \param key     key being searched for
  *  \return Pointer to h bucket containing a match, or NULL if no
  *          match found */
-static struct M_hashtable_bucket *M_hashtable_get_match(const M_hashtable_t *h, size_t idx, const void *key)
+static struct M_hashtable_bucket *M_hashtable_chain_match(const M_hashtable_t *h, struct M_hashtable_bucket *buckets, M_uint32 size, M_uint32 hash, const void *key)
 {
 	struct M_hashtable_bucket *entry;
 
-	entry = &h->buckets[idx];
+	entry = &buckets[hash & (size - 1)];
 	if (entry->key == NULL)
 		return NULL;
 
@@ -211,11 +274,107 @@ static struct M_hashtable_bucket *M_hashtable_get_match(const M_hashtable_t *h,
 }
 
 
-/*! Grabs the Hashtable index from the key and length.  The h index is
- *  the hash of the function reduced to the size of the bucket list.
- *  We are doing "hash & (size - 1)" since we are guaranteeing a power of 2 for size.
- *  This is equivalent to "hash % size", but should be more efficient */
-#define HASH_IDX(h, key) h->key_hash(key, h->key_hash_seed) & (h->size - 1)
+/*! Searches for a matching key.
+ *
+ *  During an incremental rehash keys that haven't been migrated yet are
+ *  still in the old bucket list so it's searched if the key isn't found in
+ *  the current one.
+ *
+ *  \param h    Pointer to the h
+ *  \param hash Full hash of the key
+ *  \param key  key being searched for
+ *  \return Pointer to h bucket containing a match, or NULL if no
+ *          match found */
+static struct M_hashtable_bucket *M_hashtable_get_match(const M_hashtable_t *h, M_uint32 hash, const void *key)
+{
+	struct M_hashtable_bucket *entry;
+
+	if (h->meta != NULL)
+		return M_hashtable_oa_get_match(h, hash, key);
+
+	entry = M_hashtable_chain_match(h, h->buckets, h->size, hash, key);
+	if (entry == NULL && h->old_buckets != NULL)
+		entry = M_hashtable_chain_match(h, h->old_buckets, h->old_size, hash, key);
+
+	return entry;
+}
+
+
+/*! Reserve an open addressing slot for a new key.
+ *
+ *  The slot is placed where Robin Hood ordering dictates and any entries that
+ *  are further from their home slot are shifted forward by one. The caller
+ *  must ensure there is at least one empty slot.
+ *
+ *  \param h    Pointer to the h
+ *  \param hash Full hash of the key that will be stored
+ *  \return Zeroed bucket to store the key and value in. */
+static struct M_hashtable_bucket *M_hashtable_oa_claim(M_hashtable_t *h, M_uint32 hash)
+{
+	M_uint32 idx;
+	M_uint32 end;
+	M_uint32 prev;
+	M_uint32 psl = 1;
+
+	idx = HASH_IDX(h, hash);
+	while (h->meta[idx].psl != 0 && h->meta[idx].psl >= psl) {
+		idx = HASH_IDX(h, idx + 1);
+		psl++;
+	}
+
+	if (psl > 1)
+		h->num_collisions++;
+
+	if (h->meta[idx].psl != 0) {
+		/* Slot is taken by an entry that's closer to home than we are. Shift the
+		 * rest of the run forward to open the slot up. */
+		end = idx;
+		while (h->meta[end].psl != 0)
+			end = HASH_IDX(h, end + 1);
+
+		while (end != idx) {
+			prev = HASH_IDX(h, end - 1);
+			M_mem_copy(&h->buckets[end], &h->buckets[prev], sizeof(*h->buckets));
+			h->meta[end].hash = h->meta[prev].hash;
+			h->meta[end].psl  = h->meta[prev].psl + 1;
+			end               = prev;
+		}
+	}
+
+	h->meta[idx].hash = hash;
+	h->meta[idx].psl  = psl;
+	M_mem_set(&h->buckets[idx], 0, sizeof(*h->buckets));
+	return &h->buckets[idx];
+}
+
+
+/*! Release an open addressing slot.
+ *
+ *  Uses backward shift deletion so no tombstones are needed. Any entries
+ *  following the removed one that are not in their home slot are shifted back.
+ *
+ *  \param h     Pointer to the h
+ *  \param entry Bucket being released. The key and value must already be cleaned up. */
+static void M_hashtable_oa_release(M_hashtable_t *h, struct M_hashtable_bucket *entry)
+{
+	M_uint32 idx;
+	M_uint32 next;
+
+	idx  = (M_uint32)(entry - h->buckets);
+	next = HASH_IDX(h, idx + 1);
+	while (h->meta[next].psl > 1) {
+		M_mem_copy(&h->buckets[idx], &h->buckets[next], sizeof(*h->buckets));
+		h->meta[idx].hash = h->meta[next].hash;
+		h->meta[idx].psl  = h->meta[next].psl - 1;
+		idx               = next;
+		next              = HASH_IDX(h, next + 1);
+	}
+
+	h->meta[idx].hash = 0;
+	h->meta[idx].psl  = 0;
+	M_mem_set(&h->buckets[idx], 0, sizeof(*h->buckets));
+}
+
 
 enum M_hashtable_insert_type {
 	M_HASHTABLE_INSERT_NODUP   = 0,      /*!< Do not duplicate the value. Store the pointer directly. */
@@ -239,11 +398,13 @@ enum M_hashtable_insert_type {
  *
  *                     Also whether this is an insert operation or an internal copy.
  *                     Used to determine which duplicate callback to use.
+ *  \param hash Full hash of the key
  *  \param key Key being inserted
  *  \param value Value associated with the key
  *  \return M_TRUE on success. M_FALSE on failure.  Currently this function will
- *          only return failure on misuse. */
-static M_bool M_hashtable_insert_direct(M_hashtable_t *h, enum M_hashtable_insert_type insert_type, const void *key, const void *value)
+ *          only return failure if an open addressing h is full and can't grow
+ *          any larger. */
+static M_bool M_hashtable_insert_direct_hashed(M_hashtable_t *h, enum M_hashtable_insert_type insert_type, M_uint32 hash, const void *key, const void *value)
 {
 	size_t                     idx;
 	struct M_hashtable_bucket *entry;
@@ -251,7 +412,11 @@ static M_bool M_hashtable_insert_direct(M_hashtable_t *h, enum M_hashtable_inser
 	struct M_list_callbacks    list_callbacks;
 	M_bool                     key_added       = M_FALSE;
 
-	if (h == NULL || key == NULL)
+	entry = M_hashtable_get_match(h, hash, key);
+
+	/* Open addressing can't chain so a new key needs a free slot. The table is
+	 * grown before it fills up so this can only happen at the max size. */
+	if (entry == NULL && h->meta != NULL && h->num_keys >= h->size)
 		return M_FALSE;
 
 	/* Duplicate the value (before possibly freeing the old one in case the
@@ -267,22 +432,22 @@ static M_bool M_hashtable_insert_direct(M_hashtable_t *h, enum M_hashtable_inser
 		myvalue = M_CAST_OFF_CONST(void *, value);
 	}
 
-	idx   = HASH_IDX(h, key);
-	entry = M_hashtable_get_match(h, idx, key);
-
 	if (entry == NULL) {
 		/* No matching entry */
 		if (!(insert_type & M_HASHTABLE_INSERT_REHASH))
 			h->num_keys++;
 		key_added = M_TRUE;
+		idx       = HASH_IDX(h, hash);
 
-		if (h->buckets[idx].key == NULL) {
+		if (h->meta != NULL) {
+			entry = M_hashtable_oa_claim(h, hash);
+		} else if (h->buckets[idx].key == NULL) {
 			/* No collision */
 			entry = &h->buckets[idx];
 		} else {
 			/* Collision, chain it */
 			h->num_collisions++;
-			entry                       = M_malloc(sizeof(*entry));
+			entry                       = M_mempool_malloc(sizeof(*entry));
 			M_mem_set(entry, 0, sizeof(*entry));
 			entry->next                 = h->buckets[idx].next;
 			h->buckets[idx].next = entry;
@@ -351,6 +516,16 @@ static M_bool M_hashtable_insert_direct(M_hashtable_t *h, enum M_hashtable_inser
 }
 
 
+/*! Insert into a h computing the hash of the key.
+ *  \see M_hashtable_insert_direct_hashed */
+static M_bool M_hashtable_insert_direct(M_hashtable_t *h, enum M_hashtable_insert_type insert_type, const void *key, const void *value)
+{
+	if (h == NULL || key == NULL)
+		return M_FALSE;
+	return M_hashtable_insert_direct_hashed(h, insert_type, HASH_VAL(h, key), key, value);
+}
+
+
 /*! Function to cleanup key/value when removing an entry or destroying the
  *  h. */
 static void M_hashtable_destroy_entry(M_hashtable_t *h, struct M_hashtable_bucket *entry, M_bool destroy_vals)
@@ -369,14 +544,99 @@ static void M_hashtable_destroy_entry(M_hashtable_t *h, struct M_hashtable_bucke
 }
 
 
+/*! Grow an open addressing h.
+ *
+ *  The cached hash of each entry is used to place it in the new slot list so the
+ *  key_hash callback is never called during a rehash.
+ *  \param h        Pointer to the h
+ *  \param new_size New number of slots. Power of 2 */
+static void M_hashtable_oa_rehash(M_hashtable_t *h, M_uint32 new_size)
+{
+	M_uint32                   i;
+	M_uint32                   old_size;
+	struct M_hashtable_bucket *old;
+	struct M_hashtable_meta   *old_meta;
+	struct M_hashtable_bucket *entry;
+
+	old      = h->buckets;
+	old_meta = h->meta;
+	old_size = h->size;
+
+	h->size        = new_size;
+	h->num_expansions++;
+	h->buckets     = M_malloc(sizeof(*h->buckets) * h->size);
+	M_mem_set(h->buckets, 0, sizeof(*h->buckets) * h->size);
+	h->meta        = M_malloc(sizeof(*h->meta) * h->size);
+	M_mem_set(h->meta, 0, sizeof(*h->meta) * h->size);
+
+	for (i=0; i<old_size; i++) {
+		if (old_meta[i].psl == 0)
+			continue;
+		entry = M_hashtable_oa_claim(h, old_meta[i].hash);
+		M_mem_copy(entry, &old[i], sizeof(*entry));
+	}
+
+	M_free(old_meta);
+	M_free(old);
+}
+
+
+/*! Move entries from the old bucket list into the current one during an
+ *  incremental rehash. The old bucket list is released once it's empty.
+ *  \param h   Pointer to the h
+ *  \param cnt Maximum number of old buckets to migrate */
+static void M_hashtable_migrate(M_hashtable_t *h, M_uint32 cnt)
+{
+	struct M_hashtable_bucket  bucket;
+	struct M_hashtable_bucket *ptr;
+	struct M_hashtable_bucket *next;
+
+	while (h->old_buckets != NULL && cnt > 0) {
+		/* Take the bucket out of the old list first so inserting doesn't find it there. */
+		M_mem_copy(&bucket, &h->old_buckets[h->migrate_idx], sizeof(bucket));
+		M_mem_set(&h->old_buckets[h->migrate_idx], 0, sizeof(bucket));
+		h->migrate_idx++;
+		cnt--;
+
+		if (bucket.key != NULL) {
+			if (h->flags & M_HASHTABLE_MULTI_VALUE) {
+				M_hashtable_insert_direct(h, M_HASHTABLE_INSERT_NODUP|M_HASHTABLE_INSERT_REHASH, bucket.key, bucket.value.multi_value);
+			} else {
+				M_hashtable_insert_direct(h, M_HASHTABLE_INSERT_NODUP|M_HASHTABLE_INSERT_REHASH, bucket.key, bucket.value.value);
+			}
+			ptr = bucket.next;
+			while (ptr != NULL) {
+				next = ptr->next;
+				if (h->flags & M_HASHTABLE_MULTI_VALUE) {
+					M_hashtable_insert_direct(h, M_HASHTABLE_INSERT_NODUP|M_HASHTABLE_INSERT_REHASH, ptr->key, ptr->value.multi_value);
+				} else {
+					M_hashtable_insert_direct(h, M_HASHTABLE_INSERT_NODUP|M_HASHTABLE_INSERT_REHASH, ptr->key, ptr->value.value);
+				}
+				M_free(ptr);
+				ptr = next;
+			}
+		}
+
+		if (h->migrate_idx == h->old_size) {
+			M_free(h->old_buckets);
+			h->old_buckets = NULL;
+			h->old_size    = 0;
+			h->migrate_idx = 0;
+		}
+	}
+}
+
+
 /*! This function is used to either rehash a h or destroy a h.
  *  Though it seems odd that they'd be the same function, they both iterate
  *  over the h the same exact way.  So in order to reduce this error-prone
  *  logic, they were combined into a single function.
  *  \param h  Pointer to the h
  *  \param is_destroy Whether or not this is a destroy call or a rehash call.
- *                    M_TRUE for destroy, M_FALSE for rehash. */
-static void M_hashtable_rehash_or_destroy(M_hashtable_t *h, M_bool is_destroy, M_bool destroy_vals)
+ *                    M_TRUE for destroy, M_FALSE for rehash.
+ *  \param destroy_vals Whether values should be destroyed. Only used with destroy.
+ *  \param new_size Number of buckets to grow to. Power of 2. Only used with rehash. */
+static void M_hashtable_rehash_or_destroy(M_hashtable_t *h, M_bool is_destroy, M_bool destroy_vals, M_uint32 new_size)
 {
 	M_uint32                   i;
 	M_uint32                   old_size;
@@ -387,6 +647,33 @@ static void M_hashtable_rehash_or_destroy(M_hashtable_t *h, M_bool is_destroy, M
 	if (h == NULL)
 		return;
 
+	/* No-op if we grow too large.  Do not need to rehash, just return.
+	 * Checked before migrating so a reserve that doesn't grow stays cheap. */
+	if (!is_destroy && (new_size <= h->size || new_size > M_HASHTABLE_MAX_BUCKETS))
+		return;
+
+	/* Finish any incremental rehash that's in progress. */
+	M_hashtable_migrate(h, h->old_size);
+
+	if (!is_destroy) {
+		if (h->meta != NULL) {
+			M_hashtable_oa_rehash(h, new_size);
+			return;
+		}
+
+		/* Entries will be moved over a few buckets at a time as the h is modified. */
+		if (h->flags & M_HASHTABLE_INCREMENTAL_REHASH) {
+			h->old_buckets = h->buckets;
+			h->old_size    = h->size;
+			h->migrate_idx = 0;
+			h->size        = new_size;
+			h->num_expansions++;
+			h->buckets     = M_malloc(sizeof(*h->buckets) * h->size);
+			M_mem_set(h->buckets, 0, sizeof(*h->buckets) * h->size);
+			return;
+		}
+	}
+
 	/* If we are rehashing, we are going to create a new bucket list and
 	 * re-insert (and thus re-hash) each item in the h one by one.
 	 * We will NOT call the key_duplicate() or value_duplicate() callbacks
@@ -395,11 +682,7 @@ static void M_hashtable_rehash_or_destroy(M_hashtable_t *h, M_bool is_destroy, M
 	old_size = h->size;
 
 	if (!is_destroy) {
-		/* No-op if we grow too large.  Do not need to rehash, just return */
-		if (h->size << 1 > M_HASHTABLE_MAX_BUCKETS)
-			return;
-
-		h->size      <<= 1;
+		h->size        = new_size;
 		h->num_expansions++;
 		h->buckets     = M_malloc(sizeof(*h->buckets) * h->size);
 		M_mem_set(h->buckets, 0, sizeof(*h->buckets) * h->size);
@@ -444,6 +727,7 @@ static void M_hashtable_rehash_or_destroy(M_hashtable_t *h, M_bool is_destroy, M
 	M_free(old);
 
 	if (is_destroy) {
+		M_free(h->meta);
 		if (h->flags & M_HASHTABLE_KEYS_ORDERED) {
 			M_llist_destroy(h->keys, M_FALSE);
 		}
@@ -454,7 +738,7 @@ static void M_hashtable_rehash_or_destroy(M_hashtable_t *h, M_bool is_destroy, M
 
 void M_hashtable_destroy(M_hashtable_t *h, M_bool destroy_vals)
 {
-	M_hashtable_rehash_or_destroy(h, M_TRUE, destroy_vals);
+	M_hashtable_rehash_or_destroy(h, M_TRUE, destroy_vals, 0);
 }
 
 
@@ -463,6 +747,9 @@ void M_hashtable_destroy(M_hashtable_t *h, M_bool destroy_vals)
  *  \return M_TRUE if exceeded, M_FALSE if not */
 static M_bool M_hashtable_exceeds_load(const M_hashtable_t *h)
 {
+	/* Open addressing can't chain so it must grow before it runs out of slots. */
+	if (h->meta != NULL && h->num_keys >= h->size)
+		return M_TRUE;
 	return h->fillpct && h->num_keys * 100 / h->size >= h->fillpct;
 }
 
@@ -477,9 +764,11 @@ static M_bool M_hashtable_insert_int(M_hashtable_t *h, M_bool initial_insert, co
 	if (!M_hashtable_insert_direct(h, insert_type, key, value))
 		return M_FALSE;
 
+	M_hashtable_migrate(h, M_HASHTABLE_MIGRATE_BUCKETS);
+
 	/* Check if we need to rehash */
 	if (M_hashtable_exceeds_load(h))
-		M_hashtable_rehash_or_destroy(h, M_FALSE, M_FALSE);
+		M_hashtable_rehash_or_destroy(h, M_FALSE, M_FALSE, h->size << 1);
 
 	return M_TRUE;
 }
@@ -516,17 +805,12 @@ static M_bool M_hashtable_get_int(const M_hashtable_t *h, struct M_hashtable_buc
 	return M_TRUE;
 }
 
-M_bool M_hashtable_get(const M_hashtable_t *h, const void *key, void **value)
+static M_bool M_hashtable_get_hashed(const M_hashtable_t *h, M_uint32 hash, const void *key, void **value)
 {
 	struct M_hashtable_bucket *entry;
-	size_t                     hash_idx;
 	size_t                     idx     = 0;
 
-	if (h == NULL || key == NULL)
-		return M_FALSE;
-
-	hash_idx = HASH_IDX(h, key);
-	entry    = M_hashtable_get_match(h, hash_idx, key);
+	entry = M_hashtable_get_match(h, hash, key);
 
 	if (entry == NULL)
 		return M_FALSE;
@@ -543,23 +827,40 @@ M_bool M_hashtable_get(const M_hashtable_t *h, const void *key, void **value)
 	return M_hashtable_get_int(h, entry, idx, value);
 }
 
+M_bool M_hashtable_get(const M_hashtable_t *h, const void *key, void **value)
+{
+	if (h == NULL || key == NULL)
+		return M_FALSE;
 
-M_bool M_hashtable_remove(M_hashtable_t *h, const void *key, M_bool destroy_vals)
+	return M_hashtable_get_hashed(h, HASH_VAL(h, key), key, value);
+}
+
+
+static M_bool M_hashtable_remove_hashed(M_hashtable_t *h, M_uint32 hash, const void *key, M_bool destroy_vals)
 {
 	size_t                     idx;
+	struct M_hashtable_bucket *buckets = h->buckets;
+	M_uint32                   size    = h->size;
 	struct M_hashtable_bucket *entry;
 	struct M_hashtable_bucket *next;
 	size_t                     value_cnt;
 
-	if (h == NULL || key == NULL)
-		return M_FALSE;
-
-	idx   = HASH_IDX(h, key);
-	entry = M_hashtable_get_match(h, idx, key);
+	if (h->meta != NULL) {
+		entry = M_hashtable_oa_get_match(h, hash, key);
+	} else {
+		/* Need to know which bucket list the entry is in to unlink it. */
+		entry = M_hashtable_chain_match(h, buckets, size, hash, key);
+		if (entry == NULL && h->old_buckets != NULL) {
+			buckets = h->old_buckets;
+			size    = h->old_size;
+			entry   = M_hashtable_chain_match(h, buckets, size, hash, key);
+		}
+	}
 
 	if (entry == NULL)
 		return M_FALSE;
 
+	idx   = hash & (size - 1);
 	next  = entry->next;
 
 	if (h->flags & M_HASHTABLE_MULTI_VALUE) {
@@ -569,12 +870,15 @@ M_bool M_hashtable_remove(M_hashtable_t *h, const void *key, M_bool destroy_vals
 	}
 	M_hashtable_destroy_entry(h, entry, destroy_vals);
 
-	if (next != NULL) {
+	if (h->meta != NULL) {
+		/* Open addressing, shift the rest of the run back into the slot. */
+		M_hashtable_oa_release(h, entry);
+	} else if (next != NULL) {
 		/* If there is a chained entry following ours, then just copy
 		 * its contents over ours and free its chaining ptr memory */
 		M_mem_copy(entry, next, sizeof(*entry));
 		M_free(next);
-	} else if (entry == &h->buckets[idx]) {
+	} else if (entry == &buckets[idx]) {
 		/* If we are a non-chained entry, just zero out the
 		 * memory as we freed the bucket */
 		M_mem_set(entry, 0, sizeof(*entry));
@@ -583,7 +887,7 @@ M_bool M_hashtable_remove(M_hashtable_t *h, const void *key, M_bool destroy_vals
 		 * can terminate the chain ... most expensive case */
 		struct M_hashtable_bucket *ptr;
 
-		ptr = &h->buckets[idx];
+		ptr = &buckets[idx];
 		while (ptr->next != entry)
 			ptr = ptr->next;
 
@@ -598,6 +902,175 @@ M_bool M_hashtable_remove(M_hashtable_t *h, const void *key, M_bool destroy_vals
 }
 
 
+M_bool M_hashtable_remove(M_hashtable_t *h, const void *key, M_bool destroy_vals)
+{
+	M_bool ret;
+
+	if (h == NULL || key == NULL)
+		return M_FALSE;
+
+	ret = M_hashtable_remove_hashed(h, HASH_VAL(h, key), key, destroy_vals);
+	M_hashtable_migrate(h, M_HASHTABLE_MIGRATE_BUCKETS);
+	return ret;
+}
+
+
+/*! Number of keys hashed and prefetched at a time by the bulk functions. */
+#define M_HASHTABLE_BATCH_SIZE 16
+
+/*! Hash a batch of keys and prefetch the slots they map to so the memory
+ *  loads overlap instead of stalling one key at a time.
+ *  \param h      Pointer to the h
+ *  \param keys   Keys to hash. NULL keys are skipped
+ *  \param cnt    Number of keys. At most M_HASHTABLE_BATCH_SIZE
+ *  \param hashes Array to store the full hash of each key in */
+static void M_hashtable_hash_batch(const M_hashtable_t *h, const void * const *keys, size_t cnt, M_uint32 *hashes)
+{
+	size_t i;
+
+	for (i=0; i<cnt && keys[i] != NULL; i++)
+		;
+
+	if (i == cnt) {
+		M_hash_func_hash_bulk(h->key_hash, keys, cnt, h->key_hash_seed, hashes);
+	} else {
+		for (i=0; i<cnt; i++) {
+			hashes[i] = keys[i] == NULL ? 0 : HASH_VAL(h, keys[i]);
+		}
+	}
+
+	for (i=0; i<cnt; i++) {
+		M_PREFETCH(&h->buckets[HASH_IDX(h, hashes[i])]);
+		if (h->meta != NULL) {
+			M_PREFETCH(&h->meta[HASH_IDX(h, hashes[i])]);
+		}
+	}
+}
+
+
+/*! Grow a h once so that num_new additional keys can be inserted
+ *  without further expansions. */
+static void M_hashtable_reserve(M_hashtable_t *h, size_t num_new)
+{
+	size_t   num_keys = h->num_keys + num_new;
+	M_uint32 size     = h->size;
+
+	/* Without a fill percentage a chained h never grows. Open addressing
+	 * always needs a slot for every key. */
+	while (size < M_HASHTABLE_MAX_BUCKETS) {
+		if (h->fillpct != 0) {
+			if (num_keys * 100 / size < h->fillpct && (h->meta == NULL || num_keys < size)) {
+				break;
+			}
+		} else if (h->meta == NULL || num_keys < size) {
+			break;
+		}
+		size <<= 1;
+	}
+
+	M_hashtable_rehash_or_destroy(h, M_FALSE, M_FALSE, size);
+}
+
+
+size_t M_hashtable_get_many(const M_hashtable_t *h, const void * const *keys, size_t num_keys, void **values, M_bool *found)
+{
+	M_uint32 hashes[M_HASHTABLE_BATCH_SIZE];
+	size_t   num_found = 0;
+	size_t   cnt;
+	size_t   i;
+	size_t   j;
+	M_bool   ret;
+
+	if (h == NULL || keys == NULL || num_keys == 0)
+		return 0;
+
+	for (i=0; i<num_keys; i+=cnt) {
+		cnt = M_MIN(num_keys - i, M_HASHTABLE_BATCH_SIZE);
+		M_hashtable_hash_batch(h, keys+i, cnt, hashes);
+
+		for (j=0; j<cnt; j++) {
+			if (values != NULL)
+				values[i+j] = NULL;
+
+			ret = M_FALSE;
+			if (keys[i+j] != NULL)
+				ret = M_hashtable_get_hashed(h, hashes[j], keys[i+j], values==NULL?NULL:&values[i+j]);
+
+			if (found != NULL)
+				found[i+j] = ret;
+			if (ret)
+				num_found++;
+		}
+	}
+
+	return num_found;
+}
+
+
+size_t M_hashtable_insert_many(M_hashtable_t *h, const void * const *keys, const void * const *values, size_t num_keys)
+{
+	M_uint32 hashes[M_HASHTABLE_BATCH_SIZE];
+	size_t   num_inserted = 0;
+	size_t   cnt;
+	size_t   i;
+	size_t   j;
+
+	if (h == NULL || keys == NULL || num_keys == 0)
+		return 0;
+
+	/* Grow once up front instead of doubling repeatedly during the load. */
+	M_hashtable_reserve(h, num_keys);
+
+	for (i=0; i<num_keys; i+=cnt) {
+		cnt = M_MIN(num_keys - i, M_HASHTABLE_BATCH_SIZE);
+		M_hashtable_hash_batch(h, keys+i, cnt, hashes);
+
+		for (j=0; j<cnt; j++) {
+			if (keys[i+j] == NULL)
+				continue;
+
+			if (!M_hashtable_insert_direct_hashed(h, M_HASHTABLE_INSERT_DUP|M_HASHTABLE_INSERT_INITIAL, hashes[j], keys[i+j], values==NULL?NULL:values[i+j]))
+				continue;
+			num_inserted++;
+			M_hashtable_migrate(h, M_HASHTABLE_MIGRATE_BUCKETS);
+
+			/* Only possible when the reserve was limited by the max size. */
+			if (M_hashtable_exceeds_load(h))
+				M_hashtable_rehash_or_destroy(h, M_FALSE, M_FALSE, h->size << 1);
+		}
+	}
+
+	return num_inserted;
+}
+
+
+size_t M_hashtable_remove_many(M_hashtable_t *h, const void * const *keys, size_t num_keys, M_bool destroy_vals)
+{
+	M_uint32 hashes[M_HASHTABLE_BATCH_SIZE];
+	size_t   num_removed = 0;
+	size_t   cnt;
+	size_t   i;
+	size_t   j;
+
+	if (h == NULL || keys == NULL || num_keys == 0)
+		return 0;
+
+	for (i=0; i<num_keys; i+=cnt) {
+		cnt = M_MIN(num_keys - i, M_HASHTABLE_BATCH_SIZE);
+		M_hashtable_hash_batch(h, keys+i, cnt, hashes);
+
+		for (j=0; j<cnt; j++) {
+			if (keys[i+j] != NULL && M_hashtable_remove_hashed(h, hashes[j], keys[i+j], destroy_vals)) {
+				num_removed++;
+			}
+		}
+		M_hashtable_migrate(h, M_HASHTABLE_MIGRATE_BUCKETS);
+	}
+
+	return num_removed;
+}
+
+
 M_bool M_hashtable_is_multi(const M_hashtable_t *h)
 {
 	if (h == NULL || !(h->flags & M_HASHTABLE_MULTI_VALUE))
@@ -609,7 +1082,6 @@ M_bool M_hashtable_is_multi(const M_hashtable_t *h)
 M_bool M_hashtable_multi_len(const M_hashtable_t *h, const void *key, size_t *len)
 {
 	struct M_hashtable_bucket *entry;
-	size_t                     hash_idx;
 	size_t                     mylen;
 
 	if (len == NULL) {
@@ -621,8 +1093,7 @@ M_bool M_hashtable_multi_len(const M_hashtable_t *h, const void *key, size_t *le
 	if (h == NULL || !(h->flags & M_HASHTABLE_MULTI_VALUE) || key == NULL)
 		return M_FALSE;
 
-	hash_idx = HASH_IDX(h, key);
-	entry    = M_hashtable_get_match(h, hash_idx, key);
+	entry = M_hashtable_get_match(h, HASH_VAL(h, key), key);
 
 	if (entry == NULL)
 		return M_FALSE;
@@ -640,13 +1111,11 @@ M_bool M_hashtable_multi_len(const M_hashtable_t *h, const void *key, size_t *le
 M_bool M_hashtable_multi_get(const M_hashtable_t *h, const void *key, size_t idx, void **value)
 {
 	struct M_hashtable_bucket *entry;
-	size_t                     hash_idx;
 
 	if (h == NULL || !(h->flags & M_HASHTABLE_MULTI_VALUE) || key == NULL)
 		return M_FALSE;
 
-	hash_idx = HASH_IDX(h, key);
-	entry    = M_hashtable_get_match(h, hash_idx, key);
+	entry = M_hashtable_get_match(h, HASH_VAL(h, key), key);
 
 	if (entry == NULL)
 		return M_FALSE;
@@ -659,14 +1128,12 @@ M_bool M_hashtable_multi_remove(M_hashtable_t *h, const void *key, size_t idx, M
 {
 	struct M_hashtable_bucket *entry;
 	void                      *value;
-	size_t                     hash_idx;
 	size_t                     value_len = 1;
 
 	if (h == NULL || !(h->flags & M_HASHTABLE_MULTI_VALUE) || key == NULL)
 		return M_FALSE;
 
-	hash_idx = HASH_IDX(h, key);
-	entry    = M_hashtable_get_match(h, hash_idx, key);
+	entry = M_hashtable_get_match(h, HASH_VAL(h, key), key);
 
 	if (entry == NULL)
 		return M_FALSE;
@@ -752,9 +1219,14 @@ static M_bool M_hashtable_enumerate_next_unordered(const M_hashtable_t *h, M_has
 		*value = NULL;
 	}
 
-	/* Go though each bucket looking for something in them. */
-	for (i=hashenum->entry.unordered.hash; i<h->size; i++) {
-		ptr = &h->buckets[i];
+	/* Go though each bucket looking for something in them. Buckets still waiting
+	 * to be migrated by an incremental rehash are visited after the current ones. */
+	for (i=hashenum->entry.unordered.hash; i<h->size+h->old_size; i++) {
+		if (i < h->size) {
+			ptr = &h->buckets[i];
+		} else {
+			ptr = &h->old_buckets[i-h->size];
+		}
 		/* having a key tell us there is something in the bucket. */
 		if (ptr->key != NULL) {
 			/* We're keeping track of which item in the chain we're currently processing.
@@ -945,7 +1417,7 @@ void M_hashtable_merge(M_hashtable_t **dest, M_hashtable_t *src)
 
 			/* See if we need to rehash it because we added so many entries */
 			if (M_hashtable_exceeds_load(*dest))
-				M_hashtable_rehash_or_destroy(*dest, M_FALSE, M_FALSE);
+				M_hashtable_rehash_or_destroy(*dest, M_FALSE, M_FALSE, (*dest)->size << 1);
 		}
 	}
 
@@ -143,7 +143,7 @@ static M_llist_node_t *M_llist_node_create(M_llist_t *d, const void *val, M_llis
 {
 	M_llist_node_t *node;
 
-	node         = M_malloc_zero(sizeof(*node));
+	node         = M_mempool_malloc_zero(sizeof(*node));
 	node->parent = d;
 
 	node->val = M_CAST_OFF_CONST(void *, val);
@@ -57,4 +57,20 @@
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+/* Thread local storage class. Not defined when the compiler does not support it. */
+#if defined(_MSC_VER)
+#  define M_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__) || defined(__SUNPRO_C)
+#  define M_THREAD_LOCAL __thread
+#endif
+
+/* Hint that memory will be read soon. */
+#if defined(__GNUC__) || defined(__clang__)
+#  define M_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#  define M_PREFETCH(addr)
+#endif
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
 #endif /* __M_DEFS_INT_H__ */
@@ -0,0 +1,362 @@
+/* The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Monetra Technologies, LLC.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "m_config.h"
+
+#include <mstdlib/mstdlib.h>
+#include "m_defs_int.h"
+#include "mem/m_mem_int.h"
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define M_ARENA_DEFAULT_BLOCK_SIZE (64*1024)
+
+/* Round up to a multiple of the alignment M_malloc guarantees. */
+#define M_ARENA_ROUND(x) ((((x)+M_SAFE_ALIGNMENT-1)/M_SAFE_ALIGNMENT)*M_SAFE_ALIGNMENT)
+
+/* Largest request that can be serviced without overflowing the rounding
+ * or colliding with the flags in the size header. */
+#define M_ARENA_MAX_ALLOC (M_MEM_MAX_SIZE - (M_ARENA_HDR_LEN * 2))
+
+typedef struct M_arena_block {
+	struct M_arena_block *prev; /*!< Block that was filled before this one. */
+	size_t                base; /*!< Arena position at the start of this block. */
+	size_t                size; /*!< Usable bytes in the block. */
+	size_t                used; /*!< Bytes handed out from the block. */
+} M_arena_block_t;
+
+#define M_ARENA_BLOCK_HDR_LEN M_ARENA_ROUND(sizeof(M_arena_block_t))
+
+/* Each allocation is preceded by the same size header M_malloc uses so M_free
+ * and M_realloc can identify it. The owning arena is stored directly after the
+ * size when there is room, otherwise in front of it. */
+#define M_ARENA_HDR_LEN M_ARENA_ROUND(sizeof(size_t) + sizeof(M_arena_t *))
+
+struct M_arena {
+	M_arena_block_t *block;       /*!< Block allocations are currently served from. */
+	M_arena_block_t *spare;       /*!< Blocks kept for reuse after a reset. */
+	size_t           block_size;  /*!< Usable size of a standard block. */
+	size_t           capacity;    /*!< Total usable size of all blocks. */
+	M_arena_t       *prev_active; /*!< Arena that was active when this one was pushed. */
+	M_bool           pushed;
+};
+
+#ifdef M_THREAD_LOCAL
+M_THREAD_LOCAL M_arena_t *M_arena_thread_active = NULL;
+#endif
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static unsigned char *M_arena_block_data(M_arena_block_t *block)
+{
+	return ((unsigned char *)block) + M_ARENA_BLOCK_HDR_LEN;
+}
+
+static unsigned char *M_arena_owner_pos(unsigned char *ptr)
+{
+	if (M_SAFE_ALIGNMENT >= sizeof(size_t) + sizeof(M_arena_t *))
+		return ptr - M_SAFE_ALIGNMENT + sizeof(size_t);
+	return ptr - M_ARENA_HDR_LEN;
+}
+
+static void M_arena_set_header(M_arena_t *arena, unsigned char *ptr, size_t size)
+{
+	size = size | M_MEM_ARENA_FLAG;
+	M_mem_copy(ptr - M_SAFE_ALIGNMENT, &size, sizeof(size));
+	M_mem_copy(M_arena_owner_pos(ptr), &arena, sizeof(arena));
+}
+
+static M_arena_block_t *M_arena_block_add(M_arena_t *arena, size_t need)
+{
+	M_arena_block_t *block;
+	size_t           size = arena->block_size;
+
+	/* Oversized allocations get a block of their own. */
+	if (need > size)
+		size = need;
+
+	if (size == arena->block_size && arena->spare != NULL) {
+		block         = arena->spare;
+		arena->spare  = block->prev;
+	} else {
+		block = M_malloc_heap(M_ARENA_BLOCK_HDR_LEN + size);
+		if (block == NULL)
+			return NULL;
+		block->size      = size;
+		arena->capacity += size;
+	}
+
+	block->used  = 0;
+	block->prev  = arena->block;
+	block->base  = block->prev == NULL ? 0 : block->prev->base + block->prev->size;
+	arena->block = block;
+	return block;
+}
+
+static void M_arena_block_release(M_arena_t *arena, M_arena_block_t *block, M_bool keep)
+{
+	if (keep && block->size == arena->block_size) {
+		/* Don't leave old data laying around in memory that will be handed out again. */
+		M_mem_set(M_arena_block_data(block), 0xFF, block->used);
+		block->prev  = arena->spare;
+		arena->spare = block;
+		return;
+	}
+
+	/* M_free clears the memory. */
+	arena->capacity -= block->size;
+	M_free(block);
+}
+
+static void M_arena_release_all(M_arena_t *arena, M_bool keep)
+{
+	M_arena_block_t *block;
+
+	while (arena->block != NULL) {
+		block        = arena->block;
+		arena->block = block->prev;
+		M_arena_block_release(arena, block, keep);
+	}
+}
+
+static void M_arena_unlink(M_arena_t *arena)
+{
+#ifdef M_THREAD_LOCAL
+	M_arena_t **pos = &M_arena_thread_active;
+
+	while (*pos != NULL) {
+		if (*pos == arena) {
+			*pos = arena->prev_active;
+			break;
+		}
+		pos = &(*pos)->prev_active;
+	}
+#endif
+	arena->prev_active = NULL;
+	arena->pushed      = M_FALSE;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+M_arena_t *M_arena_create(size_t block_size)
+{
+	M_arena_t *arena;
+
+	if (block_size == 0)
+		block_size = M_ARENA_DEFAULT_BLOCK_SIZE;
+	if (block_size > M_ARENA_MAX_ALLOC)
+		return NULL;
+
+	/* The arena itself must never come from another arena. */
+	arena = M_malloc_heap(sizeof(*arena));
+	if (arena == NULL)
+		return NULL;
+	M_mem_set(arena, 0, sizeof(*arena));
+
+	arena->block_size = M_ARENA_ROUND(block_size);
+	return arena;
+}
+
+void M_arena_destroy(M_arena_t *arena)
+{
+	M_arena_block_t *block;
+
+	if (arena == NULL)
+		return;
+
+	if (arena->pushed)
+		M_arena_unlink(arena);
+
+	M_arena_release_all(arena, M_FALSE);
+	while (arena->spare != NULL) {
+		block        = arena->spare;
+		arena->spare = block->prev;
+		M_free(block);
+	}
+
+	M_free(arena);
+}
+
+void *M_arena_alloc(M_arena_t *arena, size_t size)
+{
+	M_arena_block_t *block;
+	unsigned char   *ptr;
+	size_t           need;
+
+	if (arena == NULL || size == 0 || size > M_ARENA_MAX_ALLOC)
+		return NULL;
+
+	need  = M_ARENA_HDR_LEN + M_ARENA_ROUND(size);
+	block = arena->block;
+	if (block == NULL || block->size - block->used < need) {
+		block = M_arena_block_add(arena, need);
+		if (block == NULL) {
+			return NULL;
+		}
+	}
+
+	ptr          = M_arena_block_data(block) + block->used + M_ARENA_HDR_LEN;
+	block->used += need;
+
+	M_arena_set_header(arena, ptr, size);
+	return ptr;
+}
+
+void *M_arena_realloc_int(void *ptr, size_t orig_size, size_t size, M_bool zero)
+{
+	M_arena_t       *arena = NULL;
+	M_arena_block_t *block;
+	unsigned char   *uptr  = ptr;
+	unsigned char   *ret;
+	size_t           orig_need;
+	size_t           need;
+
+	M_mem_copy(&arena, M_arena_owner_pos(uptr), sizeof(arena));
+	if (arena == NULL || size > M_ARENA_MAX_ALLOC)
+		return NULL;
+
+	/* Resize in place if this is the most recent allocation and there is room. */
+	block     = arena->block;
+	orig_need = M_ARENA_ROUND(orig_size);
+	need      = M_ARENA_ROUND(size);
+	if (block != NULL && uptr + orig_need == M_arena_block_data(block) + block->used &&
+		(need <= orig_need || block->size - block->used >= need - orig_need))
+	{
+		block->used = block->used - orig_need + need;
+		M_arena_set_header(arena, uptr, size);
+		if (size > orig_size && zero) {
+			M_mem_set(uptr + orig_size, 0, size - orig_size);
+		} else if (size < orig_size) {
+			M_mem_set(uptr + size, 0xFF, orig_size - size);
+		}
+		return ptr;
+	}
+
+	ret = M_arena_alloc(arena, size);
+	if (ret == NULL)
+		return NULL;
+
+	M_mem_copy(ret, ptr, M_MIN(orig_size, size));
+	if (zero && size > orig_size)
+		M_mem_set(ret + orig_size, 0, size - orig_size);
+	return ret;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+size_t M_arena_mark(const M_arena_t *arena)
+{
+	if (arena == NULL || arena->block == NULL)
+		return 0;
+	return arena->block->base + arena->block->used;
+}
+
+void M_arena_reset_mark(M_arena_t *arena, size_t mark)
+{
+	M_arena_block_t *block;
+
+	if (arena == NULL)
+		return;
+
+	while (arena->block != NULL && arena->block->base > mark) {
+		block        = arena->block;
+		arena->block = block->prev;
+		M_arena_block_release(arena, block, M_TRUE);
+	}
+
+	block = arena->block;
+	if (block == NULL || mark >= block->base + block->used)
+		return;
+
+	M_mem_set(M_arena_block_data(block) + (mark - block->base), 0xFF, block->used - (mark - block->base));
+	block->used = mark - block->base;
+}
+
+void M_arena_reset(M_arena_t *arena)
+{
+	if (arena == NULL)
+		return;
+	M_arena_release_all(arena, M_TRUE);
+}
+
+size_t M_arena_used(const M_arena_t *arena)
+{
+	const M_arena_block_t *block;
+	size_t                 used = 0;
+
+	if (arena == NULL)
+		return 0;
+
+	for (block = arena->block; block != NULL; block = block->prev)
+		used += block->used;
+	return used;
+}
+
+size_t M_arena_capacity(const M_arena_t *arena)
+{
+	if (arena == NULL)
+		return 0;
+	return arena->capacity;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+M_bool M_arena_push(M_arena_t *arena)
+{
+#ifdef M_THREAD_LOCAL
+	if (arena == NULL || arena->pushed)
+		return M_FALSE;
+
+	arena->prev_active    = M_arena_thread_active;
+	arena->pushed         = M_TRUE;
+	M_arena_thread_active = arena;
+	return M_TRUE;
+#else
+	(void)arena;
+	return M_FALSE;
+#endif
+}
+
+M_arena_t *M_arena_pop(void)
+{
+#ifdef M_THREAD_LOCAL
+	M_arena_t *arena = M_arena_thread_active;
+
+	if (arena == NULL)
+		return NULL;
+
+	M_arena_unlink(arena);
+	return arena;
+#else
+	return NULL;
+#endif
+}
+
+M_arena_t *M_arena_active(void)
+{
+#ifdef M_THREAD_LOCAL
+	return M_arena_thread_active;
+#else
+	return NULL;
+#endif
+}
@@ -28,6 +28,7 @@
 
 #include <mstdlib/mstdlib.h>
 #include "m_defs_int.h"
+#include "mem/m_mem_int.h"
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
  * TODO:
@@ -137,14 +138,15 @@ void M_malloc_clear_errorcb(void)
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-void *M_malloc(size_t size)
+void *M_malloc_heap(size_t size)
 {
 	void   *ptr;
 	size_t  ecb_num = error_cbs_cnt;
 	M_bool  success = M_FALSE;
 
-	/* Prevent size + M_SAFE_ALIGNMENT exceeding maximum amount of memory */
-	if (size == 0 || size > SIZE_MAX - M_SAFE_ALIGNMENT)
+	/* Prevent size + M_SAFE_ALIGNMENT exceeding maximum amount of memory. The
+	 * high bits of the size are reserved for marking arena and pool memory. */
+	if (size == 0 || size > M_MEM_MAX_SIZE - M_SAFE_ALIGNMENT)
 		return NULL;
 
 	while (1) {
@@ -172,6 +174,15 @@ void *M_malloc(size_t size)
 	return ((char *)ptr) + M_SAFE_ALIGNMENT;
 }
 
+void *M_malloc(size_t size)
+{
+#ifdef M_THREAD_LOCAL
+	if (M_arena_thread_active != NULL)
+		return M_arena_alloc(M_arena_thread_active, size);
+#endif
+	return M_malloc_heap(size);
+}
+
 void *M_malloc_zero(size_t size)
 {
 	void *p;
@@ -208,6 +219,11 @@ static void *M_realloc_int(void *ptr, size_t size, M_bool zero)
 	/* Get the original size */
 	M_mem_copy(&orig_size, ((char *)ptr) - M_SAFE_ALIGNMENT, sizeof(orig_size));
 
+	/* Arena memory has to stay with the arena that owns it */
+	if (orig_size & M_MEM_ARENA_FLAG)
+		return M_arena_realloc_int(ptr, orig_size & ~M_MEM_FLAGS, size, zero);
+	orig_size &= ~M_MEM_FLAGS;
+
 	/* Copy all data to new memory address */
 	ret = M_memdup_max(ptr, orig_size, size);
 
@@ -284,12 +300,33 @@ void M_free(void *ptr)
 		abort();
 	}
 
+	/* Arena memory is released with the arena */
+	if (size & M_MEM_ARENA_FLAG)
+		return;
+
+	/* Pool memory goes back to the pool */
+	if (size & M_MEM_POOL_FLAG) {
+		M_mempool_release_int(ptr, size & ~M_MEM_FLAGS);
+		return;
+	}
+
 	/* Secure the user-data */
 	M_mem_secure_clear(actual_ptr, size + M_SAFE_ALIGNMENT);
 
 	free(actual_ptr);
 }
 
+M_bool M_mem_is_arena(const void *ptr)
+{
+	size_t size = 0;
+
+	if (ptr == NULL)
+		return M_FALSE;
+
+	M_mem_copy(&size, ((const char *)ptr) - M_SAFE_ALIGNMENT, sizeof(size));
+	return (size & M_MEM_ARENA_FLAG) ? M_TRUE : M_FALSE;
+}
+
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - */
 
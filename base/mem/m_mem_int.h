@@ -0,0 +1,58 @@
+/* The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Monetra Technologies, LLC.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __M_MEM_INT_H__
+#define __M_MEM_INT_H__
+
+#include <mstdlib/mstdlib.h>
+#include "m_defs_int.h"
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+/* The high bits of the size stored in front of M_malloc'd memory mark where the
+ * memory came from. Arena memory stores the owning arena directly after the size.
+ * Pool memory is returned to the calling thread's pool cache by M_free. */
+#define M_MEM_ARENA_FLAG (~(SIZE_MAX >> 1))
+#define M_MEM_POOL_FLAG  (~(SIZE_MAX >> 2) & (SIZE_MAX >> 1))
+#define M_MEM_FLAGS      (~(SIZE_MAX >> 2))
+
+/* Largest size that can be stored without colliding with the flags. */
+#define M_MEM_MAX_SIZE   (SIZE_MAX >> 2)
+
+/* Allocate from the system heap. Never uses an arena. */
+void *M_malloc_heap(size_t size);
+
+#ifdef M_THREAD_LOCAL
+extern M_THREAD_LOCAL M_arena_t *M_arena_thread_active;
+#endif
+
+/* Whether M_malloc'd memory came from an arena. */
+M_bool M_mem_is_arena(const void *ptr);
+
+/* Resize memory that was allocated from an arena. */
+void *M_arena_realloc_int(void *ptr, size_t orig_size, size_t size, M_bool zero);
+
+/* Return pool memory to the calling thread's cache. */
+void M_mempool_release_int(void *ptr, size_t size);
+
+#endif /* __M_MEM_INT_H__ */
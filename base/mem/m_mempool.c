@@ -0,0 +1,172 @@
+/* The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Monetra Technologies, LLC.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "m_config.h"
+
+#include <mstdlib/mstdlib.h>
+#include "m_defs_int.h"
+#include "mem/m_mem_int.h"
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+/* Size classes are multiples of the alignment M_malloc guarantees. */
+#define M_MEMPOOL_CLASS_SIZE   M_SAFE_ALIGNMENT
+#define M_MEMPOOL_NUM_CLASSES  ((M_MEMPOOL_MAX_SIZE + M_MEMPOOL_CLASS_SIZE - 1) / M_MEMPOOL_CLASS_SIZE)
+
+/* Number of free objects a thread can hold per class before a batch is returned. */
+#define M_MEMPOOL_MAX_CACHED   512
+#define M_MEMPOOL_TRIM_BATCH   (M_MEMPOOL_MAX_CACHED / 2)
+
+#ifdef M_THREAD_LOCAL
+
+typedef struct {
+	void              *head[M_MEMPOOL_NUM_CLASSES]; /*!< Free objects linked through their first bytes. */
+	size_t             cnt[M_MEMPOOL_NUM_CLASSES];
+	M_mempool_stats_t  stats;
+} M_mempool_cache_t;
+
+static M_THREAD_LOCAL M_mempool_cache_t M_mempool_cache;
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void M_mempool_set_size(void *ptr, size_t size)
+{
+	M_mem_copy(((char *)ptr) - M_SAFE_ALIGNMENT, &size, sizeof(size));
+}
+
+static void M_mempool_trim(M_mempool_cache_t *cache, size_t idx, size_t cnt)
+{
+	void *ptr;
+
+	while (cnt > 0 && cache->head[idx] != NULL) {
+		ptr = cache->head[idx];
+		M_mem_copy(&cache->head[idx], ptr, sizeof(ptr));
+		cache->cnt[idx]--;
+		cache->stats.resident_bytes -= (idx+1) * M_MEMPOOL_CLASS_SIZE;
+		cache->stats.released++;
+		cnt--;
+
+		/* Restore the header M_malloc_heap created so it goes back to the system. */
+		M_mempool_set_size(ptr, (idx+1) * M_MEMPOOL_CLASS_SIZE);
+		M_free(ptr);
+	}
+}
+
+#endif
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+void *M_mempool_malloc(size_t size)
+{
+#ifdef M_THREAD_LOCAL
+	M_mempool_cache_t *cache;
+	void              *ptr;
+	size_t             idx;
+
+	if (size == 0 || size > M_MEMPOOL_MAX_SIZE || M_arena_thread_active != NULL)
+		return M_malloc(size);
+
+	cache = &M_mempool_cache;
+	idx   = (size - 1) / M_MEMPOOL_CLASS_SIZE;
+	ptr   = cache->head[idx];
+	if (ptr != NULL) {
+		M_mem_copy(&cache->head[idx], ptr, sizeof(ptr));
+		cache->cnt[idx]--;
+		cache->stats.resident_bytes -= (idx+1) * M_MEMPOOL_CLASS_SIZE;
+		cache->stats.hits++;
+	} else {
+		/* Always allocate the full class so the object can be reused for any size in it. */
+		ptr = M_malloc_heap((idx+1) * M_MEMPOOL_CLASS_SIZE);
+		if (ptr == NULL)
+			return NULL;
+		cache->stats.misses++;
+	}
+
+	M_mempool_set_size(ptr, size | M_MEM_POOL_FLAG);
+	return ptr;
+#else
+	return M_malloc(size);
+#endif
+}
+
+void *M_mempool_malloc_zero(size_t size)
+{
+	void *ptr;
+
+	ptr = M_mempool_malloc(size);
+	if (ptr == NULL)
+		return NULL;
+
+	M_mem_set(ptr, 0, size);
+	return ptr;
+}
+
+void M_mempool_release_int(void *ptr, size_t size)
+{
+#ifdef M_THREAD_LOCAL
+	M_mempool_cache_t *cache = &M_mempool_cache;
+	size_t             idx   = (size - 1) / M_MEMPOOL_CLASS_SIZE;
+
+	/* Secure the user-data and mark the header the same way M_free does so a
+	 * double free is still detected. */
+	M_mem_set(ptr, 0xFF, size);
+	M_mempool_set_size(ptr, SIZE_MAX);
+
+	M_mem_copy(ptr, &cache->head[idx], sizeof(ptr));
+	cache->head[idx] = ptr;
+	cache->cnt[idx]++;
+	cache->stats.resident_bytes += (idx+1) * M_MEMPOOL_CLASS_SIZE;
+
+	if (cache->cnt[idx] > M_MEMPOOL_MAX_CACHED) {
+		M_mempool_trim(cache, idx, M_MEMPOOL_TRIM_BATCH);
+	}
+#else
+	(void)ptr;
+	(void)size;
+#endif
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+void M_mempool_thread_flush(void)
+{
+#ifdef M_THREAD_LOCAL
+	size_t i;
+
+	for (i=0; i<M_MEMPOOL_NUM_CLASSES; i++) {
+		M_mempool_trim(&M_mempool_cache, i, SIZE_MAX);
+	}
+#endif
+}
+
+void M_mempool_thread_stats(M_mempool_stats_t *stats)
+{
+	if (stats == NULL)
+		return;
+
+#ifdef M_THREAD_LOCAL
+	M_mem_copy(stats, &M_mempool_cache.stats, sizeof(*stats));
+#else
+	M_mem_set(stats, 0, sizeof(*stats));
+#endif
+}
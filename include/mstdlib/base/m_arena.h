@@ -0,0 +1,228 @@
+/* The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Monetra Technologies, LLC.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __M_ARENA_H__
+#define __M_ARENA_H__
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#include <mstdlib/base/m_defs.h>
+#include <mstdlib/base/m_types.h>
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+__BEGIN_DECLS
+
+/*! \addtogroup m_arena Arena
+ *  \ingroup mstdlib_base
+ *
+ * Region based memory allocation.
+ *
+ * An arena hands out memory by bumping a pointer through large blocks which are
+ * obtained from M_malloc. Individual allocations are never released, instead
+ * everything allocated from the arena is released at once by resetting or
+ * destroying the arena. This is useful when a large number of small allocations
+ * share a lifetime, such as a parsed document or the data associated with a
+ * single request.
+ *
+ * Marks can be used to record a position in the arena and later release
+ * everything allocated after that position.
+ *
+ * Arena memory is fully compatible with M_free and M_realloc. M_free does
+ * nothing with arena memory and M_realloc will allocate the new memory from the
+ * arena the original memory came from.
+ *
+ * Using objects with an arena
+ * ===========================
+ *
+ * An arena can be pushed onto the calling thread. While pushed, every
+ * allocation made by M_malloc (and everything built on it) on that thread is
+ * served by the arena. This allows any object, such as an M_buf_t, M_list_t,
+ * M_hashtable_t or M_json_node_t tree, to be built inside of an arena and
+ * released by resetting or destroying the arena without destroying the object
+ * itself.
+ *
+ * An object only lives entirely inside the arena if every allocation it makes
+ * happens while the arena is pushed. An object created in an arena must not be
+ * used after the arena has been reset past it or destroyed. Calling the
+ * object's destroy function is allowed but not necessary.
+ *
+ * Care must be taken not to call functions that create long lived data (such
+ * as global caches or objects shared with other threads) while an arena is
+ * pushed.
+ *
+ * Pushing an arena requires compiler support for thread local storage. When
+ * not available M_arena_push will fail and the arena can only be used directly
+ * with M_arena_alloc.
+ *
+ * An arena is not thread safe.
+ *
+ * Example:
+ *
+ * \code{.c}
+ *     M_arena_t     *arena;
+ *     M_json_node_t *json;
+ *
+ *     arena = M_arena_create(0);
+ *
+ *     M_arena_push(arena);
+ *     json = M_json_read(data, data_len, M_JSON_READER_NONE, NULL, NULL, NULL, NULL);
+ *     M_arena_pop();
+ *
+ *     ... use json ...
+ *
+ *     // Releases json and everything else allocated in the arena.
+ *     M_arena_destroy(arena);
+ * \endcode
+ *
+ * @{
+ */
+
+struct M_arena;
+typedef struct M_arena M_arena_t;
+
+
+/*! Create an arena.
+ *
+ * \param[in] block_size Size of each block of memory the arena will request. 0 to use
+ *                       the default of 64 KB. Allocations larger than the block
+ *                       size are given their own block.
+ *
+ * \return Arena.
+ */
+M_API M_arena_t *M_arena_create(size_t block_size) M_MALLOC;
+
+
+/*! Destroy an arena.
+ *
+ * All memory allocated from the arena is released. If the arena is the one
+ * currently pushed on the calling thread it will be popped.
+ *
+ * \param[in] arena Arena.
+ */
+M_API void M_arena_destroy(M_arena_t *arena) M_FREE(1);
+
+
+/*! Allocate memory from an arena.
+ *
+ * The memory is aligned the same as memory returned by M_malloc.
+ *
+ * \param[in] arena Arena.
+ * \param[in] size  Number of bytes to allocate.
+ *
+ * \return Memory, or NULL on error.
+ */
+M_API void *M_arena_alloc(M_arena_t *arena, size_t size) M_ALLOC_SIZE(2) M_WARN_UNUSED_RESULT M_MALLOC;
+
+
+/*! Get the current position in the arena.
+ *
+ * \param[in] arena Arena.
+ *
+ * \return Mark that can be passed to M_arena_reset_mark.
+ *
+ * \see M_arena_reset_mark
+ */
+M_API size_t M_arena_mark(const M_arena_t *arena);
+
+
+/*! Release all memory allocated after a mark was taken.
+ *
+ * Memory allocated before the mark was taken is not affected. Marks
+ * taken after this mark are no longer valid.
+ *
+ * \param[in] arena Arena.
+ * \param[in] mark  Mark from M_arena_mark.
+ *
+ * \see M_arena_mark
+ */
+M_API void M_arena_reset_mark(M_arena_t *arena, size_t mark);
+
+
+/*! Release all memory allocated from the arena.
+ *
+ * The arena can be used again after being reset. Blocks are retained
+ * for reuse.
+ *
+ * \param[in] arena Arena.
+ */
+M_API void M_arena_reset(M_arena_t *arena);
+
+
+/*! Number of bytes allocated from the arena.
+ *
+ * This includes per allocation overhead.
+ *
+ * \param[in] arena Arena.
+ *
+ * \return Bytes.
+ */
+M_API size_t M_arena_used(const M_arena_t *arena);
+
+
+/*! Number of bytes the arena has requested from the system.
+ *
+ * \param[in] arena Arena.
+ *
+ * \return Bytes.
+ */
+M_API size_t M_arena_capacity(const M_arena_t *arena);
+
+
+/*! Direct all allocations on the calling thread to an arena.
+ *
+ * Arenas can be nested. Pushing an arena while another is pushed will
+ * direct allocations to the new arena until it is popped.
+ *
+ * \param[in] arena Arena.
+ *
+ * \return M_TRUE on success. Otherwise M_FALSE if the arena is already pushed
+ *         or thread local storage is not supported.
+ *
+ * \see M_arena_pop
+ */
+M_API M_bool M_arena_push(M_arena_t *arena);
+
+
+/*! Stop directing allocations on the calling thread to the current arena.
+ *
+ * The previously pushed arena, if any, will become active again.
+ *
+ * \return The arena that was popped. NULL if no arena was pushed.
+ *
+ * \see M_arena_push
+ */
+M_API M_arena_t *M_arena_pop(void);
+
+
+/*! Get the arena currently pushed on the calling thread.
+ *
+ * \return Arena or NULL if no arena is pushed.
+ */
+M_API M_arena_t *M_arena_active(void);
+
+/*! @} */
+
+__END_DECLS
+
+#endif /* __M_ARENA_H__ */
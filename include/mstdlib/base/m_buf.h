@@ -100,6 +100,79 @@ enum M_BUF_TRANSFORM_TYPE {
 M_API M_buf_t *M_buf_create(void) M_WARN_UNUSED_RESULT M_MALLOC;
 
 
+/*! Memory M_buf_create_inline uses out of the caller's memory for bookkeeping.
+ *
+ * Add this to the amount of data the buffer should be able to hold without
+ * allocating when sizing the memory.
+ */
+#define M_BUF_INLINE_OVERHEAD 64
+
+
+/*! Create a buffer within caller provided memory.
+ *
+ * The buffer and its data are stored in the memory (typically a stack array)
+ * so nothing is allocated until the data outgrows it. At that point the data
+ * is moved to the heap and the buffer continues to work as normal.
+ *
+ * The buffer must still be released with M_buf_cancel or M_buf_finish. Neither
+ * will free the memory itself but they will free any heap memory the buffer
+ * spilled into. M_buf_finish always returns allocated memory.
+ *
+ * \code{.c}
+ *     unsigned char  mem[256 + M_BUF_INLINE_OVERHEAD];
+ *     M_buf_t       *buf;
+ *
+ *     buf = M_buf_create_inline(mem, sizeof(mem));
+ *     M_buf_add_str(buf, "...");
+ *     ...
+ *     M_buf_cancel(buf);
+ * \endcode
+ *
+ * \param[in] mem     Memory to use for the buffer. Must remain valid until the
+ *                    buffer is released.
+ * \param[in] mem_len Length of mem. If less than M_BUF_INLINE_OVERHEAD a heap
+ *                    buffer is created instead.
+ *
+ * \return Buffer.
+ *
+ * \see M_buf_cancel
+ * \see M_buf_finish
+ */
+M_API M_buf_t *M_buf_create_inline(void *mem, size_t mem_len) M_WARN_UNUSED_RESULT;
+
+
+/*! Create a buffer reusing one released by the calling thread.
+ *
+ * Pooled buffers are kept per thread. When a pooled buffer is released with
+ * M_buf_cancel it is reset and kept, along with its allocated data, for the
+ * next call on the same thread. M_buf_finish hands the data to the caller
+ * and keeps only the buffer itself. Very large allocations are not kept.
+ *
+ * Use this for short lived buffers that are created frequently, such as
+ * when formatting log lines or building queries.
+ *
+ * A pooled buffer can be released on any thread and will be kept by the
+ * thread that releases it.
+ *
+ * \return Buffer.
+ *
+ * \see M_buf_cancel
+ * \see M_buf_finish
+ * \see M_buf_pool_thread_flush
+ */
+M_API M_buf_t *M_buf_create_pooled(void) M_WARN_UNUSED_RESULT;
+
+
+/*! Free pooled buffers held by the calling thread.
+ *
+ * Threads created with M_thread_create call this automatically before
+ * exiting. Other threads that use M_buf_create_pooled must call this
+ * before exiting or the buffers are leaked. M_library_cleanup calls this
+ * for the calling thread.
+ */
+M_API void M_buf_pool_thread_flush(void);
+
+
 /*! Free a buffer, discarding its data.
  *
  * \param[in] buf Buffer.
@@ -162,6 +235,16 @@ M_API size_t M_buf_alloc_size(const M_buf_t *buf);
 M_API const char *M_buf_peek(const M_buf_t *buf);
 
 
+/*! Remove all data from the buffer.
+ *
+ * Allocated memory is kept so the buffer can be reused without
+ * allocating again.
+ *
+ * \param[in,out] buf Buffer.
+ */
+M_API void M_buf_reset(M_buf_t *buf);
+
+
 /*! Truncate the length of the data to the specified size.
  *
  * Removes data from the end of the buffer.
@@ -48,6 +48,19 @@ __BEGIN_DECLS
  *
  * Hot cache.
  *
+ * Entries are evicted least recently used first once the cache holds the maximum
+ * number of entries. Optionally entries can be given a weight (such as their size in
+ * bytes) and the cache limited by total weight. Entries can also be given a time to
+ * live after which they're treated as if they were never inserted.
+ *
+ * With M_CACHE_TINYLFU a frequency sketch of recently requested keys is kept. When the
+ * cache is full a new key is only admitted if it has been requested more often than the
+ * entry that would be evicted for it. This prevents keys that are only requested once
+ * from pushing popular entries out of the cache.
+ *
+ * A cache is not thread safe. See M_cache_concurrent_t in the thread library for a
+ * cache that can be shared between threads.
+ *
  * @{
  */
 
@@ -65,10 +78,22 @@ typedef void (*M_cache_free_func)(void *);
 
 /*! Flags for controlling the behavior of the hash */
 typedef enum {
-	M_CACHE_NONE = 0, /*!< Default. */
+	M_CACHE_NONE    = 0,      /*!< Default. */
+	M_CACHE_TINYLFU = 1 << 0  /*!< Use TinyLFU admission. New keys that are requested less often than
+	                               the entry they would replace are not stored. */
 } M_cache_flags_t;
 
 
+/*! Cache statistics. */
+typedef struct {
+	M_uint64 hits;        /*!< Lookups that found an entry. */
+	M_uint64 misses;      /*!< Lookups that didn't find an entry. */
+	M_uint64 evictions;   /*!< Entries removed to make room for others. */
+	M_uint64 expirations; /*!< Entries removed because their time to live passed. */
+	M_uint64 rejections;  /*!< Inserts that were not stored because of the admission policy or their weight. */
+} M_cache_stats_t;
+
+
 /*! Structure of callbacks that can be registered to override default
  *  behavior for implementation. */
 struct M_cache_callbacks {
@@ -91,7 +116,7 @@ struct M_cache_callbacks {
  *                         the pointer address as the key.
  * \param[in] key_equality The function to use to determine if two keys are equal.  If not 
  *                         specified, will compare pointer addresses.
- * \param[in] flags        M_hash_strvp_flags_t flags for modifying behavior.
+ * \param[in] flags        M_cache_flags_t flags for modifying behavior.
  * \param[in] callbacks    Register callbacks for overriding default behavior.
  *
  * \return Allocated cache.
@@ -124,6 +149,27 @@ M_API void M_cache_destroy(M_cache_t *c);
 M_API M_bool M_cache_insert(M_cache_t *c, const void *key, const void *value);
 
 
+/*! Insert an entry into the cache with a weight and time to live.
+ *
+ * If the entry is heavier than the maximum weight, or it's a new key that isn't
+ * admitted by M_CACHE_TINYLFU, it won't be stored. Any existing entry for the key
+ * is removed and the value is destroyed. This is not an error.
+ *
+ * \param[in] c      Cache being referenced.
+ * \param[in] key    Key to insert.
+ * \param[in] value  Value to insert into h.
+ *                   The c will take ownership of the value. Maybe NULL.
+ * \param[in] weight Weight of the entry. Only used when a maximum weight is set.
+ * \param[in] ttl_ms Milliseconds until the entry expires. 0 to use the default time to live.
+ *
+ * \return M_TRUE on success, or M_FALSE on failure.
+ *
+ * \see M_cache_set_max_weight
+ * \see M_cache_set_ttl
+ */
+M_API M_bool M_cache_insert_ext(M_cache_t *c, const void *key, const void *value, size_t weight, M_uint64 ttl_ms);
+
+
 /*! Remove an entry from the cache.
  *
  * \param[in] c   Cache being referenced.
@@ -144,6 +190,17 @@ M_API M_bool M_cache_remove(M_cache_t *c, const void *key);
  */
 M_API M_bool M_cache_get(const M_cache_t *c, const void *key, void **value);
 
+
+/*! Remove all expired entries.
+ *
+ * Expired entries are otherwise only removed when they're looked up or evicted.
+ *
+ * \param[in] c Cache being referenced.
+ *
+ * \return Number of entries removed.
+ */
+M_API size_t M_cache_expire(M_cache_t *c);
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 /*! Get the number of items in the cache.
@@ -177,6 +234,64 @@ M_API size_t M_cache_max_size(const M_cache_t *c);
  */
 M_API M_bool M_cache_set_max_size(M_cache_t *c, size_t max_size);
 
+
+/*! Get the total weight of the items in the cache.
+ *
+ * \param[in] c Cache being referenced.
+ *
+ * \return Weight.
+ */
+M_API size_t M_cache_weight(const M_cache_t *c);
+
+
+/*! Get the maximum total weight allowed in the cache.
+ *
+ * \param[in] c Cache being referenced.
+ *
+ * \return Max weight. 0 if the weight is not limited.
+ */
+M_API size_t M_cache_max_weight(const M_cache_t *c);
+
+
+/*! Set the maximum total weight allowed in the cache.
+ *
+ * Entries are evicted once either the maximum size or the maximum
+ * weight is reached.
+ *
+ * \param[in] c          Cache being referenced.
+ * \param[in] max_weight Maximum weight. 0 to not limit by weight.
+ *
+ * \return M_TRUE if the max weight was changed, otherwise M_FALSE on error.
+ */
+M_API M_bool M_cache_set_max_weight(M_cache_t *c, size_t max_weight);
+
+
+/*! Set the default time to live of entries.
+ *
+ * Only applies to entries inserted after it's set.
+ *
+ * \param[in] c      Cache being referenced.
+ * \param[in] ttl_ms Milliseconds until an entry expires. 0 for entries to never expire.
+ */
+M_API void M_cache_set_ttl(M_cache_t *c, M_uint64 ttl_ms);
+
+
+/*! Get the default time to live of entries.
+ *
+ * \param[in] c Cache being referenced.
+ *
+ * \return Milliseconds. 0 if entries don't expire.
+ */
+M_API M_uint64 M_cache_ttl(const M_cache_t *c);
+
+
+/*! Get statistics about the cache.
+ *
+ * \param[in]  c     Cache being referenced.
+ * \param[out] stats Statistics.
+ */
+M_API void M_cache_stats(const M_cache_t *c, M_cache_stats_t *stats);
+
 /*! @} */
 
 __END_DECLS
@@ -50,6 +50,7 @@ typedef struct M_cache_strvp M_cache_strvp_t;
 typedef enum {
 	M_CACHE_STRVP_NONE    = 0,      /*!< Default. */
 	M_CACHE_STRVP_CASECMP = 1 << 0, /*!< Compare keys case insensitive. */
+	M_CACHE_STRVP_TINYLFU = 1 << 1  /*!< Use TinyLFU admission. See M_CACHE_TINYLFU. */
 } M_cache_strvp_flags_t;
 
 
@@ -58,7 +59,7 @@ typedef enum {
 /*! Create a cache.
  *
  * \param[in] max_size     Maximum number of entries in the cache.
- * \param[in] flags        M_hash_strvp_flags_t flags for modifying behavior.
+ * \param[in] flags        M_cache_strvp_flags_t flags for modifying behavior.
  * \param[in] destroy_func The function to be called to destroy value when removed.
  *
  * \return Allocated cache.
@@ -89,6 +90,22 @@ M_API void M_cache_strvp_destroy(M_cache_strvp_t *c);
 M_API M_bool M_cache_strvp_insert(M_cache_strvp_t *c, const char *key, const void *value);
 
 
+/*! Insert an entry into the cache with a weight and time to live.
+ *
+ * \param[in] c      Cache being referenced.
+ * \param[in] key    Key to insert.
+ * \param[in] value  Value to insert into h.
+ *                   The c will take ownership of the value. Maybe NULL.
+ * \param[in] weight Weight of the entry. Only used when a maximum weight is set.
+ * \param[in] ttl_ms Milliseconds until the entry expires. 0 to use the default time to live.
+ *
+ * \return M_TRUE on success, or M_FALSE on failure.
+ *
+ * \see M_cache_insert_ext
+ */
+M_API M_bool M_cache_strvp_insert_ext(M_cache_strvp_t *c, const char *key, const void *value, size_t weight, M_uint64 ttl_ms);
+
+
 /*! Remove an entry from the cache.
  *
  * \param[in] c   Cache being referenced.
@@ -123,6 +140,15 @@ M_API M_bool M_cache_strvp_get(const M_cache_strvp_t *c, const char *key, void *
 M_API void *M_cache_strvp_get_direct(const M_cache_strvp_t *c, const char *key);
 
 
+/*! Remove all expired entries.
+ *
+ * \param[in] c Cache being referenced.
+ *
+ * \return Number of entries removed.
+ */
+M_API size_t M_cache_strvp_expire(M_cache_strvp_t *c);
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 /*! Get the number of items in the cache.
@@ -156,6 +182,59 @@ M_API size_t M_cache_strvp_max_size(const M_cache_strvp_t *c);
  */
 M_API M_bool M_cache_strvp_set_max_size(M_cache_strvp_t *c, size_t max_size);
 
+
+/*! Get the total weight of the items in the cache.
+ *
+ * \param[in] c Cache being referenced.
+ *
+ * \return Weight.
+ */
+M_API size_t M_cache_strvp_weight(const M_cache_strvp_t *c);
+
+
+/*! Get the maximum total weight allowed in the cache.
+ *
+ * \param[in] c Cache being referenced.
+ *
+ * \return Max weight. 0 if the weight is not limited.
+ */
+M_API size_t M_cache_strvp_max_weight(const M_cache_strvp_t *c);
+
+
+/*! Set the maximum total weight allowed in the cache.
+ *
+ * \param[in] c          Cache being referenced.
+ * \param[in] max_weight Maximum weight. 0 to not limit by weight.
+ *
+ * \return M_TRUE if the max weight was changed, otherwise M_FALSE on error.
+ */
+M_API M_bool M_cache_strvp_set_max_weight(M_cache_strvp_t *c, size_t max_weight);
+
+
+/*! Set the default time to live of entries.
+ *
+ * \param[in] c      Cache being referenced.
+ * \param[in] ttl_ms Milliseconds until an entry expires. 0 for entries to never expire.
+ */
+M_API void M_cache_strvp_set_ttl(M_cache_strvp_t *c, M_uint64 ttl_ms);
+
+
+/*! Get the default time to live of entries.
+ *
+ * \param[in] c Cache being referenced.
+ *
+ * \return Milliseconds. 0 if entries don't expire.
+ */
+M_API M_uint64 M_cache_strvp_ttl(const M_cache_strvp_t *c);
+
+
+/*! Get statistics about the cache.
+ *
+ * \param[in]  c     Cache being referenced.
+ * \param[out] stats Statistics.
+ */
+M_API void M_cache_strvp_stats(const M_cache_strvp_t *c, M_cache_stats_t *stats);
+
 /*! @} */
 
 __END_DECLS
@@ -0,0 +1,281 @@
+/* The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Monetra Technologies, LLC.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __M_CHAINBUF_H__
+#define __M_CHAINBUF_H__
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#include <mstdlib/base/m_defs.h>
+#include <mstdlib/base/m_types.h>
+#include <mstdlib/base/m_buf.h>
+#include <mstdlib/base/m_parser.h>
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+__BEGIN_DECLS
+
+/*! \addtogroup m_chainbuf Chained Buffer
+ *  \ingroup mstdlib_base
+ *
+ * Buffer made up of a chain of separately allocated chunks.
+ *
+ * Unlike M_buf_t the data is not stored in one continuous array. Appending data never
+ * moves or copies what is already in the buffer, and dropping data from the front only
+ * releases chunks that have been fully consumed. Existing memory, such as the contents of an
+ * M_buf_t or M_parser_t, can be added by reference without copying.
+ *
+ * This makes it well suited to streaming large amounts of data where M_buf_t would
+ * repeatedly grow and move its contents. The data can be handed to vectored I/O via
+ * M_chainbuf_iovec().
+ *
+ * Example:
+ *
+ * \code{.c}
+ *     M_chainbuf_t *cb;
+ *     M_buf_t      *buf;
+ *     M_iovec_t     iov[8];
+ *     size_t        cnt;
+ *
+ *     buf = M_buf_create();
+ *     M_buf_add_str(buf, "body");
+ *
+ *     cb = M_chainbuf_create(0);
+ *     M_chainbuf_add_str(cb, "header");
+ *     M_chainbuf_add_buf(cb, buf);
+ *
+ *     cnt = M_chainbuf_iovec(cb, iov, 8);
+ *     // Write iov entries.
+ *     M_chainbuf_drop(cb, M_chainbuf_len(cb));
+ *
+ *     M_chainbuf_destroy(cb);
+ * \endcode
+ *
+ * @{
+ */
+
+struct M_chainbuf;
+typedef struct M_chainbuf M_chainbuf_t;
+
+/*! A segment of data. */
+typedef struct {
+	const unsigned char *data; /*!< Start of the segment. */
+	size_t               len;  /*!< Length of the segment. */
+} M_iovec_t;
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+/*! Create a chained buffer.
+ *
+ * \param[in] chunk_size Size of chunks allocated for copied data. 0 to use the default (4 KB).
+ *
+ * \return Chained buffer.
+ *
+ * \see M_chainbuf_destroy
+ */
+M_API M_chainbuf_t *M_chainbuf_create(size_t chunk_size) M_MALLOC;
+
+
+/*! Destroy a chained buffer.
+ *
+ * Referenced data is released using the free function it was added with.
+ *
+ * \param[in] cb Chained buffer.
+ */
+M_API void M_chainbuf_destroy(M_chainbuf_t *cb) M_FREE(1);
+
+
+/*! Number of bytes in the buffer.
+ *
+ * \param[in] cb Chained buffer.
+ *
+ * \return Length.
+ */
+M_API size_t M_chainbuf_len(const M_chainbuf_t *cb);
+
+
+/*! Number of chunks making up the buffer.
+ *
+ * This is the number of entries needed to export the whole buffer with M_chainbuf_iovec().
+ *
+ * \param[in] cb Chained buffer.
+ *
+ * \return Count.
+ */
+M_API size_t M_chainbuf_num_chunks(const M_chainbuf_t *cb);
+
+
+/*! Copy data onto the end of the buffer.
+ *
+ * The data fills any space left in the last chunk. New chunks are added as needed.
+ *
+ * \param[in] cb    Chained buffer.
+ * \param[in] bytes Data to add.
+ * \param[in] len   Length of data.
+ */
+M_API void M_chainbuf_add_bytes(M_chainbuf_t *cb, const void *bytes, size_t len);
+
+
+/*! Copy a string onto the end of the buffer.
+ *
+ * \param[in] cb  Chained buffer.
+ * \param[in] str String to add.
+ */
+M_API void M_chainbuf_add_str(M_chainbuf_t *cb, const char *str);
+
+
+/*! Add data to the end of the buffer by reference.
+ *
+ * The data is not copied and must remain valid and unchanged until it has been dropped or
+ * the buffer is destroyed.
+ *
+ * \param[in] cb        Chained buffer.
+ * \param[in] bytes     Data to add.
+ * \param[in] len       Length of data.
+ * \param[in] free_func Called with bytes once the data is no longer needed. NULL if the
+ *                      caller manages the memory.
+ */
+M_API void M_chainbuf_add_bytes_ref(M_chainbuf_t *cb, const void *bytes, size_t len, void (*free_func)(void *));
+
+
+/*! Move the contents of a buffer to the end of the chained buffer.
+ *
+ * The data is not copied. The chained buffer takes ownership of the buffer's memory.
+ *
+ * \param[in] cb  Chained buffer.
+ * \param[in] buf Buffer to add. Will be destroyed.
+ */
+M_API void M_chainbuf_add_buf(M_chainbuf_t *cb, M_buf_t *buf) M_FREE(2);
+
+
+/*! Add the remaining data of a parser to the end of the buffer by reference.
+ *
+ * The parser is not modified. The parser must not be changed or destroyed until
+ * the data has been dropped or the buffer is destroyed.
+ *
+ * \param[in] cb     Chained buffer.
+ * \param[in] parser Parser.
+ */
+M_API void M_chainbuf_add_parser(M_chainbuf_t *cb, const M_parser_t *parser);
+
+
+/*! Move the contents of one chained buffer to the end of another.
+ *
+ * No data is copied.
+ *
+ * \param[in] dest   Chained buffer to add to.
+ * \param[in] source Chained buffer to move. Will be destroyed.
+ */
+M_API void M_chainbuf_merge(M_chainbuf_t *dest, M_chainbuf_t *source) M_FREE(2);
+
+
+/*! Begin a direct write operation.
+ *
+ * Returns writable space at the end of the buffer. A new chunk is added if the
+ * last one is full or can't be written to. Must be followed by
+ * M_chainbuf_direct_write_end().
+ *
+ * \param[in]  cb  Chained buffer.
+ * \param[out] len Number of bytes that can be written.
+ *
+ * \return Pointer to write to.
+ */
+M_API unsigned char *M_chainbuf_direct_write_start(M_chainbuf_t *cb, size_t *len);
+
+
+/*! End a direct write operation.
+ *
+ * \param[in] cb  Chained buffer.
+ * \param[in] len Number of bytes written.
+ */
+M_API void M_chainbuf_direct_write_end(M_chainbuf_t *cb, size_t len);
+
+
+/*! Export the data as a list of segments without copying.
+ *
+ * The segments remain valid until data is dropped or the buffer is modified.
+ *
+ * \param[in]  cb      Chained buffer.
+ * \param[out] iov     Array to fill.
+ * \param[in]  iov_cnt Number of entries in iov.
+ *
+ * \return Number of entries filled. Less than M_chainbuf_num_chunks() if iov is too small.
+ */
+M_API size_t M_chainbuf_iovec(const M_chainbuf_t *cb, M_iovec_t *iov, size_t iov_cnt);
+
+
+/*! Get the first continuous segment of data.
+ *
+ * \param[in]  cb  Chained buffer.
+ * \param[out] len Length of the segment.
+ *
+ * \return Start of the segment. NULL if the buffer is empty.
+ */
+M_API const unsigned char *M_chainbuf_peek(const M_chainbuf_t *cb, size_t *len);
+
+
+/*! Copy data out of the front of the buffer and drop it.
+ *
+ * \param[in]  cb  Chained buffer.
+ * \param[out] buf Buffer to copy into.
+ * \param[in]  len Size of buf.
+ *
+ * \return Number of bytes copied.
+ */
+M_API size_t M_chainbuf_read(M_chainbuf_t *cb, unsigned char *buf, size_t len);
+
+
+/*! Drop data from the front of the buffer.
+ *
+ * Chunks that have been fully consumed are released. No data is moved.
+ *
+ * \param[in] cb  Chained buffer.
+ * \param[in] num Number of bytes to drop.
+ */
+M_API void M_chainbuf_drop(M_chainbuf_t *cb, size_t num);
+
+
+/*! Copy the contents of the buffer onto the end of an M_buf_t.
+ *
+ * The chained buffer is not modified.
+ *
+ * \param[in] cb  Chained buffer.
+ * \param[in] buf Buffer to add to.
+ */
+M_API void M_chainbuf_to_buf(const M_chainbuf_t *cb, M_buf_t *buf);
+
+
+/*! Destroy the chained buffer, returning its contents as one continuous array.
+ *
+ * \param[in]  cb         Chained buffer.
+ * \param[out] out_length Length of the returned data. Optional.
+ *
+ * \return NULL terminated data. Must be freed with M_free().
+ */
+M_API unsigned char *M_chainbuf_finish(M_chainbuf_t *cb, size_t *out_length) M_FREE(1) M_WARN_UNUSED_RESULT M_MALLOC;
+
+/*! @} */
+
+__END_DECLS
+
+#endif /* __M_CHAINBUF_H__ */
@@ -1183,6 +1183,19 @@ M_API M_fs_error_t M_fs_file_seek(M_fs_file_t *fd, M_int64 offset, M_fs_file_see
 M_API M_fs_error_t M_fs_file_sync(M_fs_file_t *fd, M_uint32 type);
 
 
+/*! Get the OS file descriptor.
+ *
+ * Used to hand the file to OS functions such as sendfile(). Data buffered by
+ * M_fs_file_read() or M_fs_file_write() is not visible through the descriptor,
+ * use M_fs_file_sync() with M_FS_FILE_SYNC_BUFFER to write out pending data first.
+ *
+ * \param[in] fd The file object.
+ *
+ * \return File descriptor (a HANDLE on Windows), or -1 on error.
+ */
+M_API M_intptr M_fs_file_get_fd(const M_fs_file_t *fd);
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 /*! Read a file into a buffer as a str.
@@ -82,6 +82,10 @@ typedef enum {
 	                                           DO _NOT_ use this flag with any hashtable that could store user
 	                                           generated data! Be very careful about duplicating a hashtable that
 	                                           was created with this flag. All duplicates will use the static seed. */
+	M_HASH_DICT_OPEN_ADDRESSING = 1 << 12, /*!< Use open addressing instead of chaining. Hashes are cached so they
+	                                            are not recomputed when the table expands. See M_HASHTABLE_OPEN_ADDRESSING. */
+	M_HASH_DICT_INCREMENTAL_REHASH = 1 << 13, /*!< Expand the table a few buckets at a time instead of all at once.
+	                                               See M_HASHTABLE_INCREMENTAL_REHASH. */
 	M_HASH_DICT_DESER_TRIM_WHITESPACE = 1 << 26, /*!< During deserialization, trim whitespace. */
 } M_hash_dict_flags_t;
 
@@ -28,15 +28,39 @@
 
 #include <mstdlib/base/m_defs.h>
 #include <mstdlib/base/m_types.h>
+#include <mstdlib/base/m_hashtable.h>
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 __BEGIN_DECLS
 /*! \addtogroup m_hash_func Hashtable - Callback default implementations
  *  \ingroup m_hashtable
+ *
+ * Two hash algorithms are provided.
+ *
+ * - FNV1a processes one byte at a time. This is the default and is kept for
+ *   compatibility.
+ * - wyhash processes 8 bytes at a time and uses a dedicated integer mixer
+ *   for u64 and pointer keys. It is considerably faster for long keys.
+ *
+ * Both algorithms use the hashtable's random seed so collision attack protection
+ * is the same regardless of which is used.
+ *
+ * The typed hashtable wrappers (M_hash_strvp, M_hash_u64vp, M_hash_dict, ...) use the
+ * default algorithm at the time they are created. Changing the default does not
+ * affect hashtables that already exist. A M_hashtable can use any algorithm by passing
+ * the hash function to M_hashtable_create.
+ *
  * @{
  */
 
+/*! Hash algorithms. */
+typedef enum {
+	M_HASH_FUNC_TYPE_FNV1A  = 0, /*!< FNV1a. */
+	M_HASH_FUNC_TYPE_WYHASH      /*!< wyhash. */
+} M_hash_func_type_t;
+
+
 /*! Implementation will compute a hash using FNV1a from a string. */
 M_API M_uint32 M_hash_func_hash_str(const void *key, M_uint32 seed);
 
@@ -49,6 +73,86 @@ M_API M_uint32 M_hash_func_hash_u64(const void *key, M_uint32 seed);
 /*! Implemntation will compute a hash using FNV1a from a pointer address */
 M_API M_uint32 M_hash_func_hash_vp(const void *key, M_uint32 seed);
 
+/*! Implementation will compute a hash using wyhash from a string. */
+M_API M_uint32 M_hash_func_hash_str_wyhash(const void *key, M_uint32 seed);
+
+/*! Implementation will compute a hash using wyhash from a string in a case-insensitive manner. */
+M_API M_uint32 M_hash_func_hash_str_casecmp_wyhash(const void *key, M_uint32 seed);
+
+/*! Implementation will compute a hash using the wyhash integer mixer from a u64 (pointer). */
+M_API M_uint32 M_hash_func_hash_u64_wyhash(const void *key, M_uint32 seed);
+
+/*! Implementation will compute a hash using the wyhash integer mixer from a pointer address. */
+M_API M_uint32 M_hash_func_hash_vp_wyhash(const void *key, M_uint32 seed);
+
+
+/*! Hash multiple keys in one call.
+ *
+ * Equivalent to calling key_hash for each key. When key_hash is one of the
+ * fixed size wyhash functions the integer mixer is called directly instead of
+ * through the function pointer.
+ *
+ * \param[in]  key_hash Hash function.
+ * \param[in]  keys     Keys to hash.
+ * \param[in]  num_keys Number of keys.
+ * \param[in]  seed     Seed.
+ * \param[out] hashes   Array of at least num_keys elements that will be filled with the hash of each key.
+ */
+M_API void M_hash_func_hash_bulk(M_hashtable_hash_func key_hash, const void * const *keys, size_t num_keys, M_uint32 seed, M_uint32 *hashes);
+
+
+/*! Hash an array of u64 keys using the wyhash integer mixer.
+ *
+ * Produces the same hashes as M_hash_func_hash_u64_wyhash.
+ *
+ * \param[in]  keys     Keys to hash.
+ * \param[in]  num_keys Number of keys.
+ * \param[in]  seed     Seed.
+ * \param[out] hashes   Array of at least num_keys elements that will be filled with the hash of each key.
+ */
+M_API void M_hash_func_hash_u64_bulk_wyhash(const M_uint64 *keys, size_t num_keys, M_uint32 seed, M_uint32 *hashes);
+
+
+/*! Set the default hash algorithm used by typed hashtables.
+ *
+ * Only affects hashtables created after this is called. This is not thread safe
+ * and should be called at application start before any hashtables are created.
+ *
+ * \param[in] type Algorithm.
+ */
+M_API void M_hash_func_set_default_type(M_hash_func_type_t type);
+
+
+/*! Get the default hash algorithm used by typed hashtables.
+ *
+ * \return Algorithm.
+ */
+M_API M_hash_func_type_t M_hash_func_get_default_type(void);
+
+
+/*! String hash function for the default algorithm.
+ *
+ * \param[in] casecmp Whether the hash should be case-insensitive.
+ *
+ * \return Hash function.
+ */
+M_API M_hashtable_hash_func M_hash_func_default_str(M_bool casecmp);
+
+
+/*! u64 (pointer) hash function for the default algorithm.
+ *
+ * \return Hash function.
+ */
+M_API M_hashtable_hash_func M_hash_func_default_u64(void);
+
+
+/*! Pointer address hash function for the default algorithm.
+ *
+ * \return Hash function.
+ */
+M_API M_hashtable_hash_func M_hash_func_default_vp(void);
+
+
 /*! This function duplicates a M_uint64 (pointer). */
 M_API void *M_hash_func_u64dup(const void *arg);
 
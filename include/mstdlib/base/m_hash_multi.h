@@ -49,8 +49,11 @@ typedef struct M_hash_multi M_hash_multi_t;
 
 /*! Flags for controlling the behavior of the hash_multi. */
 typedef enum {
-	M_HASH_MULTI_NONE        = 0,     /*!< String key compare is case sensitive. */
-	M_HASH_MULTI_STR_CASECMP = 1 << 0 /*!< String key compare is case insensitive. */
+	M_HASH_MULTI_NONE            = 0,      /*!< String key compare is case sensitive. */
+	M_HASH_MULTI_STR_CASECMP     = 1 << 0, /*!< String key compare is case insensitive. */
+	M_HASH_MULTI_OPEN_ADDRESSING = 1 << 1, /*!< Use open addressing instead of chaining. See M_HASHTABLE_OPEN_ADDRESSING. */
+	M_HASH_MULTI_INCREMENTAL_REHASH = 1 << 2 /*!< Expand the table a few buckets at a time instead of all at once.
+	                                              See M_HASHTABLE_INCREMENTAL_REHASH. */
 } M_hash_multi_flags_t;
 
 
@@ -73,13 +73,17 @@ typedef enum {
 	                                          Sorted in insertion order another sorting is specified. */
 	M_HASH_STRVP_MULTI_GETLAST = 1 << 7, /*!< When using get and get_direct function get the last value from the list
 	                                          when allowing multiple values. The default is to get the first value. */
-	M_HASH_STRVP_STATIC_SEED   = 1 << 8  /*!< Use a static seed for hash function initialization. This greatly reduces
+	M_HASH_STRVP_STATIC_SEED   = 1 << 8, /*!< Use a static seed for hash function initialization. This greatly reduces
 	                                           the security of the hashtable and removes collision attack protections.
 	                                           This should only be used as a performance optimization when creating
 	                                           millions of hashtables with static data specifically for quick look up.
 	                                           DO _NOT_ use this flag with any hashtable that could store user
 	                                           generated data! Be very careful about duplicating a hashtable that
 	                                           was created with this flag. All duplicates will use the static seed. */
+	M_HASH_STRVP_OPEN_ADDRESSING = 1 << 9, /*!< Use open addressing instead of chaining. Hashes are cached so they
+	                                            are not recomputed when the table expands. See M_HASHTABLE_OPEN_ADDRESSING. */
+	M_HASH_STRVP_INCREMENTAL_REHASH = 1 << 10 /*!< Expand the table a few buckets at a time instead of all at once.
+	                                             See M_HASHTABLE_INCREMENTAL_REHASH. */
 } M_hash_strvp_flags_t;
 
 
@@ -147,6 +151,33 @@ M_API M_bool M_hash_strvp_insert(M_hash_strvp_t *h, const char *key, void *value
 M_API M_bool M_hash_strvp_remove(M_hash_strvp_t *h, const char *key, M_bool destroy_vals);
 
 
+/*! Insert multiple entries into the hashtable.
+ *
+ * The hashtable is grown at most once to hold the new entries.
+ *
+ * \param[in,out] h        Hashtable being referenced.
+ * \param[in]     keys     Keys to insert. NULL and empty keys are skipped.
+ * \param[in]     values   Value to insert for each key. The hashtable will take ownership
+ *                         of the values. Optional, pass NULL to insert NULL values.
+ * \param[in]     num_keys Number of keys.
+ *
+ * \return Number of keys inserted.
+ */
+M_API size_t M_hash_strvp_insert_many(M_hash_strvp_t *h, const char * const *keys, void * const *values, size_t num_keys);
+
+
+/*! Remove multiple entries from the hashtable.
+ *
+ * \param[in,out] h            Hashtable being referenced.
+ * \param[in]     keys         Keys to remove. NULL keys are skipped.
+ * \param[in]     num_keys     Number of keys.
+ * \param[in]     destroy_vals M_TRUE if the values held by the hashtable should be destroyed.
+ *
+ * \return Number of keys removed.
+ */
+M_API size_t M_hash_strvp_remove_many(M_hash_strvp_t *h, const char * const *keys, size_t num_keys, M_bool destroy_vals);
+
+
 /*! Retrieve the value for a key from the hashtable. 
  *
  * \param[in] h      Hashtable being referenced.
@@ -172,6 +203,23 @@ M_API M_bool M_hash_strvp_get(const M_hash_strvp_t *h, const char *key, void **v
 M_API void *M_hash_strvp_get_direct(const M_hash_strvp_t *h, const char *key);
 
 
+/*! Retrieve the values for multiple keys from the hashtable.
+ *
+ * Faster than looking up each key individually when looking up many keys.
+ *
+ * \param[in]  h        Hashtable being referenced.
+ * \param[in]  keys     Keys to look up.
+ * \param[in]  num_keys Number of keys.
+ * \param[out] values   Array of num_keys to store the value for each key in. NULL is stored
+ *                      for keys that do not exist. Optional, pass NULL if not needed.
+ * \param[out] found    Array of num_keys to store if each key exists. Optional, pass NULL
+ *                      if not needed.
+ *
+ * \return Number of keys that exist.
+ */
+M_API size_t M_hash_strvp_get_many(const M_hash_strvp_t *h, const char * const *keys, size_t num_keys, void **values, M_bool *found);
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 /*! Wether the hashtable a multi value table.
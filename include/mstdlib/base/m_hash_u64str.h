@@ -70,13 +70,17 @@ typedef enum {
 	M_HASH_U64STR_MULTI_GETLAST  = 1 << 6, /*!< When using get and get_direct function get the last value from the list
 	                                            when allowing multiple values. The default is to get the first value. */
 	M_HASH_U64STR_MULTI_CASECMP  = 1 << 7, /*!< Value compare is case insensitive. */
-	M_HASH_U64STR_STATIC_SEED    = 1 << 8  /*!< Use a static seed for hash function initialization. This greatly reduces
+	M_HASH_U64STR_STATIC_SEED    = 1 << 8, /*!< Use a static seed for hash function initialization. This greatly reduces
 	                                           the security of the hashtable and removes collision attack protections.
 	                                           This should only be used as a performance optimization when creating
 	                                           millions of hashtables with static data specifically for quick look up.
 	                                           DO _NOT_ use this flag with any hashtable that could store user
 	                                           generated data! Be very careful about duplicating a hashtable that
 	                                           was created with this flag. All duplicates will use the static seed. */
+	M_HASH_U64STR_OPEN_ADDRESSING = 1 << 9, /*!< Use open addressing instead of chaining. Hashes are cached so they
+	                                             are not recomputed when the table expands. See M_HASHTABLE_OPEN_ADDRESSING. */
+	M_HASH_U64STR_INCREMENTAL_REHASH = 1 << 10 /*!< Expand the table a few buckets at a time instead of all at once.
+	                                              See M_HASHTABLE_INCREMENTAL_REHASH. */
 } M_hash_u64str_flags_t;
 
 
@@ -102,6 +102,11 @@ __BEGIN_DECLS
  *
  * In our variation care has been taken to ensure the bias is never 0.
  *
+ * wyhash is also available (see M_hash_func_set_default_type). It reads
+ * 8 bytes at a time and uses a dedicated integer mixer for u64 and pointer keys
+ * which makes it considerably faster than FNV1a for longer keys. It uses the same
+ * random per hashtable seed as FNV1a. FNV1a remains the default for compatibility.
+ *
  * The random seed is created using M_rand. While M_rand is not a secure random
  * number generator the random seed for M_rand is created from unlikely to be known
  * data such as stack and heap memory addresses at the time the hashtable is created.
@@ -205,13 +210,26 @@ typedef enum {
 	M_HASHTABLE_MULTI_SORTED  = 1 << 3, /*!< Allow keys to contain multiple values sorted in ascending order */
 	M_HASHTABLE_MULTI_GETLAST = 1 << 4, /*!< When using the get function will get the last value from the list
 	                                         when allowing multiple values. The default is to get the first value. */
-	M_HASHTABLE_STATIC_SEED   = 1 << 5  /*!< Use a static seed for hash function initialization. This greatly reduces
+	M_HASHTABLE_STATIC_SEED   = 1 << 5, /*!< Use a static seed for hash function initialization. This greatly reduces
 	                                         the security of the hashtable and removes collision attack protections.
 	                                         This should only be used as a performance optimization when creating
 	                                         millions of hashtables with static data specifically for quick look up.
 	                                         DO _NOT_ use this flag with any hashtable that could store user
 	                                         generated data! Be very careful about duplicating a hashtable that
 	                                         was created with this flag. All duplicates will use the static seed. */
+	M_HASHTABLE_OPEN_ADDRESSING = 1 << 6, /*!< Use open addressing (Robin Hood hashing) instead of chaining. Hashes are
+	                                           cached per slot so they never need to be recomputed when the table
+	                                           expands and a lookup only compares keys whose hashes match. Collisions
+	                                           never allocate memory. The table will always expand before it becomes
+	                                           full regardless of the fill percentage. Once it can no longer expand
+	                                           inserting new keys will fail. A fill percentage of 90 or lower
+	                                           is recommended. */
+	M_HASHTABLE_INCREMENTAL_REHASH = 1 << 7 /*!< Spread the cost of expanding across subsequent operations instead of
+	                                             rehashing every entry at once. When the table expands the old bucket
+	                                             list is kept and a few buckets are moved into the new one on each
+	                                             insert or remove. Lookups check both lists until the move completes.
+	                                             This bounds the worst case latency of a single insert. Ignored when
+	                                             open addressing is used. */
 } M_hashtable_flags_t;
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
@@ -219,7 +237,8 @@ typedef enum {
 /*! Create a new h.
  *
  * The h will pre-allocate an array of buckets based on the rounded up size specified. Any hash collisions
- * will result in those collisions being chained together via a linked list. The h will auto-expand by a
+ * will result in those collisions being chained together via a linked list unless M_HASHTABLE_OPEN_ADDRESSING
+ * is used, in which case the colliding entry is stored in a nearby slot instead. The h will auto-expand by a
  * power of 2 when the fill percentage specified is reached. All key entries are compared in a case-insensitive
  * fashion, and are duplicated internally. Values are duplicated. Case is preserved for both keys and values.
  *
@@ -289,6 +308,52 @@ M_API M_bool M_hashtable_remove(M_hashtable_t *h, const void *key, M_bool destro
  */
 M_API M_bool M_hashtable_get(const M_hashtable_t *h, const void *key, void **value);
 
+
+/*! Insert multiple entries into the h.
+ *
+ * All keys are hashed up front and the h is grown at most once to hold the
+ * new entries. Equivalent to calling M_hashtable_insert for each key in order.
+ *
+ * \param[in] h        Hashtable being referenced.
+ * \param[in] keys     Keys to insert. NULL keys are skipped.
+ * \param[in] values   Value to insert for each key. Optional, pass NULL to insert NULL values.
+ * \param[in] num_keys Number of keys.
+ *
+ * \return Number of keys inserted.
+ */
+M_API size_t M_hashtable_insert_many(M_hashtable_t *h, const void * const *keys, const void * const *values, size_t num_keys);
+
+
+/*! Remove multiple entries from the h.
+ *
+ * \param[in] h            Hashtable being referenced.
+ * \param[in] keys         Keys to remove. NULL keys are skipped.
+ * \param[in] num_keys     Number of keys.
+ * \param[in] destroy_vals M_TRUE if the values held by the h should be destroyed.
+ *
+ * \return Number of keys removed.
+ */
+M_API size_t M_hashtable_remove_many(M_hashtable_t *h, const void * const *keys, size_t num_keys, M_bool destroy_vals);
+
+
+/*! Retrieve the values for multiple keys from the h.
+ *
+ * Keys are hashed in batches and the memory they reference is prefetched before
+ * being looked at. This hides memory latency when looking up many keys in a
+ * large h.
+ *
+ * \param[in]  h        Hashtable being referenced.
+ * \param[in]  keys     Keys to look up.
+ * \param[in]  num_keys Number of keys.
+ * \param[out] values   Array of num_keys to store the value for each key in. NULL is stored
+ *                      for keys that do not exist. Optional, pass NULL if not needed.
+ * \param[out] found    Array of num_keys to store if each key exists. Optional, pass NULL
+ *                      if not needed.
+ *
+ * \return Number of keys that exist.
+ */
+M_API size_t M_hashtable_get_many(const M_hashtable_t *h, const void * const *keys, size_t num_keys, void **values, M_bool *found);
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 /*! Wether the hashtable a multi value table.
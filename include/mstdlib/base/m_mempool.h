@@ -0,0 +1,118 @@
+/* The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Monetra Technologies, LLC.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __M_MEMPOOL_H__
+#define __M_MEMPOOL_H__
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#include <mstdlib/base/m_defs.h>
+#include <mstdlib/base/m_types.h>
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+__BEGIN_DECLS
+
+/*! \addtogroup m_mempool Memory Pool
+ *  \ingroup mstdlib_base
+ *
+ * Per thread size class memory pool for small fixed size objects.
+ *
+ * Small objects that are frequently allocated and released, such as list
+ * nodes and hashtable entries, can be allocated from the pool. Released
+ * objects are kept in a free list owned by the thread that released them and
+ * are handed out again by the next pool allocation of the same size class on
+ * that thread. Neither operation takes a lock so pool allocations do not
+ * contend with other threads.
+ *
+ * Memory from the pool is released with M_free like any other memory and
+ * can be passed to M_realloc. An object can be released on a different
+ * thread than the one that allocated it, the object joins the releasing
+ * thread's free list. When a thread holds too many free objects of a size
+ * class a batch of them is returned to the system.
+ *
+ * Objects larger than M_MEMPOOL_MAX_SIZE are allocated with M_malloc. When an
+ * arena is pushed on the calling thread pool allocations are made from the
+ * arena.
+ *
+ * Threads created with M_thread_create release their free lists when they exit.
+ * Other threads must call M_mempool_thread_flush before exiting, otherwise the
+ * objects they hold (up to 512 per size class) are leaked. M_library_cleanup
+ * does this for the thread that calls it, usually the main thread.
+ *
+ * The pool requires compiler support for thread local storage. When not available
+ * all pool allocations are made with M_malloc.
+ *
+ * @{
+ */
+
+/*! Largest object size serviced by the pool. */
+#define M_MEMPOOL_MAX_SIZE 256
+
+
+/*! Pool statistics for a thread. */
+typedef struct {
+	M_uint64 hits;           /*!< Allocations served from the free lists. */
+	M_uint64 misses;         /*!< Allocations that had to be made from the system. */
+	M_uint64 released;       /*!< Objects returned to the system. */
+	size_t   resident_bytes; /*!< Bytes currently held in the free lists. */
+} M_mempool_stats_t;
+
+
+/*! Allocate memory from the pool.
+ *
+ * \param[in] size Number of bytes to allocate.
+ *
+ * \return Memory, or NULL on error. Release with M_free.
+ */
+M_API void *M_mempool_malloc(size_t size) M_ALLOC_SIZE(1) M_WARN_UNUSED_RESULT M_MALLOC;
+
+
+/*! Allocate zeroed memory from the pool.
+ *
+ * \param[in] size Number of bytes to allocate.
+ *
+ * \return Memory, or NULL on error. Release with M_free.
+ */
+M_API void *M_mempool_malloc_zero(size_t size) M_ALLOC_SIZE(1) M_WARN_UNUSED_RESULT M_MALLOC;
+
+
+/*! Return all objects held in the calling thread's free lists to the system.
+ *
+ * Call before a thread that has released pool memory exits unless it was created
+ * with M_thread_create. M_library_cleanup calls this for the calling thread.
+ */
+M_API void M_mempool_thread_flush(void);
+
+
+/*! Get the pool statistics of the calling thread.
+ *
+ * \param[out] stats Statistics.
+ */
+M_API void M_mempool_thread_stats(M_mempool_stats_t *stats);
+
+/*! @} */
+
+__END_DECLS
+
+#endif /* __M_MEMPOOL_H__ */
@@ -235,7 +235,7 @@ enum M_EVENT_FLAGS {
                                                      *   need to use it without your knowledge. */
 	M_EVENT_FLAG_EXITONEMPTY          = 1 << 1, /*!< Exit the event loop when there are no registered events */
 	M_EVENT_FLAG_EXITONEMPTY_NOTIMERS = 1 << 2, /*!< When combined with M_EVENT_FLAG_EXITONEMPTY, will ignore timers */
-	M_EVENT_FLAG_NON_SCALABLE         = 1 << 3  /*!< Utilize the 'non-scalable/small' event subsystem, generally
+	M_EVENT_FLAG_NON_SCALABLE         = 1 << 3, /*!< Utilize the 'non-scalable/small' event subsystem, generally
 	                                             *   implemented using poll() instead of the more scalable solution
 	                                             *   using kqueue() or epoll().  The main reason one might want to use
 	                                             *   this is if a large number of event loops are being created such
@@ -244,6 +244,21 @@ enum M_EVENT_FLAGS {
 	                                             *   desirable.  Not all systems have different subsystems, in which
 	                                             *   case this flag will be ignored.
 	                                             */
+	M_EVENT_FLAG_TIMER_WHEEL          = 1 << 4, /*!< Keep timers in a hierarchical timer wheel from the start rather
+	                                             *   than a sorted queue. Starting, stopping and resetting a timer is
+	                                             *   constant time. Event loops switch to the wheel automatically
+	                                             *   once a large number of timers exist, this flag is for loops
+	                                             *   known to have many short lived or frequently reset timers. */
+	M_EVENT_FLAG_IO_URING             = 1 << 5, /*!< Use io_uring for readiness notifications on Linux. Handle
+	                                             *   registrations are batched and submitted together with the wait
+	                                             *   so each loop iteration is a single system call. Falls back to
+	                                             *   epoll if the kernel lacks support (5.13 or newer is required).
+	                                             *   Ignored on other systems and with M_EVENT_FLAG_NON_SCALABLE. */
+	M_EVENT_FLAG_BUSY_POLL            = 1 << 6  /*!< Latency sensitive mode. Before blocking for events the loop
+	                                             *   polls without blocking for a short period (see
+	                                             *   M_event_set_busy_poll(), default 50 microseconds), and sockets
+	                                             *   added get SO_BUSY_POLL where permitted. Trades CPU time for
+	                                             *   fewer context switches. Currently only used with epoll. */
 };
 
 /*! Possible values to pass to M_event_get_statistic() */
@@ -252,7 +267,9 @@ typedef enum {
 	M_EVENT_STATISTIC_OSEVENT_COUNT,    /*!< Get the number of OS-delivered events */
 	M_EVENT_STATISTIC_SOFTEVENT_COUNT,  /*!< Get the number of soft-events delivered */
 	M_EVENT_STATISTIC_TIMER_COUNT,      /*!< Get the number of timer (or queued) events delivered */
-	M_EVENT_STATISTIC_PROCESS_TIME_MS   /*!< Get the about of non-idle time spent by the event loop in ms */
+	M_EVENT_STATISTIC_PROCESS_TIME_MS,  /*!< Get the about of non-idle time spent by the event loop in ms */
+	M_EVENT_STATISTIC_LOAD_US           /*!< Get the recent non-idle time spent by the event loop in microseconds,
+	                                     *   decaying by half every second */
 } M_event_statistic_t;
 
 
@@ -299,6 +316,38 @@ M_API M_event_t *M_event_create(M_uint32 flags);
 M_API M_event_t *M_event_pool_create(size_t max_threads);
 
 
+/*! How event pool threads are bound to processors. */
+typedef enum {
+	M_EVENT_POOL_PLACEMENT_CORE    = 0, /*!< One loop per processor in processor order. Default used by
+	                                     *   M_event_pool_create(). */
+	M_EVENT_POOL_PLACEMENT_NONE,        /*!< Don't bind loop threads to processors. */
+	M_EVENT_POOL_PLACEMENT_COMPACT,     /*!< Keep loops on as few NUMA nodes and sockets as possible, using
+	                                     *   distinct physical cores before SMT siblings. Best when loops
+	                                     *   share data. */
+	M_EVENT_POOL_PLACEMENT_SCATTER      /*!< Spread loops round robin across NUMA nodes and sockets. Best for
+	                                     *   independent loops needing memory bandwidth. */
+} M_event_pool_placement_t;
+
+
+/*! Create a pool of event loops with control over which processors they run on.
+ *
+ *  See M_event_pool_create() for how pools are used. Only processors usable by the process
+ *  are considered so a cgroup cpuset or affinity mask set by the caller is respected. Each
+ *  loop is allocated separately on its own cache lines so loops on different processors
+ *  don't contend. Memory is not placed on any particular NUMA node.
+ *
+ *  \param[in] max_threads    Maximum number of threads, 0 for one per usable processor.
+ *  \param[in] placement      How threads are bound to processors.
+ *  \param[in] processors     Optional list of processor ids (0 to M_thread_num_cpu_cores()-1)
+ *                            to limit the pool to. NULL to use all usable processors.
+ *  \param[in] num_processors Number of entries in processors.
+ *
+ *  \return Initialized event pool, or in the case only a single thread would be used,
+ *          a normal event object.
+ */
+M_API M_event_t *M_event_pool_create_placement(size_t max_threads, M_event_pool_placement_t placement, const int *processors, size_t num_processors);
+
+
 /*! Retrieve the distributed pool handle for balancing the load across an event pool, or
  *  self if not part of a pool.
  *
@@ -317,6 +366,79 @@ M_API M_event_t *M_event_pool_create(size_t max_threads);
 M_API M_event_t *M_event_get_pool(M_event_t *event);
 
 
+/*! How an event pool chooses the thread for objects added to it. */
+typedef enum {
+	M_EVENT_DISTRIBUTE_PROCESS_TIME = 0, /*!< Thread with the least total processing time since the pool was
+	                                      *   created, ties broken by fewest objects. Default. */
+	M_EVENT_DISTRIBUTE_ROUND_ROBIN,      /*!< Each thread in turn. */
+	M_EVENT_DISTRIBUTE_LEAST_OBJECTS,    /*!< Thread with the fewest registered objects. */
+	M_EVENT_DISTRIBUTE_LOAD              /*!< Thread with the least recent processing time. Load decays by half
+	                                      *   every second so a thread that was busy in the past isn't
+	                                      *   penalized forever. */
+} M_event_distribute_t;
+
+
+/*! Set how an event pool distributes objects added to it across its threads.
+ *
+ *  Only affects objects added after the call, use M_event_migrate() to move existing ones.
+ *
+ *  \param[in] event Event pool.
+ *  \param[in] type  Distribution policy.
+ *
+ *  \return M_TRUE on success, M_FALSE if event is not a pool.
+ */
+M_API M_bool M_event_pool_set_distribution(M_event_t *event, M_event_distribute_t type);
+
+
+/*! Get the event loop within a pool for an affinity key.
+ *
+ *  The same key always maps to the same thread so related objects (for example all
+ *  connections for one client) can be kept together. Pass the result to M_event_add()
+ *  instead of the pool.
+ *
+ *  \param[in] event Event pool, or event loop.
+ *  \param[in] key   Caller chosen affinity key.
+ *
+ *  \return Event loop within the pool, or event itself if not a pool.
+ */
+M_API M_event_t *M_event_pool_get_loop(M_event_t *event, M_uint64 key);
+
+
+/*! Move an idle io object to a different event loop.
+ *
+ *  The io object keeps its callback and callback data and is registered with the new
+ *  event loop as if it had been passed to M_event_add(), except no duplicate
+ *  M_EVENT_TYPE_CONNECTED event is delivered. Nothing is lost from the OS as pending
+ *  readiness is reported by the new loop once registered.
+ *
+ *  The io object must be idle: connected (or listening) with no events waiting to be
+ *  delivered. Call from the io object's callback, or ensure the io object is otherwise
+ *  not in use while migrating.
+ *
+ *  \param[in] io    io object to move.
+ *  \param[in] event Event loop to move to. If a pool, the pool's distribution policy
+ *                   chooses the thread.
+ *
+ *  \return M_TRUE if moved (or already on the requested loop). M_FALSE if the io object
+ *          is not registered, not idle, or could not be registered with the new loop in
+ *          which case it is no longer associated with any event loop.
+ */
+M_API M_bool M_event_migrate(M_io_t *io, M_event_t *event);
+
+
+/*! Set how long the event loop spins polling for events before blocking.
+ *
+ *  Enables or disables busy polling (M_EVENT_FLAG_BUSY_POLL) on an existing event loop, or
+ *  on every loop in an event pool. The SO_BUSY_POLL socket option is only applied to sockets
+ *  added after busy polling is enabled.
+ *
+ *  \param[in] event Pointer to event handle either returned by M_event_create(), M_event_pool_create(),
+ *                   or from an M_event_callback_t.
+ *  \param[in] usec  Number of microseconds to spin before blocking. 0 disables busy polling.
+ */
+M_API void M_event_set_busy_poll(M_event_t *event, M_uint64 usec);
+
+
 /*! Get the registered event handle for the io object
  *
  * \param[in] io IO object.
@@ -825,6 +947,103 @@ M_API M_uint64 M_event_get_statistic(M_event_t *event, M_event_statistic_t type)
   */
 M_API size_t M_event_num_objects(M_event_t *event);
 
+
+/*! Latency histograms that can be retrieved by M_event_get_histogram() */
+typedef enum {
+	M_EVENT_HISTOGRAM_CALLBACK = 0, /*!< Time spent in each io, timer and task callback */
+	M_EVENT_HISTOGRAM_ITERATION,    /*!< Time spent processing events each time the event loop wakes */
+	M_EVENT_HISTOGRAM_DISPATCH,     /*!< Time from the event loop waking to an io object's callback being
+	                                 *   called, includes time spent in callbacks delivered before it */
+	M_EVENT_HISTOGRAM_TIMER_LATE    /*!< Time a timer fired after it was scheduled to */
+} M_event_histogram_type_t;
+
+/*! Number of buckets in an M_event_histogram_t */
+#define M_EVENT_HISTOGRAM_BUCKETS 128
+
+/*! Latency histogram in microseconds.
+ *
+ *  Buckets are log-linear: each power of two range is split into four equal width buckets,
+ *  so a reported value is within 25% of the real value. Values 0-3 each have their own
+ *  bucket, values too large for the last bucket are counted in the last bucket.
+ */
+typedef struct {
+	M_uint64 count;                              /*!< Number of values recorded */
+	M_uint64 sum_us;                             /*!< Sum of all values recorded */
+	M_uint64 max_us;                             /*!< Largest value recorded */
+	M_uint64 buckets[M_EVENT_HISTOGRAM_BUCKETS]; /*!< Count of values for each bucket */
+} M_event_histogram_t;
+
+
+/*! Callback for callbacks that run longer than the threshold set with M_event_set_slow_callback().
+ *
+ *  Called from the event thread after the slow callback returns, must not block.
+ *
+ *  \param[in] event      Event loop the callback ran on.
+ *  \param[in] type       Event type passed to the callback.
+ *  \param[in] io         io object passed to the callback, NULL for timers and tasks. The
+ *                        callback may have destroyed it so it must only be compared, not used.
+ *  \param[in] callback   The slow callback.
+ *  \param[in] elapsed_us How long the callback ran.
+ *  \param[in] cb_arg     Argument passed to M_event_set_slow_callback().
+ */
+typedef void (*M_event_slow_callback_t)(M_event_t *event, M_event_type_t type, M_io_t *io, M_event_callback_t callback, M_uint64 elapsed_us, void *cb_arg);
+
+
+/*! Enable or disable recording of latency histograms.
+ *
+ *  Disabled by default as recording reads the clock around every callback. Disabling
+ *  discards anything recorded. If a pool is passed, applies to all of its event loops.
+ *
+ *  \param[in] event  Initialized event handle.
+ *  \param[in] enable M_TRUE to enable, M_FALSE to disable.
+ */
+M_API void M_event_histogram_enable(M_event_t *event, M_bool enable);
+
+
+/*! Retrieve a latency histogram.
+ *
+ *  Like M_event_get_statistic(), a child of an event pool only returns its own histogram,
+ *  and a pool returns the histograms of all of its event loops combined.
+ *
+ *  \param[in]  event Initialized event handle.
+ *  \param[in]  type  Histogram to return.
+ *  \param[out] hist  Histogram.
+ *
+ *  \return M_TRUE on success, M_FALSE if histograms are not enabled or on invalid use.
+ */
+M_API M_bool M_event_get_histogram(M_event_t *event, M_event_histogram_type_t type, M_event_histogram_t *hist);
+
+
+/*! Clear all recorded histogram values.
+ *
+ *  \param[in] event Initialized event handle. If a pool, all of its event loops are cleared.
+ */
+M_API void M_event_histogram_reset(M_event_t *event);
+
+
+/*! Get a percentile from a histogram.
+ *
+ *  \param[in] hist       Histogram from M_event_get_histogram().
+ *  \param[in] percentile Percentile, 0 to 100. For example 99.9.
+ *
+ *  \return Upper bound in microseconds of the bucket holding the percentile, never more
+ *          than the largest value recorded. 0 if nothing was recorded.
+ */
+M_API M_uint64 M_event_histogram_percentile(const M_event_histogram_t *hist, double percentile);
+
+
+/*! Report callbacks that run longer than a threshold.
+ *
+ *  If a pool is passed, applies to all of its event loops.
+ *
+ *  \param[in] event        Initialized event handle.
+ *  \param[in] threshold_us Callbacks running at least this long are reported.
+ *  \param[in] callback     Callback to report to. NULL to stop reporting.
+ *  \param[in] cb_arg       Argument passed to callback.
+ */
+M_API void M_event_set_slow_callback(M_event_t *event, M_uint64 threshold_us, M_event_slow_callback_t callback, void *cb_arg);
+
+
 /*! Get human readable event type from M_event_type_t
  *
  * \param[in] type    event type
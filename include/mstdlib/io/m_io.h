@@ -30,6 +30,7 @@
 #include <mstdlib/base/m_types.h>
 #include <mstdlib/base/m_parser.h>
 #include <mstdlib/base/m_buf.h>
+#include <mstdlib/base/m_chainbuf.h>
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
@@ -300,6 +301,61 @@ M_API M_io_error_t M_io_write_meta(M_io_t *comm, const unsigned char *buf, size_
 M_API M_io_error_t M_io_write_from_buf_meta(M_io_t *comm, M_buf_t *buf, M_io_meta_t *meta);
 
 
+/*! Write data from multiple buffers to an io object.
+ *
+ * The segments are written in order as if they were one contiguous buffer, without
+ * needing to be copied together first. Layers that support vectored writes pass the
+ * segments to the OS in a single call (e.g. writev/sendmsg for network connections).
+ * Other layers receive as much as fits in a single write.
+ *
+ * Like M_io_write(), not all data may be written. Writing continues until all segments
+ * are written or the io object can't take more, so a write event follows a short write.
+ * The application should skip the number of bytes written across the segments and try
+ * writing the rest on the next write event.
+ *
+ * \param[in]  comm        io object.
+ * \param[in]  iov         Segments to write.
+ * \param[in]  iov_cnt     Number of segments.
+ * \param[out] len_written Number of bytes written across all segments.
+ *
+ * \return Result.
+ *
+ * \see M_io_writev_meta
+ * \see M_io_write_from_chainbuf
+ */
+M_API M_io_error_t M_io_writev(M_io_t *comm, const M_iovec_t *iov, size_t iov_cnt, size_t *len_written);
+
+
+/*! Write data from multiple buffers to an io object with a meta data object.
+ *
+ * \param[in]  comm        io object.
+ * \param[in]  iov         Segments to write.
+ * \param[in]  iov_cnt     Number of segments.
+ * \param[out] len_written Number of bytes written across all segments.
+ * \param[in]  meta        Meta data object.
+ *
+ * \return Result.
+ *
+ * \see M_io_writev
+ */
+M_API M_io_error_t M_io_writev_meta(M_io_t *comm, const M_iovec_t *iov, size_t iov_cnt, size_t *len_written, M_io_meta_t *meta);
+
+
+/*! Write data to an io object from an M_chainbuf_t.
+ *
+ * The chained buffer is written with M_io_writev() and the data written is dropped
+ * from the front of the buffer.
+ *
+ * \param[in]  comm io object.
+ * \param[in]  cb   Chained buffer to write from.
+ *
+ * \return Result.
+ *
+ * \see M_io_writev
+ */
+M_API M_io_error_t M_io_write_from_chainbuf(M_io_t *comm, M_chainbuf_t *cb);
+
+
 /*! Accept an io connection.
  *
  * Typically used with network io when a connection is setup as a listening socket.
@@ -97,6 +97,17 @@ __BEGIN_DECLS
  * need to buffer the data and write more later when the `processevent_cb` receives a write event
  * stating layers below can accept data to write.
  *
+ * `M_io_writev` and `M_io_layer_writev` pass a list of segments down. A layer that registers
+ * `writev_cb` with `M_io_callbacks_reg_writev()` receives the segments as is. Layers without one
+ * have the segments coalesced into a single `write_cb` call, so the amount written may be less
+ * than requested.
+ *
+ * `M_io_send_file` passes file descriptors down so the OS can copy a file to the connection without
+ * it passing through user memory. A layer that can do this registers `sendfile_cb` with
+ * `M_io_callbacks_reg_sendfile()` and returns `M_IO_ERROR_NOTIMPL` whenever it can't handle a
+ * request, in which case the file is read and written through the layers instead. Layers without
+ * one that register a `write_cb` always cause the fallback since they need to see the data.
+ *
  * ## Examples
  *
  * Example layers:
@@ -1137,6 +1148,20 @@ M_API M_bool M_io_callbacks_reg_read(M_io_callbacks_t *callbacks, M_io_error_t (
 /*! Register callback to write to the connection. Optional if not base layer, required if base layer */
 M_API M_bool M_io_callbacks_reg_write(M_io_callbacks_t *callbacks, M_io_error_t (*cb_write)(M_io_layer_t *layer, const unsigned char *buf, size_t *write_len, M_io_meta_t *meta));
 
+/*! Register callback to write multiple buffers to the connection. Optional.
+ *
+ * write_len is set to the number of bytes written across all segments.  If not registered,
+ * the write callback is used instead with as much data as fits in a single write. */
+M_API M_bool M_io_callbacks_reg_writev(M_io_callbacks_t *callbacks, M_io_error_t (*cb_writev)(M_io_layer_t *layer, const M_iovec_t *iov, size_t iov_cnt, size_t *write_len, M_io_meta_t *meta));
+
+/*! Register callback to write directly from a file to the connection. Optional.
+ *
+ * fd is the OS file descriptor to read from. offset is the position to read at, or -1 to read
+ * from the current position of a file without one (e.g. a pipe). write_len is set to the number
+ * of bytes written, 0 meaning the file ended. Return M_IO_ERROR_NOTIMPL if the request can't be
+ * handled without the data passing through the layer. */
+M_API M_bool M_io_callbacks_reg_sendfile(M_io_callbacks_t *callbacks, M_io_error_t (*cb_sendfile)(M_io_layer_t *layer, M_intptr fd, M_int64 offset, size_t len, size_t *write_len));
+
 /*! Register callback to process events.  Optional. If returns M_TRUE event is consumed and not propagated to the next layer. */
 M_API M_bool M_io_callbacks_reg_processevent(M_io_callbacks_t *callbacks, M_bool (*cb_process_event)(M_io_layer_t *layer, M_event_type_t *type));
 
@@ -1193,6 +1218,9 @@ M_API M_io_error_t M_io_layer_read(M_io_t *io, size_t layer_id, unsigned char *b
 /*! Perform a write operation at the given layer index */
 M_API M_io_error_t M_io_layer_write(M_io_t *io, size_t layer_id, const unsigned char *buf, size_t *write_len, M_io_meta_t *meta);
 
+/*! Perform a vectored write operation at the given layer index */
+M_API M_io_error_t M_io_layer_writev(M_io_t *io, size_t layer_id, const M_iovec_t *iov, size_t iov_cnt, size_t *write_len, M_io_meta_t *meta);
+
 M_API M_bool M_io_error_is_critical(M_io_error_t err);
 
 /*! Add a soft-event.  If sibling_only is true, will only notify next layer and not self. Must specify an error. */
@@ -356,6 +356,37 @@ typedef enum M_io_net_type M_io_net_type_t;
 M_API M_io_error_t M_io_net_server_create(M_io_t **io_out, unsigned short port, const char *bind_ip, M_io_net_type_t type);
 
 
+/*! Create server listeners sharded across the threads of an event pool.
+ *
+ * One listener is created per event loop in the pool, all bound to the same port using
+ * SO_REUSEPORT (SO_REUSEPORT_LB on FreeBSD), and each is added to its own loop. The kernel
+ * balances incoming connections between the listeners so accepting is spread across all
+ * threads rather than bottlenecked on one.
+ *
+ * To keep a connection on the thread that accepted it, add the io object returned by
+ * M_io_accept() to the event handle passed to the callback rather than to the pool
+ * returned by M_event_get_pool().
+ *
+ * If event is not a pool, or the system can't balance connections across listeners
+ * sharing a port, a single listener is created and added to event.
+ *
+ * \param[out] ios_out     Array of listeners. Each must be destroyed with M_io_destroy() and
+ *                         the array freed with M_free().
+ * \param[out] num_ios_out Number of listeners in ios_out.
+ * \param[in]  event       Event pool (or loop) to add the listeners to.
+ * \param[in]  port        Port to listen on.  If 0 is used, the OS will assign an unused port which can be
+ *                         retrieved via M_io_net_get_port() on any of the listeners.
+ * \param[in]  bind_ip     NULL to listen on all interfaces, or an explicit ip address to listen on.
+ * \param[in]  type        Connection type.
+ * \param[in]  callback    Callback for listener events (M_EVENT_TYPE_ACCEPT).
+ * \param[in]  cb_data     Data passed to the callback.
+ *
+ * \return Result.
+ */
+M_API M_io_error_t M_io_net_server_create_sharded(M_io_t ***ios_out, size_t *num_ios_out, M_event_t *event, unsigned short port,
+                                                  const char *bind_ip, M_io_net_type_t type, M_event_callback_t callback, void *cb_data);
+
+
 /*! Create a client net object.
  *
  * \param[out] io_out  io object for communication.
@@ -470,6 +501,19 @@ M_API unsigned short M_io_net_get_ephemeral_port(M_io_t *io);
 M_API enum M_io_net_type M_io_net_get_type(M_io_t *io);
 
 
+/*! Get the OS socket of a connection.
+ *
+ * For layers that hand the socket to the OS or a library directly, such as
+ * kernel TLS offload. The socket is still owned by the io object and must
+ * not be closed. Events for it are still delivered through the io object.
+ *
+ * \param[in] io io object.
+ *
+ * \return Socket, or -1 if not connected or not a network connection.
+ */
+M_API M_intptr M_io_net_get_socket(M_io_t *io);
+
+
 /*! Get connection timeout
  *
  * This is not the amount of time connec took, this is the
@@ -0,0 +1,264 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2023 Monetra Technologies, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __M_IO_NET_UDP_H__
+#define __M_IO_NET_UDP_H__
+
+#include <mstdlib/mstdlib.h>
+#include <mstdlib/io/m_io.h>
+#include <mstdlib/io/m_io_net.h>
+
+__BEGIN_DECLS
+
+/*! \addtogroup m_io_net_udp UDP Datagram I/O
+ *  \ingroup m_io_net
+ *
+ * UDP datagram sockets.
+ *
+ * Each read returns exactly one datagram and each write sends exactly one
+ * datagram. If the read buffer is smaller than the datagram the remainder is
+ * discarded and the read is still successful. Such reads are flagged as truncated,
+ * see M_io_net_udp_meta_get_truncated() and M_io_net_udp_dgram_t.truncated. The peer address of a received datagram, and the destination of
+ * a datagram being sent, are carried in the io meta object
+ * (M_io_read_meta() / M_io_write_meta()).
+ *
+ * Unlike stream connections, an error sending to or receiving from one peer
+ * does not affect others. Errors specific to a single datagram, such as a
+ * datagram too large to send, are returned as M_IO_ERROR_INVALID and do not
+ * trigger an error event.
+ *
+ * For high packet rates, M_io_net_udp_read_batch() and M_io_net_udp_write_batch()
+ * move many datagrams per system call (recvmmsg() and sendmmsg() on Linux).
+ * UDP segmentation offload (GSO) and receive offload (GRO) are used when the
+ * system supports them.
+ *
+ * Example (echo server):
+ *
+ * \code{.c}
+ *     static void udp_cb(M_event_t *event, M_event_type_t type, M_io_t *io, void *thunk)
+ *     {
+ *         unsigned char buf[2048];
+ *         size_t        len;
+ *         M_io_meta_t  *meta;
+ *
+ *         (void)event;
+ *         (void)thunk;
+ *
+ *         if (type != M_EVENT_TYPE_READ)
+ *             return;
+ *
+ *         meta = M_io_meta_create();
+ *         while (M_io_read_meta(io, buf, sizeof(buf), &len, meta) == M_IO_ERROR_SUCCESS) {
+ *             // Peer stored in meta by the read is used as the destination.
+ *             M_io_write_meta(io, buf, len, &len, meta);
+ *         }
+ *         M_io_meta_destroy(meta);
+ *     }
+ *
+ *     M_io_net_udp_create(&io, 8999, NULL, M_IO_NET_ANY);
+ *     M_event_add(el, io, udp_cb, NULL);
+ * \endcode
+ *
+ * @{
+ */
+
+/*! A datagram for batched reads and writes.
+ *
+ * Addresses are in binary form as used by M_io_net_ipaddr_to_bin() and M_io_net_bin_to_ipaddr().
+ * IPv4 peers of a dual stack socket are always reported as 4 byte addresses. */
+typedef struct {
+	unsigned char  *buf;          /*!< Datagram data. */
+	size_t          buf_size;     /*!< Read: size of buf. Not used for writes. */
+	size_t          len;          /*!< Read: length of data received. Write: length of data to send. */
+	unsigned char   ipaddr[16];   /*!< Peer address. */
+	size_t          ipaddr_len;   /*!< Length of peer address: 4 (IPv4), 16 (IPv6). For writes, 0 sends to the
+	                               *   peer of a client created with M_io_net_udp_client_create(). */
+	unsigned short  port;         /*!< Peer port. */
+	size_t          segment_size; /*!< Read: if non-zero, buf holds multiple datagrams from the same peer coalesced
+	                               *   by GRO, each segment_size long except possibly the last.
+	                               *   Write: if non-zero, the kernel splits buf into datagrams of segment_size
+	                               *   (GSO). */
+	M_bool          truncated;    /*!< Read: the datagram was larger than buf_size and the rest was
+	                               *   discarded. len is the part that was received. Not used for writes. */
+} M_io_net_udp_dgram_t;
+
+
+/*! Create a UDP socket bound to a local port.
+ *
+ * The socket is not associated with any peer. Reads receive datagrams from any
+ * peer and writes must specify a destination with M_io_net_udp_meta_set_peer().
+ *
+ * \param[out] io_out  io object for communication.
+ * \param[in]  port    Port to bind. If 0 is used, the OS will assign an unused port which can be
+ *                     retrieved via M_io_net_udp_get_port().
+ * \param[in]  bind_ip NULL to bind all interfaces, or an explicit ip address to bind.
+ * \param[in]  type    Connection type.
+ *
+ * \return Result.
+ */
+M_API M_io_error_t M_io_net_udp_create(M_io_t **io_out, unsigned short port, const char *bind_ip, M_io_net_type_t type);
+
+
+/*! Create a UDP socket associated with a single peer.
+ *
+ * Only datagrams from the peer are received, and writes without a destination
+ * set in meta are sent to the peer. Errors reported by the peer's host (such as
+ * the port being unreachable) are delivered as an error event.
+ *
+ * \param[out] io_out  io object for communication.
+ * \param[in]  ipaddr  IP address of the peer. Host names are not resolved.
+ * \param[in]  port    Port of the peer.
+ * \param[in]  type    Connection type.
+ *
+ * \return Result.
+ */
+M_API M_io_error_t M_io_net_udp_client_create(M_io_t **io_out, const char *ipaddr, unsigned short port, M_io_net_type_t type);
+
+
+/*! Get the local port a UDP socket is bound to.
+ *
+ * \param[in] io io object.
+ *
+ * \return Port, or 0 if io is not a UDP socket.
+ */
+M_API unsigned short M_io_net_udp_get_port(M_io_t *io);
+
+
+/*! Enable or disable UDP receive offload (GRO).
+ *
+ * When enabled the kernel may coalesce several datagrams from the same peer
+ * into a single read. The segment size is reported in
+ * M_io_net_udp_dgram_t.segment_size or by M_io_net_udp_meta_get_segment_size().
+ *
+ * \param[in] io     io object.
+ * \param[in] enable Whether to enable GRO.
+ *
+ * \return M_TRUE on success, M_FALSE if not supported by the system.
+ */
+M_API M_bool M_io_net_udp_set_gro(M_io_t *io, M_bool enable);
+
+
+/*! Receive multiple datagrams.
+ *
+ * Operates directly on the UDP layer, any layers added on top are bypassed.
+ *
+ * \param[in]  io      io object.
+ * \param[in]  dgrams  Datagrams to fill. buf and buf_size must be set on each.
+ * \param[in]  cnt     Number of datagrams in dgrams.
+ * \param[out] cnt_out Number of datagrams received.
+ *
+ * \return M_IO_ERROR_SUCCESS if at least one datagram was received, M_IO_ERROR_WOULDBLOCK
+ *         if none are available, otherwise an error.
+ */
+M_API M_io_error_t M_io_net_udp_read_batch(M_io_t *io, M_io_net_udp_dgram_t *dgrams, size_t cnt, size_t *cnt_out);
+
+
+/*! Send multiple datagrams.
+ *
+ * Operates directly on the UDP layer, any layers added on top are bypassed.
+ * Datagrams are sent in order. If fewer than cnt are sent, the next one would block
+ * or failed; retrying it will return the error.
+ *
+ * \param[in]  io      io object.
+ * \param[in]  dgrams  Datagrams to send.
+ * \param[in]  cnt     Number of datagrams in dgrams.
+ * \param[out] cnt_out Number of datagrams sent.
+ *
+ * \return M_IO_ERROR_SUCCESS if at least one datagram was sent, M_IO_ERROR_WOULDBLOCK
+ *         if the socket buffer is full, M_IO_ERROR_NOTIMPL if segment_size was set but
+ *         GSO is not supported, otherwise an error.
+ */
+M_API M_io_error_t M_io_net_udp_write_batch(M_io_t *io, const M_io_net_udp_dgram_t *dgrams, size_t cnt, size_t *cnt_out);
+
+
+/*! Get the peer ip address of a datagram read with M_io_read_meta().
+ *
+ * \param[in] io   io object.
+ * \param[in] meta Meta from the read.
+ *
+ * \return String ip address, or NULL if not available.
+ */
+M_API const char *M_io_net_udp_meta_get_ipaddr(M_io_t *io, M_io_meta_t *meta);
+
+
+/*! Get the peer port of a datagram read with M_io_read_meta().
+ *
+ * \param[in] io   io object.
+ * \param[in] meta Meta from the read.
+ *
+ * \return Port, or 0 if not available.
+ */
+M_API unsigned short M_io_net_udp_meta_get_port(M_io_t *io, M_io_meta_t *meta);
+
+
+/*! Get the GRO segment size of a datagram read with M_io_read_meta().
+ *
+ * \param[in] io   io object.
+ * \param[in] meta Meta from the read.
+ *
+ * \return Segment size, or 0 if the read holds a single datagram.
+ */
+M_API size_t M_io_net_udp_meta_get_segment_size(M_io_t *io, M_io_meta_t *meta);
+
+
+/*! Get whether a datagram read with M_io_read_meta() was truncated.
+ *
+ * A datagram larger than the read buffer is cut to the buffer's size and the
+ * rest is discarded. The read itself still succeeds.
+ *
+ * \param[in] io   io object.
+ * \param[in] meta Meta from the read.
+ *
+ * \return M_TRUE if part of the datagram was discarded, otherwise M_FALSE.
+ */
+M_API M_bool M_io_net_udp_meta_get_truncated(M_io_t *io, M_io_meta_t *meta);
+
+
+/*! Set the destination of a datagram written with M_io_write_meta().
+ *
+ * The peer of a datagram read with the same meta is used as the destination
+ * unless changed with this function.
+ *
+ * \param[in] io     io object.
+ * \param[in] meta   Meta for the write.
+ * \param[in] ipaddr IP address of the destination.
+ * \param[in] port   Port of the destination.
+ *
+ * \return M_TRUE on success, M_FALSE if ipaddr is not a valid ip address.
+ */
+M_API M_bool M_io_net_udp_meta_set_peer(M_io_t *io, M_io_meta_t *meta, const char *ipaddr, unsigned short port);
+
+
+/*! Set the GSO segment size of a datagram written with M_io_write_meta().
+ *
+ * \param[in] io           io object.
+ * \param[in] meta         Meta for the write.
+ * \param[in] segment_size Segment size, 0 to send as a single datagram.
+ */
+M_API void M_io_net_udp_meta_set_segment_size(M_io_t *io, M_io_meta_t *meta, size_t segment_size);
+
+/*! @} */
+
+__END_DECLS
+
+#endif /* __M_IO_NET_UDP_H__ */
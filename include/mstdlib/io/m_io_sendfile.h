@@ -0,0 +1,150 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2023 Monetra Technologies, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __M_IO_SENDFILE_H__
+#define __M_IO_SENDFILE_H__
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#include <mstdlib/base/m_defs.h>
+#include <mstdlib/base/m_types.h>
+#include <mstdlib/base/m_fs.h>
+#include <mstdlib/io/m_io.h>
+#include <mstdlib/io/m_event.h>
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+__BEGIN_DECLS
+
+/*! \addtogroup m_io_sendfile Sending files
+ *  \ingroup m_eventio
+ *
+ * Send the contents of a file over an io object from its event loop.
+ *
+ * When the file is written straight to a network socket, with no layers that
+ * need to see the data (TLS, bandwidth shaping, trace, ...), the OS copies the
+ * data from the file to the socket without it passing through user memory
+ * (sendfile() on Linux, splice() for pipes). Otherwise, or on systems without
+ * support, the file is read in chunks and written through the layers.
+ *
+ * While a transfer is in progress it owns the io object's write events. Other
+ * events are still delivered to the io object's callback. A disconnect or error
+ * ends the transfer and is delivered to the io object's callback after the final
+ * progress callback, unless the io object was destroyed there. The application must
+ * not write to the io object until the transfer completes.
+ *
+ * Example:
+ *
+ * \code{.c}
+ *     static void send_done(M_io_t *io, M_io_error_t err, M_uint64 sent, M_bool done, void *thunk)
+ *     {
+ *         M_fs_file_t *file = thunk;
+ *
+ *         if (!done)
+ *             return;
+ *
+ *         if (err != M_IO_ERROR_SUCCESS)
+ *             M_printf("Sent %llu bytes before failure: %s\n", sent, M_io_error_string(err));
+ *
+ *         M_fs_file_close(file);
+ *         M_io_disconnect(io);
+ *     }
+ *
+ *     // Within the io object's event callback once connected.
+ *     if (M_fs_file_open(&file, "/srv/file.bin", 0, M_FS_FILE_MODE_READ, NULL) == M_FS_ERROR_SUCCESS)
+ *         M_io_send_file(io, file, 0, 0, M_IO_SENDFILE_FLAG_NONE, send_done, file);
+ * \endcode
+ *
+ * @{
+ */
+
+
+/*! Flags controlling file transfers. */
+typedef enum {
+	M_IO_SENDFILE_FLAG_NONE        = 0,     /*!< Default. */
+	M_IO_SENDFILE_FLAG_NO_ZEROCOPY = 1 << 0 /*!< Always read the file into memory and write it through the layers. */
+} M_io_sendfile_flags_t;
+
+
+/*! Transfer progress callback.
+ *
+ * Called from the io object's event loop each time data is sent, and once more
+ * when the transfer ends. After the final call the application may write to
+ * the io object again. The io object may be destroyed from within the callback.
+ *
+ * \param[in] io    io object.
+ * \param[in] err   Result. M_IO_ERROR_SUCCESS unless the transfer failed.
+ * \param[in] sent  Total bytes sent so far.
+ * \param[in] done  M_TRUE if this is the final call for the transfer.
+ * \param[in] thunk Argument passed to M_io_send_file().
+ */
+typedef void (*M_io_sendfile_cb_t)(M_io_t *io, M_io_error_t err, M_uint64 sent, M_bool done, void *thunk);
+
+
+/*! Send a file over an io object.
+ *
+ * The io object must be connected and added to an event loop. The transfer
+ * starts once control returns to the event loop and this should be called
+ * from the event loop's thread (e.g. from the io object's event callback).
+ *
+ * The file must remain open until the transfer ends. Files without a position,
+ * such as pipes, are read from their current position and offset must be 0.
+ * Reading from a pipe blocks the event loop until data is available. Do not
+ * mix this with buffered reads of the same pipe since data already buffered
+ * by M_fs_file_read() would be skipped.
+ *
+ * A file that ends before len bytes have been sent fails the transfer with
+ * M_IO_ERROR_ERROR.
+ *
+ * \param[in] io     io object.
+ * \param[in] file   File to send.
+ * \param[in] offset Position in the file to start at.
+ * \param[in] len    Number of bytes to send. 0 to send until the end of the file.
+ * \param[in] flags  M_io_sendfile_flags_t flags.
+ * \param[in] cb     Progress and completion callback. Optional.
+ * \param[in] thunk  Argument passed to the callback.
+ *
+ * \return M_IO_ERROR_SUCCESS if the transfer was started. M_IO_ERROR_NOTPERM if a
+ *         transfer is already in progress on the io object. M_IO_ERROR_INVALID on
+ *         invalid use, such as io not being added to an event loop or the offset
+ *         being past the end of the file.
+ */
+M_API M_io_error_t M_io_send_file(M_io_t *io, M_fs_file_t *file, M_uint64 offset, M_uint64 len, M_uint32 flags, M_io_sendfile_cb_t cb, void *thunk);
+
+
+/*! Stop a file transfer.
+ *
+ * The progress callback is not called. Data already handed to the io object
+ * is still sent.
+ *
+ * \param[in] io io object.
+ *
+ * \return M_TRUE if a transfer was stopped, M_FALSE if none was in progress.
+ */
+M_API M_bool M_io_send_file_cancel(M_io_t *io);
+
+/*! @} */
+
+__END_DECLS
+
+#endif /* __M_IO_SENDFILE_H__ */
@@ -75,6 +75,7 @@
 #include <mstdlib/io/m_io.h>
 #include <mstdlib/io/m_io_net.h>
 #include <mstdlib/io/m_io_net_iface_ips.h>
+#include <mstdlib/io/m_io_net_udp.h>
 #include <mstdlib/io/m_dns.h>
 #include <mstdlib/io/m_io_pipe.h>
 #include <mstdlib/io/m_event.h>
@@ -84,6 +85,7 @@
 #include <mstdlib/io/m_io_bwshaping.h>
 #include <mstdlib/io/m_io_loopback.h>
 #include <mstdlib/io/m_io_process.h>
+#include <mstdlib/io/m_io_sendfile.h>
 #include <mstdlib/io/m_io_proxy_protocol.h>
 #include <mstdlib/io/m_io_serial.h>
 #include <mstdlib/io/m_io_hid.h>
@@ -0,0 +1,232 @@
+/* The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Monetra Technologies, LLC.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __M_CACHE_CONCURRENT_H__
+#define __M_CACHE_CONCURRENT_H__
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#include <mstdlib/base/m_defs.h>
+#include <mstdlib/base/m_types.h>
+#include <mstdlib/base/m_cache.h>
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+__BEGIN_DECLS
+
+/*! \addtogroup m_cache_concurrent Concurrent Cache
+ *  \ingroup    m_thread
+ *
+ * Cache that can be shared by multiple threads.
+ *
+ * The cache is split into a number of shards. Each shard is an M_cache_t protected by its
+ * own lock and a key always maps to the same shard. The capacity (size and weight) is divided
+ * evenly between the shards. Eviction, expiration and TinyLFU admission happen per shard.
+ * See M_cache_t for details of how entries are managed.
+ *
+ * A value returned by M_cache_concurrent_get() can be evicted and destroyed by another thread
+ * at any time. Unless values are reference counted or never destroyed by the cache use
+ * M_cache_concurrent_get_copy() which copies the value while the shard is locked.
+ *
+ * @{
+ */
+
+struct M_cache_concurrent;
+typedef struct M_cache_concurrent M_cache_concurrent_t;
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+/*! Create a concurrent cache.
+ *
+ * \param[in] max_size     Maximum number of entries in the cache.
+ * \param[in] num_shards   Number of shards. Rounded up to the nearest power of 2. 0 to choose a
+ *                         number based on the number of CPU cores and max_size.
+ * \param[in] key_hash     The function to use for hashing a key. If not specified will use
+ *                         the pointer address as the key.
+ * \param[in] key_equality The function to use to determine if two keys are equal. If not
+ *                         specified, will compare pointer addresses.
+ * \param[in] flags        M_cache_flags_t flags for modifying behavior.
+ * \param[in] callbacks    Register callbacks for overriding default behavior.
+ *
+ * \return Allocated cache.
+ *
+ * \see M_cache_create
+ * \see M_cache_concurrent_destroy
+ */
+M_API M_cache_concurrent_t *M_cache_concurrent_create(size_t max_size, size_t num_shards,
+		M_hashtable_hash_func key_hash, M_sort_compar_t key_equality,
+		M_uint32 flags, const struct M_cache_callbacks *callbacks) M_MALLOC;
+
+
+/*! Destroy the cache.
+ *
+ * No other threads can be using the cache.
+ *
+ * \param[in] c Cache to destroy
+ */
+M_API void M_cache_concurrent_destroy(M_cache_concurrent_t *c);
+
+
+/*! Insert an entry into the cache. \see M_cache_insert */
+M_API M_bool M_cache_concurrent_insert(M_cache_concurrent_t *c, const void *key, const void *value);
+
+
+/*! Insert an entry into the cache with a weight and time to live. \see M_cache_insert_ext */
+M_API M_bool M_cache_concurrent_insert_ext(M_cache_concurrent_t *c, const void *key, const void *value, size_t weight, M_uint64 ttl_ms);
+
+
+/*! Remove an entry from the cache. \see M_cache_remove */
+M_API M_bool M_cache_concurrent_remove(M_cache_concurrent_t *c, const void *key);
+
+
+/*! Retrieve the value for a key from the cache.
+ *
+ * \param[in]  c      Cache being referenced.
+ * \param[in]  key    Key for value.
+ * \param[out] value  Pointer to value stored in the cache. Optional, pass NULL if not needed.
+ *
+ * \return M_TRUE if value retrieved, M_FALSE if key does not exist.
+ *
+ * \see M_cache_get
+ */
+M_API M_bool M_cache_concurrent_get(M_cache_concurrent_t *c, const void *key, void **value);
+
+
+/*! Retrieve a copy of the value for a key from the cache.
+ *
+ * \param[in]  c         Cache being referenced.
+ * \param[in]  key       Key for value.
+ * \param[in]  copy_func Function used to copy the value while the entry can't be changed.
+ * \param[out] value     Copy of the value. The caller owns the copy.
+ *
+ * \return M_TRUE if value retrieved, M_FALSE if key does not exist.
+ */
+M_API M_bool M_cache_concurrent_get_copy(M_cache_concurrent_t *c, const void *key, M_cache_duplicate_func copy_func, void **value);
+
+
+/*! Remove all expired entries. \see M_cache_expire */
+M_API size_t M_cache_concurrent_expire(M_cache_concurrent_t *c);
+
+
+/*! Get the number of items in the cache. \see M_cache_size */
+M_API size_t M_cache_concurrent_size(M_cache_concurrent_t *c);
+
+
+/*! Get the maximum number of items allowed in the cache. \see M_cache_max_size */
+M_API size_t M_cache_concurrent_max_size(M_cache_concurrent_t *c);
+
+
+/*! Set the maximum number of items allowed in the cache. \see M_cache_set_max_size */
+M_API M_bool M_cache_concurrent_set_max_size(M_cache_concurrent_t *c, size_t max_size);
+
+
+/*! Get the total weight of the items in the cache. \see M_cache_weight */
+M_API size_t M_cache_concurrent_weight(M_cache_concurrent_t *c);
+
+
+/*! Set the maximum total weight allowed in the cache. \see M_cache_set_max_weight */
+M_API M_bool M_cache_concurrent_set_max_weight(M_cache_concurrent_t *c, size_t max_weight);
+
+
+/*! Set the default time to live of entries. \see M_cache_set_ttl */
+M_API void M_cache_concurrent_set_ttl(M_cache_concurrent_t *c, M_uint64 ttl_ms);
+
+
+/*! Get statistics about the cache, combined from all shards. \see M_cache_stats */
+M_API void M_cache_concurrent_stats(M_cache_concurrent_t *c, M_cache_stats_t *stats);
+
+
+/*! Number of shards the cache is split into.
+ *
+ * \param[in] c Cache being referenced.
+ *
+ * \return Number of shards.
+ */
+M_API size_t M_cache_concurrent_num_shards(const M_cache_concurrent_t *c);
+
+/*! @} */
+
+
+/*! \addtogroup m_cache_concurrent_strvp Concurrent Cache - String/Void Pointer
+ *  \ingroup    m_cache_concurrent
+ *
+ * Concurrent cache with string keys and void pointer values.
+ *
+ * @{
+ */
+
+struct M_cache_concurrent_strvp;
+typedef struct M_cache_concurrent_strvp M_cache_concurrent_strvp_t;
+
+/*! Create a concurrent string/void pointer cache.
+ *
+ * \param[in] max_size     Maximum number of entries in the cache.
+ * \param[in] num_shards   Number of shards. 0 to choose a number based on the number of CPU cores.
+ * \param[in] flags        M_cache_strvp_flags_t flags for modifying behavior.
+ * \param[in] destroy_func The function to be called to destroy value when removed.
+ *
+ * \return Allocated cache.
+ */
+M_API M_cache_concurrent_strvp_t *M_cache_concurrent_strvp_create(size_t max_size, size_t num_shards, M_uint32 flags, void (*destroy_func)(void *)) M_MALLOC_ALIASED;
+
+/*! Destroy the cache. \see M_cache_concurrent_destroy */
+M_API void M_cache_concurrent_strvp_destroy(M_cache_concurrent_strvp_t *c);
+
+/*! Insert an entry. \see M_cache_concurrent_insert */
+M_API M_bool M_cache_concurrent_strvp_insert(M_cache_concurrent_strvp_t *c, const char *key, const void *value);
+
+/*! Insert an entry with a weight and time to live. \see M_cache_concurrent_insert_ext */
+M_API M_bool M_cache_concurrent_strvp_insert_ext(M_cache_concurrent_strvp_t *c, const char *key, const void *value, size_t weight, M_uint64 ttl_ms);
+
+/*! Remove an entry. \see M_cache_concurrent_remove */
+M_API M_bool M_cache_concurrent_strvp_remove(M_cache_concurrent_strvp_t *c, const char *key);
+
+/*! Retrieve a value. \see M_cache_concurrent_get */
+M_API M_bool M_cache_concurrent_strvp_get(M_cache_concurrent_strvp_t *c, const char *key, void **value);
+
+/*! Retrieve a copy of a value. \see M_cache_concurrent_get_copy */
+M_API M_bool M_cache_concurrent_strvp_get_copy(M_cache_concurrent_strvp_t *c, const char *key, M_cache_duplicate_func copy_func, void **value);
+
+/*! Remove all expired entries. \see M_cache_concurrent_expire */
+M_API size_t M_cache_concurrent_strvp_expire(M_cache_concurrent_strvp_t *c);
+
+/*! Get the number of items. \see M_cache_concurrent_size */
+M_API size_t M_cache_concurrent_strvp_size(M_cache_concurrent_strvp_t *c);
+
+/*! Set the maximum number of items. \see M_cache_concurrent_set_max_size */
+M_API M_bool M_cache_concurrent_strvp_set_max_size(M_cache_concurrent_strvp_t *c, size_t max_size);
+
+/*! Set the maximum total weight. \see M_cache_concurrent_set_max_weight */
+M_API M_bool M_cache_concurrent_strvp_set_max_weight(M_cache_concurrent_strvp_t *c, size_t max_weight);
+
+/*! Set the default time to live. \see M_cache_concurrent_set_ttl */
+M_API void M_cache_concurrent_strvp_set_ttl(M_cache_concurrent_strvp_t *c, M_uint64 ttl_ms);
+
+/*! Get statistics. \see M_cache_concurrent_stats */
+M_API void M_cache_concurrent_strvp_stats(M_cache_concurrent_strvp_t *c, M_cache_stats_t *stats);
+
+/*! @} */
+
+__END_DECLS
+
+#endif /* __M_CACHE_CONCURRENT_H__ */
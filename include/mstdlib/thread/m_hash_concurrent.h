@@ -0,0 +1,338 @@
+/* The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Monetra Technologies, LLC.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __M_HASH_CONCURRENT_H__
+#define __M_HASH_CONCURRENT_H__
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#include <mstdlib/base/m_defs.h>
+#include <mstdlib/base/m_types.h>
+#include <mstdlib/base/m_sort.h>
+#include <mstdlib/base/m_hashtable.h>
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+__BEGIN_DECLS
+
+/*! \addtogroup m_hash_concurrent Concurrent Hashtable
+ *  \ingroup    m_thread
+ *
+ * Hashtable that can be shared by multiple threads reading and writing at the same time.
+ *
+ * The table is split into a number of shards. Each shard is a regular M_hashtable_t protected
+ * by its own read/write lock and a key always maps to the same shard. Operations on keys in
+ * different shards never wait on each other and any number of readers can access the same
+ * shard at once. This is much more scalable than wrapping a single hashtable in one lock.
+ *
+ * Since other threads can remove a key at any time, a value pointer returned by a get is only
+ * guaranteed to remain valid if values are never destroyed by the table or the application
+ * otherwise guarantees the key will not be removed. Use M_hash_concurrent_compute_if_absent()
+ * to atomically look up or create a value.
+ *
+ * Key ordering flags only apply within a shard and should not be used.
+ *
+ * Example:
+ *
+ * \code{.c}
+ *     static void *create_val(const void *key, void *thunk)
+ *     {
+ *         (void)thunk;
+ *         return M_strdup(key);
+ *     }
+ *
+ *     M_hash_concurrent_strvp_t *h;
+ *     char                      *val;
+ *
+ *     h   = M_hash_concurrent_strvp_create(16, 75, 0, M_HASH_STRVP_NONE, M_free);
+ *     val = M_hash_concurrent_strvp_compute_if_absent(h, "key", create_val, NULL);
+ *     M_hash_concurrent_strvp_destroy(h, M_TRUE);
+ * \endcode
+ *
+ * @{
+ */
+
+struct M_hash_concurrent;
+typedef struct M_hash_concurrent M_hash_concurrent_t;
+
+struct M_hash_concurrent_enum;
+typedef struct M_hash_concurrent_enum M_hash_concurrent_enum_t;
+
+/*! Callback used by compute if absent to create a value for a key.
+ *
+ * Called while the key's shard is locked. Must not access the same table.
+ *
+ * \param[in] key   Key being added.
+ * \param[in] thunk Thunk passed to the compute function.
+ *
+ * \return Value to insert. NULL to not insert anything.
+ */
+typedef void *(*M_hash_concurrent_create_func)(const void *key, void *thunk);
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+/*! Create a new concurrent hashtable.
+ *
+ * \param[in] size         Size of each shard. Rounded up to the nearest power of 2.
+ * \param[in] fillpct      Maximum fill percentage of each shard before it's expanded. 0 to disable.
+ * \param[in] num_shards   Number of shards. Rounded up to the nearest power of 2. 0 to choose a
+ *                         number based on the number of CPU cores.
+ * \param[in] key_hash     Function to use for hashing a key.
+ * \param[in] key_equality Function to use to determine if two keys are equal.
+ * \param[in] flags        M_hashtable_flags_t flags for modifying behavior.
+ * \param[in] callbacks    Register callbacks for overriding default behavior.
+ *
+ * \return Allocated hashtable on success, otherwise NULL.
+ *
+ * \see M_hashtable_create
+ * \see M_hash_concurrent_destroy
+ */
+M_API M_hash_concurrent_t *M_hash_concurrent_create(size_t size, M_uint8 fillpct, size_t num_shards,
+	M_hashtable_hash_func key_hash, M_sort_compar_t key_equality, M_uint32 flags,
+	const struct M_hashtable_callbacks *callbacks);
+
+
+/*! Destroy the hashtable.
+ *
+ * No other threads can be using the table.
+ *
+ * \param[in] h            Hashtable to destroy.
+ * \param[in] destroy_vals M_TRUE if the values held by the table should be destroyed.
+ */
+M_API void M_hash_concurrent_destroy(M_hash_concurrent_t *h, M_bool destroy_vals) M_FREE(1);
+
+
+/*! Insert an entry into the table.
+ *
+ * If the key already exists its value is replaced.
+ *
+ * \param[in,out] h     Hashtable.
+ * \param[in]     key   Key to insert.
+ * \param[in]     value Value to insert.
+ *
+ * \return M_TRUE on success, otherwise M_FALSE.
+ */
+M_API M_bool M_hash_concurrent_insert(M_hash_concurrent_t *h, const void *key, const void *value);
+
+
+/*! Remove an entry from the table.
+ *
+ * \param[in,out] h            Hashtable.
+ * \param[in]     key          Key to remove.
+ * \param[in]     destroy_vals M_TRUE if the value should be destroyed.
+ *
+ * \return M_TRUE if the key was removed, otherwise M_FALSE.
+ */
+M_API M_bool M_hash_concurrent_remove(M_hash_concurrent_t *h, const void *key, M_bool destroy_vals);
+
+
+/*! Retrieve the value for a key.
+ *
+ * \param[in]  h     Hashtable.
+ * \param[in]  key   Key to look up.
+ * \param[out] value Value of the key. Optional, pass NULL if only checking if the key exists.
+ *
+ * \return M_TRUE if the key exists, otherwise M_FALSE.
+ */
+M_API M_bool M_hash_concurrent_get(M_hash_concurrent_t *h, const void *key, void **value);
+
+
+/*! Retrieve the value for a key, creating it if it doesn't exist.
+ *
+ * The look up and insert are done under the same lock so only one value is ever
+ * created for a key even when multiple threads race to add it.
+ *
+ * \param[in,out] h           Hashtable.
+ * \param[in]     key         Key to look up.
+ * \param[in]     create_func Callback to create the value when the key doesn't exist.
+ * \param[in]     thunk       Thunk passed to create_func.
+ *
+ * \return Existing or newly created value. NULL if the key didn't exist and create_func didn't
+ *         create a value.
+ */
+M_API void *M_hash_concurrent_compute_if_absent(M_hash_concurrent_t *h, const void *key, M_hash_concurrent_create_func create_func, void *thunk);
+
+
+/*! Number of keys in the table.
+ *
+ * Other threads can be modifying the table so this is only an estimate.
+ *
+ * \param[in] h Hashtable.
+ *
+ * \return Number of keys.
+ */
+M_API size_t M_hash_concurrent_num_keys(M_hash_concurrent_t *h);
+
+
+/*! Number of shards the table is split into.
+ *
+ * \param[in] h Hashtable.
+ *
+ * \return Number of shards.
+ */
+M_API size_t M_hash_concurrent_num_shards(const M_hash_concurrent_t *h);
+
+
+/*! Start an enumeration of the table.
+ *
+ * All shards are locked while a snapshot of the keys and values is taken so the
+ * enumeration reflects the table at a single point in time. Changes made to the
+ * table afterwards do not affect the enumeration. Keys are duplicated into the
+ * snapshot. Values are not.
+ *
+ * \param[in]  h        Hashtable.
+ * \param[out] hashenum Enumeration to use with M_hash_concurrent_enumerate_next().
+ *
+ * \return Number of entries in the enumeration.
+ *
+ * \see M_hash_concurrent_enumerate_free
+ */
+M_API size_t M_hash_concurrent_enumerate(M_hash_concurrent_t *h, M_hash_concurrent_enum_t **hashenum);
+
+
+/*! Retrieve the next entry of an enumeration.
+ *
+ * \param[in,out] hashenum Enumeration.
+ * \param[out]    key      Next key. Optional, pass NULL if not needed.
+ * \param[out]    value    Next value. Optional, pass NULL if not needed.
+ *
+ * \return M_TRUE if an entry was returned. M_FALSE when there are no more entries.
+ */
+M_API M_bool M_hash_concurrent_enumerate_next(M_hash_concurrent_enum_t *hashenum, const void **key, void **value);
+
+
+/*! Destroy an enumeration.
+ *
+ * \param[in] hashenum Enumeration to destroy.
+ */
+M_API void M_hash_concurrent_enumerate_free(M_hash_concurrent_enum_t *hashenum);
+
+/*! @} */
+
+
+/*! \addtogroup m_hash_concurrent_strvp Concurrent Hashtable - String/Void Pointer
+ *  \ingroup    m_hash_concurrent
+ *
+ * Concurrent hashtable with string keys and void pointer values.
+ *
+ * @{
+ */
+
+struct M_hash_concurrent_strvp;
+typedef struct M_hash_concurrent_strvp M_hash_concurrent_strvp_t;
+
+/*! Create a new concurrent string/void pointer hashtable.
+ *
+ * \param[in] size         Size of each shard. Rounded up to the nearest power of 2.
+ * \param[in] fillpct      Maximum fill percentage of each shard before it's expanded. 0 to disable.
+ * \param[in] num_shards   Number of shards. 0 to choose a number based on the number of CPU cores.
+ * \param[in] flags        M_hash_strvp_flags_t flags for modifying behavior. Multi-value and key
+ *                         ordering flags are not supported.
+ * \param[in] destroy_func Function to destroy values. NULL if values should not be destroyed.
+ *
+ * \return Allocated hashtable.
+ */
+M_API M_hash_concurrent_strvp_t *M_hash_concurrent_strvp_create(size_t size, M_uint8 fillpct, size_t num_shards, M_uint32 flags, M_hashtable_free_func destroy_func);
+
+/*! Destroy the hashtable. \see M_hash_concurrent_destroy */
+M_API void M_hash_concurrent_strvp_destroy(M_hash_concurrent_strvp_t *h, M_bool destroy_vals) M_FREE(1);
+
+/*! Insert an entry. \see M_hash_concurrent_insert */
+M_API M_bool M_hash_concurrent_strvp_insert(M_hash_concurrent_strvp_t *h, const char *key, void *value);
+
+/*! Remove an entry. \see M_hash_concurrent_remove */
+M_API M_bool M_hash_concurrent_strvp_remove(M_hash_concurrent_strvp_t *h, const char *key, M_bool destroy_vals);
+
+/*! Retrieve a value. \see M_hash_concurrent_get */
+M_API M_bool M_hash_concurrent_strvp_get(M_hash_concurrent_strvp_t *h, const char *key, void **value);
+
+/*! Retrieve a value, creating it if it doesn't exist. The key passed to create_func is a const char *.
+ *  \see M_hash_concurrent_compute_if_absent */
+M_API void *M_hash_concurrent_strvp_compute_if_absent(M_hash_concurrent_strvp_t *h, const char *key, M_hash_concurrent_create_func create_func, void *thunk);
+
+/*! Number of keys. \see M_hash_concurrent_num_keys */
+M_API size_t M_hash_concurrent_strvp_num_keys(M_hash_concurrent_strvp_t *h);
+
+/*! Start an enumeration. \see M_hash_concurrent_enumerate */
+M_API size_t M_hash_concurrent_strvp_enumerate(M_hash_concurrent_strvp_t *h, M_hash_concurrent_enum_t **hashenum);
+
+/*! Retrieve the next entry of an enumeration. \see M_hash_concurrent_enumerate_next */
+M_API M_bool M_hash_concurrent_strvp_enumerate_next(M_hash_concurrent_enum_t *hashenum, const char **key, void **value);
+
+/*! @} */
+
+
+/*! \addtogroup m_hash_concurrent_u64vp Concurrent Hashtable - uint64/Void Pointer
+ *  \ingroup    m_hash_concurrent
+ *
+ * Concurrent hashtable with uint64 keys and void pointer values.
+ *
+ * @{
+ */
+
+struct M_hash_concurrent_u64vp;
+typedef struct M_hash_concurrent_u64vp M_hash_concurrent_u64vp_t;
+
+/*! Create a new concurrent uint64/void pointer hashtable.
+ *
+ * \param[in] size         Size of each shard. Rounded up to the nearest power of 2.
+ * \param[in] fillpct      Maximum fill percentage of each shard before it's expanded. 0 to disable.
+ * \param[in] num_shards   Number of shards. 0 to choose a number based on the number of CPU cores.
+ * \param[in] flags        M_hash_u64vp_flags_t flags for modifying behavior. Multi-value and key
+ *                         ordering flags are not supported.
+ * \param[in] destroy_func Function to destroy values. NULL if values should not be destroyed.
+ *
+ * \return Allocated hashtable.
+ */
+M_API M_hash_concurrent_u64vp_t *M_hash_concurrent_u64vp_create(size_t size, M_uint8 fillpct, size_t num_shards, M_uint32 flags, M_hashtable_free_func destroy_func);
+
+/*! Destroy the hashtable. \see M_hash_concurrent_destroy */
+M_API void M_hash_concurrent_u64vp_destroy(M_hash_concurrent_u64vp_t *h, M_bool destroy_vals) M_FREE(1);
+
+/*! Insert an entry. \see M_hash_concurrent_insert */
+M_API M_bool M_hash_concurrent_u64vp_insert(M_hash_concurrent_u64vp_t *h, M_uint64 key, void *value);
+
+/*! Remove an entry. \see M_hash_concurrent_remove */
+M_API M_bool M_hash_concurrent_u64vp_remove(M_hash_concurrent_u64vp_t *h, M_uint64 key, M_bool destroy_vals);
+
+/*! Retrieve a value. \see M_hash_concurrent_get */
+M_API M_bool M_hash_concurrent_u64vp_get(M_hash_concurrent_u64vp_t *h, M_uint64 key, void **value);
+
+/*! Retrieve a value, creating it if it doesn't exist. The key passed to create_func is a const M_uint64 *.
+ *  \see M_hash_concurrent_compute_if_absent */
+M_API void *M_hash_concurrent_u64vp_compute_if_absent(M_hash_concurrent_u64vp_t *h, M_uint64 key, M_hash_concurrent_create_func create_func, void *thunk);
+
+/*! Number of keys. \see M_hash_concurrent_num_keys */
+M_API size_t M_hash_concurrent_u64vp_num_keys(M_hash_concurrent_u64vp_t *h);
+
+/*! Start an enumeration. \see M_hash_concurrent_enumerate */
+M_API size_t M_hash_concurrent_u64vp_enumerate(M_hash_concurrent_u64vp_t *h, M_hash_concurrent_enum_t **hashenum);
+
+/*! Retrieve the next entry of an enumeration. \see M_hash_concurrent_enumerate_next */
+M_API M_bool M_hash_concurrent_u64vp_enumerate_next(M_hash_concurrent_enum_t *hashenum, M_uint64 *key, void **value);
+
+/*! @} */
+
+__END_DECLS
+
+#endif /* __M_HASH_CONCURRENT_H__ */
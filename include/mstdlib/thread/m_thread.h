@@ -173,6 +173,10 @@ M_API void M_thread_destructor_remove(void (*destructor)(void));
  *  be called at the end of program execution to free memory or other resources,
  *  especially if running under a leak checker such as Valgrind.
  *
+ *  Memory the calling thread holds for reuse (M_mempool_thread_flush(),
+ *  M_buf_pool_thread_flush()) is released as well. Other threads not created
+ *  with M_thread_create() must release their own before exiting.
+ *
  */
 M_API void M_library_cleanup(void);
 
@@ -205,6 +209,27 @@ M_API size_t M_thread_count(void);
 M_API size_t M_thread_num_cpu_cores(void);
 
 
+/*! Physical placement of a processor. */
+typedef struct {
+	size_t socket;    /*!< Physical package (socket) the processor is on. */
+	size_t core;      /*!< Physical core within the socket. SMT siblings (hyperthreads) share the same core. */
+	size_t numa_node; /*!< NUMA memory node local to the processor. */
+} M_thread_cpu_topology_t;
+
+
+/*! Retrieve the physical placement of a processor.
+ *
+ *  Processor ids are the same as used by M_thread_set_processor() so only processors
+ *  usable by the process (such as restricted by a cgroup cpuset) are considered.
+ *
+ *  \param[in]  processor_id 0 to M_thread_num_cpu_cores()-1.
+ *  \param[out] topology     Placement of the processor. Values are zero if unknown.
+ *
+ *  \return M_TRUE if the placement could be determined (currently Linux only), otherwise M_FALSE.
+ */
+M_API M_bool M_thread_get_processor_topology(int processor_id, M_thread_cpu_topology_t *topology);
+
+
 /*! @} */
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
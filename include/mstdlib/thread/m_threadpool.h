@@ -193,6 +193,25 @@ M_API void M_threadpool_dispatch(M_threadpool_parent_t *parent, void (*task)(voi
 M_API void M_threadpool_dispatch_notify(M_threadpool_parent_t *parent, void (*task)(void *), void **task_args, size_t num_tasks, void (*finished)(void *));
 
 
+/*! Dispatch a task to the threadpool that isn't tracked by a parent.
+ *
+ * For callers that can't wait for the task to complete, such as when the task
+ * may outlive the object that queued it. The task is responsible for cleaning up
+ * its argument. Tasks still queued when the threadpool is destroyed are not run.
+ *
+ * Unlike M_threadpool_dispatch() this never waits for a queue slot, it's meant
+ * to be safe to call from an event loop.
+ *
+ * \param[in] pool     Initialized threadpool.
+ * \param[in] task     Task callback.
+ * \param[in] task_arg Argument to pass to the task.
+ *
+ * \return M_TRUE if queued. M_FALSE if there are no queue slots available, the
+ *         task was not queued.
+ */
+M_API M_bool M_threadpool_dispatch_detached(M_threadpool_t *pool, void (*task)(void *), void *task_arg);
+
+
 /*! Count the number of queue slots available to be enqueued for a threadpool.
  *
  *  \param[in] pool initialized threadpool.
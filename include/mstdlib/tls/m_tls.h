@@ -28,6 +28,8 @@
 
 #include <mstdlib/base/m_defs.h>
 #include <mstdlib/base/m_types.h>
+#include <mstdlib/base/m_time.h>
+#include <mstdlib/thread/m_threadpool.h>
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
@@ -76,6 +78,38 @@ typedef enum {
 } M_tls_verify_level_t;
 
 
+/*! Directions of a connection handled by kernel TLS offload. */
+typedef enum {
+	M_TLS_KTLS_NONE = 0,      /*!< Records are handled by the TLS layer. */
+	M_TLS_KTLS_SEND = 1 << 0, /*!< The kernel encrypts written data. */
+	M_TLS_KTLS_RECV = 1 << 1  /*!< The kernel decrypts read data. */
+} M_tls_ktls_t;
+
+
+/*! External storage of server sessions.
+ *
+ * Lets sessions outlive the server context and be shared between processes, e.g.
+ * through a file or shared memory backed store, so clients can still resume after
+ * the server context is replaced or a worker restarts.
+ *
+ * Sessions are identified by an opaque id. The session data is serialized and
+ * contains the session's master secret. It must be protected accordingly.
+ *
+ * Callbacks can be called from any thread handling a connection and must be
+ * thread safe.
+ */
+struct M_tls_session_store_callbacks {
+	M_bool         (*store)(const unsigned char *id, size_t id_len, const unsigned char *data, size_t data_len, M_time_t expire, void *thunk);
+	                 /*!< Save a new session. expire is when the session is no longer valid.
+	                      Return M_FALSE if the session could not be stored. */
+	unsigned char *(*fetch)(const unsigned char *id, size_t id_len, size_t *data_len, void *thunk);
+	                 /*!< Look up a session. Return the data allocated with M_malloc(), which will be
+	                      freed by the TLS layer, or NULL if not found. */
+	void           (*remove)(const unsigned char *id, size_t id_len, void *thunk);
+	                 /*!< Remove a session that can no longer be used. Optional. */
+};
+
+
 /*! How the TLS stack was/is initialized.
  *
  * The TLS system uses OpenSSL as its back ends. It has global initialization
@@ -308,6 +342,81 @@ M_API M_bool M_tls_clientctx_set_verify_level(M_tls_clientctx_t *ctx, M_tls_veri
 M_API M_bool M_tls_clientctx_set_session_resumption(M_tls_clientctx_t *ctx, M_bool enable);
 
 
+/*! Set the limits of the session cache.
+ *
+ * Sessions from completed connections are kept for resuming later connections to
+ * the same host and port. Each session is used once.
+ *
+ * When the cache is full the oldest session is dropped. Sessions are also dropped
+ * once they expire, which is the lifetime given by the server unless max_age_s is
+ * shorter.
+ *
+ * Defaults to 1024 sessions with no additional age limit.
+ *
+ * \param[in] ctx          Client context.
+ * \param[in] max_sessions Maximum number of sessions to keep. 0 for no limit.
+ * \param[in] max_age_s    Maximum number of seconds a session is kept. 0 to use the session's lifetime.
+ *
+ * \return M_TRUE on success, otherwise M_FALSE on error.
+ */
+M_API M_bool M_tls_clientctx_set_session_cache(M_tls_clientctx_t *ctx, size_t max_sessions, M_uint64 max_age_s);
+
+
+/*! Enable or disable kernel TLS offload.
+ *
+ * Once the handshake completes the session keys are handed to the kernel, which then
+ * encrypts and decrypts records as data is written to and read from the socket. This
+ * saves copying every record through user memory and allows M_io_send_file() to send
+ * files over TLS without the file passing through user memory.
+ *
+ * Only applies when the TLS layer is added directly on top of a network connection,
+ * other layers below it would never see the data. Connections created with this
+ * enabled are not given the usual buffer layer below the TLS layer.
+ *
+ * If the OS, OpenSSL or the negotiated cipher don't support it the connection
+ * falls back to handling records itself. Use M_tls_get_ktls() to see if offload
+ * is in use for a connection.
+ *
+ * Disabled by default. Only affects connections created after it is set.
+ *
+ * \param[in] ctx    Client context.
+ * \param[in] enable M_TRUE to enable. M_FALSE to disable.
+ *
+ * \return M_TRUE on success, otherwise M_FALSE on error.
+ */
+M_API M_bool M_tls_clientctx_set_ktls(M_tls_clientctx_t *ctx, M_bool enable);
+
+
+/*! Run handshakes on a thread pool.
+ *
+ * Key exchange and certificate signing and verification are CPU heavy. Run inline
+ * they hold up every other connection on the event loop. With a pool set, each
+ * step of the handshake runs on a pool thread and the event loop only moves data
+ * between OpenSSL and the connection. The event loop is told when a step finishes.
+ *
+ * If every queue slot in the pool is in use the step runs on the event loop's
+ * thread instead of waiting for a slot.
+ *
+ * Connections using kernel TLS offload (M_tls_clientctx_set_ktls()) with OpenSSL
+ * talking directly to the socket always handshake on the event loop's thread.
+ *
+ * OpenSSL callbacks made during the handshake, such as session cache callbacks,
+ * are then called from pool threads.
+ *
+ * The pool must not be destroyed while connections created from the context
+ * exist or may still be created. Destroy it before the event loop the connections
+ * ran on, a step that just finished may still be telling the event loop about it.
+ * Handshake steps still queued when the pool is destroyed are dropped. Only
+ * affects connections created after it is set.
+ *
+ * \param[in] ctx  Client context.
+ * \param[in] pool Thread pool. NULL to handshake on the event loop's thread (default).
+ *
+ * \return M_TRUE on success, otherwise M_FALSE on error.
+ */
+M_API M_bool M_tls_clientctx_set_handshake_pool(M_tls_clientctx_t *ctx, M_threadpool_t *pool);
+
+
 /*! Retrieves a colon separated list of ciphers that are enabled.
  *
  * \param[in] ctx Client context.
@@ -653,6 +762,101 @@ M_API M_bool M_tls_serverctx_set_dhparam_file(M_tls_serverctx_t *ctx, const char
 M_API M_bool M_tls_serverctx_set_session_resumption(M_tls_serverctx_t *ctx, M_bool enable);
 
 
+/*! Set external storage for sessions.
+ *
+ * The store replaces the context's own session cache. New sessions are saved to
+ * it and looked up from it when a client asks to resume a session.
+ *
+ * Only used for sessions identified by the server (session ids). Clients that use
+ * session tickets carry the session themselves, see M_tls_serverctx_set_ticket_keys()
+ * for sharing tickets between contexts and M_tls_serverctx_set_session_tickets() for
+ * turning tickets off.
+ *
+ * Cannot be set on an SNI child context, the store of the parent is used.
+ *
+ * \param[in] ctx       Server context.
+ * \param[in] callbacks Store callbacks, copied. NULL to remove the store.
+ * \param[in] thunk     Argument passed to the callbacks.
+ *
+ * \return M_TRUE on success, otherwise M_FALSE on error.
+ */
+M_API M_bool M_tls_serverctx_set_session_store(M_tls_serverctx_t *ctx, const struct M_tls_session_store_callbacks *callbacks, void *thunk);
+
+
+/*! Enable or disable session tickets.
+ *
+ * With tickets the session is encrypted and handed to the client, the server does
+ * not need to store it. Without, sessions are kept by the server and the session
+ * store is used.
+ *
+ * Enabled by default. Cannot be set on an SNI child context.
+ *
+ * \param[in] ctx    Server context.
+ * \param[in] enable M_TRUE to enable. M_FALSE to disable.
+ *
+ * \return M_TRUE on success, otherwise M_FALSE on error.
+ */
+M_API M_bool M_tls_serverctx_set_session_tickets(M_tls_serverctx_t *ctx, M_bool enable);
+
+
+/*! Manage the keys used to encrypt session tickets.
+ *
+ * By default OpenSSL generates one random key per context which is never changed.
+ * Tickets can't be decrypted by any other context, so replacing the context (such
+ * as to load a new certificate) or restarting the process makes clients do a full
+ * handshake.
+ *
+ * With this set a new key is used every rotate_s seconds. Tickets encrypted with
+ * the previous key are still accepted, and are replaced with a new ticket, so a
+ * ticket is valid for up to two intervals. Rotation happens on interval boundaries
+ * of the wall clock.
+ *
+ * When a secret is given the keys are derived from it and the interval. Every
+ * context and process with the same secret and interval uses the same keys and
+ * accepts each other's tickets. The secret protects every session, keep it
+ * private and change it periodically. Without a secret the keys are random
+ * and only known to this context.
+ *
+ * Cannot be set on an SNI child context, the keys of the parent are used.
+ *
+ * \param[in] ctx        Server context.
+ * \param[in] secret     Secret to derive keys from. At least 32 bytes. NULL for random keys.
+ * \param[in] secret_len Length of secret.
+ * \param[in] rotate_s   Number of seconds each key is used for. 0 restores OpenSSL's handling.
+ *
+ * \return M_TRUE on success, otherwise M_FALSE on error.
+ */
+M_API M_bool M_tls_serverctx_set_ticket_keys(M_tls_serverctx_t *ctx, const unsigned char *secret, size_t secret_len, M_uint64 rotate_s);
+
+
+/*! Enable or disable kernel TLS offload.
+ *
+ * See M_tls_clientctx_set_ktls(). Cannot be set on an SNI child context, the
+ * setting of the parent is used.
+ *
+ * Disabled by default. Only affects listeners and connections created after it is set.
+ *
+ * \param[in] ctx    Server context.
+ * \param[in] enable M_TRUE to enable. M_FALSE to disable.
+ *
+ * \return M_TRUE on success, otherwise M_FALSE on error.
+ */
+M_API M_bool M_tls_serverctx_set_ktls(M_tls_serverctx_t *ctx, M_bool enable);
+
+
+/*! Run handshakes on a thread pool.
+ *
+ * See M_tls_clientctx_set_handshake_pool(). Cannot be set on an SNI child context,
+ * the setting of the parent is used.
+ *
+ * \param[in] ctx  Server context.
+ * \param[in] pool Thread pool. NULL to handshake on the event loop's thread (default).
+ *
+ * \return M_TRUE on success, otherwise M_FALSE on error.
+ */
+M_API M_bool M_tls_serverctx_set_handshake_pool(M_tls_serverctx_t *ctx, M_threadpool_t *pool);
+
+
 /*! Retrieves a colon separated list of ciphers that are enabled.
  *
  * \param[in] ctx Server context.
@@ -767,6 +971,19 @@ M_API char *M_tls_get_peer_cert(M_io_t *io, size_t id);
 M_API M_uint64 M_tls_get_negotiation_time_ms(M_io_t *io, size_t id);
 
 
+/*! Which directions of the connection are handled by the kernel.
+ *
+ * \param[in] io io object.
+ * \param[in] id Layer id.
+ *
+ * \return M_tls_ktls_t flags. M_TLS_KTLS_NONE if offload isn't enabled or isn't in use.
+ *
+ * \see M_tls_clientctx_set_ktls
+ * \see M_tls_serverctx_set_ktls
+ */
+M_API M_tls_ktls_t M_tls_get_ktls(M_io_t *io, size_t id);
+
+
 /*! Convert a protocol to string.
  *
  * Only single protocol should be specified. If multiple are provided
@@ -49,6 +49,95 @@ const char *M_event_type_string(M_event_type_t type)
 	return "UNKNOWN";
 }
 
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+/* NOTE: event handle must be locked when calling the io queue functions */
+
+static void M_event_ioqueue_init(M_event_ioqueue_t *queue, size_t offset)
+{
+	queue->head   = NULL;
+	queue->tail   = NULL;
+	queue->offset = offset;
+}
+
+
+static M_event_ioqueue_entry_t *M_event_ioqueue_entry(const M_event_ioqueue_t *queue, M_io_t *io)
+{
+	return (M_event_ioqueue_entry_t *)(void *)(((unsigned char *)io) + queue->offset);
+}
+
+
+/*! Append to the end of the queue if not already queued, returns the entry */
+static M_event_ioqueue_entry_t *M_event_ioqueue_push(M_event_ioqueue_t *queue, M_io_t *io)
+{
+	M_event_ioqueue_entry_t *entry = M_event_ioqueue_entry(queue, io);
+
+	if (entry->queued)
+		return entry;
+
+	entry->queued = M_TRUE;
+	entry->prev   = queue->tail;
+	entry->next   = NULL;
+	if (queue->tail != NULL) {
+		M_event_ioqueue_entry(queue, queue->tail)->next = io;
+	} else {
+		queue->head = io;
+	}
+	queue->tail = io;
+
+	return entry;
+}
+
+
+/*! Unlink from the queue, events are left alone */
+static void M_event_ioqueue_remove(M_event_ioqueue_t *queue, M_io_t *io)
+{
+	M_event_ioqueue_entry_t *entry = M_event_ioqueue_entry(queue, io);
+
+	if (!entry->queued)
+		return;
+
+	if (entry->prev != NULL) {
+		M_event_ioqueue_entry(queue, entry->prev)->next = entry->next;
+	} else {
+		queue->head = entry->next;
+	}
+	if (entry->next != NULL) {
+		M_event_ioqueue_entry(queue, entry->next)->prev = entry->prev;
+	} else {
+		queue->tail = entry->prev;
+	}
+	entry->prev   = NULL;
+	entry->next   = NULL;
+	entry->queued = M_FALSE;
+}
+
+
+/*! Unlink and return the first io object, or NULL if empty */
+static M_io_t *M_event_ioqueue_pop(M_event_ioqueue_t *queue)
+{
+	M_io_t *io = queue->head;
+
+	if (io != NULL)
+		M_event_ioqueue_remove(queue, io);
+	return io;
+}
+
+
+/*! Unlink everything and drop any queued events */
+static void M_event_ioqueue_clear(M_event_ioqueue_t *queue)
+{
+	M_io_t *io;
+
+	while ((io = M_event_ioqueue_pop(queue)) != NULL) {
+		M_mem_set(M_event_ioqueue_entry(queue, io)->events, 0, sizeof(M_event_ioqueue_entry(queue, io)->events));
+	}
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
 static void M_event_io_unregister(M_io_t *comm, M_bool in_destructor)
 {
 	size_t     i;
@@ -100,26 +189,22 @@ static void M_event_loop_init(M_event_t *event, M_uint32 flags)
 		NULL,  /* value_equality */
 		M_free /* value_free */
 	};
-	struct M_llist_callbacks softevent_cbs = {
-		NULL,  /* equality */
-		NULL,  /* duplicate_insert */
-		NULL,  /* duplicate_copy */
-		M_free /* value_free */
-	};
 	M_thread_model_t threadmodel;
 
 	event->type                 = M_EVENT_BASE_TYPE_LOOP;
 	event->u.loop.lock          = M_thread_mutex_create(M_THREAD_MUTEXATTR_RECURSIVE);
 	event->u.loop.flags         = flags;
 	event->u.loop.status        = M_EVENT_STATUS_PAUSED;
+	event->u.loop.busy_poll_us  = M_EVENT_BUSY_POLL_DEFAULT_US;
+	M_time_elapsed_start(&event->u.loop.load_tv);
 
 	/* On destroy, this will auto-unregister all registered M_io_t * objects */
-	event->u.loop.reg_ios       = M_hashtable_create(16, 72, M_hash_func_hash_vp, M_sort_compar_vp, M_HASHTABLE_NONE, &member_cbs);
+	event->u.loop.reg_ios       = M_hashtable_create(16, 72, M_hash_func_default_vp(), M_sort_compar_vp, M_HASHTABLE_NONE, &member_cbs);
 
 	event->u.loop.evhandles     = M_hash_u64vp_create(16, 72, M_HASH_U64VP_NONE, NULL);
 
-	/* On destroy, this will auto-free any soft event handles left over */
-	event->u.loop.soft_events   = M_llist_create(&softevent_cbs, M_LLIST_NONE);
+	M_event_ioqueue_init(&event->u.loop.soft_events, offsetof(M_io_t, softevent));
+	M_event_ioqueue_init(&event->u.loop.pending_events, offsetof(M_io_t, pending));
 
 #if defined(_WIN32)
 	event->u.loop.impl          = &M_event_impl_win32;
@@ -132,6 +217,10 @@ static void M_event_loop_init(M_event_t *event, M_uint32 flags)
 #elif defined(HAVE_EPOLL)
 	if (flags & M_EVENT_FLAG_NON_SCALABLE) {
 		event->u.loop.impl      = &M_event_impl_poll;
+#  if defined(HAVE_IO_URING)
+	} else if (flags & M_EVENT_FLAG_IO_URING) {
+		event->u.loop.impl      = &M_event_impl_io_uring;
+#  endif
 	} else {
 		event->u.loop.impl      = &M_event_impl_epoll;
 	}
@@ -163,37 +252,180 @@ M_event_t *M_event_create(M_uint32 flags)
 }
 
 
-M_event_t *M_event_pool_create(size_t max_threads)
+typedef struct {
+	int                     id;
+	M_thread_cpu_topology_t topo;
+	size_t                  sibling; /*!< SMT sibling index on the physical core */
+	size_t                  rank;    /*!< Position within the node/socket in compact order */
+} M_event_pool_cpu_t;
+
+
+static int M_event_pool_cpu_compar_compact(const void *arg1, const void *arg2, void *thunk)
 {
-	size_t     num_threads;
-	size_t     i;
-	M_event_t *event;
+	const M_event_pool_cpu_t *c1 = arg1;
+	const M_event_pool_cpu_t *c2 = arg2;
+
+	(void)thunk;
+
+	if (c1->topo.numa_node != c2->topo.numa_node)
+		return (c1->topo.numa_node < c2->topo.numa_node)?-1:1;
+	if (c1->topo.socket != c2->topo.socket)
+		return (c1->topo.socket < c2->topo.socket)?-1:1;
+	if (c1->sibling != c2->sibling)
+		return (c1->sibling < c2->sibling)?-1:1;
+	if (c1->topo.core != c2->topo.core)
+		return (c1->topo.core < c2->topo.core)?-1:1;
+	if (c1->id != c2->id)
+		return (c1->id < c2->id)?-1:1;
+	return 0;
+}
+
+
+static int M_event_pool_cpu_compar_scatter(const void *arg1, const void *arg2, void *thunk)
+{
+	const M_event_pool_cpu_t *c1 = arg1;
+	const M_event_pool_cpu_t *c2 = arg2;
+
+	if (c1->rank != c2->rank)
+		return (c1->rank < c2->rank)?-1:1;
+	return M_event_pool_cpu_compar_compact(arg1, arg2, thunk);
+}
+
+
+/*! Order usable processors according to the placement policy.
+ *
+ * \return Number of processors in cpus_out.
+ */
+static size_t M_event_pool_cpus(M_event_pool_placement_t placement, const int *processors, size_t num_processors, M_event_pool_cpu_t **cpus_out)
+{
+	M_event_pool_cpu_t *cpus;
+	size_t              num_cores = M_thread_num_cpu_cores();
+	size_t              cnt       = 0;
+	size_t              i;
+	size_t              j;
+
+	if (num_cores == 0)
+		num_cores = 1;
+
+	if (processors == NULL || num_processors == 0)
+		num_processors = num_cores;
+
+	cpus = M_malloc_zero(sizeof(*cpus) * num_processors);
+	for (i=0; i<num_processors; i++) {
+		int id = (processors != NULL)?processors[i]:(int)i;
+
+		if (id < 0 || (size_t)id >= num_cores)
+			continue;
+
+		/* Ignore duplicates */
+		for (j=0; j<cnt && cpus[j].id != id; j++)
+			;
+		if (j != cnt)
+			continue;
+
+		cpus[cnt].id = id;
+		M_thread_get_processor_topology(id, &cpus[cnt].topo);
+		for (j=0; j<cnt; j++) {
+			if (cpus[j].topo.numa_node == cpus[cnt].topo.numa_node && cpus[j].topo.socket == cpus[cnt].topo.socket && cpus[j].topo.core == cpus[cnt].topo.core)
+				cpus[cnt].sibling++;
+		}
+		cnt++;
+	}
+
+	if (placement == M_EVENT_POOL_PLACEMENT_COMPACT || placement == M_EVENT_POOL_PLACEMENT_SCATTER)
+		M_sort_qsort(cpus, cnt, sizeof(*cpus), M_event_pool_cpu_compar_compact, NULL);
+
+	if (placement == M_EVENT_POOL_PLACEMENT_SCATTER) {
+		/* Take the first processor of every node/socket, then the second, etc. */
+		for (i=0; i<cnt; i++) {
+			if (i > 0 && cpus[i].topo.numa_node == cpus[i-1].topo.numa_node && cpus[i].topo.socket == cpus[i-1].topo.socket) {
+				cpus[i].rank = cpus[i-1].rank + 1;
+			}
+		}
+		M_sort_qsort(cpus, cnt, sizeof(*cpus), M_event_pool_cpu_compar_scatter, NULL);
+	}
+
+	*cpus_out = cpus;
+	return cnt;
+}
+
+
+/* Loops in a pool run on different processors so they must not share a cache
+ * line. Each one gets its own allocation that starts on a cache line and is
+ * padded out to one. The start of the allocation is stored just before the loop. */
+#define M_EVENT_CACHE_LINE 64
+
+static M_event_t *M_event_pool_loop_alloc(void)
+{
+	unsigned char *mem;
+	unsigned char *ptr;
+	size_t         len;
+
+	len = ((sizeof(M_event_t) + M_EVENT_CACHE_LINE - 1) / M_EVENT_CACHE_LINE) * M_EVENT_CACHE_LINE;
+	mem = M_malloc_zero(sizeof(mem) + (M_EVENT_CACHE_LINE - 1) + len);
+	ptr = mem + sizeof(mem);
+	ptr += (M_EVENT_CACHE_LINE - ((M_uintptr)ptr % M_EVENT_CACHE_LINE)) % M_EVENT_CACHE_LINE;
+	M_mem_copy(ptr - sizeof(mem), &mem, sizeof(mem));
+
+	return (M_event_t *)(void *)ptr;
+}
+
+static void M_event_pool_loop_free(M_event_t *loop)
+{
+	unsigned char *mem;
+
+	M_mem_copy(&mem, (unsigned char *)loop - sizeof(mem), sizeof(mem));
+	M_free(mem);
+}
+
+
+M_event_t *M_event_pool_create_placement(size_t max_threads, M_event_pool_placement_t placement, const int *processors, size_t num_processors)
+{
+	size_t              num_threads;
+	size_t              i;
+	M_event_t          *event;
+	M_event_pool_cpu_t *cpus = NULL;
 
 	if (max_threads == 0)
 		max_threads = SIZE_MAX;
 
-	num_threads = M_MIN(M_thread_num_cpu_cores(), max_threads);
+	num_threads = M_event_pool_cpus(placement, processors, num_processors, &cpus);
+	num_threads = M_MIN(num_threads, max_threads);
 	if (num_threads == 0)
 		num_threads = 1;
 
 	/* If there's only one core, we won't create a pool */
-	if (num_threads == 1)
+	if (num_threads == 1) {
+		M_free(cpus);
 		return M_event_create(M_EVENT_FLAG_NONE);
+	}
 
-	event                       = M_malloc_zero(sizeof(*event));
-	event->type                 = M_EVENT_BASE_TYPE_POOL;
-	event->u.pool.thread_count  = num_threads;
-	event->u.pool.thread_ids    = M_malloc_zero(sizeof(*event->u.pool.thread_ids)    * num_threads);
-	event->u.pool.thread_evloop = M_malloc_zero(sizeof(*event->u.pool.thread_evloop) * num_threads);
+	event                           = M_malloc_zero(sizeof(*event));
+	event->type                     = M_EVENT_BASE_TYPE_POOL;
+	event->u.pool.thread_count      = num_threads;
+	event->u.pool.thread_ids        = M_malloc_zero(sizeof(*event->u.pool.thread_ids)        * num_threads);
+	event->u.pool.thread_processors = M_malloc_zero(sizeof(*event->u.pool.thread_processors) * num_threads);
+	event->u.pool.thread_evloop     = M_malloc_zero(sizeof(*event->u.pool.thread_evloop)     * num_threads);
 	for (i=0; i<num_threads; i++) {
-		M_event_loop_init(&event->u.pool.thread_evloop[i], M_EVENT_FLAG_NONE);
-		event->u.pool.thread_evloop[i].u.loop.parent = event;
+		event->u.pool.thread_evloop[i]                = M_event_pool_loop_alloc();
+		M_event_loop_init(event->u.pool.thread_evloop[i], M_EVENT_FLAG_NONE);
+		event->u.pool.thread_evloop[i]->u.loop.parent = event;
+		event->u.pool.thread_processors[i]           = (placement == M_EVENT_POOL_PLACEMENT_NONE)?-1:cpus[i].id;
 	}
 
+	M_free(cpus);
 	return event;
 }
 
 
+M_event_t *M_event_pool_create(size_t max_threads)
+{
+	return M_event_pool_create_placement(max_threads, M_EVENT_POOL_PLACEMENT_CORE, NULL, 0);
+}
+
+
+static void M_event_task_destroy_all(M_event_t *event);
+
 static void M_event_destroy_loop(M_event_t *event)
 {
 	M_event_lock(event);
@@ -202,6 +434,11 @@ static void M_event_destroy_loop(M_event_t *event)
 		M_io_destroy(event->u.loop.parent_wake);
 	event->u.loop.parent_wake          = NULL;
 
+	/* Soft events aren't cleared when unregistering from a destructor, and the
+	 * io objects may not outlive unregistering */
+	M_event_ioqueue_clear(&event->u.loop.soft_events);
+	M_event_ioqueue_clear(&event->u.loop.pending_events);
+
 	/* Should unregister self from every registered COMM handle */
 	M_hashtable_destroy(event->u.loop.reg_ios, M_TRUE);
 	event->u.loop.reg_ios              = NULL;
@@ -213,13 +450,8 @@ static void M_event_destroy_loop(M_event_t *event)
 	M_hash_u64vp_destroy(event->u.loop.evhandles, M_TRUE);
 	event->u.loop.evhandles            = NULL;
 
-	/* Should auto-destroy any lingering soft event handles automatically */
-	M_llist_destroy(event->u.loop.soft_events, M_TRUE);
-	event->u.loop.soft_events          = NULL;
-
-	/* Should auto-destroy any lingering timer handles automatically */
-	M_queue_destroy(event->u.loop.timers);
-	event->u.loop.timers        = NULL;
+	M_event_timer_destroy_all(event);
+	M_event_task_destroy_all(event);
 
 	if (event->u.loop.impl_data != NULL) {
 		if (event->u.loop.impl->data_free != NULL) {
@@ -228,6 +460,9 @@ static void M_event_destroy_loop(M_event_t *event)
 		event->u.loop.impl_data = NULL;
 	}
 
+	M_free(event->u.loop.histograms);
+	event->u.loop.histograms = NULL;
+
 	M_event_unlock(event);
 	M_thread_mutex_destroy(event->u.loop.lock);
 }
@@ -265,10 +500,12 @@ void M_event_destroy(M_event_t *event)
 	} else {
 		size_t i;
 		for (i=0; i<event->u.pool.thread_count; i++) {
-			M_event_destroy_loop(&event->u.pool.thread_evloop[i]);
+			M_event_destroy_loop(event->u.pool.thread_evloop[i]);
+			M_event_pool_loop_free(event->u.pool.thread_evloop[i]);
 		}
 		M_free(event->u.pool.thread_evloop);
 		M_free(event->u.pool.thread_ids);
+		M_free(event->u.pool.thread_processors);
 	}
 
 	M_free(event);
@@ -288,9 +525,8 @@ void M_io_set_error(M_io_t *io, M_io_error_t err)
 
 void M_io_softevent_add(M_io_t *io, size_t layer_id, M_event_type_t type, M_io_error_t err)
 {
-	M_event_t            *event  = M_io_get_event(io);
-	M_event_io_t         *ioev   = NULL;
-	M_event_softevent_t  *softevent;
+	M_event_t               *event = M_io_get_event(io);
+	M_event_ioqueue_entry_t *softevent;
 
 	/* Its possible someone could try to reference an io object that is not currently
 	 * associated with an event object.  In which case, we just ignore this request */
@@ -305,15 +541,13 @@ void M_io_softevent_add(M_io_t *io, size_t layer_id, M_event_type_t type, M_io_e
 	if (io->flags & M_IO_FLAG_USER_DESTROY)
 		goto done;
 
-	if (M_hashtable_get(event->u.loop.reg_ios, io, (void **)&ioev)) {
+	/* Already delivered on the loop the io object came from */
+	if (io->flags & M_IO_FLAG_MIGRATING && type == M_EVENT_TYPE_CONNECTED)
+		goto done;
+
+	if (M_hashtable_get(event->u.loop.reg_ios, io, NULL)) {
 		M_uint16 ev;
-		if (ioev->softevent_node == NULL) {
-			softevent            = M_malloc_zero(sizeof(*softevent));
-			softevent->io        = io;
-			ioev->softevent_node = M_llist_insert(event->u.loop.soft_events, softevent);
-		} else {
-			softevent            = M_llist_node_val(ioev->softevent_node);
-		}
+		softevent = M_event_ioqueue_push(&event->u.loop.soft_events, io);
 		ev = (M_uint16)(1 << type);
 		softevent->events[layer_id] |= ev;
 //M_printf("%s(): softevent io %p layer %zu type %d\n", __FUNCTION__, io, layer_id, (int)type);
@@ -332,13 +566,13 @@ done:
 
 }
 
-static M_bool M_io_layer_softevent_is_empty(M_io_t *io, M_event_softevent_t *softevent)
+static M_bool M_io_layer_softevent_is_empty(M_io_t *io)
 {
 	size_t num_layers = M_io_layer_count(io) + 1;
 	size_t i;
 
 	for (i=0; i<num_layers; i++) {
-		if (softevent->events[i] != 0)
+		if (io->softevent.events[i] != 0)
 			return M_FALSE;
 	}
 	return M_TRUE;
@@ -365,8 +599,6 @@ void M_io_user_softevent_add(M_io_t *io, M_event_type_t type, M_io_error_t err)
 static void M_io_softevent_clear(M_io_t *io, size_t layer_id)
 {
 	M_event_t            *event = M_io_get_event(io);
-	M_event_io_t         *ioev  = NULL;
-	M_event_softevent_t  *softevent;
 
 	if (layer_id >= M_io_layer_count(io) + 1 /* User layer */)
 		return;
@@ -376,14 +608,10 @@ static void M_io_softevent_clear(M_io_t *io, size_t layer_id)
 
 	M_event_lock(event);
 
-	if (M_hashtable_get(event->u.loop.reg_ios, io, (void **)&ioev)) {
-		if (ioev->softevent_node != NULL) {
-			softevent                   = M_llist_node_val(ioev->softevent_node);
-			softevent->events[layer_id] = 0;
-			if (M_io_layer_softevent_is_empty(io, softevent)) {
-				M_llist_remove_node(ioev->softevent_node);
-				ioev->softevent_node = NULL;
-			}
+	if (io->softevent.queued && M_hashtable_get(event->u.loop.reg_ios, io, NULL)) {
+		io->softevent.events[layer_id] = 0;
+		if (M_io_layer_softevent_is_empty(io)) {
+			M_event_ioqueue_remove(&event->u.loop.soft_events, io);
 		}
 	}
 
@@ -403,37 +631,31 @@ void M_io_layer_softevent_clear(M_io_layer_t *layer)
 void M_io_softevent_clearall(M_io_t *io, M_bool nonerror_only)
 {
 	M_event_t            *event = M_io_get_event(io);
-	M_event_io_t         *ioev  = NULL;
 //M_printf("%s(): io = %p\n", __FUNCTION__, io);
 	if (event == NULL || event->type != M_EVENT_BASE_TYPE_LOOP)
 		return;
 
 	M_event_lock(event);
 
-	if (M_hashtable_get(event->u.loop.reg_ios, io, (void **)&ioev)) {
-		if (ioev->softevent_node != NULL) {
-			M_event_softevent_t  *softevent = M_llist_node_val(ioev->softevent_node);
-			size_t                num       = M_io_layer_count(io);
-			size_t                layer_id;
-
-			if (softevent) {
-				for (layer_id=0; layer_id <= num /* <= as num is user layer */; layer_id++) {
-					if (nonerror_only) {
-						softevent->events[layer_id]    &= (M_uint16)((~(1 << M_EVENT_TYPE_CONNECTED)) & 0xFFFF);
-						softevent->events[layer_id]    &= (M_uint16)((~(1 << M_EVENT_TYPE_ACCEPT))    & 0xFFFF);
-						softevent->events[layer_id]    &= (M_uint16)((~(1 << M_EVENT_TYPE_READ))      & 0xFFFF);
-						softevent->events[layer_id]    &= (M_uint16)((~(1 << M_EVENT_TYPE_WRITE))     & 0xFFFF);
-						softevent->events[layer_id]    &= (M_uint16)((~(1 << M_EVENT_TYPE_OTHER))     & 0xFFFF);
-					} else {
-						softevent->events[layer_id]     = 0;
-					}
-				}
-				if (M_io_layer_softevent_is_empty(io, softevent)) {
-					M_llist_remove_node(ioev->softevent_node);
-					ioev->softevent_node = NULL;
-				}
+	if (io->softevent.queued && M_hashtable_get(event->u.loop.reg_ios, io, NULL)) {
+		M_uint16 *events   = io->softevent.events;
+		size_t    num      = M_io_layer_count(io);
+		size_t    layer_id;
+
+		for (layer_id=0; layer_id <= num /* <= as num is user layer */; layer_id++) {
+			if (nonerror_only) {
+				events[layer_id]    &= (M_uint16)((~(1 << M_EVENT_TYPE_CONNECTED)) & 0xFFFF);
+				events[layer_id]    &= (M_uint16)((~(1 << M_EVENT_TYPE_ACCEPT))    & 0xFFFF);
+				events[layer_id]    &= (M_uint16)((~(1 << M_EVENT_TYPE_READ))      & 0xFFFF);
+				events[layer_id]    &= (M_uint16)((~(1 << M_EVENT_TYPE_WRITE))     & 0xFFFF);
+				events[layer_id]    &= (M_uint16)((~(1 << M_EVENT_TYPE_OTHER))     & 0xFFFF);
+			} else {
+				events[layer_id]     = 0;
 			}
 		}
+		if (M_io_layer_softevent_is_empty(io)) {
+			M_event_ioqueue_remove(&event->u.loop.soft_events, io);
+		}
 	}
 
 	M_event_unlock(event);
@@ -443,8 +665,6 @@ void M_io_softevent_clearall(M_io_t *io, M_bool nonerror_only)
 static void M_io_softevent_del(M_io_t *io, size_t layer_id, M_event_type_t type)
 {
 	M_event_t            *event = M_io_get_event(io);
-	M_event_io_t         *ioev  = NULL;
-	M_event_softevent_t  *softevent;
 //M_printf("%s(): io = %p, layer %zu, type %d\n", __FUNCTION__, io, layer_id, (int)type);
 
 	if (layer_id >= M_io_layer_count(io) + 1 /* User layer */)
@@ -455,14 +675,10 @@ static void M_io_softevent_del(M_io_t *io, size_t layer_id, M_event_type_t type)
 
 	M_event_lock(event);
 
-	if (M_hashtable_get(event->u.loop.reg_ios, io, (void **)&ioev)) {
-		if (ioev->softevent_node != NULL) {
-			softevent                   = M_llist_node_val(ioev->softevent_node);
-			softevent->events[layer_id] &= (M_uint16)((~(1 << type)) & 0xFFFF);
-			if (M_io_layer_softevent_is_empty(io, softevent)) {
-				M_llist_remove_node(ioev->softevent_node);
-				ioev->softevent_node = NULL;
-			}
+	if (io->softevent.queued && M_hashtable_get(event->u.loop.reg_ios, io, NULL)) {
+		io->softevent.events[layer_id] &= (M_uint16)((~(1 << type)) & 0xFFFF);
+		if (M_io_layer_softevent_is_empty(io)) {
+			M_event_ioqueue_remove(&event->u.loop.soft_events, io);
 		}
 	}
 
@@ -585,6 +801,65 @@ cleanup:
 }
 
 
+M_uint64 M_event_elapsed_us(const M_timeval_t *start_tv)
+{
+	M_timeval_t curr_tv;
+	M_int64     usec;
+
+	M_time_elapsed_start(&curr_tv);
+	usec = ((curr_tv.tv_sec - start_tv->tv_sec) * 1000000) + (curr_tv.tv_usec - start_tv->tv_usec);
+	if (usec < 0)
+		return 0;
+	return (M_uint64)usec;
+}
+
+
+/*! Load of an event loop as of now. Must be called with the event lock held. */
+static M_uint64 M_event_load_current(M_event_t *event)
+{
+	M_uint64 elapsed_ms;
+	M_uint64 load = event->u.loop.load_us;
+
+	if (load == 0)
+		return 0;
+
+	elapsed_ms = M_event_elapsed_us(&event->u.loop.load_tv) / 1000;
+	if (elapsed_ms / M_EVENT_LOAD_HALFLIFE_MS >= 64)
+		return 0;
+
+	/* Halve for each full half life, then linear within the remaining one */
+	load >>= elapsed_ms / M_EVENT_LOAD_HALFLIFE_MS;
+	load  -= (load * (elapsed_ms % M_EVENT_LOAD_HALFLIFE_MS)) / (2 * M_EVENT_LOAD_HALFLIFE_MS);
+	return load;
+}
+
+
+static M_event_t *M_event_distribute_least(M_event_t *event, M_bool by_load)
+{
+	M_event_t *best_event = NULL;
+	M_uint64   best       = 0;
+	size_t     i;
+
+	for (i=0; i<event->u.pool.thread_count; i++) {
+		M_event_t *loop = event->u.pool.thread_evloop[i];
+		M_uint64   curr;
+
+		if (by_load) {
+			curr = M_event_get_statistic(loop, M_EVENT_STATISTIC_LOAD_US);
+		} else {
+			curr = M_event_num_objects(loop);
+		}
+
+		if (best_event == NULL || curr < best) {
+			best_event = loop;
+			best       = curr;
+		}
+	}
+
+	return best_event;
+}
+
+
 M_event_t *M_event_distribute(M_event_t *event)
 {
 	M_event_t *best_event       = NULL;
@@ -598,14 +873,26 @@ M_event_t *M_event_distribute(M_event_t *event)
 	if (event->type == M_EVENT_BASE_TYPE_LOOP)
 		return event;
 
+	switch (event->u.pool.distribute) {
+		case M_EVENT_DISTRIBUTE_ROUND_ROBIN:
+			i = (size_t)(M_atomic_inc_u64(&event->u.pool.rr_next) % event->u.pool.thread_count);
+			return event->u.pool.thread_evloop[i];
+		case M_EVENT_DISTRIBUTE_LEAST_OBJECTS:
+			return M_event_distribute_least(event, M_FALSE);
+		case M_EVENT_DISTRIBUTE_LOAD:
+			return M_event_distribute_least(event, M_TRUE);
+		case M_EVENT_DISTRIBUTE_PROCESS_TIME:
+			break;
+	}
+
 	/* If a pool, choose the best thread */
 	for (i=0; i<event->u.pool.thread_count; i++) {
-		M_uint64 curr_time  = M_event_get_statistic(&event->u.pool.thread_evloop[i], M_EVENT_STATISTIC_PROCESS_TIME_MS);
-		size_t   curr_count = M_event_num_objects(&event->u.pool.thread_evloop[i]);
+		M_uint64 curr_time  = M_event_get_statistic(event->u.pool.thread_evloop[i], M_EVENT_STATISTIC_PROCESS_TIME_MS);
+		size_t   curr_count = M_event_num_objects(event->u.pool.thread_evloop[i]);
 
 		/* If the event loop has nothing, it automatically wins */
 		if (curr_count == 0)
-			return &event->u.pool.thread_evloop[i];
+			return event->u.pool.thread_evloop[i];
 
 		/* Worse match */
 		if (best_event != NULL && curr_time > best_event_time)
@@ -616,7 +903,7 @@ M_event_t *M_event_distribute(M_event_t *event)
 			continue;
 
 		/* Best so far */
-		best_event       = &event->u.pool.thread_evloop[i];
+		best_event       = event->u.pool.thread_evloop[i];
 		best_event_time  = curr_time;
 		best_event_count = curr_count;
 	}
@@ -771,45 +1058,120 @@ void M_event_remove(M_io_t *io)
 }
 
 
+/* Tasks are pushed onto a lock free stack by any thread and the event loop
+ * takes the whole stack at once, so there's no ABA problem with multiple
+ * producers and a single consumer. */
+typedef struct M_event_task {
+	struct M_event_task *next;
+	M_event_callback_t   callback;
+	void                *cb_data;
+} M_event_task_t;
+
+
+/*! Atomically take all queued tasks, returned oldest first. */
+static M_event_task_t *M_event_task_take_all(M_event_t *event)
+{
+	M_event_task_t *task;
+	M_event_task_t *next;
+	M_event_task_t *list = NULL;
+	M_uint64        head;
+
+	do {
+		head = event->u.loop.tasks;
+		if (head == 0)
+			return NULL;
+	} while (!M_atomic_cas64(&event->u.loop.tasks, head, 0));
+
+	/* Reverse so tasks run in the order they were queued */
+	for (task = (M_event_task_t *)((M_uintptr)head); task != NULL; task = next) {
+		next       = task->next;
+		task->next = list;
+		list       = task;
+	}
+
+	return list;
+}
+
+
 M_bool M_event_queue_task(M_event_t *event, M_event_callback_t callback, void *cb_data)
 {
-	M_event_timer_t *timer;
+	M_event_task_t *task;
+	M_uint64        head;
+
+	if (event == NULL || callback == NULL)
+		return M_FALSE;
 
-	timer = M_event_timer_oneshot(event, 0, M_TRUE, callback, cb_data);
+	/* Balance if pool provided */
+	event          = M_event_distribute(event);
 
-	if (timer != NULL) {
-		return M_TRUE;
+	task           = M_mempool_malloc(sizeof(*task));
+	task->callback = callback;
+	task->cb_data  = cb_data;
+
+	do {
+		head       = event->u.loop.tasks;
+		task->next = (M_event_task_t *)((M_uintptr)head);
+	} while (!M_atomic_cas64(&event->u.loop.tasks, head, (M_uint64)((M_uintptr)task)));
+
+	/* Only the task that made the queue non-empty has to wake the loop, anything
+	 * queued after it is picked up by the same drain. The loop checks for tasks
+	 * under the lock before it waits so taking it here can't miss the wake. */
+	if (head == 0) {
+		M_event_lock(event);
+		M_event_wake(event);
+		M_event_unlock(event);
 	}
 
-	return M_FALSE;
+	return M_TRUE;
 }
 
 
-static void M_event_queue_pending(M_event_t *event, M_io_t *io, size_t layer_id, M_event_type_t type)
+/* NOTE: event handle must be locked when this function is called */
+static void M_event_task_process(M_event_t *event)
 {
-	M_event_pending_t *entry  = NULL;
-	size_t             i;
-	M_uint16           ev;
+	M_event_task_t *task;
+	M_event_task_t *list;
+	size_t          cnt = 0;
+
+	list = M_event_task_take_all(event);
+	if (list == NULL)
+		return;
 
-	/* If this is the first event, create the container */
-	if (event->u.loop.pending_events == NULL) {
-		const struct M_hashtable_callbacks pending_events_cb = {
-			NULL,
-			NULL,
-			NULL,
-			NULL,
-			NULL,
-			NULL,
-			M_free
-		};
-		event->u.loop.pending_events = M_hashtable_create(16, 75, NULL, NULL, M_HASHTABLE_KEYS_ORDERED, &pending_events_cb);
+	while (list != NULL) {
+		task = list;
+		list = task->next;
+		/* Unlocks event lock since the callback may take some time */
+		M_event_callback_call(event, task->callback, M_EVENT_TYPE_OTHER, NULL, task->cb_data);
+		M_free(task);
+		cnt++;
 	}
 
-	/* If this is the first event for this io object, create the container */
-	if (!M_hashtable_get(event->u.loop.pending_events, io, (void **)&entry)) {
-		entry                = M_malloc_zero(sizeof(*entry));
-		M_hashtable_insert(event->u.loop.pending_events, io, entry);
+	event->u.loop.timer_cnt += cnt;
+}
+
+
+static void M_event_task_destroy_all(M_event_t *event)
+{
+	M_event_task_t *task;
+	M_event_task_t *list;
+
+	list = M_event_task_take_all(event);
+	while (list != NULL) {
+		task = list;
+		list = task->next;
+		M_free(task);
 	}
+}
+
+
+static void M_event_queue_pending(M_event_t *event, M_io_t *io, size_t layer_id, M_event_type_t type)
+{
+	M_event_ioqueue_entry_t *entry;
+	size_t                   i;
+	M_uint16                 ev;
+
+	/* First event for this io object queues it */
+	entry = M_event_ioqueue_push(&event->u.loop.pending_events, io);
 
 //M_printf("%s(): io %p layer %zu handle %d type %d\n", __FUNCTION__, io_or_timer, layer_id, handle, (int)type);
 	ev                       = (M_uint16)(1 << type);
@@ -826,23 +1188,24 @@ static void M_event_queue_pending(M_event_t *event, M_io_t *io, size_t layer_id,
 
 static void M_event_queue_pending_delivered(M_event_t *event, M_io_t *io, M_event_type_t type, size_t layer_id)
 {
-	M_event_pending_t *entry = NULL;
-	ssize_t            i;
-	M_uint16           mask;
+	M_uint16 *events = io->pending.events;
+	ssize_t   i;
+	M_uint16  mask;
 
-	if (!M_hashtable_get(event->u.loop.pending_events, io, (void **)&entry))
+	/* Only the io object being delivered can have events */
+	if (event->u.loop.pending_current != io)
 		return;
 
 	/* Unset delivered event */
-	mask                     = (M_uint16)((M_uint16)1 << (M_uint16)type);
-	entry->events[layer_id] &= (M_uint16)(~mask);
+	mask              = (M_uint16)((M_uint16)1 << (M_uint16)type);
+	events[layer_id] &= (M_uint16)(~mask);
 
 	/* Clear high bits if next layer is empty */
 	if (layer_id > 0) {
 		for (i=(ssize_t)layer_id-1; i>=0; i--) {
-			if (entry->events[i+1] != 0)
+			if (events[i+1] != 0)
 				break;
-			entry->events[i] &= (M_uint16)0x7FFF;
+			events[i] &= (M_uint16)0x7FFF;
 		}
 	}
 
@@ -851,17 +1214,14 @@ static void M_event_queue_pending_delivered(M_event_t *event, M_io_t *io, M_even
 
 void M_event_queue_pending_clear(M_event_t *event, M_io_t *io)
 {
-	/* We must not modify the hashtables themselves, we just need to clear the events so we
-	 * don't force the thread processing the events to know they have to restart enumeration. */
-	M_event_pending_t        *entry        = NULL;
+	/* Stop delivery if this is the object being delivered, it may be about to be freed */
+	if (event->u.loop.pending_current == io)
+		event->u.loop.pending_current = NULL;
 
-	/* No events for this object were enqueued */
-	if (!M_hashtable_get(event->u.loop.pending_events, io, (void **)&entry)) {
-		return;
-	}
+	M_event_ioqueue_remove(&event->u.loop.pending_events, io);
 
 	/* Clear events */
-	M_mem_set(entry->events, 0, sizeof(entry->events));
+	M_mem_set(io->pending.events, 0, sizeof(io->pending.events));
 }
 
 
@@ -911,57 +1271,46 @@ static void M_event_deliver(M_event_t *event, M_io_t *io, size_t layer_id, M_eve
 	if (callback == NULL)
 		return;
 
-	/* Release locks before calling user callbacks */
-	M_event_unlock(event);
+	/* Releases locks while calling user callbacks */
 //M_printf("%s(): user deliver io %p handle %d type %d - cb %p, %p\n", __FUNCTION__, io, handle, (int)type, callback, cb_data);
-
-	callback(event, type, io, cb_data);
+	M_event_callback_call(event, callback, type, io, cb_data);
 //M_printf("%s(): user deliver io %p handle %d type %d DONE - cb %p, %p\n", __FUNCTION__, io, handle, (int)type, callback, cb_data);
-
-	/* Re-obtain locks */
-	M_event_lock(event);
-
 }
 
 
 /* NOTE: event must be locked before calling this */
 static void M_event_queue_deliver(M_event_t *event)
 {
-	M_hashtable_enum_t        enumevent;
-	const void               *key = NULL;
-	const void               *val = NULL;
+	M_io_t *io;
 
-	if (M_hashtable_enumerate(event->u.loop.pending_events, &enumevent) == 0)
-		goto done;
-
-	/* Enumerate io or timer objects */
-	while (M_hashtable_enumerate_next(event->u.loop.pending_events, &enumevent, &key, &val)) {
-		M_io_t            *io     = NULL;
-		M_event_pending_t *entry  = M_CAST_OFF_CONST(M_event_pending_t *, val);
-		size_t             i;
-		size_t             j;
+	/* Take io objects off in the order their first event was queued */
+	while ((io = M_event_ioqueue_pop(&event->u.loop.pending_events)) != NULL) {
+		M_uint16 *events = io->pending.events;
+		size_t    i;
+		size_t    j;
 
-		io = M_CAST_OFF_CONST(M_io_t *, key);
-
-		if (io->flags & M_IO_FLAG_USER_DESTROY)
+		if (io->flags & M_IO_FLAG_USER_DESTROY) {
+			M_mem_set(events, 0, sizeof(io->pending.events));
 			continue;
+		}
 
 		/* Process all events, even if there are no events for this layer, the high
-		 * bit is set if there are events for a higher layer */
-		for (j=0; entry->events[j] != 0; j++) {
-			for (i=0; i<M_EVENT_TYPE__CNT && (entry->events[j] & 0x7FFF) != 0; i++) {
-				if (entry->events[j] & (((M_uint16)1) << (M_uint8)i)) {
+		 * bit is set if there are events for a higher layer.  Stop if the io object
+		 * is removed by a callback as it may no longer exist */
+		event->u.loop.pending_current = io;
+		for (j=0; event->u.loop.pending_current == io && j < M_IO_LAYERS_MAX && events[j] != 0; j++) {
+			for (i=0; i<M_EVENT_TYPE__CNT && event->u.loop.pending_current == io && (events[j] & 0x7FFF) != 0; i++) {
+				if (events[j] & (((M_uint16)1) << (M_uint8)i)) {
 					M_event_deliver(event, io, j, (M_event_type_t)i);
 				}
 			}
 		}
-	}
-
-done:
 
-	/* Clean up events */
-	M_hashtable_destroy(event->u.loop.pending_events, M_TRUE);
-	event->u.loop.pending_events = NULL;
+		/* Anything not delivered (no callback) is dropped, same as when it was first queued */
+		if (event->u.loop.pending_current == io)
+			M_mem_set(events, 0, sizeof(io->pending.events));
+		event->u.loop.pending_current = NULL;
+	}
 }
 
 
@@ -977,46 +1326,32 @@ void M_event_deliver_io(M_event_t *event, M_io_t *io, M_event_type_t type)
 
 static void M_event_softevent_process(M_event_t *event)
 {
-	M_llist_node_t *node;
-	M_event_io_t   *ioev = NULL;
+	M_io_t *io;
 
-	if (event == NULL || event->type != M_EVENT_BASE_TYPE_LOOP)
-		return;
-
-	node = M_llist_first(event->u.loop.soft_events);
-	while (node != NULL) {
-		M_llist_node_t      *next      = M_llist_node_next(node);
-		M_event_softevent_t *softevent;
-		size_t               i;
-		size_t               j;
-		size_t               num_layers;
-
-		softevent  = M_llist_take_node(node);
+	while ((io = M_event_ioqueue_pop(&event->u.loop.soft_events)) != NULL) {
+		M_uint16 *events = io->softevent.events;
+		size_t    i;
+		size_t    j;
+		size_t    num_layers;
 
-		if (softevent->io->flags & M_IO_FLAG_USER_DESTROY)
+		if (io->flags & M_IO_FLAG_USER_DESTROY) {
+			M_mem_set(events, 0, sizeof(io->softevent.events));
 			continue;
+		}
 
-		num_layers = M_io_layer_count(softevent->io) + 1 /* User layer */;
+		num_layers = M_io_layer_count(io) + 1 /* User layer */;
 
 		/* Enqueue all events */
 		for (j=0; j<num_layers; j++) {
-			for (i=0; i<M_EVENT_TYPE__CNT && softevent->events[j] != 0; i++) {
-				if (softevent->events[j] & (((M_uint16)1) << i)) {
+			for (i=0; i<M_EVENT_TYPE__CNT && events[j] != 0; i++) {
+				if (events[j] & (((M_uint16)1) << i)) {
 					M_uint16 mask = (M_uint16)((M_uint16)1 << (M_uint16)i);
-					M_event_queue_pending(event, softevent->io, j, (M_event_type_t)i);
-					softevent->events[j] &= (M_uint16)(~mask);
+					M_event_queue_pending(event, io, j, (M_event_type_t)i);
+					events[j] &= (M_uint16)(~mask);
 					event->u.loop.softevent_cnt++;
 				}
 			}
 		}
-
-		/* Remove softevent handle */
-		if (M_hashtable_get(event->u.loop.reg_ios, softevent->io, (void **)&ioev)) {
-			ioev->softevent_node = NULL;
-		}
-		M_free(softevent);
-
-		node = next;
 	}
 }
 
@@ -1111,7 +1446,7 @@ void M_event_done_with_disconnect(M_event_t *event, M_uint64 timeout_before_disc
 	if (event->type == M_EVENT_BASE_TYPE_POOL) {
 		size_t i;
 		for (i=0; i<event->u.pool.thread_count; i++)
-			M_event_done_with_disconnect_int(&event->u.pool.thread_evloop[i], timeout_before_disconnect_ms, disconnect_timeout_ms);
+			M_event_done_with_disconnect_int(event->u.pool.thread_evloop[i], timeout_before_disconnect_ms, disconnect_timeout_ms);
 		return;
 	}
 }
@@ -1146,7 +1481,7 @@ void M_event_done(M_event_t *event)
 	if (event->type == M_EVENT_BASE_TYPE_POOL) {
 		size_t i;
 		for (i=0; i<event->u.pool.thread_count; i++)
-			M_event_status_change(&event->u.pool.thread_evloop[i], M_EVENT_STATUS_DONE);
+			M_event_status_change(event->u.pool.thread_evloop[i], M_EVENT_STATUS_DONE);
 		return;
 	}
 }
@@ -1169,7 +1504,7 @@ void M_event_return(M_event_t *event)
 	if (event->type == M_EVENT_BASE_TYPE_POOL) {
 		size_t i;
 		for (i=0; i<event->u.pool.thread_count; i++)
-			M_event_status_change(&event->u.pool.thread_evloop[i], M_EVENT_STATUS_RETURN);
+			M_event_status_change(event->u.pool.thread_evloop[i], M_EVENT_STATUS_RETURN);
 		return;
 	}
 }
@@ -1184,7 +1519,7 @@ M_event_status_t M_event_get_status(M_event_t *event)
 
 	/* Status for all should be the same, just get the first */
 	if (event->type == M_EVENT_BASE_TYPE_POOL) {
-		event = &event->u.pool.thread_evloop[0];
+		event = event->u.pool.thread_evloop[0];
 	}
 
 	M_event_lock(event);
@@ -1205,7 +1540,7 @@ M_uint64 M_event_get_statistic(M_event_t *event, M_event_statistic_t type)
 	if (event->type == M_EVENT_BASE_TYPE_POOL) {
 		size_t i;
 		for (i=0; i<event->u.pool.thread_count; i++)
-			cnt += M_event_get_statistic(&event->u.pool.thread_evloop[i], type);
+			cnt += M_event_get_statistic(event->u.pool.thread_evloop[i], type);
 		return cnt;
 	}
 
@@ -1226,6 +1561,9 @@ M_uint64 M_event_get_statistic(M_event_t *event, M_event_statistic_t type)
 		case M_EVENT_STATISTIC_PROCESS_TIME_MS:
 			cnt = event->u.loop.process_time_ms;
 			break;
+		case M_EVENT_STATISTIC_LOAD_US:
+			cnt = M_event_load_current(event);
+			break;
 	}
 	M_event_unlock(event);
 
@@ -1243,14 +1581,16 @@ size_t M_event_num_objects(M_event_t *event)
 	if (event->type == M_EVENT_BASE_TYPE_POOL) {
 		size_t i;
 		for (i=0; i<event->u.pool.thread_count; i++) {
-			num_objects += M_event_num_objects(&event->u.pool.thread_evloop[i]);
+			num_objects += M_event_num_objects(event->u.pool.thread_evloop[i]);
 		}
 
 		return num_objects;
 	}
 
 	M_event_lock(event);
-	num_objects = M_hashtable_num_keys(event->u.loop.reg_ios) + M_queue_len(event->u.loop.timers);
+	num_objects = M_hashtable_num_keys(event->u.loop.reg_ios) + M_event_timer_count(event);
+	if (event->u.loop.tasks != 0)
+		num_objects++;
 //M_printf("%s(): ev:%p io objects = %zu, timers = %zu\n", __FUNCTION__, event, M_hashtable_num_keys(event->u.loop.reg_ios), M_queue_len(event->u.loop.timers));
 	if (!(event->u.loop.flags & M_EVENT_FLAG_NOWAKE) && num_objects && event->u.loop.parent_wake)
 		num_objects--;
@@ -1300,7 +1640,11 @@ static M_event_err_t M_event_loop_loop(M_event_t *event, M_uint64 timeout_ms)
 
 			/* Only count timers if they are not stopped and we haven't been explicitly told not to count them */
 			if (M_event_timer_minimum_ms(event) != M_TIMEOUT_INF && !(event->u.loop.flags & M_EVENT_FLAG_EXITONEMPTY_NOTIMERS))
-				num_objects += M_queue_len(event->u.loop.timers);
+				num_objects += M_event_timer_count(event);
+
+			/* Queued tasks always need to run */
+			if (event->u.loop.tasks != 0)
+				num_objects++;
 
 			/* Subtract the internal wake object */
 			if (!(event->u.loop.flags & M_EVENT_FLAG_NOWAKE) && num_objects && event->u.loop.parent_wake)
@@ -1317,7 +1661,7 @@ static M_event_err_t M_event_loop_loop(M_event_t *event, M_uint64 timeout_ms)
 		event->u.loop.waiting  = M_TRUE;
 		min_timer_ms           = M_event_timer_minimum_ms(event);
 		has_soft_events        = M_FALSE;
-		if (M_llist_len(event->u.loop.soft_events))
+		if (event->u.loop.soft_events.head != NULL || event->u.loop.tasks != 0)
 			has_soft_events = M_TRUE;
 
 		M_event_unlock(event);
@@ -1348,6 +1692,7 @@ static M_event_err_t M_event_loop_loop(M_event_t *event, M_uint64 timeout_ms)
 
 		/* Start recording how much time event processing takes */
 		M_time_elapsed_start(&event_process_tv);
+		event->u.loop.wake_tv = event_process_tv;
 //M_printf("%s(): %p processing soft events\n", __FUNCTION__, event);
 
 		/* Process soft events -- NOTE: we must always process these first, as a CONNECTED event
@@ -1365,6 +1710,9 @@ static M_event_err_t M_event_loop_loop(M_event_t *event, M_uint64 timeout_ms)
 		/* Deliver all queued events */
 		M_event_queue_deliver(event);
 
+		/* Run tasks queued from other threads */
+		M_event_task_process(event);
+
 		/* Process timer events */
 		M_event_timer_process(event);
 
@@ -1380,6 +1728,9 @@ static M_event_err_t M_event_loop_loop(M_event_t *event, M_uint64 timeout_ms)
 
 		/* Record event processing time */
 		event->u.loop.process_time_ms += M_time_elapsed(&event_process_tv);
+		event->u.loop.load_us          = M_event_load_current(event) + M_event_elapsed_us(&event_process_tv);
+		M_time_elapsed_start(&event->u.loop.load_tv);
+		M_event_histogram_record(event, M_EVENT_HISTOGRAM_ITERATION, M_event_elapsed_us(&event_process_tv));
 		/* ----- End Process Events ----- */
 
 	} while ((elapsed = M_time_elapsed(&event->u.loop.start_tv)) < event->u.loop.timeout_ms);
@@ -1451,9 +1802,9 @@ static M_event_err_t M_event_pool_loop(M_event_t *event, M_uint64 timeout_ms)
 		M_event_pool_loop_thread_arg_t *thread_arg = M_malloc_zero(sizeof(*thread_arg));
 
 		/* Bind thread to single cpu core */
-		M_thread_attr_set_processor(attr, (int)i);
+		M_thread_attr_set_processor(attr, event->u.pool.thread_processors[i]);
 
-		thread_arg->event                          = &event->u.pool.thread_evloop[i];
+		thread_arg->event                          = event->u.pool.thread_evloop[i];
 		thread_arg->timeout_ms                     = timeout_ms;
 		event->u.pool.thread_ids[i]                = M_thread_create(attr, M_event_pool_loop_thread, thread_arg);
 	}
@@ -1461,9 +1812,10 @@ static M_event_err_t M_event_pool_loop(M_event_t *event, M_uint64 timeout_ms)
 	M_thread_attr_destroy(attr);
 
 	/* Bind self to first CPU core */
-	M_thread_set_processor(M_thread_self(), 0);
+	if (event->u.pool.thread_processors[0] != -1)
+		M_thread_set_processor(M_thread_self(), event->u.pool.thread_processors[0]);
 
-	rv = M_event_loop_loop(&event->u.pool.thread_evloop[0], timeout_ms);
+	rv = M_event_loop_loop(event->u.pool.thread_evloop[0], timeout_ms);
 
 	/* Wait for all threads to exit */
 	for (i=1; i<event->u.pool.thread_count; i++) {
@@ -1472,7 +1824,8 @@ static M_event_err_t M_event_pool_loop(M_event_t *event, M_uint64 timeout_ms)
 	}
 
 	/* Unbind the main thread from the first core */
-	M_thread_set_processor(M_thread_self(), -1);
+	if (event->u.pool.thread_processors[0] != -1)
+		M_thread_set_processor(M_thread_self(), -1);
 
 	/* All threads return values should be the same */
 	return rv;
@@ -1508,3 +1861,114 @@ M_event_t *M_event_get_pool(M_event_t *event)
 	return event->u.loop.parent;
 }
 
+
+M_bool M_event_pool_set_distribution(M_event_t *event, M_event_distribute_t type)
+{
+	if (event == NULL || event->type != M_EVENT_BASE_TYPE_POOL)
+		return M_FALSE;
+
+	event->u.pool.distribute = type;
+	return M_TRUE;
+}
+
+
+M_event_t *M_event_pool_get_loop(M_event_t *event, M_uint64 key)
+{
+	if (event == NULL)
+		return NULL;
+
+	/* Loops within a pool map to themselves, keys are relative to the pool */
+	if (event->type == M_EVENT_BASE_TYPE_LOOP) {
+		if (event->u.loop.parent == NULL)
+			return event;
+		event = event->u.loop.parent;
+	}
+
+	/* Mix the key so sequential keys spread across threads */
+	key *= 0x9E3779B97F4A7C15ULL;
+	return event->u.pool.thread_evloop[(size_t)((key >> 32) % event->u.pool.thread_count)];
+}
+
+
+M_bool M_event_migrate(M_io_t *io, M_event_t *event)
+{
+	M_event_t          *src;
+	M_event_io_t       *ioev = NULL;
+	M_event_callback_t  callback;
+	void               *cb_data;
+	M_io_state_t        state;
+	M_bool              rv;
+
+	if (io == NULL || event == NULL || io->private_event || io->flags & M_IO_FLAG_USER_DESTROY)
+		return M_FALSE;
+
+	src = io->reg_event;
+	if (src == NULL)
+		return M_FALSE;
+
+	event = M_event_distribute(event);
+	if (event == src)
+		return M_TRUE;
+
+	M_event_lock(src);
+
+	if (io->reg_event != src || !M_hashtable_get(src->u.loop.reg_ios, io, (void **)&ioev)) {
+		M_event_unlock(src);
+		return M_FALSE;
+	}
+
+	/* Anything waiting to be delivered would be lost */
+	state = M_io_get_state(io);
+	if ((state != M_IO_STATE_CONNECTED && state != M_IO_STATE_LISTENING) || io->softevent.queued || io->pending.queued) {
+		M_event_unlock(src);
+		return M_FALSE;
+	}
+
+	callback = ioev->callback;
+	cb_data  = ioev->cb_data;
+
+	M_event_io_unregister(io, M_FALSE);
+	M_hashtable_remove(src->u.loop.reg_ios, io, M_TRUE);
+	M_event_queue_pending_clear(src, io);
+
+	M_event_unlock(src);
+
+	/* Not registered anywhere so nothing else can be looking at the flags */
+	io->flags |= M_IO_FLAG_MIGRATING;
+	rv         = M_event_add(event, io, callback, cb_data);
+	io->flags &= ~((M_uint32)M_IO_FLAG_MIGRATING);
+
+	return rv;
+}
+
+
+static void M_event_loop_set_busy_poll(M_event_t *event, M_uint64 usec)
+{
+	M_event_lock(event);
+	event->u.loop.busy_poll_us = usec;
+	if (usec > 0) {
+		event->u.loop.flags |= M_EVENT_FLAG_BUSY_POLL;
+	} else {
+		event->u.loop.flags &= ~((M_uint32)M_EVENT_FLAG_BUSY_POLL);
+	}
+	M_event_unlock(event);
+}
+
+
+void M_event_set_busy_poll(M_event_t *event, M_uint64 usec)
+{
+	size_t i;
+
+	if (event == NULL)
+		return;
+
+	if (event->type == M_EVENT_BASE_TYPE_POOL) {
+		for (i=0; i<event->u.pool.thread_count; i++) {
+			M_event_loop_set_busy_poll(event->u.pool.thread_evloop[i], usec);
+		}
+		return;
+	}
+
+	M_event_loop_set_busy_poll(event, usec);
+}
+
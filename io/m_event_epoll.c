@@ -25,14 +25,20 @@
 #include <mstdlib/mstdlib_io.h>
 #include "m_event_int.h"
 #include <sys/epoll.h>
+#include <sys/socket.h>
 #include <unistd.h>
 #include "m_io_posix_common.h"
 
-#define EPOLL_WAIT_EVENTS 64
+/* The events array follows the number of registered handles so a single
+ * epoll_wait() can return everything that is ready. */
+#define EPOLL_WAIT_EVENTS_MIN 64
+#define EPOLL_WAIT_EVENTS_MAX 65536
+
 struct M_event_data {
-	int                epoll_fd;
-	struct epoll_event events[EPOLL_WAIT_EVENTS];
-	int                nevents;
+	int                 epoll_fd;
+	struct epoll_event *events;
+	size_t              events_alloc;
+	int                 nevents;
 };
 
 
@@ -42,6 +48,7 @@ static void M_event_impl_epoll_data_free(M_event_data_t *data)
 		return;
 	if (data->epoll_fd != -1)
 		close(data->epoll_fd);
+	M_free(data->events);
 	M_free(data);
 }
 
@@ -76,6 +83,16 @@ static void M_event_impl_epoll_modify_event(M_event_t *event, M_event_modify_typ
 
 			ev.data.fd = handle;
 			epoll_ctl(event->u.loop.impl_data->epoll_fd, EPOLL_CTL_ADD, handle, &ev);
+
+#ifdef SO_BUSY_POLL
+			/* Let the driver be polled for sockets while spinning. Raising it above the
+			 * system default needs privileges and the handle may not be a socket, either
+			 * failure is fine. */
+			if (event->u.loop.flags & M_EVENT_FLAG_BUSY_POLL && event->u.loop.busy_poll_us > 0) {
+				int usec = (int)M_MIN(event->u.loop.busy_poll_us, M_INT32_MAX);
+				setsockopt(handle, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec));
+			}
+#endif
 			break;
 		case M_EVENT_MODTYPE_DEL_HANDLE:
 			epoll_ctl(event->u.loop.impl_data->epoll_fd, EPOLL_CTL_DEL, handle, &ev /* Can be NULL after kernel 2.6.9 */);
@@ -87,13 +104,37 @@ static void M_event_impl_epoll_modify_event(M_event_t *event, M_event_modify_typ
 }
 
 
+static void M_event_impl_epoll_size_events(M_event_t *event)
+{
+	M_event_data_t *data = event->u.loop.impl_data;
+	size_t          want;
+
+	want = M_hash_u64vp_num_keys(event->u.loop.evhandles);
+	want = M_MAX(want, EPOLL_WAIT_EVENTS_MIN);
+	want = M_MIN(want, EPOLL_WAIT_EVENTS_MAX);
+
+	/* Grow to fit all handles, only shrink once well below the current size so
+	 * handles coming and going don't cause constant reallocation. */
+	if (data->events != NULL && want <= data->events_alloc && want * 4 > data->events_alloc)
+		return;
+
+	data->events_alloc = M_size_t_round_up_to_power_of_two(want);
+	M_free(data->events);
+	data->events       = M_malloc(data->events_alloc * sizeof(*data->events));
+}
+
+
 static void M_event_impl_epoll_data_structure(M_event_t *event)
 {
 	M_hash_u64vp_enum_t *hashenum = NULL;
 	M_event_evhandle_t  *member   = NULL;
 
-	if (event->u.loop.impl_data != NULL)
+	/* Called with the event lock held before every wait, the only safe place to
+	 * look at the handle count. */
+	if (event->u.loop.impl_data != NULL) {
+		M_event_impl_epoll_size_events(event);
 		return;
+	}
 
 	event->u.loop.impl_data            = M_malloc_zero(sizeof(*event->u.loop.impl_data));
 #ifdef HAVE_EPOLL_CREATE1
@@ -108,17 +149,56 @@ static void M_event_impl_epoll_data_structure(M_event_t *event)
 		M_event_impl_epoll_modify_event(event, M_EVENT_MODTYPE_ADD_HANDLE, member->handle, member->waittype, member->caps);
 	}
 	M_hash_u64vp_enumerate_free(hashenum);
+
+	M_event_impl_epoll_size_events(event);
+}
+
+
+/*! Spin on epoll_wait() without blocking for up to the busy poll duration.
+ *
+ * \return M_TRUE if events were received (or an error occurred), otherwise
+ *         M_FALSE with the timeout reduced by the time spent spinning.
+ */
+static M_bool M_event_impl_epoll_busy_poll(M_event_t *event, M_uint64 *timeout_ms)
+{
+	M_event_data_t *data = event->u.loop.impl_data;
+	M_timeval_t     start_tv;
+	M_uint64        spin_us;
+	M_uint64        elapsed_us;
+
+	spin_us = event->u.loop.busy_poll_us;
+	if (*timeout_ms != M_TIMEOUT_INF)
+		spin_us = M_MIN(spin_us, *timeout_ms * 1000);
+
+	M_time_elapsed_start(&start_tv);
+	do {
+		data->nevents = epoll_wait(data->epoll_fd, data->events, (int)data->events_alloc, 0);
+		if (data->nevents != 0)
+			return M_TRUE;
+		elapsed_us = M_event_elapsed_us(&start_tv);
+	} while (elapsed_us < spin_us);
+
+	if (*timeout_ms != M_TIMEOUT_INF)
+		*timeout_ms -= M_MIN(*timeout_ms, elapsed_us / 1000);
+	return M_FALSE;
 }
 
 
 static M_bool M_event_impl_epoll_wait(M_event_t *event, M_uint64 timeout_ms)
 {
+	M_event_data_t *data = event->u.loop.impl_data;
+
+	if (event->u.loop.flags & M_EVENT_FLAG_BUSY_POLL && event->u.loop.busy_poll_us > 0 && timeout_ms != 0) {
+		if (M_event_impl_epoll_busy_poll(event, &timeout_ms))
+			return (data->nevents > 0)?M_TRUE:M_FALSE;
+	}
+
 	if (timeout_ms > M_INT32_MAX && timeout_ms != M_TIMEOUT_INF)
 		timeout_ms = M_INT32_MAX;
 
-	event->u.loop.impl_data->nevents = epoll_wait(event->u.loop.impl_data->epoll_fd, event->u.loop.impl_data->events,
-	                                              EPOLL_WAIT_EVENTS, (timeout_ms == M_TIMEOUT_INF)?-1:(int)timeout_ms);
-	if (event->u.loop.impl_data->nevents > 0) {
+	data->nevents = epoll_wait(data->epoll_fd, data->events, (int)data->events_alloc,
+	                           (timeout_ms == M_TIMEOUT_INF)?-1:(int)timeout_ms);
+	if (data->nevents > 0) {
 		return M_TRUE;
 	}
 	return M_FALSE;
@@ -0,0 +1,277 @@
+/* The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Monetra Technologies, LLC.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "m_config.h"
+#include "mstdlib/mstdlib_io.h"
+#include "m_event_int.h"
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+/* Each power of two range from 4 up is split into 1 << M_EVENT_HISTOGRAM_SUB_BITS buckets */
+#define M_EVENT_HISTOGRAM_SUB_BITS 2
+#define M_EVENT_HISTOGRAM_SUB_CNT  (1 << M_EVENT_HISTOGRAM_SUB_BITS)
+
+static size_t M_event_histogram_bucket(M_uint64 usec)
+{
+	size_t msb;
+	size_t idx;
+
+	if (usec < M_EVENT_HISTOGRAM_SUB_CNT)
+		return (size_t)usec;
+
+	msb = M_uint64_log2(usec);
+	idx = M_EVENT_HISTOGRAM_SUB_CNT + ((msb - M_EVENT_HISTOGRAM_SUB_BITS) * M_EVENT_HISTOGRAM_SUB_CNT) +
+	      (size_t)((usec >> (msb - M_EVENT_HISTOGRAM_SUB_BITS)) & (M_EVENT_HISTOGRAM_SUB_CNT - 1));
+
+	return M_MIN(idx, M_EVENT_HISTOGRAM_BUCKETS - 1);
+}
+
+
+/*! Largest value that falls in a bucket */
+static M_uint64 M_event_histogram_bucket_max(size_t idx)
+{
+	size_t shift;
+	size_t sub;
+
+	if (idx < M_EVENT_HISTOGRAM_SUB_CNT)
+		return idx;
+
+	shift = (idx - M_EVENT_HISTOGRAM_SUB_CNT) / M_EVENT_HISTOGRAM_SUB_CNT;
+	sub   = (idx - M_EVENT_HISTOGRAM_SUB_CNT) % M_EVENT_HISTOGRAM_SUB_CNT;
+
+	return (((M_uint64)(M_EVENT_HISTOGRAM_SUB_CNT + sub + 1)) << shift) - 1;
+}
+
+
+void M_event_histogram_record(M_event_t *event, M_event_histogram_type_t type, M_uint64 usec)
+{
+	M_event_histogram_t *hist;
+
+	if (event->u.loop.histograms == NULL)
+		return;
+
+	hist = &event->u.loop.histograms[type];
+	hist->count++;
+	hist->sum_us += usec;
+	if (usec > hist->max_us)
+		hist->max_us = usec;
+	hist->buckets[M_event_histogram_bucket(usec)]++;
+}
+
+
+void M_event_callback_call(M_event_t *event, M_event_callback_t callback, M_event_type_t type, M_io_t *io, void *cb_data)
+{
+	M_event_slow_callback_t  slow_cb     = event->u.loop.slow_cb;
+	void                    *slow_cb_arg = event->u.loop.slow_cb_arg;
+	M_uint64                 slow_us     = event->u.loop.slow_us;
+	M_timeval_t              start_tv;
+	M_uint64                 elapsed_us;
+
+	/* Don't read the clock unless something wants it */
+	if (event->u.loop.histograms == NULL && slow_cb == NULL) {
+		M_event_unlock(event);
+		callback(event, type, io, cb_data);
+		M_event_lock(event);
+		return;
+	}
+
+	if (io != NULL)
+		M_event_histogram_record(event, M_EVENT_HISTOGRAM_DISPATCH, M_event_elapsed_us(&event->u.loop.wake_tv));
+
+	M_event_unlock(event);
+
+	M_time_elapsed_start(&start_tv);
+	callback(event, type, io, cb_data);
+	elapsed_us = M_event_elapsed_us(&start_tv);
+
+	if (slow_cb != NULL && elapsed_us >= slow_us)
+		slow_cb(event, type, io, callback, elapsed_us, slow_cb_arg);
+
+	M_event_lock(event);
+
+	M_event_histogram_record(event, M_EVENT_HISTOGRAM_CALLBACK, elapsed_us);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void M_event_loop_histogram_enable(M_event_t *event, M_bool enable)
+{
+	M_event_lock(event);
+	if (enable && event->u.loop.histograms == NULL) {
+		event->u.loop.histograms = M_malloc_zero(sizeof(*event->u.loop.histograms) * M_EVENT_HISTOGRAM_CNT);
+	} else if (!enable) {
+		M_free(event->u.loop.histograms);
+		event->u.loop.histograms = NULL;
+	}
+	M_event_unlock(event);
+}
+
+
+void M_event_histogram_enable(M_event_t *event, M_bool enable)
+{
+	size_t i;
+
+	if (event == NULL)
+		return;
+
+	if (event->type == M_EVENT_BASE_TYPE_POOL) {
+		for (i=0; i<event->u.pool.thread_count; i++) {
+			M_event_loop_histogram_enable(event->u.pool.thread_evloop[i], enable);
+		}
+		return;
+	}
+
+	M_event_loop_histogram_enable(event, enable);
+}
+
+
+static M_bool M_event_loop_get_histogram(M_event_t *event, M_event_histogram_type_t type, M_event_histogram_t *hist)
+{
+	const M_event_histogram_t *loop_hist;
+	size_t                     i;
+
+	M_event_lock(event);
+
+	if (event->u.loop.histograms == NULL) {
+		M_event_unlock(event);
+		return M_FALSE;
+	}
+
+	loop_hist     = &event->u.loop.histograms[type];
+	hist->count  += loop_hist->count;
+	hist->sum_us += loop_hist->sum_us;
+	hist->max_us  = M_MAX(hist->max_us, loop_hist->max_us);
+	for (i=0; i<M_EVENT_HISTOGRAM_BUCKETS; i++)
+		hist->buckets[i] += loop_hist->buckets[i];
+
+	M_event_unlock(event);
+	return M_TRUE;
+}
+
+
+M_bool M_event_get_histogram(M_event_t *event, M_event_histogram_type_t type, M_event_histogram_t *hist)
+{
+	size_t i;
+
+	if (event == NULL || hist == NULL || (size_t)type >= M_EVENT_HISTOGRAM_CNT)
+		return M_FALSE;
+
+	M_mem_set(hist, 0, sizeof(*hist));
+
+	if (event->type == M_EVENT_BASE_TYPE_POOL) {
+		for (i=0; i<event->u.pool.thread_count; i++) {
+			if (!M_event_loop_get_histogram(event->u.pool.thread_evloop[i], type, hist))
+				return M_FALSE;
+		}
+		return M_TRUE;
+	}
+
+	return M_event_loop_get_histogram(event, type, hist);
+}
+
+
+static void M_event_loop_histogram_reset(M_event_t *event)
+{
+	M_event_lock(event);
+	if (event->u.loop.histograms != NULL)
+		M_mem_set(event->u.loop.histograms, 0, sizeof(*event->u.loop.histograms) * M_EVENT_HISTOGRAM_CNT);
+	M_event_unlock(event);
+}
+
+
+void M_event_histogram_reset(M_event_t *event)
+{
+	size_t i;
+
+	if (event == NULL)
+		return;
+
+	if (event->type == M_EVENT_BASE_TYPE_POOL) {
+		for (i=0; i<event->u.pool.thread_count; i++) {
+			M_event_loop_histogram_reset(event->u.pool.thread_evloop[i]);
+		}
+		return;
+	}
+
+	M_event_loop_histogram_reset(event);
+}
+
+
+M_uint64 M_event_histogram_percentile(const M_event_histogram_t *hist, double percentile)
+{
+	M_uint64 target;
+	M_uint64 cnt = 0;
+	size_t   i;
+
+	if (hist == NULL || hist->count == 0)
+		return 0;
+
+	if (percentile < 0)
+		percentile = 0;
+	if (percentile > 100)
+		percentile = 100;
+
+	/* Rank of the value, rounded up so 100 is the last value and 0 the first */
+	target = (M_uint64)((((double)hist->count) * percentile) / 100.0);
+	if ((double)target < (((double)hist->count) * percentile) / 100.0)
+		target++;
+	if (target == 0)
+		target = 1;
+
+	for (i=0; i<M_EVENT_HISTOGRAM_BUCKETS - 1; i++) {
+		cnt += hist->buckets[i];
+		if (cnt >= target)
+			return M_MIN(M_event_histogram_bucket_max(i), hist->max_us);
+	}
+
+	/* Last bucket is unbounded */
+	return hist->max_us;
+}
+
+
+static void M_event_loop_set_slow_callback(M_event_t *event, M_uint64 threshold_us, M_event_slow_callback_t callback, void *cb_arg)
+{
+	M_event_lock(event);
+	event->u.loop.slow_us     = threshold_us;
+	event->u.loop.slow_cb     = callback;
+	event->u.loop.slow_cb_arg = cb_arg;
+	M_event_unlock(event);
+}
+
+
+void M_event_set_slow_callback(M_event_t *event, M_uint64 threshold_us, M_event_slow_callback_t callback, void *cb_arg)
+{
+	size_t i;
+
+	if (event == NULL)
+		return;
+
+	if (event->type == M_EVENT_BASE_TYPE_POOL) {
+		for (i=0; i<event->u.pool.thread_count; i++) {
+			M_event_loop_set_slow_callback(event->u.pool.thread_evloop[i], threshold_us, callback, cb_arg);
+		}
+		return;
+	}
+
+	M_event_loop_set_slow_callback(event, threshold_us, callback, cb_arg);
+}
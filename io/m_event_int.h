@@ -54,6 +54,10 @@ __BEGIN_DECLS
 
 #define M_EVENT_TYPE__CNT 7  /*!< Count of event types */
 
+#define M_EVENT_BUSY_POLL_DEFAULT_US 50 /*!< Default spin time for M_EVENT_FLAG_BUSY_POLL */
+
+#define M_EVENT_LOAD_HALFLIFE_MS 1000 /*!< Half life of the load used by M_EVENT_DISTRIBUTE_LOAD */
+
 enum M_event_caps {
 	M_EVENT_CAPS_WRITE = 1 << 0, /*!< Also implies Connect */
 	M_EVENT_CAPS_READ  = 1 << 1  /*!< Also implies Accept */
@@ -79,7 +83,6 @@ typedef struct M_event_evhandle M_event_evhandle_t;
 struct M_event_io {
 	M_event_callback_t callback;       /*!< User-supplied callback                                       */
 	void              *cb_data;        /*!< Data to pass to user-supplied callback                       */
-	M_llist_node_t    *softevent_node; /*!< Reference to the node in the soft event list for this M_io_t */
 };
 typedef struct M_event_io M_event_io_t;
 
@@ -89,6 +92,8 @@ struct M_event_trigger {
 
 M_uint64 M_event_timer_minimum_ms(M_event_t *event);
 void M_event_timer_process(M_event_t *event);
+size_t M_event_timer_count(M_event_t *event);
+void M_event_timer_destroy_all(M_event_t *event);
 void M_event_deliver_io(M_event_t *event, M_io_t *io, M_event_type_t type);
 void M_io_softevent_add(M_io_t *io, size_t layer_id, M_event_type_t type, M_io_error_t err);
 
@@ -115,24 +120,35 @@ struct M_event_impl_cbs {
 typedef struct M_event_impl_cbs M_event_impl_cbs_t;
 
 
-struct M_event_softevent {
-	M_io_t      *io;
-	M_uint16     events[M_IO_LAYERS_MAX]; /*!< each event sets its bit */
+/*! Membership of an M_io_t in one of an event loop's io queues. Embedded in the M_io_t so queuing
+ *  never allocates. Protected by the lock of the event loop the io object is registered with. */
+struct M_event_ioqueue_entry {
+	M_io_t      *prev;
+	M_io_t      *next;
+	M_bool       queued;                  /*!< Whether linked into the queue */
+	M_uint16     events[M_IO_LAYERS_MAX]; /*!< each event sets its bit, per layer */
 };
-typedef struct M_event_softevent M_event_softevent_t;
+typedef struct M_event_ioqueue_entry M_event_ioqueue_entry_t;
 
 
-struct M_event_pending {
-	M_uint16     events[M_IO_LAYERS_MAX]; /*!< each event sets its bit and layer to deliver to */
+/*! FIFO of M_io_t objects linked through an embedded M_event_ioqueue_entry_t */
+struct M_event_ioqueue {
+	M_io_t      *head;
+	M_io_t      *tail;
+	size_t       offset;                  /*!< Offset of the M_event_ioqueue_entry_t within M_io_t */
 };
-typedef struct M_event_pending M_event_pending_t;
+typedef struct M_event_ioqueue M_event_ioqueue_t;
 
 
+struct M_event_timer_wheel;
+typedef struct M_event_timer_wheel M_event_timer_wheel_t;
+
 struct M_event_loop {
 	M_event_t          *parent;               /*!< For event pools, this is the pool object, otherwise NULL */
 	M_threadid_t        threadid;             /*!< ThreadID currently processing the event loop              */
 	M_thread_mutex_t   *lock;                 /*!< Lock to prevent concurrent access */
 	M_uint64            timeout_ms;           /*!< Cache variable for tracking the current event loop timeout */
+	M_uint64            busy_poll_us;         /*!< Microseconds to poll without blocking before waiting, with M_EVENT_FLAG_BUSY_POLL */
 	M_timeval_t         start_tv;             /*!< Elapsed timer start of current event loop                  */
 	enum M_EVENT_FLAGS  flags;                /*!< Flags that control behavior */
 	M_event_status_t    status;               /*!< Status of event loop */
@@ -144,17 +160,29 @@ struct M_event_loop {
 	M_bool              waiting;              /*!< Whether or not the event loop is currently blocked waiting on new events (event->impl->wait_event()) */
 
 	M_queue_t          *timers;               /*!< Sorted list of M_event_timer_t members */
+	M_event_timer_wheel_t *timer_wheel;       /*!< Timer wheel replacing timers once enabled or enough timers exist */
+
+	volatile M_uint64   tasks;                /*!< Lock free stack (newest first) of M_event_task_t pushed by M_event_queue_task(), stored as a pointer */
 
-	M_llist_t          *soft_events;          /*!< Linked list of M_event_softevent_t which are M_event-generated events to turn edge-triggered events into resettable events */
-	M_hashtable_t      *reg_ios;              /*!< M_io_t * to M_event_io_t * for tracking M_io_t handles and associated user callbacks and soft events */
-	M_hashtable_t      *pending_events;       /*!< M_io_t * or M_event_timer_t * to M_event_pending_t * ordered hashtable (in insertion order for prioritization) */
+	M_event_ioqueue_t   soft_events;          /*!< Queue of M_io_t with M_event-generated events to turn edge-triggered events into resettable events */
+	M_hashtable_t      *reg_ios;              /*!< M_io_t * to M_event_io_t * for tracking M_io_t handles and associated user callbacks */
+	M_event_ioqueue_t   pending_events;       /*!< Queue of M_io_t with events to deliver, in insertion order for prioritization */
+	M_io_t             *pending_current;      /*!< M_io_t currently having its pending events delivered, NULL if removed meanwhile */
 
 	M_uint64            process_time_ms;      /*!< Number of milliseconds spent processing events (to track load) */
+	M_uint64            load_us;              /*!< Recent processing time in microseconds, decaying by half every M_EVENT_LOAD_HALFLIFE_MS */
+	M_timeval_t         load_tv;              /*!< When load_us was last updated */
 	M_uint64            wake_cnt;             /*!< Number of times event loop has been woken */
 	M_uint64            osevent_cnt;          /*!< Number of OS-triggered events */
 	M_uint64            softevent_cnt;        /*!< Number of soft events */
 	M_uint64            timer_cnt;            /*!< Number of timer events */
 
+	M_event_histogram_t *histograms;          /*!< Array of M_EVENT_HISTOGRAM_CNT histograms, NULL if not enabled */
+	M_timeval_t         wake_tv;              /*!< When the event loop last woke, for M_EVENT_HISTOGRAM_DISPATCH */
+	M_uint64            slow_us;              /*!< Threshold for slow_cb */
+	M_event_slow_callback_t slow_cb;          /*!< Callback for slow callbacks */
+	void               *slow_cb_arg;          /*!< Argument for slow_cb */
+
 	M_event_impl_cbs_t *impl;                 /*!< Which callback is currently in use */
 	M_event_data_t     *impl_data;            /*!< Implementation data used by the registered callbacks above */
 };
@@ -162,9 +190,12 @@ struct M_event_loop {
 typedef struct M_event_loop M_event_loop_t;
 
 struct M_event_pool {
-	M_event_t     *thread_evloop;       /*!< Array of event loop structures, one per thread */
-	M_threadid_t  *thread_ids;          /*!< Array of thread ids */
-	size_t         thread_count;        /*!< Count of threads */
+	M_event_t           **thread_evloop;     /*!< Array of event loops, one per thread, each in its own cache lines */
+	M_threadid_t         *thread_ids;        /*!< Array of thread ids */
+	int                  *thread_processors; /*!< Array of processors each thread is bound to, -1 for unbound */
+	size_t                thread_count;      /*!< Count of threads */
+	M_event_distribute_t  distribute;        /*!< How new objects are assigned to threads */
+	volatile M_uint64     rr_next;           /*!< Next thread for round robin distribution */
 };
 
 typedef struct M_event_pool M_event_pool_t;
@@ -184,6 +215,17 @@ struct M_event {
 
 /*! Get child event handle if a pool was provided that is least loaded */
 M_event_t *M_event_distribute(M_event_t *event);
+M_uint64 M_event_elapsed_us(const M_timeval_t *start_tv);
+
+/*! Number of M_event_histogram_type_t values */
+#define M_EVENT_HISTOGRAM_CNT 4
+
+/*! Record a histogram value. Event lock must be held. */
+void M_event_histogram_record(M_event_t *event, M_event_histogram_type_t type, M_uint64 usec);
+
+/*! Call a user callback, recording how long it takes. Event lock must be held, and is
+ *  released while the callback runs. */
+void M_event_callback_call(M_event_t *event, M_event_callback_t callback, M_event_type_t type, M_io_t *io, void *cb_data);
 
 M_bool M_event_handle_modify(M_event_t *event, M_event_modify_type_t modtype, M_io_t *io, M_EVENT_HANDLE handle, M_EVENT_SOCKET sock, M_event_wait_type_t waittype, M_event_caps_t caps);
 
@@ -209,6 +251,9 @@ extern struct M_event_impl_cbs M_event_impl_win32;
 extern struct M_event_impl_cbs M_event_impl_kqueue;
 #elif defined(HAVE_EPOLL)
 extern struct M_event_impl_cbs M_event_impl_epoll;
+#  if defined(HAVE_IO_URING)
+extern struct M_event_impl_cbs M_event_impl_io_uring;
+#  endif
 #endif
 
 __END_DECLS
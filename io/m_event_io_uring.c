@@ -0,0 +1,441 @@
+/* The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Monetra Technologies, LLC.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "m_config.h"
+#include <mstdlib/mstdlib_io.h>
+#include "m_event_int.h"
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <errno.h>
+#include <unistd.h>
+#include <endian.h>
+
+/* Readiness notification using io_uring multishot poll requests. Arming and
+ * disarming handles only queues submission entries, they're all submitted
+ * along with the wait for completions so a loop iteration is one syscall no
+ * matter how many handles changed. Requires kernel 5.13+ (multishot poll and
+ * extended wait arguments), otherwise the loop falls back to epoll. */
+
+#define IO_URING_ENTRIES     256
+#define IO_URING_WAIT_EVENTS 64
+
+/* Completions that don't belong to a handle, such as for poll removals. */
+#define IO_URING_TAG_IGNORE  M_UINT64_MAX
+
+#ifndef POLLRDHUP
+#  define POLLRDHUP 0x2000
+#endif
+
+typedef struct {
+	M_uint64 user_data;
+	M_int32  res;
+	M_uint32 flags;
+} M_event_io_uring_cqe_t;
+
+struct M_event_data {
+	int                     ring_fd;
+
+	/* Submission ring */
+	void                   *sq_ring;
+	size_t                  sq_ring_size;
+	unsigned               *sq_head;
+	unsigned               *sq_tail;
+	unsigned               *sq_mask;
+	unsigned               *sq_array;
+	struct io_uring_sqe    *sqes;
+	size_t                  sqes_size;
+	unsigned                sq_pending;  /*!< Entries added to the ring that haven't been submitted */
+
+	/* Completion ring */
+	void                   *cq_ring;
+	size_t                  cq_ring_size;
+	unsigned               *cq_head;
+	unsigned               *cq_tail;
+	unsigned               *cq_mask;
+	struct io_uring_cqe    *cqes;
+
+	M_hash_u64u64_t        *generations; /*!< Handle to registration generation, completions for older generations are stale */
+	M_uint32                generation;
+
+	M_event_io_uring_cqe_t  events[IO_URING_WAIT_EVENTS];
+	size_t                  nevents;
+};
+
+
+static int M_event_io_uring_setup(unsigned entries, struct io_uring_params *params)
+{
+	return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+
+static int M_event_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void *arg, size_t argsz)
+{
+	return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+
+static void M_event_impl_io_uring_data_free(M_event_data_t *data)
+{
+	if (data == NULL)
+		return;
+
+	if (data->sqes != NULL && data->sqes != MAP_FAILED)
+		munmap(data->sqes, data->sqes_size);
+	if (data->cq_ring != NULL && data->cq_ring != MAP_FAILED && data->cq_ring != data->sq_ring)
+		munmap(data->cq_ring, data->cq_ring_size);
+	if (data->sq_ring != NULL && data->sq_ring != MAP_FAILED)
+		munmap(data->sq_ring, data->sq_ring_size);
+	if (data->ring_fd != -1)
+		close(data->ring_fd);
+
+	M_hash_u64u64_destroy(data->generations);
+	M_free(data);
+}
+
+
+static M_event_data_t *M_event_impl_io_uring_create(void)
+{
+	M_event_data_t         *data;
+	struct io_uring_params  params;
+	unsigned char          *sq_ring;
+	unsigned char          *cq_ring;
+
+	data          = M_malloc_zero(sizeof(*data));
+	data->ring_fd = -1;
+
+	M_mem_set(&params, 0, sizeof(params));
+	data->ring_fd = M_event_io_uring_setup(IO_URING_ENTRIES, &params);
+	if (data->ring_fd < 0) {
+		data->ring_fd = -1;
+		goto fail;
+	}
+
+	/* Multishot poll came after the extended wait args so this rules out kernels without it. */
+	if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_RSRC_TAGS))
+		goto fail;
+
+	data->sq_ring_size = params.sq_off.array + (params.sq_entries * sizeof(unsigned));
+	data->cq_ring_size = params.cq_off.cqes + (params.cq_entries * sizeof(struct io_uring_cqe));
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		data->sq_ring_size = M_MAX(data->sq_ring_size, data->cq_ring_size);
+		data->cq_ring_size = data->sq_ring_size;
+	}
+
+	data->sq_ring = mmap(NULL, data->sq_ring_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, data->ring_fd, IORING_OFF_SQ_RING);
+	if (data->sq_ring == MAP_FAILED)
+		goto fail;
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		data->cq_ring = data->sq_ring;
+	} else {
+		data->cq_ring = mmap(NULL, data->cq_ring_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, data->ring_fd, IORING_OFF_CQ_RING);
+		if (data->cq_ring == MAP_FAILED)
+			goto fail;
+	}
+
+	data->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	data->sqes      = mmap(NULL, data->sqes_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, data->ring_fd, IORING_OFF_SQES);
+	if (data->sqes == MAP_FAILED)
+		goto fail;
+
+	sq_ring        = data->sq_ring;
+	data->sq_head  = (unsigned *)(void *)(sq_ring + params.sq_off.head);
+	data->sq_tail  = (unsigned *)(void *)(sq_ring + params.sq_off.tail);
+	data->sq_mask  = (unsigned *)(void *)(sq_ring + params.sq_off.ring_mask);
+	data->sq_array = (unsigned *)(void *)(sq_ring + params.sq_off.array);
+
+	cq_ring        = data->cq_ring;
+	data->cq_head  = (unsigned *)(void *)(cq_ring + params.cq_off.head);
+	data->cq_tail  = (unsigned *)(void *)(cq_ring + params.cq_off.tail);
+	data->cq_mask  = (unsigned *)(void *)(cq_ring + params.cq_off.ring_mask);
+	data->cqes     = (struct io_uring_cqe *)(void *)(cq_ring + params.cq_off.cqes);
+
+	data->generations = M_hash_u64u64_create(16, 75, M_HASH_U64U64_NONE);
+	return data;
+
+fail:
+	M_event_impl_io_uring_data_free(data);
+	return NULL;
+}
+
+
+/*! Submit queued entries without waiting for anything. */
+static void M_event_impl_io_uring_submit(M_event_data_t *data)
+{
+	int rv;
+
+	while (data->sq_pending > 0) {
+		rv = M_event_io_uring_enter(data->ring_fd, data->sq_pending, 0, 0, NULL, 0);
+		if (rv < 0) {
+			if (errno == EINTR)
+				continue;
+			/* Dropping entries would leave handles without notifications, but there's
+			 * nothing more that can be done. */
+			data->sq_pending = 0;
+			return;
+		}
+		data->sq_pending -= (unsigned)rv;
+	}
+}
+
+
+static struct io_uring_sqe *M_event_impl_io_uring_get_sqe(M_event_data_t *data)
+{
+	struct io_uring_sqe *sqe;
+	unsigned             tail;
+	unsigned             head;
+
+	tail = *data->sq_tail;
+	head = __atomic_load_n(data->sq_head, __ATOMIC_ACQUIRE);
+	if (tail - head > *data->sq_mask) {
+		/* Ring is full, hand what's there to the kernel to make room. */
+		M_event_impl_io_uring_submit(data);
+		head = __atomic_load_n(data->sq_head, __ATOMIC_ACQUIRE);
+		if (tail - head > *data->sq_mask)
+			return NULL;
+	}
+
+	sqe = &data->sqes[tail & *data->sq_mask];
+	M_mem_set(sqe, 0, sizeof(*sqe));
+	data->sq_array[tail & *data->sq_mask] = tail & *data->sq_mask;
+	__atomic_store_n(data->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	data->sq_pending++;
+
+	return sqe;
+}
+
+
+static void M_event_impl_io_uring_arm(M_event_data_t *data, M_EVENT_HANDLE handle, M_event_caps_t caps, M_uint64 user_data)
+{
+	struct io_uring_sqe *sqe;
+	M_uint32             events;
+
+	sqe = M_event_impl_io_uring_get_sqe(data);
+	if (sqe == NULL)
+		return;
+
+	/* Always listen for read events as for write-only pipes this is how we are
+	 * notified of a closure on the remote end. Same as epoll. */
+	events = POLLIN|POLLRDHUP;
+	if (caps & M_EVENT_CAPS_WRITE)
+		events |= POLLOUT;
+#if __BYTE_ORDER == __BIG_ENDIAN
+	events = (events << 16) | (events >> 16);
+#endif
+
+	sqe->opcode        = IORING_OP_POLL_ADD;
+	sqe->fd            = handle;
+	sqe->poll32_events = events;
+	sqe->len           = IORING_POLL_ADD_MULTI;
+	sqe->user_data     = user_data;
+}
+
+
+static void M_event_impl_io_uring_modify_event(M_event_t *event, M_event_modify_type_t modtype, M_EVENT_HANDLE handle, M_event_wait_type_t waittype, M_event_caps_t caps)
+{
+	M_event_data_t      *data = event->u.loop.impl_data;
+	struct io_uring_sqe *sqe;
+	M_uint64             gen;
+	(void)waittype;
+
+	if (data == NULL)
+		return;
+
+	switch (modtype) {
+		case M_EVENT_MODTYPE_ADD_HANDLE:
+			/* Completions carry the generation so ones for a prior registration of
+			 * the same descriptor number can be told apart. */
+			data->generation++;
+			M_hash_u64u64_insert(data->generations, (M_uint64)handle, data->generation);
+			M_event_impl_io_uring_arm(data, handle, caps, ((M_uint64)data->generation << 32) | (M_uint32)handle);
+			break;
+		case M_EVENT_MODTYPE_DEL_HANDLE:
+			if (!M_hash_u64u64_get(data->generations, (M_uint64)handle, &gen))
+				return;
+			M_hash_u64u64_remove(data->generations, (M_uint64)handle);
+
+			sqe = M_event_impl_io_uring_get_sqe(data);
+			if (sqe == NULL)
+				return;
+			sqe->opcode    = IORING_OP_POLL_REMOVE;
+			sqe->fd        = -1;
+			sqe->addr      = (gen << 32) | (M_uint32)handle;
+			sqe->user_data = IO_URING_TAG_IGNORE;
+
+			/* The poll request holds a reference to the file, submit now so the
+			 * caller closing the descriptor really closes it. */
+			M_event_impl_io_uring_submit(data);
+			break;
+		default:
+			return;
+	}
+}
+
+
+static void M_event_impl_io_uring_data_structure(M_event_t *event)
+{
+	M_hash_u64vp_enum_t *hashenum = NULL;
+	M_event_evhandle_t  *member   = NULL;
+
+	if (event->u.loop.impl_data != NULL)
+		return;
+
+	event->u.loop.impl_data = M_event_impl_io_uring_create();
+	if (event->u.loop.impl_data == NULL) {
+		/* Kernel lacks support or io_uring is disabled, use epoll instead. */
+		event->u.loop.impl = &M_event_impl_epoll;
+		event->u.loop.impl->data_structure(event);
+		return;
+	}
+
+	M_hash_u64vp_enumerate(event->u.loop.evhandles, &hashenum);
+	while (M_hash_u64vp_enumerate_next(event->u.loop.evhandles, hashenum, NULL, (void **)&member)) {
+		M_event_impl_io_uring_modify_event(event, M_EVENT_MODTYPE_ADD_HANDLE, member->handle, member->waittype, member->caps);
+	}
+	M_hash_u64vp_enumerate_free(hashenum);
+}
+
+
+static M_bool M_event_impl_io_uring_wait(M_event_t *event, M_uint64 timeout_ms)
+{
+	M_event_data_t                *data = event->u.loop.impl_data;
+	struct io_uring_getevents_arg  arg;
+	struct __kernel_timespec       ts;
+	unsigned                       head;
+	unsigned                       tail;
+	int                            rv;
+
+	M_mem_set(&arg, 0, sizeof(arg));
+	if (timeout_ms != M_TIMEOUT_INF) {
+		ts.tv_sec  = (long long)(timeout_ms / 1000);
+		ts.tv_nsec = (long long)((timeout_ms % 1000) * 1000000);
+		arg.ts     = (M_uint64)((M_uintptr)&ts);
+	}
+
+	/* Submits everything queued since the last wait in the same call. */
+	rv = M_event_io_uring_enter(data->ring_fd, data->sq_pending, (timeout_ms == 0)?0:1,
+	                            IORING_ENTER_GETEVENTS|IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+	if (rv > 0)
+		data->sq_pending -= M_MIN((unsigned)rv, data->sq_pending);
+
+	data->nevents = 0;
+	head          = *data->cq_head;
+	tail          = __atomic_load_n(data->cq_tail, __ATOMIC_ACQUIRE);
+	while (head != tail && data->nevents < IO_URING_WAIT_EVENTS) {
+		struct io_uring_cqe *cqe = &data->cqes[head & *data->cq_mask];
+
+		data->events[data->nevents].user_data = cqe->user_data;
+		data->events[data->nevents].res       = cqe->res;
+		data->events[data->nevents].flags     = cqe->flags;
+		data->nevents++;
+		head++;
+	}
+	__atomic_store_n(data->cq_head, head, __ATOMIC_RELEASE);
+
+	if (data->nevents > 0)
+		return M_TRUE;
+	return M_FALSE;
+}
+
+
+static void M_event_impl_io_uring_process(M_event_t *event)
+{
+	M_event_data_t *data = event->u.loop.impl_data;
+	size_t          i;
+
+	for (i=0; i<data->nevents; i++) {
+		M_event_io_uring_cqe_t *cqe    = &data->events[i];
+		M_event_evhandle_t     *member = NULL;
+		M_EVENT_HANDLE          handle;
+		M_uint64                gen;
+		M_uint32                revents;
+
+		if (cqe->user_data == IO_URING_TAG_IGNORE)
+			continue;
+
+		handle = (M_EVENT_HANDLE)(cqe->user_data & 0xFFFFFFFF);
+		if (!M_hash_u64u64_get(data->generations, (M_uint64)handle, &gen) || gen != (cqe->user_data >> 32))
+			continue;
+
+		if (!M_hash_u64vp_get(event->u.loop.evhandles, (M_uint64)handle, (void **)&member))
+			continue;
+
+		/* The poll itself failed (e.g. -EBADF). Arming it again would fail the same
+		 * way straight away, so leave it ended and let the io object see the error. */
+		if (cqe->res < 0) {
+			if (member->waittype & M_EVENT_WAIT_READ) {
+				M_event_deliver_io(event, member->io, M_EVENT_TYPE_READ);
+			}
+			M_event_deliver_io(event, member->io, M_EVENT_TYPE_ERROR);
+			continue;
+		}
+
+		/* The kernel ended the multishot request (e.g. overflow), arm it again. */
+		if (!(cqe->flags & IORING_CQE_F_MORE))
+			M_event_impl_io_uring_arm(data, handle, member->caps, cqe->user_data);
+
+		revents = (M_uint32)cqe->res;
+
+		/* Error */
+		if (revents & (POLLERR|POLLNVAL)) {
+			/* NOTE: always deliver READ event first on an error to make sure any
+			 *       possible pending data is flushed. */
+			if (member->waittype & M_EVENT_WAIT_READ) {
+				M_event_deliver_io(event, member->io, M_EVENT_TYPE_READ);
+			}
+			M_event_deliver_io(event, member->io, M_EVENT_TYPE_ERROR);
+		}
+
+		/* Read */
+		if (revents & POLLIN) {
+			M_event_deliver_io(event, member->io, M_EVENT_TYPE_READ);
+		}
+
+		/* Disconnect */
+		if (revents & (POLLHUP|POLLRDHUP)) {
+			/* NOTE: always deliver READ event first on a disconnect to make sure any
+			 *       possible pending data is flushed. */
+			if (member->waittype & M_EVENT_WAIT_READ) {
+				M_event_deliver_io(event, member->io, M_EVENT_TYPE_READ);
+			}
+			M_event_deliver_io(event, member->io, M_EVENT_TYPE_DISCONNECTED);
+		}
+
+		/* Write */
+		if (revents & POLLOUT) {
+			M_event_deliver_io(event, member->io, M_EVENT_TYPE_WRITE);
+		}
+	}
+	data->nevents = 0;
+}
+
+
+struct M_event_impl_cbs M_event_impl_io_uring = {
+	M_event_impl_io_uring_data_free,
+	M_event_impl_io_uring_data_structure,
+	M_event_impl_io_uring_wait,
+	M_event_impl_io_uring_process,
+	M_event_impl_io_uring_modify_event
+};
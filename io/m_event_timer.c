@@ -49,6 +49,43 @@ struct M_event_timer {
 	M_timeval_t          next_run;     /* Next run, based on M_time_elapse_start() */
 	M_timeval_t          last_run;     /* Last run time, to prevent starvation of other tasks */
 	M_bool               executing;    /* If we are currently executing this timer's callback -- make sure we don't really destroy ourselves */
+
+	/* Timer wheel placement, only used when the event loop has a wheel */
+	M_event_timer_t     *wheel_prev;
+	M_event_timer_t     *wheel_next;
+	M_event_timer_t    **wheel_head;   /* Slot or stopped list the timer is linked into, NULL if not linked */
+	size_t               wheel_level;  /* Level of the slot, M_EVENT_TIMER_WHEEL_LEVELS for the stopped list */
+	M_bool               wheel_ready;  /* In the wheel's ready queue */
+	M_bool               wheel_tracked; /* In the wheel's list of known timers */
+};
+
+/* Hierarchical timer wheel. Level 0 has 1ms slots covering 256ms, each following
+ * level has 64 slots each covering an entire lap of the level below it. Five levels
+ * cover 2^32 ms (~49 days) which is more than INTERVAL_MAX.
+ *
+ * Timers are placed in the slot for the tick (ms since base_tv) they expire on.
+ * When the wheel advances to a tick where a lower level wraps, the matching slot
+ * in the level above is cascaded down. Timers whose slot comes due are moved to
+ * a sorted ready queue so timers expiring on the same tick run in the same order
+ * the sorted queue would run them in. */
+#define M_EVENT_TIMER_WHEEL_LEVELS    5
+#define M_EVENT_TIMER_WHEEL_L0_BITS   8
+#define M_EVENT_TIMER_WHEEL_LN_BITS   6
+#define M_EVENT_TIMER_WHEEL_SLOTS     ((1 << M_EVENT_TIMER_WHEEL_L0_BITS) + ((M_EVENT_TIMER_WHEEL_LEVELS - 1) << M_EVENT_TIMER_WHEEL_LN_BITS))
+#define M_EVENT_TIMER_WHEEL_MAX_TICKS ((M_uint64)1 << (M_EVENT_TIMER_WHEEL_L0_BITS + (M_EVENT_TIMER_WHEEL_LEVELS - 1) * M_EVENT_TIMER_WHEEL_LN_BITS))
+
+/* Number of timers on an event loop that causes it to switch from the sorted
+ * queue to the timer wheel. */
+#define M_EVENT_TIMER_WHEEL_THRESHOLD 1024
+
+struct M_event_timer_wheel {
+	M_timeval_t      base_tv;                            /*!< Elapsed time of tick 0 */
+	M_uint64         now;                                /*!< Tick the wheel has been advanced to */
+	M_event_timer_t *slots[M_EVENT_TIMER_WHEEL_SLOTS];   /*!< All levels, level 0 first */
+	size_t           level_cnt[M_EVENT_TIMER_WHEEL_LEVELS]; /*!< Number of timers in each level */
+	M_event_timer_t *stopped;                            /*!< Timers that are not started */
+	M_queue_t       *ready;                              /*!< Sorted timers whose tick has come due */
+	M_hash_u64vp_t  *tracked;                            /*!< All timers, owns the timer memory */
 };
 
 /* Max interval is 30 days (in milliseconds).  This is due to Windows using a 32bit timer
@@ -92,17 +129,263 @@ static int M_event_timer_compar_cb(const void *arg1, const void *arg2, void *thu
 }
 
 
+static M_uint64 M_event_timer_wheel_tick(const M_event_timer_wheel_t *wheel, const M_timeval_t *tv)
+{
+	M_int64 diff;
+
+	diff = M_time_timeval_diff(&wheel->base_tv, tv);
+	if (diff < 0)
+		return 0;
+	return (M_uint64)diff;
+}
+
+
+static size_t M_event_timer_wheel_shift(size_t level)
+{
+	if (level == 0)
+		return 0;
+	return M_EVENT_TIMER_WHEEL_L0_BITS + ((level - 1) * M_EVENT_TIMER_WHEEL_LN_BITS);
+}
+
+
+static M_event_timer_t **M_event_timer_wheel_slot(M_event_timer_wheel_t *wheel, size_t level, M_uint64 tick)
+{
+	size_t idx;
+
+	if (level == 0)
+		return &wheel->slots[tick & ((1 << M_EVENT_TIMER_WHEEL_L0_BITS) - 1)];
+
+	idx  = (1 << M_EVENT_TIMER_WHEEL_L0_BITS) + ((level - 1) << M_EVENT_TIMER_WHEEL_LN_BITS);
+	idx += (size_t)((tick >> M_event_timer_wheel_shift(level)) & ((1 << M_EVENT_TIMER_WHEEL_LN_BITS) - 1));
+	return &wheel->slots[idx];
+}
+
+
+static void M_event_timer_wheel_link(M_event_timer_wheel_t *wheel, M_event_timer_t **head, size_t level, M_event_timer_t *timer)
+{
+	timer->wheel_prev = NULL;
+	timer->wheel_next = *head;
+	if (*head != NULL)
+		(*head)->wheel_prev = timer;
+	*head              = timer;
+	timer->wheel_head  = head;
+	timer->wheel_level = level;
+	if (level < M_EVENT_TIMER_WHEEL_LEVELS)
+		wheel->level_cnt[level]++;
+}
+
+
+static void M_event_timer_wheel_unlink(M_event_timer_wheel_t *wheel, M_event_timer_t *timer)
+{
+	if (timer->wheel_ready) {
+		M_queue_take(wheel->ready, timer);
+		timer->wheel_ready = M_FALSE;
+		return;
+	}
+
+	if (timer->wheel_head == NULL)
+		return;
+
+	if (timer->wheel_prev != NULL) {
+		timer->wheel_prev->wheel_next = timer->wheel_next;
+	} else {
+		*timer->wheel_head = timer->wheel_next;
+	}
+	if (timer->wheel_next != NULL)
+		timer->wheel_next->wheel_prev = timer->wheel_prev;
+
+	if (timer->wheel_level < M_EVENT_TIMER_WHEEL_LEVELS)
+		wheel->level_cnt[timer->wheel_level]--;
+
+	timer->wheel_prev = NULL;
+	timer->wheel_next = NULL;
+	timer->wheel_head = NULL;
+}
+
+
+static void M_event_timer_wheel_insert(M_event_timer_wheel_t *wheel, M_event_timer_t *timer)
+{
+	M_uint64 expires;
+	M_uint64 diff;
+	size_t   level;
+
+	if (!timer->started) {
+		M_event_timer_wheel_link(wheel, &wheel->stopped, M_EVENT_TIMER_WHEEL_LEVELS, timer);
+		return;
+	}
+
+	expires = M_event_timer_wheel_tick(wheel, &timer->next_run);
+	if (expires <= wheel->now) {
+		M_queue_insert(wheel->ready, timer);
+		timer->wheel_ready = M_TRUE;
+		return;
+	}
+
+	diff = expires - wheel->now;
+	if (diff >= M_EVENT_TIMER_WHEEL_MAX_TICKS) {
+		/* Will be cascaded into the correct slot as the wheel turns */
+		expires = wheel->now + M_EVENT_TIMER_WHEEL_MAX_TICKS - 1;
+		diff    = M_EVENT_TIMER_WHEEL_MAX_TICKS - 1;
+	}
+
+	for (level=0; level<M_EVENT_TIMER_WHEEL_LEVELS-1; level++) {
+		if (diff < ((M_uint64)1 << M_event_timer_wheel_shift(level+1)))
+			break;
+	}
+
+	M_event_timer_wheel_link(wheel, M_event_timer_wheel_slot(wheel, level, expires), level, timer);
+}
+
+
+/*! Next tick after now where a slot holding timers comes due or gets cascaded.
+ *  M_UINT64_MAX if the wheel holds no started timers. */
+static M_uint64 M_event_timer_wheel_next_tick(M_event_timer_wheel_t *wheel)
+{
+	M_uint64 best = M_UINT64_MAX;
+	M_uint64 cand;
+	M_uint64 k;
+	size_t   level;
+	size_t   shift;
+
+	if (wheel->level_cnt[0]) {
+		for (k=1; k<((M_uint64)1 << M_EVENT_TIMER_WHEEL_L0_BITS); k++) {
+			if (*M_event_timer_wheel_slot(wheel, 0, wheel->now + k) != NULL) {
+				best = wheel->now + k;
+				break;
+			}
+		}
+	}
+
+	for (level=1; level<M_EVENT_TIMER_WHEEL_LEVELS; level++) {
+		if (!wheel->level_cnt[level])
+			continue;
+
+		/* A slot is cascaded when the wheel reaches the start of it. */
+		shift = M_event_timer_wheel_shift(level);
+		for (k=1; k<=((M_uint64)1 << M_EVENT_TIMER_WHEEL_LN_BITS); k++) {
+			cand = ((wheel->now >> shift) + k) << shift;
+			if (*M_event_timer_wheel_slot(wheel, level, cand) != NULL) {
+				if (cand < best)
+					best = cand;
+				break;
+			}
+		}
+	}
+
+	return best;
+}
+
+
+static void M_event_timer_wheel_advance(M_event_timer_wheel_t *wheel, M_uint64 tick)
+{
+	M_event_timer_t *timer;
+	M_event_timer_t *list;
+	M_uint64         next;
+	size_t           level;
+
+	while (wheel->now < tick) {
+		/* Ticks in between have nothing to do so skip straight to the next one that does. */
+		next = M_event_timer_wheel_next_tick(wheel);
+		if (next > tick) {
+			wheel->now = tick;
+			break;
+		}
+		wheel->now = next;
+
+		/* Cascade each level whose lower levels just wrapped around. */
+		for (level=1; level<M_EVENT_TIMER_WHEEL_LEVELS; level++) {
+			if (wheel->now & (((M_uint64)1 << M_event_timer_wheel_shift(level)) - 1))
+				break;
+
+			list = *M_event_timer_wheel_slot(wheel, level, wheel->now);
+			while ((timer = list) != NULL) {
+				list = timer->wheel_next;
+				M_event_timer_wheel_unlink(wheel, timer);
+				M_event_timer_wheel_insert(wheel, timer);
+			}
+		}
+
+		/* Anything in the current level 0 slot is due. */
+		while ((timer = *M_event_timer_wheel_slot(wheel, 0, wheel->now)) != NULL) {
+			M_event_timer_wheel_unlink(wheel, timer);
+			M_queue_insert(wheel->ready, timer);
+			timer->wheel_ready = M_TRUE;
+		}
+	}
+}
+
+
+static void M_event_timer_wheel_enqueue(M_event_timer_wheel_t *wheel, M_event_timer_t *timer)
+{
+	if (!timer->wheel_tracked) {
+		M_hash_u64vp_insert(wheel->tracked, (M_uint64)((M_uintptr)timer), timer);
+		timer->wheel_tracked = M_TRUE;
+	}
+	M_event_timer_wheel_insert(wheel, timer);
+}
+
+
+static M_event_timer_wheel_t *M_event_timer_wheel_create(void)
+{
+	M_event_timer_wheel_t *wheel;
+
+	wheel          = M_malloc_zero(sizeof(*wheel));
+	wheel->ready   = M_queue_create(M_event_timer_compar_cb, NULL);
+	wheel->tracked = M_hash_u64vp_create(16, 75, M_HASH_U64VP_NONE, M_free);
+	M_time_elapsed_start(&wheel->base_tv);
+
+	return wheel;
+}
+
+
+static void M_event_timer_wheel_destroy(M_event_timer_wheel_t *wheel)
+{
+	if (wheel == NULL)
+		return;
+
+	/* Tracked owns the timers */
+	M_queue_destroy(wheel->ready);
+	M_hash_u64vp_destroy(wheel->tracked, M_TRUE);
+	M_free(wheel);
+}
+
+
 static void M_event_timer_enqueue(M_event_timer_t *timer)
 {
 	M_event_t *event = timer->event;
 
+	if (event->u.loop.timer_wheel != NULL) {
+		M_event_timer_wheel_enqueue(event->u.loop.timer_wheel, timer);
+		return;
+	}
+
 	/* NOTE: This isn't part of the M_event_t initialization as not all implementations
 	 *       need timers, so detect that it wasn't initialized and initialize when
 	 *       needed */
 	if (event->u.loop.timers == NULL) {
+		if (event->u.loop.flags & M_EVENT_FLAG_TIMER_WHEEL) {
+			event->u.loop.timer_wheel = M_event_timer_wheel_create();
+			M_event_timer_wheel_enqueue(event->u.loop.timer_wheel, timer);
+			return;
+		}
 		event->u.loop.timers = M_queue_create(M_event_timer_compar_cb, M_free);
 	}
 
+	/* Switch to the wheel once there are enough timers for the sorted insert to cost more. */
+	if (M_queue_len(event->u.loop.timers) >= M_EVENT_TIMER_WHEEL_THRESHOLD) {
+		M_event_timer_t *t;
+
+		event->u.loop.timer_wheel = M_event_timer_wheel_create();
+		while ((t = M_queue_take_first(event->u.loop.timers)) != NULL) {
+			M_event_timer_wheel_enqueue(event->u.loop.timer_wheel, t);
+		}
+		M_queue_destroy(event->u.loop.timers);
+		event->u.loop.timers = NULL;
+
+		M_event_timer_wheel_enqueue(event->u.loop.timer_wheel, timer);
+		return;
+	}
+
 	M_queue_insert(event->u.loop.timers, timer);
 }
 
@@ -111,10 +394,66 @@ static void M_event_timer_dequeue(M_event_timer_t *timer)
 {
 	M_event_t *event = timer->event;
 
+	if (event->u.loop.timer_wheel != NULL) {
+		M_event_timer_wheel_unlink(event->u.loop.timer_wheel, timer);
+		return;
+	}
+
 	M_queue_take(event->u.loop.timers, timer);
 }
 
 
+/*! Release a timer that has already been dequeued. */
+static void M_event_timer_free(M_event_timer_t *timer)
+{
+	M_event_t *event = timer->event;
+
+	if (event->u.loop.timer_wheel != NULL && timer->wheel_tracked)
+		M_hash_u64vp_remove(event->u.loop.timer_wheel->tracked, (M_uint64)((M_uintptr)timer), M_FALSE);
+
+	M_free(timer);
+}
+
+
+static M_bool M_event_timer_exists(M_event_t *event, M_event_timer_t *timer)
+{
+	if (event->u.loop.timer_wheel != NULL)
+		return M_hash_u64vp_get(event->u.loop.timer_wheel->tracked, (M_uint64)((M_uintptr)timer), NULL);
+	return M_queue_exists(event->u.loop.timers, timer);
+}
+
+
+/*! First timer in run order, NULL if none. A lock on M_event_t should already be held. */
+static M_event_timer_t *M_event_timer_first(M_event_t *event, const M_timeval_t *curr)
+{
+	M_event_timer_wheel_t *wheel = event->u.loop.timer_wheel;
+
+	if (wheel == NULL)
+		return M_queue_first(event->u.loop.timers);
+
+	M_event_timer_wheel_advance(wheel, M_event_timer_wheel_tick(wheel, curr));
+	return M_queue_first(wheel->ready);
+}
+
+
+size_t M_event_timer_count(M_event_t *event)
+{
+	if (event->u.loop.timer_wheel != NULL)
+		return M_hash_u64vp_num_keys(event->u.loop.timer_wheel->tracked);
+	return M_queue_len(event->u.loop.timers);
+}
+
+
+void M_event_timer_destroy_all(M_event_t *event)
+{
+	/* Should auto-destroy any lingering timer handles automatically */
+	M_queue_destroy(event->u.loop.timers);
+	event->u.loop.timers      = NULL;
+	M_event_timer_wheel_destroy(event->u.loop.timer_wheel);
+	event->u.loop.timer_wheel = NULL;
+}
+
+
 M_event_timer_t *M_event_timer_add(M_event_t *event, M_event_callback_t callback, void *cb_data)
 {
 	M_event_timer_t *timer;
@@ -186,7 +525,7 @@ M_bool M_event_timer_remove(M_event_timer_t *timer)
 	M_event_timer_dequeue(timer);
 //M_printf("%s(): timer %p destroyed\n", __FUNCTION__, timer); fflush(stdout);
 
-	M_free(timer);
+	M_event_timer_free(timer);
 	M_event_unlock(event);
 
 	return M_TRUE;
@@ -201,7 +540,7 @@ static void M_event_timer_remove_cb(M_event_t *event, M_event_type_t type, M_io_
 	(void)io;
 
 	/* Destroyed out from under us */
-	if (!M_queue_exists(event->u.loop.timers, timer))
+	if (!M_event_timer_exists(event, timer))
 		return;
 
 	M_event_timer_remove(timer);
@@ -496,8 +835,20 @@ M_uint64 M_event_timer_minimum_ms(M_event_t *event)
 	M_event_timer_t   *timer;
 	M_int64            time_ms;
 	M_timeval_t        curr;
+	M_uint64           tick;
+
+	/* Elapsed_start just pulls the current counter */
+	M_time_elapsed_start(&curr);
+
+	timer = M_event_timer_first(event, &curr);
+	if (timer == NULL && event->u.loop.timer_wheel != NULL) {
+		/* Nothing due yet, sleep until the wheel has something to do. */
+		tick = M_event_timer_wheel_next_tick(event->u.loop.timer_wheel);
+		if (tick == M_UINT64_MAX)
+			return M_TIMEOUT_INF;
+		return tick - event->u.loop.timer_wheel->now;
+	}
 
-	timer = M_queue_first(event->u.loop.timers);
 	if (timer == NULL) {
 		return M_TIMEOUT_INF;
 	}
@@ -506,9 +857,6 @@ M_uint64 M_event_timer_minimum_ms(M_event_t *event)
 		return M_TIMEOUT_INF;
 	}
 
-	/* Elapsed_start just pulls the current counter */
-	M_time_elapsed_start(&curr);
-
 	time_ms = M_time_timeval_diff(&curr, &timer->next_run);
 	if (time_ms < 0)
 		time_ms = 0;
@@ -522,12 +870,13 @@ void M_event_timer_process(M_event_t *event)
 	M_event_timer_t   *timer;
 	M_event_timer_t   *last_timer = NULL;
 	M_timeval_t        curr;
+	M_int64            late_us;
 	size_t             cnt = 0;
 
 	M_time_elapsed_start(&curr);
 
 	/* Iterate across timers until either we run out or hit one that isn't yet triggered */
-	while ((timer = M_queue_first(event->u.loop.timers)) != NULL && timer != last_timer && timer->started && M_time_timeval_diff(&timer->next_run, &curr) >= 0) {
+	while ((timer = M_event_timer_first(event, &curr)) != NULL && timer != last_timer && timer->started && M_time_timeval_diff(&timer->next_run, &curr) >= 0) {
 //M_printf("%s(): processing timer %p\n", __FUNCTION__, timer); fflush(stdout);
 		last_timer = timer;
 		/* We always dequeue the timer from the list as we may add it back in if it is to be rescheduled */
@@ -547,13 +896,13 @@ void M_event_timer_process(M_event_t *event)
 			timer->cnt++;
 			timer->executing = M_TRUE;
 
-			/* Unlock event lock since the callback may take some time */
-			M_event_unlock(event);
-
-			timer->callback(event, M_EVENT_TYPE_OTHER, NULL, timer->cb_data);
+			/* Due check is only to the millisecond */
+			late_us = ((curr.tv_sec - timer->next_run.tv_sec) * 1000000) + (curr.tv_usec - timer->next_run.tv_usec);
+			M_event_histogram_record(event, M_EVENT_HISTOGRAM_TIMER_LATE, (M_uint64)M_MAX(late_us, 0));
 
-			/* Relock to possibly re-queue or loop */
-			M_event_lock(event);
+			/* Unlocks event lock since the callback may take some time, relocks
+			 * to possibly re-queue or loop */
+			M_event_callback_call(event, timer->callback, M_EVENT_TYPE_OTHER, NULL, timer->cb_data);
 
 			timer->executing = M_FALSE;
 
@@ -579,13 +928,13 @@ void M_event_timer_process(M_event_t *event)
 
 		/* If autodestroy and timer went to stopped mode, kill it */
 		if (!timer->started && timer->autodestroy) {
-			M_free(timer);
+			M_event_timer_free(timer);
 			continue;
 		}
 
 		/* If self-deleted during the callback, cleanup now */
 		if (timer->delay_destroy) {
-			M_free(timer);
+			M_event_timer_free(timer);
 			continue;
 		}
 
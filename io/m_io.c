@@ -300,6 +300,7 @@ static void M_io_destroy_full(M_io_t *io)
 	io->reg_event = NULL;
 
 	M_io_block_data_free(io);
+	M_io_sendfile_data_free(io);
 
 	num = M_list_len(io->layer);
 	for (i=(ssize_t)num - 1; i >= 0; i--) {
@@ -635,6 +636,138 @@ M_io_error_t M_io_layer_write(M_io_t *io, size_t layer_id, const unsigned char *
 	return err;
 }
 
+/* Largest amount of data copied together for a layer that only takes a single buffer */
+#define M_IO_WRITEV_COALESCE_MAX 8192
+
+static M_io_error_t M_io_layer_writev_coalesce(M_io_layer_t *layer, const M_iovec_t *iov, size_t iov_cnt, size_t *write_len, M_io_meta_t *meta)
+{
+	unsigned char buf[M_IO_WRITEV_COALESCE_MAX];
+	size_t        len = 0;
+	size_t        i;
+
+	for (i=0; i<iov_cnt && iov[i].len == 0; i++)
+		;
+
+	if (i == iov_cnt) {
+		*write_len = 0;
+		return M_IO_ERROR_INVALID;
+	}
+
+	/* Nothing to gather, or the first segment is large enough that copying it gains nothing */
+	if (i == iov_cnt - 1 || iov[i].len >= sizeof(buf)) {
+		*write_len = iov[i].len;
+		return layer->cb.cb_write(layer, iov[i].data, write_len, meta);
+	}
+
+	for ( ; i<iov_cnt && len < sizeof(buf); i++) {
+		size_t n = M_MIN(iov[i].len, sizeof(buf) - len);
+		M_mem_copy(buf + len, iov[i].data, n);
+		len += n;
+	}
+
+	*write_len = len;
+	return layer->cb.cb_write(layer, buf, write_len, meta);
+}
+
+M_io_error_t M_io_layer_writev(M_io_t *io, size_t layer_id, const M_iovec_t *iov, size_t iov_cnt, size_t *write_len, M_io_meta_t *meta)
+{
+	ssize_t       i;
+	M_io_error_t  err   = M_IO_ERROR_ERROR;
+	M_io_layer_t *layer = NULL;
+
+	if (io == NULL || io->flags & M_IO_FLAG_USER_DESTROY || iov == NULL || iov_cnt == 0 || write_len == NULL)
+		return M_IO_ERROR_INVALID;
+
+	if (layer_id >= M_list_len(io->layer))
+		return M_IO_ERROR_INVALID;
+
+	for (i=(ssize_t)layer_id; i >= 0; i--) {
+		layer = M_io_layer_at(io, (size_t)i);
+
+		if (layer->cb.cb_writev != NULL) {
+			err = layer->cb.cb_writev(layer, iov, iov_cnt, write_len, meta);
+			break;
+		}
+
+		if (layer->cb.cb_write != NULL) {
+			err = M_io_layer_writev_coalesce(layer, iov, iov_cnt, write_len, meta);
+			break;
+		}
+	}
+
+	if (M_io_error_is_critical(err)) {
+		/* Clear all existing non-disc/error soft events (leave the others as they may still need to be propagated up).
+		 * The connection is no longer valid, enqueue a disconnect or error softevent as necessary to ensure the error
+		 * is caught */
+		M_io_softevent_clearall(io, M_TRUE);
+		M_io_layer_softevent_add(layer, M_FALSE, (err == M_IO_ERROR_DISCONNECT)?M_EVENT_TYPE_DISCONNECTED:M_EVENT_TYPE_ERROR, err);
+	}
+	return err;
+}
+
+M_io_error_t M_io_layer_sendfile(M_io_t *io, size_t layer_id, M_intptr fd, M_int64 offset, size_t len, size_t *write_len)
+{
+	ssize_t       i;
+	M_io_error_t  err   = M_IO_ERROR_ERROR;
+	M_io_layer_t *layer = NULL;
+
+	if (io == NULL || io->flags & M_IO_FLAG_USER_DESTROY || len == 0 || write_len == NULL)
+		return M_IO_ERROR_INVALID;
+
+	if (layer_id >= M_list_len(io->layer))
+		return M_IO_ERROR_INVALID;
+
+	for (i=(ssize_t)layer_id; i >= 0; i--) {
+		layer = M_io_layer_at(io, (size_t)i);
+
+		if (layer->cb.cb_sendfile != NULL) {
+			err = layer->cb.cb_sendfile(layer, fd, offset, len, write_len);
+			break;
+		}
+
+		/* Layer needs to see (and possibly transform) the data */
+		if (layer->cb.cb_write != NULL)
+			return M_IO_ERROR_NOTIMPL;
+	}
+
+	/* Not being able to use the file isn't a connection failure */
+	if (err != M_IO_ERROR_NOTIMPL && M_io_error_is_critical(err)) {
+		M_io_softevent_clearall(io, M_TRUE);
+		M_io_layer_softevent_add(layer, M_FALSE, (err == M_IO_ERROR_DISCONNECT)?M_EVENT_TYPE_DISCONNECTED:M_EVENT_TYPE_ERROR, err);
+	}
+	return err;
+}
+
+M_io_error_t M_io_write_sendfile(M_io_t *comm, M_intptr fd, M_int64 offset, size_t len, size_t *len_written)
+{
+	M_io_error_t err;
+	size_t       layer_idx;
+
+	*len_written = 0;
+
+	if (comm == NULL || comm->flags & M_IO_FLAG_USER_DESTROY)
+		return M_IO_ERROR_INVALID;
+
+	layer_idx = M_list_len(comm->layer);
+	if (layer_idx == 0)
+		return M_IO_ERROR_INVALID;
+
+	err = M_io_layer_sendfile(comm, layer_idx-1, fd, offset, len, len_written);
+	if (err != M_IO_ERROR_SUCCESS)
+		*len_written = 0;
+
+	/* Same soft event handling as M_io_write_meta() */
+	if (err == M_IO_ERROR_WOULDBLOCK || (err == M_IO_ERROR_SUCCESS && len > *len_written)) {
+		M_io_user_softevent_del(comm, M_EVENT_TYPE_WRITE);
+	} else if (err == M_IO_ERROR_SUCCESS) {
+		M_io_user_softevent_add(comm, M_EVENT_TYPE_WRITE, M_IO_ERROR_SUCCESS);
+	}
+
+	if (err != M_IO_ERROR_NOTIMPL)
+		comm->last_error = err;
+	return err;
+}
+
 M_io_error_t M_io_write(M_io_t *comm, const unsigned char *buf, size_t buf_len, size_t *len_written)
 {
 	return M_io_write_meta(comm, buf, buf_len, len_written, NULL);
@@ -704,6 +837,118 @@ M_io_error_t M_io_write_from_buf_meta(M_io_t *comm, M_buf_t *buf, M_io_meta_t *m
 	return err;
 }
 
+M_io_error_t M_io_writev(M_io_t *comm, const M_iovec_t *iov, size_t iov_cnt, size_t *len_written)
+{
+	return M_io_writev_meta(comm, iov, iov_cnt, len_written, NULL);
+}
+
+M_io_error_t M_io_writev_meta(M_io_t *comm, const M_iovec_t *iov, size_t iov_cnt, size_t *len_written, M_io_meta_t *meta)
+{
+	M_io_error_t err       = M_IO_ERROR_SUCCESS;
+	size_t       layer_idx;
+	size_t       mylen_written;
+	size_t       total_len = 0;
+	size_t       offset    = 0;
+	size_t       len;
+	size_t       i;
+	M_iovec_t    part;
+
+	if (len_written == NULL)
+		len_written = &mylen_written;
+
+	*len_written = 0;
+
+	if (comm == NULL || comm->flags & M_IO_FLAG_USER_DESTROY || iov == NULL || iov_cnt == 0) {
+		err = M_IO_ERROR_INVALID;
+		goto fail;
+	}
+
+	for (i=0; i<iov_cnt; i++) {
+		if (iov[i].data == NULL && iov[i].len != 0) {
+			err = M_IO_ERROR_INVALID;
+			goto fail;
+		}
+		total_len += iov[i].len;
+	}
+
+	layer_idx = M_list_len(comm->layer);
+	if (layer_idx == 0 || total_len == 0) {
+		err = M_IO_ERROR_INVALID;
+		goto fail;
+	}
+
+	/* Layers may take fewer segments or bytes per call than were passed (a limit on
+	 * segments per system call, or a coalescing buffer) while still having room for
+	 * more. No write event would follow in that case, so keep writing until
+	 * everything is written or the layer stops taking data. */
+	for (i=0; i<iov_cnt; ) {
+		if (offset == iov[i].len) {
+			offset = 0;
+			i++;
+			continue;
+		}
+
+		if (offset == 0) {
+			err = M_io_layer_writev(comm, layer_idx-1, iov + i, iov_cnt - i, &len, meta);
+		} else {
+			/* Rest of a partially written segment on its own */
+			part.data = iov[i].data + offset;
+			part.len  = iov[i].len - offset;
+			err       = M_io_layer_writev(comm, layer_idx-1, &part, 1, &len, meta);
+		}
+
+		if (err != M_IO_ERROR_SUCCESS || len == 0)
+			break;
+
+		*len_written += len;
+
+		/* Skip over what was written */
+		while (i < iov_cnt && len >= iov[i].len - offset) {
+			len    -= iov[i].len - offset;
+			offset  = 0;
+			i++;
+		}
+		offset += len;
+	}
+
+	/* Data already written is reported, the error will be returned again on the next write */
+	if (*len_written > 0)
+		err = M_IO_ERROR_SUCCESS;
+
+	/* Same soft event handling as M_io_write_meta() */
+	if (err == M_IO_ERROR_WOULDBLOCK || (err == M_IO_ERROR_SUCCESS && total_len > *len_written)) {
+		M_io_user_softevent_del(comm, M_EVENT_TYPE_WRITE);
+	} else if (err == M_IO_ERROR_SUCCESS) {
+		M_io_user_softevent_add(comm, M_EVENT_TYPE_WRITE, M_IO_ERROR_SUCCESS);
+	}
+fail:
+	if (comm != NULL)
+		comm->last_error = err;
+
+	return err;
+}
+
+M_io_error_t M_io_write_from_chainbuf(M_io_t *comm, M_chainbuf_t *cb)
+{
+	M_iovec_t    iov[16];
+	size_t       iov_cnt;
+	size_t       len_written;
+	M_io_error_t err;
+
+	if (comm == NULL || cb == NULL)
+		return M_IO_ERROR_INVALID;
+
+	if (M_chainbuf_len(cb) == 0)
+		return M_IO_ERROR_SUCCESS;
+
+	iov_cnt = M_chainbuf_iovec(cb, iov, sizeof(iov) / sizeof(*iov));
+	err     = M_io_writev(comm, iov, iov_cnt, &len_written);
+	if (err == M_IO_ERROR_SUCCESS) {
+		M_chainbuf_drop(cb, len_written);
+	}
+	return err;
+}
+
 
 M_io_error_t M_io_accept(M_io_t **io_out, M_io_t *server_io)
 {
@@ -853,6 +1098,22 @@ M_bool M_io_callbacks_reg_write(M_io_callbacks_t *callbacks, M_io_error_t (*cb_w
 	return M_TRUE;
 }
 
+M_bool M_io_callbacks_reg_writev(M_io_callbacks_t *callbacks, M_io_error_t (*cb_writev)(M_io_layer_t *layer, const M_iovec_t *iov, size_t iov_cnt, size_t *write_len, M_io_meta_t *meta))
+{
+	if (callbacks == NULL)
+		return M_FALSE;
+	callbacks->cb_writev = cb_writev;
+	return M_TRUE;
+}
+
+M_bool M_io_callbacks_reg_sendfile(M_io_callbacks_t *callbacks, M_io_error_t (*cb_sendfile)(M_io_layer_t *layer, M_intptr fd, M_int64 offset, size_t len, size_t *write_len))
+{
+	if (callbacks == NULL)
+		return M_FALSE;
+	callbacks->cb_sendfile = cb_sendfile;
+	return M_TRUE;
+}
+
 M_bool M_io_callbacks_reg_processevent(M_io_callbacks_t *callbacks, M_bool (*cb_process_event)(M_io_layer_t *layer, M_event_type_t *type))
 {
 	if (callbacks == NULL)
@@ -53,6 +53,13 @@ struct M_io_callbacks {
 	/*! Attempt to write to the layer */
 	M_io_error_t   (*cb_write)(M_io_layer_t *layer, const unsigned char *buf, size_t *write_len, M_io_meta_t *meta);
 
+	/*! Attempt to write multiple buffers to the layer. Optional, cb_write is used if not set */
+	M_io_error_t   (*cb_writev)(M_io_layer_t *layer, const M_iovec_t *iov, size_t iov_cnt, size_t *write_len, M_io_meta_t *meta);
+
+	/*! Attempt to write directly from an OS file descriptor (zero-copy). Offset is -1 to read from the current position
+	 *  of a stream. Optional, only set by layers that write straight to the OS without transforming data. */
+	M_io_error_t   (*cb_sendfile)(M_io_layer_t *layer, M_intptr fd, M_int64 offset, size_t len, size_t *write_len);
+
 	/*! Process an event delivered to the layer */
 	M_bool         (*cb_process_event)(M_io_layer_t *layer, M_event_type_t *type);
 
@@ -95,14 +102,19 @@ struct M_io_layer {
 struct M_io_block_data;
 typedef struct M_io_block_data M_io_block_data_t;
 
+struct M_io_sendfile;
+typedef struct M_io_sendfile M_io_sendfile_t;
+
 /*! State flags for io object */
 typedef enum {
 	M_IO_FLAG_NONE            = 0,      /*!< no flags */
 	M_IO_FLAG_USER_DISCONNECT = 1 << 0, /*!< User requested disconnect.  Will persist until user receives disconnect or error event. */
-	M_IO_FLAG_USER_DESTROY    = 1 << 1  /*!< User requested destroy. This marks the object as effectively destroyed so nothing else
+	M_IO_FLAG_USER_DESTROY    = 1 << 1, /*!< User requested destroy. This marks the object as effectively destroyed so nothing else
 	                                     *   Can take place on the object (no events, etc).  This is used mostly for cross-eventloop
 	                                     *   destroys, where the owning event loop should perform the actual destruction to prevent
 	                                     *   any sort of thread syncronization issues */
+	M_IO_FLAG_MIGRATING       = 1 << 2  /*!< Being moved to another event loop by M_event_migrate(). Layers re-registering will
+	                                     *   signal CONNECTED again which must not reach the user a second time. */
 } M_io_flags_t;
 
 
@@ -116,7 +128,12 @@ struct M_io {
 
 	M_bool              private_event;   /*!< Registered event handler is a private event handler         */
 	M_io_block_data_t  *sync_data;       /*!< Data handle for tracking M_io_block_*() calls               */
+	M_io_sendfile_t    *sendfile;        /*!< Active M_io_send_file() transfer                            */
 	M_io_flags_t        flags;           /*!< State-related flags                                         */
+
+	M_event_ioqueue_entry_t softevent;   /*!< Soft events queued on reg_event                             */
+	M_event_ioqueue_entry_t pending;     /*!< Events waiting for delivery by reg_event, the high bit of a
+	                                          layer's events means a higher layer also has events         */
 };
 
 void M_io_lock(M_io_t *io);
@@ -131,6 +148,11 @@ M_bool M_io_setnonblock(int fd);
 #endif
 
 void M_io_block_data_free(M_io_t *io);
+void M_io_sendfile_data_free(M_io_t *io);
+
+/* Zero-copy write through the layers, M_IO_ERROR_NOTIMPL if a layer in the way must see the data */
+M_io_error_t M_io_layer_sendfile(M_io_t *io, size_t layer_id, M_intptr fd, M_int64 offset, size_t len, size_t *write_len);
+M_io_error_t M_io_write_sendfile(M_io_t *comm, M_intptr fd, M_int64 offset, size_t len, size_t *len_written);
 
 /* Here because DNS needs it instead of m_io_net_int.h */
 void M_io_net_init_system(void);
@@ -0,0 +1,338 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2023 Monetra Technologies, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "m_config.h"
+#include "mstdlib/mstdlib_io.h"
+#include "m_event_int.h"
+#include "m_io_int.h"
+#include "base/m_defs_int.h"
+
+/* Read size when the file has to pass through memory */
+#define M_IO_SENDFILE_BUF_SIZE (64 * 1024)
+
+/* Largest single zero-copy request from a regular file. Streams use the buffered
+ * read size, which is also the default pipe capacity. */
+#define M_IO_SENDFILE_ZEROCOPY_MAX (1024 * 1024 * 1024)
+
+
+struct M_io_sendfile {
+	M_io_t             *io;
+	M_fs_file_t        *file;
+	M_intptr            fd;
+	M_bool              seekable;     /* Regular file, reads are done at offset */
+	M_bool              to_eof;       /* No length, send until the file ends */
+	M_bool              eof;          /* File ended, send what's buffered and finish */
+	M_bool              zerocopy;     /* Still trying the zero-copy path */
+	M_uint64            offset;       /* Next position to read from the file */
+	M_uint64            remaining;    /* Bytes left to read from the file */
+	M_uint64            sent;         /* Bytes written to the io object */
+
+	unsigned char      *buf;          /* Buffered path only */
+	size_t              buf_len;
+	size_t              buf_pos;
+
+	M_io_sendfile_cb_t  cb;
+	void               *thunk;
+
+	/* User's event callback, restored when done */
+	M_event_callback_t  orig_cb;
+	void               *orig_cb_data;
+};
+
+
+static void M_io_sendfile_free(M_io_sendfile_t *sf)
+{
+	if (sf == NULL)
+		return;
+	M_free(sf->buf);
+	M_free(sf);
+}
+
+
+void M_io_sendfile_data_free(M_io_t *io)
+{
+	M_io_sendfile_free(io->sendfile);
+	io->sendfile = NULL;
+}
+
+
+/* Give the io object back to the user's callback */
+static void M_io_sendfile_detach(M_io_sendfile_t *sf)
+{
+	M_io_t *io = sf->io;
+
+	M_io_lock(io);
+	io->sendfile = NULL;
+	M_io_unlock(io);
+
+	M_event_edit_io_cb(io, sf->orig_cb, sf->orig_cb_data);
+}
+
+
+static void M_io_sendfile_finish(M_io_sendfile_t *sf, M_io_error_t err)
+{
+	M_io_t *io = sf->io;
+
+	M_io_sendfile_detach(sf);
+
+	/* The user may have been waiting to write more */
+	if (err == M_IO_ERROR_SUCCESS)
+		M_io_user_softevent_add(io, M_EVENT_TYPE_WRITE, M_IO_ERROR_SUCCESS);
+
+	if (sf->cb != NULL)
+		sf->cb(io, err, sf->sent, M_TRUE, sf->thunk);
+
+	M_io_sendfile_free(sf);
+}
+
+
+static size_t M_io_sendfile_chunk(const M_io_sendfile_t *sf, size_t max)
+{
+	if (sf->to_eof)
+		return max;
+	if (sf->remaining < (M_uint64)max)
+		return (size_t)sf->remaining;
+	return max;
+}
+
+
+/* Returns M_FALSE on read error */
+static M_bool M_io_sendfile_fill(M_io_sendfile_t *sf)
+{
+	size_t len = 0;
+
+	if (sf->buf == NULL)
+		sf->buf = M_malloc(M_IO_SENDFILE_BUF_SIZE);
+
+	sf->buf_pos = 0;
+	sf->buf_len = 0;
+
+	if (sf->seekable && M_fs_file_seek(sf->file, (M_int64)sf->offset, M_FS_FILE_SEEK_BEGIN) != M_FS_ERROR_SUCCESS)
+		return M_FALSE;
+
+	if (M_fs_file_read(sf->file, sf->buf, M_io_sendfile_chunk(sf, M_IO_SENDFILE_BUF_SIZE), &len, M_FS_FILE_RW_NORMAL) != M_FS_ERROR_SUCCESS)
+		return M_FALSE;
+
+	if (len == 0) {
+		sf->eof = M_TRUE;
+		return M_TRUE;
+	}
+
+	sf->buf_len    = len;
+	sf->offset    += len;
+	if (!sf->to_eof)
+		sf->remaining -= len;
+
+	return M_TRUE;
+}
+
+
+/* Send the next chunk. One write per call, a successful write queues another
+ * write event which brings us back here. */
+static void M_io_sendfile_pump(M_io_sendfile_t *sf)
+{
+	M_io_t       *io    = sf->io;
+	size_t        len;
+	size_t        wrote = 0;
+	M_io_error_t  err   = M_IO_ERROR_NOTIMPL;
+
+	if (sf->zerocopy) {
+		len = M_io_sendfile_chunk(sf, sf->seekable?M_IO_SENDFILE_ZEROCOPY_MAX:M_IO_SENDFILE_BUF_SIZE);
+		err = M_io_write_sendfile(io, sf->fd, sf->seekable?(M_int64)sf->offset:-1, len, &wrote);
+		if (err == M_IO_ERROR_NOTIMPL) {
+			sf->zerocopy = M_FALSE;
+		} else if (err == M_IO_ERROR_SUCCESS) {
+			if (wrote == 0) {
+				/* End of file */
+				M_io_sendfile_finish(sf, sf->to_eof?M_IO_ERROR_SUCCESS:M_IO_ERROR_ERROR);
+				return;
+			}
+			sf->offset += wrote;
+			if (!sf->to_eof)
+				sf->remaining -= wrote;
+
+			/* A short count may be the file (or pipe) running out rather than the
+			 * socket filling up, in which case no write event would follow. Try
+			 * again, a full socket will then return would block. */
+			if (wrote < len)
+				M_io_user_softevent_add(io, M_EVENT_TYPE_WRITE, M_IO_ERROR_SUCCESS);
+		}
+	}
+
+	if (!sf->zerocopy) {
+		if (sf->buf_pos == sf->buf_len) {
+			if (!M_io_sendfile_fill(sf)) {
+				M_io_sendfile_finish(sf, M_IO_ERROR_ERROR);
+				return;
+			}
+			if (sf->eof) {
+				M_io_sendfile_finish(sf, sf->to_eof?M_IO_ERROR_SUCCESS:M_IO_ERROR_ERROR);
+				return;
+			}
+		}
+
+		err = M_io_write(io, sf->buf + sf->buf_pos, sf->buf_len - sf->buf_pos, &wrote);
+		if (err == M_IO_ERROR_SUCCESS)
+			sf->buf_pos += wrote;
+	}
+
+	if (err == M_IO_ERROR_WOULDBLOCK)
+		return;
+
+	/* The io object will also get an error or disconnect event */
+	if (err != M_IO_ERROR_SUCCESS) {
+		M_io_sendfile_finish(sf, err);
+		return;
+	}
+
+	sf->sent += wrote;
+
+	if (!sf->to_eof && sf->remaining == 0 && sf->buf_pos == sf->buf_len) {
+		M_io_sendfile_finish(sf, M_IO_ERROR_SUCCESS);
+		return;
+	}
+
+	/* Last use of sf, the callback is allowed to destroy the io object */
+	if (sf->cb != NULL && wrote != 0)
+		sf->cb(io, M_IO_ERROR_SUCCESS, sf->sent, M_FALSE, sf->thunk);
+}
+
+
+/* Stands in for the user's callback during the transfer */
+static void M_io_sendfile_event_cb(M_event_t *event, M_event_type_t type, M_io_t *io, void *cb_data)
+{
+	M_io_sendfile_t    *sf           = cb_data;
+	M_event_callback_t  orig_cb      = sf->orig_cb;
+	void               *orig_cb_data = sf->orig_cb_data;
+	M_io_error_t        err;
+
+	switch (type) {
+		case M_EVENT_TYPE_WRITE:
+			M_io_sendfile_pump(sf);
+			return;
+		case M_EVENT_TYPE_DISCONNECTED:
+		case M_EVENT_TYPE_ERROR:
+			/* The completion callback may destroy the io object so the event can't be
+			 * passed on after it. Queue it for the user's callback instead, it goes away
+			 * with the io object if that is destroyed. */
+			err = (type == M_EVENT_TYPE_DISCONNECTED)?M_IO_ERROR_DISCONNECT:M_io_get_error(io);
+			M_io_user_softevent_add(io, type, err);
+			M_io_sendfile_finish(sf, err);
+			return;
+		default:
+			break;
+	}
+
+	if (orig_cb != NULL)
+		orig_cb(event, type, io, orig_cb_data);
+}
+
+
+M_io_error_t M_io_send_file(M_io_t *io, M_fs_file_t *file, M_uint64 offset, M_uint64 len, M_uint32 flags, M_io_sendfile_cb_t cb, void *thunk)
+{
+	M_io_sendfile_t *sf;
+	M_fs_info_t     *info     = NULL;
+	M_bool           seekable = M_FALSE;
+	M_uint64         size     = 0;
+	M_intptr         fd;
+
+	if (io == NULL || file == NULL || M_io_get_event(io) == NULL)
+		return M_IO_ERROR_INVALID;
+
+	if (M_io_get_state(io) != M_IO_STATE_CONNECTED)
+		return M_IO_ERROR_NOTCONNECTED;
+
+	fd = M_fs_file_get_fd(file);
+	if (fd == -1)
+		return M_IO_ERROR_INVALID;
+
+	if (M_fs_info_file(&info, file, M_FS_PATH_INFO_FLAGS_BASIC) == M_FS_ERROR_SUCCESS) {
+		seekable = (M_fs_info_get_type(info) == M_FS_TYPE_FILE)?M_TRUE:M_FALSE;
+		size     = M_fs_info_get_size(info);
+	}
+	M_fs_info_destroy(info);
+
+	if (seekable) {
+		if (offset > size || (len == 0 && offset == size))
+			return M_IO_ERROR_INVALID;
+		if (len == 0)
+			len = size - offset;
+	} else if (offset != 0) {
+		return M_IO_ERROR_INVALID;
+	}
+
+	/* Anything the caller wrote with buffering has to be in the file */
+	if (M_fs_file_sync(file, M_FS_FILE_SYNC_BUFFER) != M_FS_ERROR_SUCCESS)
+		return M_IO_ERROR_ERROR;
+
+	M_io_lock(io);
+	if (io->sendfile != NULL) {
+		M_io_unlock(io);
+		return M_IO_ERROR_NOTPERM;
+	}
+
+	sf            = M_malloc_zero(sizeof(*sf));
+	sf->io        = io;
+	sf->file      = file;
+	sf->fd        = fd;
+	sf->seekable  = seekable;
+	sf->to_eof    = (len == 0)?M_TRUE:M_FALSE;
+	sf->zerocopy  = (flags & M_IO_SENDFILE_FLAG_NO_ZEROCOPY)?M_FALSE:M_TRUE;
+	sf->offset    = offset;
+	sf->remaining = len;
+	sf->cb        = cb;
+	sf->thunk     = thunk;
+	sf->orig_cb   = M_event_get_io_cb(io, &sf->orig_cb_data);
+
+	if (!M_event_edit_io_cb(io, M_io_sendfile_event_cb, sf)) {
+		M_io_unlock(io);
+		M_io_sendfile_free(sf);
+		return M_IO_ERROR_INVALID;
+	}
+	io->sendfile  = sf;
+	M_io_unlock(io);
+
+	/* Kick off the first write from the event loop */
+	M_io_user_softevent_add(io, M_EVENT_TYPE_WRITE, M_IO_ERROR_SUCCESS);
+	return M_IO_ERROR_SUCCESS;
+}
+
+
+M_bool M_io_send_file_cancel(M_io_t *io)
+{
+	M_io_sendfile_t *sf;
+
+	if (io == NULL)
+		return M_FALSE;
+
+	M_io_lock(io);
+	sf = io->sendfile;
+	M_io_unlock(io);
+
+	if (sf == NULL)
+		return M_FALSE;
+
+	M_io_sendfile_detach(sf);
+	M_io_sendfile_free(sf);
+	return M_TRUE;
+}
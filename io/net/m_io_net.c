@@ -47,6 +47,9 @@
 #ifndef _WIN32
 #  include <unistd.h>
 #endif
+#ifdef HAVE_SENDFILE
+#  include <sys/sendfile.h>
+#endif
 #include "m_io_net_int.h"
 
 #ifndef HAVE_SOCKLEN_T
@@ -63,6 +66,15 @@ typedef int socklen_t;
 /* XXX: currently needed for M_io_setnonblock() which should be moved */
 #include "m_io_int.h"
 
+/* Socket option letting multiple listeners bind the same port with the kernel
+ * balancing new connections between them. Other systems allow SO_REUSEPORT
+ * but only the last listener bound receives connections. */
+#if defined(SO_REUSEPORT_LB)
+#  define M_IO_NET_REUSEPORT SO_REUSEPORT_LB
+#elif defined(__linux__) && defined(SO_REUSEPORT)
+#  define M_IO_NET_REUSEPORT SO_REUSEPORT
+#endif
+
 /* For some reason this is defined on OS X but we get a compile error. We are
  * setting _DARWIN_C_SOURCE which should allow the define to be used but it's not
  * so we just check if it's defined and if not define it ourselves.
@@ -278,6 +290,94 @@ static M_io_error_t M_io_net_write_cb_int(M_io_layer_t *layer, const unsigned ch
 	return M_IO_ERROR_SUCCESS;
 }
 
+/* Segments passed to the OS per vectored write, anything past this is left for the next write */
+#define M_IO_NET_WRITEV_MAX 64
+
+static M_io_error_t M_io_net_writev_cb_int(M_io_layer_t *layer, const M_iovec_t *iov, size_t iov_cnt, size_t *write_len)
+{
+	M_io_handle_t *handle = M_io_layer_get_handle(layer);
+	M_io_error_t   err    = M_IO_ERROR_ERROR;
+	size_t         i;
+#ifdef _WIN32
+	WSABUF         bufs[M_IO_NET_WRITEV_MAX];
+	DWORD          sent   = 0;
+	int            retval;
+#else
+	struct iovec   bufs[M_IO_NET_WRITEV_MAX];
+	struct msghdr  msg;
+	ssize_t        retval;
+	int            flags  = 0;
+#  if !defined(MSG_NOSIGNAL) /* && !defined(SO_NOSIGPIPE) */
+	M_io_posix_sigpipe_state_t sigpipe_state;
+#  endif
+#endif
+
+	if (handle->state != M_IO_NET_STATE_CONNECTED) {
+		if (handle->state == M_IO_NET_STATE_DISCONNECTED)
+			return M_IO_ERROR_DISCONNECT;
+		return M_IO_ERROR_ERROR;
+	}
+
+	iov_cnt = M_MIN(iov_cnt, M_IO_NET_WRITEV_MAX);
+#if defined(IOV_MAX) && !defined(_WIN32)
+	iov_cnt = M_MIN(iov_cnt, IOV_MAX);
+#endif
+
+	for (i=0; i<iov_cnt; i++) {
+#ifdef _WIN32
+		bufs[i].buf = M_CAST_OFF_CONST(char *, iov[i].data);
+		bufs[i].len = (ULONG)iov[i].len;
+#else
+		bufs[i].iov_base = M_CAST_OFF_CONST(void *, iov[i].data);
+		bufs[i].iov_len  = iov[i].len;
+#endif
+	}
+
+#ifdef _WIN32
+	retval = WSASend(handle->data.net.sock, bufs, (DWORD)iov_cnt, &sent, 0, NULL, NULL);
+	if (retval == 0 && sent == 0) {
+		handle->data.net.last_error = M_IO_ERROR_DISCONNECT;
+		return M_IO_ERROR_DISCONNECT;
+	} else if (retval != 0) {
+		M_io_net_resolve_error(handle);
+		return handle->data.net.last_error;
+	}
+
+	*write_len = (size_t)sent;
+	return M_IO_ERROR_SUCCESS;
+#else
+	M_mem_set(&msg, 0, sizeof(msg));
+	msg.msg_iov    = bufs;
+	msg.msg_iovlen = iov_cnt;
+
+#  if !defined(MSG_NOSIGNAL) /* && !defined(SO_NOSIGPIPE) */
+	M_io_posix_sigpipe_block(&sigpipe_state);
+#  else
+	flags |= MSG_NOSIGNAL;
+#  endif
+
+	errno  = 0;
+	retval = sendmsg(handle->data.net.sock, &msg, flags);
+	if (retval == 0) {
+		handle->data.net.last_error = M_IO_ERROR_DISCONNECT;
+		err = M_IO_ERROR_DISCONNECT;
+	} else if (retval < 0) {
+		M_io_net_resolve_error(handle);
+		err = handle->data.net.last_error;
+	}
+
+#  if !defined(MSG_NOSIGNAL) /* && !defined(SO_NOSIGPIPE) */
+	M_io_posix_sigpipe_unblock(&sigpipe_state);
+#  endif
+
+	if (retval <= 0)
+		return err;
+
+	*write_len = (size_t)retval;
+	return M_IO_ERROR_SUCCESS;
+#endif
+}
+
 
 static void M_io_net_readwrite_err(M_io_t *comm, M_io_layer_t *layer, M_bool is_read, M_io_error_t err, size_t request_len, size_t out_len)
 {
@@ -364,6 +464,95 @@ static M_io_error_t M_io_net_write_cb(M_io_layer_t *layer, const unsigned char *
 }
 
 
+static M_io_error_t M_io_net_writev_cb(M_io_layer_t *layer, const M_iovec_t *iov, size_t iov_cnt, size_t *write_len, M_io_meta_t *meta)
+{
+	size_t         request_len = 0;
+	size_t         i;
+	M_io_error_t   err;
+	M_io_handle_t *handle      = M_io_layer_get_handle(layer);
+
+	(void)meta;
+
+	if (layer == NULL || iov == NULL || iov_cnt == 0 || write_len == NULL)
+		return M_IO_ERROR_INVALID;
+
+	if (handle->state != M_IO_NET_STATE_CONNECTED)
+		return M_IO_ERROR_NOTCONNECTED;
+
+	for (i=0; i<iov_cnt && i<M_IO_NET_WRITEV_MAX; i++)
+		request_len += iov[i].len;
+
+	if (request_len == 0)
+		return M_IO_ERROR_INVALID;
+
+	*write_len = 0;
+	err        = M_io_net_writev_cb_int(layer, iov, iov_cnt, write_len);
+	M_io_net_readwrite_err(M_io_layer_get_io(layer), layer, M_FALSE, err, request_len, *write_len);
+
+	return err;
+}
+
+
+#if defined(HAVE_SENDFILE) || defined(HAVE_SPLICE)
+static M_io_error_t M_io_net_sendfile_cb(M_io_layer_t *layer, M_intptr fd, M_int64 offset, size_t len, size_t *write_len)
+{
+	M_io_handle_t *handle = M_io_layer_get_handle(layer);
+	ssize_t        retval = -1;
+	M_io_error_t   err    = M_IO_ERROR_SUCCESS;
+	int            sys_err;
+	M_io_posix_sigpipe_state_t sigpipe_state;
+
+	if (layer == NULL || fd < 0 || len == 0 || write_len == NULL)
+		return M_IO_ERROR_INVALID;
+
+	if (handle->state != M_IO_NET_STATE_CONNECTED)
+		return M_IO_ERROR_NOTCONNECTED;
+
+	*write_len = 0;
+
+	/* These don't take MSG_NOSIGNAL */
+	M_io_posix_sigpipe_block(&sigpipe_state);
+
+	errno   = 0;
+	sys_err = EINVAL;
+#  ifdef HAVE_SENDFILE
+	if (offset >= 0) {
+		off_t off = (off_t)offset;
+		retval    = sendfile(handle->data.net.sock, (int)fd, &off, len);
+		sys_err   = errno;
+	}
+#  endif
+#  ifdef HAVE_SPLICE
+	/* Pipes (and anything else without a position) need splice */
+	if (offset < 0 && retval < 0 && sys_err == EINVAL) {
+		errno   = 0;
+		retval  = splice((int)fd, NULL, handle->data.net.sock, NULL, len, SPLICE_F_MOVE);
+		sys_err = errno;
+	}
+#  endif
+
+	M_io_posix_sigpipe_unblock(&sigpipe_state);
+
+	if (retval < 0) {
+		/* File can't be used this way, caller falls back to read and write */
+		if (sys_err == EINVAL || sys_err == ENOSYS || sys_err == EOVERFLOW || sys_err == ESPIPE) {
+			errno = 0;
+			return M_IO_ERROR_NOTIMPL;
+		}
+		errno = sys_err;
+		M_io_net_resolve_error(handle);
+		err = handle->data.net.last_error;
+	} else {
+		/* 0 is end of file */
+		*write_len = (size_t)retval;
+	}
+
+	M_io_net_readwrite_err(M_io_layer_get_io(layer), layer, M_FALSE, err, len, *write_len);
+	return err;
+}
+#endif
+
+
 static void M_io_net_set_sockopts_keepalives(M_io_handle_t *handle)
 {
 	size_t               num_opts = 0;
@@ -915,6 +1104,18 @@ static M_io_error_t M_io_net_listen_bind_int(M_io_handle_t *handle)
 	(void)rv; /* silence coverity */
 #endif
 
+#ifdef M_IO_NET_REUSEPORT
+	if (handle->data.net.reuseport) {
+		enable = 1;
+		if (setsockopt(handle->data.net.sock, SOL_SOCKET, M_IO_NET_REUSEPORT, (const void *)&enable, sizeof(enable)) == -1) {
+			M_io_net_resolve_error(handle);
+			close(handle->data.net.sock);
+			M_free(sa);
+			return handle->data.net.last_error;
+		}
+	}
+#endif
+
 #ifdef SO_EXCLUSIVEADDRUSE
 	/* Windows, prevent 'stealing' of bound ports, why would this be allowed by default? */
 	rv = setsockopt(handle->data.net.sock, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, (const void *)&enable, sizeof(enable));
@@ -1265,6 +1466,10 @@ static M_io_callbacks_t *M_io_net_callbacks_create(void)
 	M_io_callbacks_reg_accept(callbacks, M_io_net_accept_cb);
 	M_io_callbacks_reg_read(callbacks, M_io_net_read_cb);
 	M_io_callbacks_reg_write(callbacks, M_io_net_write_cb);
+	M_io_callbacks_reg_writev(callbacks, M_io_net_writev_cb);
+#if defined(HAVE_SENDFILE) || defined(HAVE_SPLICE)
+	M_io_callbacks_reg_sendfile(callbacks, M_io_net_sendfile_cb);
+#endif
 	M_io_callbacks_reg_processevent(callbacks, M_io_net_process_cb);
 	M_io_callbacks_reg_unregister(callbacks, M_io_net_unregister_cb);
 	M_io_callbacks_reg_disconnect(callbacks, M_io_net_disconnect_cb);
@@ -1447,7 +1652,7 @@ M_io_t *M_io_netraw_client_create(const char *host, unsigned short port, M_io_ne
 }
 
 
-M_io_error_t M_io_net_server_create(M_io_t **io_out, unsigned short port, const char *bind_ip, M_io_net_type_t type)
+static M_io_error_t M_io_net_server_create_int(M_io_t **io_out, unsigned short port, const char *bind_ip, M_io_net_type_t type, M_bool reuseport)
 {
 	M_io_handle_t    *handle;
 	M_io_callbacks_t *callbacks;
@@ -1464,6 +1669,7 @@ M_io_error_t M_io_net_server_create(M_io_t **io_out, unsigned short port, const
 	handle                                 = M_malloc_zero(sizeof(*handle));
 	handle->data.net.evhandle              = M_EVENT_INVALID_HANDLE;
 	handle->data.net.sock                  = M_EVENT_INVALID_SOCKET;
+	handle->data.net.reuseport             = reuseport;
 	handle->host                           = M_strdup(bind_ip);
 	handle->type                           = type;
 	handle->port                           = port;
@@ -1485,6 +1691,64 @@ M_io_error_t M_io_net_server_create(M_io_t **io_out, unsigned short port, const
 }
 
 
+M_io_error_t M_io_net_server_create(M_io_t **io_out, unsigned short port, const char *bind_ip, M_io_net_type_t type)
+{
+	return M_io_net_server_create_int(io_out, port, bind_ip, type, M_FALSE);
+}
+
+
+M_io_error_t M_io_net_server_create_sharded(M_io_t ***ios_out, size_t *num_ios_out, M_event_t *event, unsigned short port,
+                                            const char *bind_ip, M_io_net_type_t type, M_event_callback_t callback, void *cb_data)
+{
+	M_io_t       **ios;
+	size_t         num = 1;
+	size_t         i;
+	M_io_error_t   err = M_IO_ERROR_SUCCESS;
+
+	if (ios_out == NULL || num_ios_out == NULL || event == NULL)
+		return M_IO_ERROR_INVALID;
+
+	*ios_out     = NULL;
+	*num_ios_out = 0;
+
+#ifdef M_IO_NET_REUSEPORT
+	if (event->type == M_EVENT_BASE_TYPE_POOL)
+		num = event->u.pool.thread_count;
+#endif
+
+	ios = M_malloc_zero(num * sizeof(*ios));
+	for (i=0; i<num; i++) {
+		err = M_io_net_server_create_int(&ios[i], port, bind_ip, type, (num > 1)?M_TRUE:M_FALSE);
+		if (err != M_IO_ERROR_SUCCESS)
+			break;
+
+		/* The first listener resolves an OS assigned port and whether ANY fell back
+		 * to IPv4, the rest must match it to share the port. */
+		if (i == 0) {
+			port = M_io_net_get_port(ios[0]);
+			type = M_io_net_get_type(ios[0]);
+		}
+
+		if (!M_event_add((num > 1)?event->u.pool.thread_evloop[i]:event, ios[i], callback, cb_data)) {
+			err = M_IO_ERROR_ERROR;
+			break;
+		}
+	}
+
+	if (err != M_IO_ERROR_SUCCESS) {
+		for (i=0; i<num; i++) {
+			M_io_destroy(ios[i]);
+		}
+		M_free(ios);
+		return err;
+	}
+
+	*ios_out     = ios;
+	*num_ios_out = num;
+	return M_IO_ERROR_SUCCESS;
+}
+
+
 /* XXX: this shouldn't be here and isn't necessarily right for everything */
 #ifdef _WIN32
 M_bool M_io_setnonblock(SOCKET fd)
@@ -1570,6 +1834,27 @@ M_bool M_io_net_set_nagle(M_io_t *io, M_bool nagle_enabled)
 }
 
 
+M_intptr M_io_net_get_socket(M_io_t *io)
+{
+	M_io_layer_t  *layer  = M_io_layer_acquire(io, 0, "NET");
+	M_io_handle_t *handle = M_io_layer_get_handle(layer);
+	M_intptr       sock   = -1;
+
+	if (layer == NULL || handle == NULL)
+		return -1;
+
+	if (handle->is_netdns) {
+		if (handle->data.netdns.io != NULL)
+			sock = M_io_net_get_socket(handle->data.netdns.io);
+	} else if (handle->state == M_IO_NET_STATE_CONNECTED && handle->data.net.sock != M_EVENT_INVALID_SOCKET) {
+		sock = (M_intptr)handle->data.net.sock;
+	}
+
+	M_io_layer_release(layer);
+	return sock;
+}
+
+
 M_bool M_io_net_set_connect_timeout_ms(M_io_t *io, M_uint64 timeout_ms)
 {
 	M_io_layer_t  *layer  = M_io_layer_acquire(io, 0, "NET");
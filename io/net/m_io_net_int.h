@@ -64,6 +64,7 @@ struct M_io_handle_net {
 	int                  last_error_sys; /*!< Last recorded system error                                     */
 #endif
 	M_io_error_t         last_error;     /*!< Last recorded error mapped                                     */
+	M_bool               reuseport;      /*!< Listener shares its port with other listeners                  */
 };
 
 struct M_io_handle_netdns {
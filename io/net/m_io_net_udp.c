@@ -0,0 +1,1268 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2023 Monetra Technologies, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "m_config.h"
+#include <mstdlib/mstdlib_io.h>
+#include <mstdlib/io/m_io_layer.h>
+#include "m_event_int.h"
+#include "m_io_meta.h"
+#include "base/m_defs_int.h"
+#ifndef _WIN32
+#  include <sys/socket.h>
+#  include <sys/uio.h>
+#  include <netinet/in.h>
+#  include <netinet/udp.h>
+#  include <arpa/inet.h>
+#endif
+
+#include <errno.h>
+#include <string.h>
+#ifndef _WIN32
+#  include <unistd.h>
+#endif
+
+#ifndef HAVE_SOCKLEN_T
+typedef int socklen_t;
+#endif
+
+#ifdef _WIN32
+#  include "m_io_win32_common.h"
+#else
+#  include "m_io_posix_common.h"
+#endif
+
+/* XXX: currently needed for M_io_setnonblock() which should be moved */
+#include "m_io_int.h"
+
+#define M_IO_NET_UDP_NAME "NETUDP"
+
+/* Maximum number of datagrams handed to the kernel per recvmmsg()/sendmmsg() call.
+ * Larger batches are split, this only bounds the stack space used. */
+#define M_IO_NET_UDP_BATCH_MAX 64
+
+#if defined(HAVE_RECVMMSG) && defined(UDP_GRO)
+#  define M_IO_NET_UDP_GRO 1
+#endif
+#if defined(HAVE_SENDMMSG) && defined(UDP_SEGMENT)
+#  define M_IO_NET_UDP_GSO 1
+#endif
+
+typedef union {
+	struct sockaddr     sa;
+	struct sockaddr_in  sin;
+#ifdef AF_INET6
+	struct sockaddr_in6 sin6;
+#endif
+} M_io_net_udp_addr_t;
+
+struct M_io_handle {
+	M_EVENT_HANDLE   evhandle;       /*!< Event handle                                     */
+	M_EVENT_SOCKET   sock;           /*!< Socket                                           */
+	int              family;         /*!< Address family of the socket                     */
+	M_io_net_type_t  type;           /*!< Network type                                     */
+	unsigned short   port;           /*!< Local port                                       */
+	M_bool           connected;      /*!< Socket is associated with a single peer          */
+	M_bool           gro;            /*!< Receive offload enabled                          */
+	M_io_state_t     state;          /*!< Current state                                    */
+#ifdef _WIN32
+	DWORD            last_error_sys;
+#else
+	int              last_error_sys; /*!< Last recorded system error                       */
+#endif
+	M_io_error_t     last_error;     /*!< Last recorded error mapped                       */
+};
+
+/* Per-layer data stored in an M_io_meta_t */
+typedef struct {
+	M_io_net_udp_dgram_t peer;       /*!< Peer address and segment size, buf is unused     */
+	char                 ipaddr[64]; /*!< String form of peer address, filled on request   */
+} M_io_net_udp_metadata_t;
+
+
+static void M_io_net_udp_resolve_error(M_io_handle_t *handle)
+{
+#ifdef _WIN32
+	handle->last_error_sys = (DWORD)WSAGetLastError();
+	handle->last_error     = M_io_win32_err_to_ioerr(handle->last_error_sys);
+#else
+	handle->last_error_sys = errno;
+	errno                  = 0;
+	handle->last_error     = M_io_posix_err_to_ioerr(handle->last_error_sys);
+#endif
+}
+
+
+static void M_io_net_udp_close(M_io_handle_t *handle)
+{
+	if (handle->sock == M_EVENT_INVALID_SOCKET)
+		return;
+#ifdef _WIN32
+	if (handle->evhandle != M_EVENT_INVALID_HANDLE) {
+		WSAEventSelect(handle->sock, handle->evhandle, 0);
+		WSACloseEvent(handle->evhandle);
+	}
+	closesocket(handle->sock);
+#else
+	close(handle->sock);
+#endif
+	handle->evhandle = M_EVENT_INVALID_HANDLE;
+	handle->sock     = M_EVENT_INVALID_SOCKET;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void M_io_net_udp_addr_to_dgram(const M_io_net_udp_addr_t *addr, M_io_net_udp_dgram_t *dgram)
+{
+#ifdef AF_INET6
+	static const unsigned char v4mapped[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF };
+#endif
+
+	dgram->ipaddr_len = 0;
+	dgram->port       = 0;
+
+	if (addr->sa.sa_family == AF_INET) {
+		M_mem_copy(dgram->ipaddr, &addr->sin.sin_addr, 4);
+		dgram->ipaddr_len = 4;
+		dgram->port       = M_ntoh16(addr->sin.sin_port);
+#ifdef AF_INET6
+	} else if (addr->sa.sa_family == AF_INET6) {
+		const unsigned char *ip = (const unsigned char *)&addr->sin6.sin6_addr;
+
+		/* IPv4 peer of a dual stack socket, report it as IPv4 */
+		if (M_mem_eq(ip, v4mapped, sizeof(v4mapped))) {
+			M_mem_copy(dgram->ipaddr, ip + sizeof(v4mapped), 4);
+			dgram->ipaddr_len = 4;
+		} else {
+			M_mem_copy(dgram->ipaddr, ip, 16);
+			dgram->ipaddr_len = 16;
+		}
+		dgram->port = M_ntoh16(addr->sin6.sin6_port);
+#endif
+	}
+}
+
+
+/* Returns the size of the address filled in, or 0 if the address can't be used with this socket */
+static socklen_t M_io_net_udp_dgram_to_addr(const M_io_handle_t *handle, const M_io_net_udp_dgram_t *dgram, M_io_net_udp_addr_t *addr)
+{
+	M_mem_set(addr, 0, sizeof(*addr));
+
+	if (dgram->ipaddr_len == 4 && handle->family == AF_INET) {
+		addr->sin.sin_family = AF_INET;
+		addr->sin.sin_port   = M_hton16(dgram->port);
+		M_mem_copy(&addr->sin.sin_addr, dgram->ipaddr, 4);
+		return sizeof(addr->sin);
+	}
+
+#ifdef AF_INET6
+	if (handle->family == AF_INET6 && (dgram->ipaddr_len == 16 || (dgram->ipaddr_len == 4 && handle->type == M_IO_NET_ANY))) {
+		unsigned char *ip = (unsigned char *)&addr->sin6.sin6_addr;
+
+		addr->sin6.sin6_family = AF_INET6;
+		addr->sin6.sin6_port   = M_hton16(dgram->port);
+		if (dgram->ipaddr_len == 4) {
+			/* Dual stack socket, IPv4 destinations are sent as IPv4 mapped IPv6 */
+			ip[10] = 0xFF;
+			ip[11] = 0xFF;
+			M_mem_copy(ip + 12, dgram->ipaddr, 4);
+		} else {
+			M_mem_copy(ip, dgram->ipaddr, 16);
+		}
+		return sizeof(addr->sin6);
+	}
+#endif
+
+	return 0;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#if defined(HAVE_RECVMMSG)
+static M_io_error_t M_io_net_udp_recv_sys(M_io_handle_t *handle, M_io_net_udp_dgram_t *dgrams, size_t cnt, size_t *cnt_out)
+{
+	struct mmsghdr      msgs[M_IO_NET_UDP_BATCH_MAX];
+	struct iovec        iovs[M_IO_NET_UDP_BATCH_MAX];
+	M_io_net_udp_addr_t addrs[M_IO_NET_UDP_BATCH_MAX];
+#  ifdef M_IO_NET_UDP_GRO
+	union {
+		struct cmsghdr hdr;
+		unsigned char  buf[CMSG_SPACE(sizeof(int))];
+	} ctrl[M_IO_NET_UDP_BATCH_MAX];
+#  endif
+	size_t              i;
+
+	while (*cnt_out < cnt) {
+		M_io_net_udp_dgram_t *d   = dgrams + *cnt_out;
+		size_t                num = M_MIN(cnt - *cnt_out, M_IO_NET_UDP_BATCH_MAX);
+		int                   rv;
+
+		M_mem_set(msgs, 0, sizeof(*msgs) * num);
+		for (i=0; i<num; i++) {
+			iovs[i].iov_base               = d[i].buf;
+			iovs[i].iov_len                = d[i].buf_size;
+			msgs[i].msg_hdr.msg_iov        = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen     = 1;
+			msgs[i].msg_hdr.msg_name       = &addrs[i];
+			msgs[i].msg_hdr.msg_namelen    = sizeof(addrs[i]);
+#  ifdef M_IO_NET_UDP_GRO
+			if (handle->gro) {
+				msgs[i].msg_hdr.msg_control    = ctrl[i].buf;
+				msgs[i].msg_hdr.msg_controllen = sizeof(ctrl[i].buf);
+			}
+#  endif
+		}
+
+		errno = 0;
+		rv    = recvmmsg(handle->sock, msgs, (unsigned int)num, 0, NULL);
+		if (rv <= 0) {
+			if (rv < 0)
+				M_io_net_udp_resolve_error(handle);
+			break;
+		}
+
+		for (i=0; i<(size_t)rv; i++) {
+			d[i].len          = msgs[i].msg_len;
+			d[i].segment_size = 0;
+			d[i].truncated    = (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)?M_TRUE:M_FALSE;
+			M_io_net_udp_addr_to_dgram(&addrs[i], &d[i]);
+#  ifdef M_IO_NET_UDP_GRO
+			if (handle->gro) {
+				struct cmsghdr *cmsg;
+				for (cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsg)) {
+					if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+						int gso_size;
+						M_mem_copy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+						if (gso_size > 0 && (size_t)gso_size < d[i].len)
+							d[i].segment_size = (size_t)gso_size;
+					}
+				}
+			}
+#  endif
+		}
+		*cnt_out += (size_t)rv;
+
+		/* Short batch, nothing more is queued */
+		if ((size_t)rv < num)
+			break;
+	}
+
+	if (*cnt_out > 0)
+		return M_IO_ERROR_SUCCESS;
+	return handle->last_error;
+}
+#else
+static M_io_error_t M_io_net_udp_recv_sys(M_io_handle_t *handle, M_io_net_udp_dgram_t *dgrams, size_t cnt, size_t *cnt_out)
+{
+	while (*cnt_out < cnt) {
+		M_io_net_udp_dgram_t *d         = dgrams + *cnt_out;
+		M_io_net_udp_addr_t   addr;
+		M_bool                truncated = M_FALSE;
+#  ifdef _WIN32
+		socklen_t             addrlen   = sizeof(addr);
+		int                   rv;
+
+		rv = recvfrom(handle->sock, (char *)d->buf, (int)d->buf_size, 0, &addr.sa, &addrlen);
+		/* Windows fails truncated datagrams rather than reporting the truncated length */
+		if (rv < 0 && WSAGetLastError() == WSAEMSGSIZE) {
+			rv        = (int)d->buf_size;
+			truncated = M_TRUE;
+		}
+#  else
+		struct msghdr         msg;
+		struct iovec          iov;
+		ssize_t               rv;
+
+		/* recvmsg() rather than recvfrom() so truncation is reported */
+		M_mem_set(&msg, 0, sizeof(msg));
+		iov.iov_base    = d->buf;
+		iov.iov_len     = d->buf_size;
+		msg.msg_iov     = &iov;
+		msg.msg_iovlen  = 1;
+		msg.msg_name    = &addr;
+		msg.msg_namelen = sizeof(addr);
+
+		errno = 0;
+		rv    = recvmsg(handle->sock, &msg, 0);
+		if (rv >= 0 && (msg.msg_flags & MSG_TRUNC))
+			truncated = M_TRUE;
+#  endif
+		if (rv < 0) {
+			M_io_net_udp_resolve_error(handle);
+			break;
+		}
+
+		d->len          = (size_t)rv;
+		d->segment_size = 0;
+		d->truncated    = truncated;
+		M_io_net_udp_addr_to_dgram(&addr, d);
+		(*cnt_out)++;
+	}
+
+	if (*cnt_out > 0)
+		return M_IO_ERROR_SUCCESS;
+	return handle->last_error;
+}
+#endif
+
+
+#if defined(HAVE_SENDMMSG)
+static M_io_error_t M_io_net_udp_send_sys(M_io_handle_t *handle, const M_io_net_udp_dgram_t *dgrams, size_t cnt, size_t *cnt_out)
+{
+	struct mmsghdr      msgs[M_IO_NET_UDP_BATCH_MAX];
+	struct iovec        iovs[M_IO_NET_UDP_BATCH_MAX];
+	M_io_net_udp_addr_t addrs[M_IO_NET_UDP_BATCH_MAX];
+#  ifdef M_IO_NET_UDP_GSO
+	union {
+		struct cmsghdr hdr;
+		unsigned char  buf[CMSG_SPACE(sizeof(M_uint16))];
+	} ctrl[M_IO_NET_UDP_BATCH_MAX];
+#  endif
+	size_t              i;
+
+	while (*cnt_out < cnt) {
+		const M_io_net_udp_dgram_t *d   = dgrams + *cnt_out;
+		size_t                      num = M_MIN(cnt - *cnt_out, M_IO_NET_UDP_BATCH_MAX);
+		int                         rv;
+
+		M_mem_set(msgs, 0, sizeof(*msgs) * num);
+		for (i=0; i<num; i++) {
+			iovs[i].iov_base           = d[i].buf;
+			iovs[i].iov_len            = d[i].len;
+			msgs[i].msg_hdr.msg_iov    = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+
+			if (d[i].ipaddr_len != 0) {
+				msgs[i].msg_hdr.msg_name    = &addrs[i];
+				msgs[i].msg_hdr.msg_namelen = M_io_net_udp_dgram_to_addr(handle, &d[i], &addrs[i]);
+				if (msgs[i].msg_hdr.msg_namelen == 0)
+					break;
+			} else if (!handle->connected) {
+				break;
+			}
+
+			if (d[i].segment_size != 0) {
+#  ifdef M_IO_NET_UDP_GSO
+				struct cmsghdr *cmsg;
+				M_uint16        segment_size = (M_uint16)d[i].segment_size;
+
+				msgs[i].msg_hdr.msg_control    = ctrl[i].buf;
+				msgs[i].msg_hdr.msg_controllen = sizeof(ctrl[i].buf);
+				cmsg                           = CMSG_FIRSTHDR(&msgs[i].msg_hdr);
+				cmsg->cmsg_level               = SOL_UDP;
+				cmsg->cmsg_type                = UDP_SEGMENT;
+				cmsg->cmsg_len                 = CMSG_LEN(sizeof(segment_size));
+				M_mem_copy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+#  else
+				if (i == 0 && *cnt_out == 0)
+					return M_IO_ERROR_NOTIMPL;
+				break;
+#  endif
+			}
+		}
+
+		/* Datagram without a usable destination, send everything before it */
+		if (i == 0) {
+			if (*cnt_out == 0)
+				return M_IO_ERROR_INVALID;
+			break;
+		}
+
+		errno = 0;
+		rv    = sendmmsg(handle->sock, msgs, (unsigned int)i, 0);
+		if (rv <= 0) {
+			if (rv < 0)
+				M_io_net_udp_resolve_error(handle);
+			break;
+		}
+		*cnt_out += (size_t)rv;
+
+		if ((size_t)rv < num)
+			break;
+	}
+
+	if (*cnt_out > 0)
+		return M_IO_ERROR_SUCCESS;
+	return handle->last_error;
+}
+#else
+static M_io_error_t M_io_net_udp_send_sys(M_io_handle_t *handle, const M_io_net_udp_dgram_t *dgrams, size_t cnt, size_t *cnt_out)
+{
+	while (*cnt_out < cnt) {
+		const M_io_net_udp_dgram_t *d       = dgrams + *cnt_out;
+		M_io_net_udp_addr_t         addr;
+		socklen_t                   addrlen = 0;
+#  ifdef _WIN32
+		int                         rv;
+#  else
+		ssize_t                     rv;
+#  endif
+
+		if (d->segment_size != 0) {
+			if (*cnt_out == 0)
+				return M_IO_ERROR_NOTIMPL;
+			break;
+		}
+
+		if (d->ipaddr_len != 0) {
+			addrlen = M_io_net_udp_dgram_to_addr(handle, d, &addr);
+			if (addrlen == 0) {
+				if (*cnt_out == 0)
+					return M_IO_ERROR_INVALID;
+				break;
+			}
+		} else if (!handle->connected) {
+			if (*cnt_out == 0)
+				return M_IO_ERROR_INVALID;
+			break;
+		}
+
+#  ifdef _WIN32
+		rv = sendto(handle->sock, (const char *)d->buf, (int)d->len, 0, (addrlen != 0)?&addr.sa:NULL, addrlen);
+#  else
+		errno = 0;
+		rv    = sendto(handle->sock, d->buf, d->len, 0, (addrlen != 0)?&addr.sa:NULL, addrlen);
+#  endif
+		if (rv < 0) {
+			M_io_net_udp_resolve_error(handle);
+			break;
+		}
+		(*cnt_out)++;
+	}
+
+	if (*cnt_out > 0)
+		return M_IO_ERROR_SUCCESS;
+	return handle->last_error;
+}
+#endif
+
+
+/* Receive datagrams and re-arm read events. Called with the layer locked. */
+static M_io_error_t M_io_net_udp_recv(M_io_layer_t *layer, M_io_net_udp_dgram_t *dgrams, size_t cnt, size_t *cnt_out)
+{
+	M_io_handle_t *handle = M_io_layer_get_handle(layer);
+	M_io_t        *io     = M_io_layer_get_io(layer);
+	M_io_error_t   err;
+
+	*cnt_out = 0;
+
+	if (handle->state != M_IO_STATE_CONNECTED || handle->sock == M_EVENT_INVALID_SOCKET)
+		return M_IO_ERROR_NOTCONNECTED;
+
+	handle->last_error = M_IO_ERROR_WOULDBLOCK;
+	err                = M_io_net_udp_recv_sys(handle, dgrams, cnt, cnt_out);
+
+	if (err == M_IO_ERROR_SUCCESS || err == M_IO_ERROR_WOULDBLOCK) {
+		/* Datagrams may still be queued, always wait for another read event */
+		M_event_handle_modify(M_io_get_event(io), M_EVENT_MODTYPE_ADD_WAITTYPE, io, handle->evhandle, handle->sock, M_EVENT_WAIT_READ, 0);
+	} else if (M_io_error_is_critical(err)) {
+		handle->state = M_IO_STATE_ERROR;
+	}
+
+	return err;
+}
+
+
+/* Send datagrams and re-arm write events. Called with the layer locked. */
+static M_io_error_t M_io_net_udp_send(M_io_layer_t *layer, const M_io_net_udp_dgram_t *dgrams, size_t cnt, size_t *cnt_out)
+{
+	M_io_handle_t *handle = M_io_layer_get_handle(layer);
+	M_io_t        *io     = M_io_layer_get_io(layer);
+	M_io_error_t   err;
+
+	*cnt_out = 0;
+
+	if (handle->state != M_IO_STATE_CONNECTED || handle->sock == M_EVENT_INVALID_SOCKET)
+		return M_IO_ERROR_NOTCONNECTED;
+
+	handle->last_error = M_IO_ERROR_WOULDBLOCK;
+	err                = M_io_net_udp_send_sys(handle, dgrams, cnt, cnt_out);
+
+	/* Errors tied to a single datagram (too large, unreachable destination, ...) must not
+	 * tear down a socket that serves other peers. The system error is still kept for
+	 * M_io_get_error_string(). */
+	if (err != M_IO_ERROR_SUCCESS && err != M_IO_ERROR_WOULDBLOCK && err != M_IO_ERROR_NOTIMPL) {
+#ifdef _WIN32
+		if (!handle->connected || handle->last_error_sys == WSAEMSGSIZE)
+#else
+		if (!handle->connected || handle->last_error_sys == EMSGSIZE)
+#endif
+			err = M_IO_ERROR_INVALID;
+	}
+
+	if (err == M_IO_ERROR_WOULDBLOCK || (err == M_IO_ERROR_SUCCESS && *cnt_out < cnt)) {
+		M_event_handle_modify(M_io_get_event(io), M_EVENT_MODTYPE_ADD_WAITTYPE, io, handle->evhandle, handle->sock, M_EVENT_WAIT_WRITE, 0);
+	} else if (err == M_IO_ERROR_SUCCESS) {
+		M_event_handle_modify(M_io_get_event(io), M_EVENT_MODTYPE_DEL_WAITTYPE, io, handle->evhandle, handle->sock, M_EVENT_WAIT_WRITE, 0);
+	} else if (M_io_error_is_critical(err) && err != M_IO_ERROR_NOTIMPL) {
+		handle->state = M_IO_STATE_ERROR;
+	}
+
+	return err;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static M_io_net_udp_metadata_t *M_io_net_udp_meta_data(M_io_meta_t *meta, M_io_layer_t *layer, M_bool create)
+{
+	M_io_net_udp_metadata_t *md;
+
+	md = M_io_meta_get_layer_data(meta, layer);
+	if (md == NULL && create) {
+		md = M_malloc_zero(sizeof(*md));
+		M_io_meta_insert_layer_data(meta, layer, md, M_free);
+	}
+	return md;
+}
+
+
+static M_io_error_t M_io_net_udp_read_cb(M_io_layer_t *layer, unsigned char *buf, size_t *read_len, M_io_meta_t *meta)
+{
+	M_io_net_udp_dgram_t     dgram;
+	M_io_net_udp_metadata_t *md;
+	size_t                   cnt;
+	M_io_error_t             err;
+
+	if (layer == NULL || buf == NULL || read_len == NULL || *read_len == 0)
+		return M_IO_ERROR_INVALID;
+
+	M_mem_set(&dgram, 0, sizeof(dgram));
+	dgram.buf      = buf;
+	dgram.buf_size = *read_len;
+
+	err = M_io_net_udp_recv(layer, &dgram, 1, &cnt);
+	if (err != M_IO_ERROR_SUCCESS)
+		return err;
+
+	*read_len = dgram.len;
+
+	if (meta != NULL) {
+		md               = M_io_net_udp_meta_data(meta, layer, M_TRUE);
+		dgram.buf        = NULL;
+		dgram.buf_size   = 0;
+		dgram.len        = 0;
+		M_mem_copy(&md->peer, &dgram, sizeof(md->peer));
+		md->ipaddr[0]    = '\0';
+	}
+
+	return M_IO_ERROR_SUCCESS;
+}
+
+
+static M_io_error_t M_io_net_udp_write_cb(M_io_layer_t *layer, const unsigned char *buf, size_t *write_len, M_io_meta_t *meta)
+{
+	M_io_net_udp_dgram_t     dgram;
+	M_io_net_udp_metadata_t *md = NULL;
+	size_t                   cnt;
+	M_io_error_t             err;
+
+	if (layer == NULL || buf == NULL || write_len == NULL || *write_len == 0)
+		return M_IO_ERROR_INVALID;
+
+	if (meta != NULL)
+		md = M_io_net_udp_meta_data(meta, layer, M_FALSE);
+
+	M_mem_set(&dgram, 0, sizeof(dgram));
+	if (md != NULL)
+		M_mem_copy(&dgram, &md->peer, sizeof(dgram));
+	dgram.buf = M_CAST_OFF_CONST(unsigned char *, buf);
+	dgram.len = *write_len;
+
+	err = M_io_net_udp_send(layer, &dgram, 1, &cnt);
+	/* Segment size requested without GSO support is a misuse of this write, not a
+	 * failure of the socket */
+	if (err == M_IO_ERROR_NOTIMPL)
+		return M_IO_ERROR_INVALID;
+	if (err != M_IO_ERROR_SUCCESS)
+		return err;
+
+	/* A datagram is sent whole or not at all */
+	return M_IO_ERROR_SUCCESS;
+}
+
+
+/* Segments of a vectored write form a single datagram. The generic coalescing in
+ * the io layer may split large writes so they're gathered here instead. */
+static M_io_error_t M_io_net_udp_writev_cb(M_io_layer_t *layer, const M_iovec_t *iov, size_t iov_cnt, size_t *write_len, M_io_meta_t *meta)
+{
+	unsigned char  stackbuf[2048];
+	unsigned char *buf = stackbuf;
+	size_t         len = 0;
+	size_t         i;
+	M_io_error_t   err;
+
+	if (layer == NULL || iov == NULL || iov_cnt == 0 || write_len == NULL)
+		return M_IO_ERROR_INVALID;
+
+	for (i=0; i<iov_cnt; i++)
+		len += iov[i].len;
+	if (len == 0)
+		return M_IO_ERROR_INVALID;
+
+	if (len > sizeof(stackbuf))
+		buf = M_malloc(len);
+
+	len = 0;
+	for (i=0; i<iov_cnt; i++) {
+		if (iov[i].len == 0)
+			continue;
+		M_mem_copy(buf + len, iov[i].data, iov[i].len);
+		len += iov[i].len;
+	}
+
+	*write_len = len;
+	err        = M_io_net_udp_write_cb(layer, buf, write_len, meta);
+
+	if (buf != stackbuf)
+		M_free(buf);
+	return err;
+}
+
+
+static M_bool M_io_net_udp_process_cb(M_io_layer_t *layer, M_event_type_t *type)
+{
+	M_io_handle_t *handle = M_io_layer_get_handle(layer);
+	M_io_t        *io     = M_io_layer_get_io(layer);
+	M_event_t     *event  = M_io_get_event(io);
+	socklen_t      arglen;
+
+	switch (*type) {
+		case M_EVENT_TYPE_READ:
+			/* Re-armed by the next read */
+			M_event_handle_modify(event, M_EVENT_MODTYPE_DEL_WAITTYPE, io, handle->evhandle, handle->sock, M_EVENT_WAIT_READ, 0);
+			return handle->state != M_IO_STATE_CONNECTED;
+		case M_EVENT_TYPE_WRITE:
+			/* Re-armed by the next write that would block */
+			M_event_handle_modify(event, M_EVENT_MODTYPE_DEL_WAITTYPE, io, handle->evhandle, handle->sock, M_EVENT_WAIT_WRITE, 0);
+			return handle->state != M_IO_STATE_CONNECTED;
+		case M_EVENT_TYPE_ERROR:
+		case M_EVENT_TYPE_DISCONNECTED:
+			/* Already failed by a read or write, pass it on */
+			if (handle->state != M_IO_STATE_CONNECTED)
+				return M_FALSE;
+
+			/* Pending socket error (e.g. ICMP port unreachable), fetching it clears it */
+			arglen = (socklen_t)sizeof(handle->last_error_sys);
+#ifdef _WIN32
+			getsockopt(handle->sock, SOL_SOCKET, SO_ERROR, (char *)&handle->last_error_sys, &arglen);
+#else
+			getsockopt(handle->sock, SOL_SOCKET, SO_ERROR, &handle->last_error_sys, &arglen);
+#endif
+
+			/* Not associated with a peer, nothing has been lost */
+			if (!handle->connected)
+				return M_TRUE;
+
+			if (handle->last_error_sys == 0) {
+#ifdef _WIN32
+				handle->last_error_sys = WSAECONNREFUSED;
+#else
+				handle->last_error_sys = ECONNREFUSED;
+#endif
+			}
+#ifdef _WIN32
+			handle->last_error = M_io_win32_err_to_ioerr(handle->last_error_sys);
+#else
+			handle->last_error = M_io_posix_err_to_ioerr(handle->last_error_sys);
+#endif
+			handle->state      = M_IO_STATE_ERROR;
+			*type              = M_EVENT_TYPE_ERROR;
+			M_io_set_error(io, handle->last_error);
+			return M_FALSE;
+		default:
+			break;
+	}
+
+	return M_FALSE;
+}
+
+
+static M_bool M_io_net_udp_init_cb(M_io_layer_t *layer)
+{
+	M_io_handle_t *handle = M_io_layer_get_handle(layer);
+	M_io_t        *io     = M_io_layer_get_io(layer);
+	M_event_t     *event  = M_io_get_event(io);
+
+	if (handle->sock == M_EVENT_INVALID_SOCKET)
+		return M_FALSE;
+
+	if (handle->state == M_IO_STATE_CONNECTED)
+		M_io_layer_softevent_add(layer, M_FALSE, M_EVENT_TYPE_CONNECTED, M_IO_ERROR_SUCCESS);
+
+	M_event_handle_modify(event, M_EVENT_MODTYPE_ADD_HANDLE, io, handle->evhandle, handle->sock, M_EVENT_WAIT_READ, M_EVENT_CAPS_READ|M_EVENT_CAPS_WRITE);
+	return M_TRUE;
+}
+
+
+static void M_io_net_udp_unregister_cb(M_io_layer_t *layer)
+{
+	M_io_handle_t *handle = M_io_layer_get_handle(layer);
+	M_io_t        *io     = M_io_layer_get_io(layer);
+
+	if (handle->evhandle == M_EVENT_INVALID_HANDLE)
+		return;
+
+	M_event_handle_modify(M_io_get_event(io), M_EVENT_MODTYPE_DEL_HANDLE, io, handle->evhandle, handle->sock, 0, 0);
+}
+
+
+static M_bool M_io_net_udp_disconnect_cb(M_io_layer_t *layer)
+{
+	M_io_handle_t *handle = M_io_layer_get_handle(layer);
+
+	/* Nothing to tell the peer, done immediately */
+	if (handle->state == M_IO_STATE_CONNECTED)
+		handle->state = M_IO_STATE_DISCONNECTED;
+	return M_TRUE;
+}
+
+
+static void M_io_net_udp_destroy_cb(M_io_layer_t *layer)
+{
+	M_io_handle_t *handle = M_io_layer_get_handle(layer);
+
+	if (handle == NULL)
+		return;
+
+	/* unregister_cb() has removed the handle from the event */
+	M_io_net_udp_close(handle);
+	M_free(handle);
+}
+
+
+static M_io_state_t M_io_net_udp_state_cb(M_io_layer_t *layer)
+{
+	M_io_handle_t *handle = M_io_layer_get_handle(layer);
+
+	return handle->state;
+}
+
+
+static M_bool M_io_net_udp_errormsg_cb(M_io_layer_t *layer, char *error, size_t err_len)
+{
+	M_io_handle_t *handle = M_io_layer_get_handle(layer);
+
+	if (handle->state == M_IO_STATE_DISCONNECTED) {
+		M_snprintf(error, err_len, "Closed");
+		return M_TRUE;
+	}
+
+#ifdef _WIN32
+	return M_io_win32_errormsg(handle->last_error_sys, error, err_len);
+#else
+	return M_io_posix_errormsg(handle->last_error_sys, error, err_len);
+#endif
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static M_io_error_t M_io_net_udp_socket(M_io_handle_t *handle, int family)
+{
+	int type = SOCK_DGRAM;
+
+#ifdef SOCK_CLOEXEC
+	type |= SOCK_CLOEXEC;
+#endif
+	handle->sock = socket(family, type, IPPROTO_UDP);
+	if (handle->sock == M_EVENT_INVALID_SOCKET) {
+		M_io_net_udp_resolve_error(handle);
+		return handle->last_error;
+	}
+#if !defined(SOCK_CLOEXEC) && !defined(_WIN32)
+	M_io_posix_fd_set_closeonexec(handle->sock, M_TRUE);
+#endif
+	handle->family = family;
+
+#ifdef AF_INET6
+	if (family == AF_INET6) {
+#  if defined(_WIN32) && !defined(IPV6_V6ONLY)
+#    define IPV6_V6ONLY 27
+#  endif
+#  if defined(IPV6_V6ONLY)
+		/* Some OS's may set IPV6_V6ONLY on by default.  So always override the flag
+		 * with our intended behavior */
+		int enable = (handle->type == M_IO_NET_IPV6)?1:0;
+		int rv;
+		rv = setsockopt(handle->sock, IPPROTO_IPV6, IPV6_V6ONLY, (const void *)&enable, sizeof(enable));
+		(void)rv; /* silence coverity */
+#  endif
+	}
+#endif
+
+	return M_IO_ERROR_SUCCESS;
+}
+
+
+/* Finish setting up a socket that has been bound or connected */
+static void M_io_net_udp_ready(M_io_handle_t *handle)
+{
+	M_io_net_udp_addr_t  addr;
+	M_io_net_udp_dgram_t dgram;
+	socklen_t            addrlen = sizeof(addr);
+
+	M_mem_set(&addr, 0, sizeof(addr));
+	M_mem_set(&dgram, 0, sizeof(dgram));
+	if (getsockname(handle->sock, &addr.sa, &addrlen) == 0) {
+		M_io_net_udp_addr_to_dgram(&addr, &dgram);
+		handle->port = dgram.port;
+	}
+
+	M_io_setnonblock(handle->sock);
+#ifdef _WIN32
+	handle->evhandle = WSACreateEvent();
+	WSAEventSelect(handle->sock, handle->evhandle, FD_READ|FD_WRITE);
+#else
+	handle->evhandle = handle->sock;
+#endif
+	handle->state    = M_IO_STATE_CONNECTED;
+}
+
+
+static M_io_error_t M_io_net_udp_bind(M_io_handle_t *handle, const char *bind_ip, unsigned short port)
+{
+	M_io_net_udp_dgram_t dgram;
+	M_io_net_udp_addr_t  addr;
+	socklen_t            addrlen;
+	M_io_error_t         err;
+	int                  family;
+
+	M_mem_set(&dgram, 0, sizeof(dgram));
+	dgram.port = port;
+
+	/* No bind address means all interfaces of the requested type */
+	if (M_str_isempty(bind_ip)) {
+#ifdef AF_INET6
+		bind_ip = (handle->type == M_IO_NET_IPV4)?"0.0.0.0":"::";
+#else
+		bind_ip = "0.0.0.0";
+#endif
+	}
+
+	if (!M_io_net_ipaddr_to_bin(dgram.ipaddr, sizeof(dgram.ipaddr), bind_ip, &dgram.ipaddr_len))
+		return M_IO_ERROR_INVALID;
+
+	if ((handle->type == M_IO_NET_IPV4 && dgram.ipaddr_len != 4) || (handle->type == M_IO_NET_IPV6 && dgram.ipaddr_len != 16))
+		return M_IO_ERROR_INVALID;
+
+	/* An explicit address that isn't the IPv6 wildcard can only be that address's type */
+	if (handle->type == M_IO_NET_ANY && !M_str_eq(bind_ip, "::"))
+		handle->type = (dgram.ipaddr_len == 4)?M_IO_NET_IPV4:M_IO_NET_IPV6;
+
+#ifdef AF_INET6
+	family = (dgram.ipaddr_len == 16)?AF_INET6:AF_INET;
+#else
+	family = AF_INET;
+#endif
+
+	err = M_io_net_udp_socket(handle, family);
+	if (err != M_IO_ERROR_SUCCESS)
+		return err;
+
+	addrlen = M_io_net_udp_dgram_to_addr(handle, &dgram, &addr);
+	if (addrlen == 0 || bind(handle->sock, &addr.sa, addrlen) != 0) {
+		if (addrlen == 0) {
+			handle->last_error = M_IO_ERROR_INVALID;
+		} else {
+			M_io_net_udp_resolve_error(handle);
+		}
+		M_io_net_udp_close(handle);
+		return handle->last_error;
+	}
+
+	M_io_net_udp_ready(handle);
+	return M_IO_ERROR_SUCCESS;
+}
+
+
+static M_io_t *M_io_net_udp_io_create(M_io_handle_t *handle)
+{
+	M_io_t           *io;
+	M_io_callbacks_t *callbacks;
+
+	io        = M_io_init(M_IO_TYPE_STREAM);
+	callbacks = M_io_callbacks_create();
+	M_io_callbacks_reg_init(callbacks, M_io_net_udp_init_cb);
+	M_io_callbacks_reg_read(callbacks, M_io_net_udp_read_cb);
+	M_io_callbacks_reg_write(callbacks, M_io_net_udp_write_cb);
+	M_io_callbacks_reg_writev(callbacks, M_io_net_udp_writev_cb);
+	M_io_callbacks_reg_processevent(callbacks, M_io_net_udp_process_cb);
+	M_io_callbacks_reg_unregister(callbacks, M_io_net_udp_unregister_cb);
+	M_io_callbacks_reg_disconnect(callbacks, M_io_net_udp_disconnect_cb);
+	M_io_callbacks_reg_destroy(callbacks, M_io_net_udp_destroy_cb);
+	M_io_callbacks_reg_state(callbacks, M_io_net_udp_state_cb);
+	M_io_callbacks_reg_errormsg(callbacks, M_io_net_udp_errormsg_cb);
+	M_io_layer_add(io, M_IO_NET_UDP_NAME, handle, callbacks);
+	M_io_callbacks_destroy(callbacks);
+
+	return io;
+}
+
+
+static M_io_handle_t *M_io_net_udp_handle_create(M_io_net_type_t type)
+{
+	M_io_handle_t *handle;
+
+	handle           = M_malloc_zero(sizeof(*handle));
+	handle->evhandle = M_EVENT_INVALID_HANDLE;
+	handle->sock     = M_EVENT_INVALID_SOCKET;
+	handle->type     = type;
+	handle->state    = M_IO_STATE_INIT;
+	return handle;
+}
+
+
+M_io_error_t M_io_net_udp_create(M_io_t **io_out, unsigned short port, const char *bind_ip, M_io_net_type_t type)
+{
+	M_io_handle_t *handle;
+	M_io_error_t   err;
+
+	if (io_out == NULL)
+		return M_IO_ERROR_INVALID;
+
+	*io_out = NULL;
+
+	M_io_net_init_system();
+
+	handle = M_io_net_udp_handle_create(type);
+	err    = M_io_net_udp_bind(handle, bind_ip, port);
+
+	/* Some OS's may allow disabling of IPv6 completely, fall back to IPv4 since they
+	 * really requested ANY */
+	if (err != M_IO_ERROR_SUCCESS && type == M_IO_NET_ANY && M_str_isempty(bind_ip)) {
+		handle->type = M_IO_NET_IPV4;
+		err          = M_io_net_udp_bind(handle, bind_ip, port);
+	}
+
+	if (err != M_IO_ERROR_SUCCESS) {
+		M_free(handle);
+		return err;
+	}
+
+	*io_out = M_io_net_udp_io_create(handle);
+	return M_IO_ERROR_SUCCESS;
+}
+
+
+M_io_error_t M_io_net_udp_client_create(M_io_t **io_out, const char *ipaddr, unsigned short port, M_io_net_type_t type)
+{
+	M_io_handle_t        *handle;
+	M_io_net_udp_dgram_t  dgram;
+	M_io_net_udp_addr_t   addr;
+	socklen_t             addrlen;
+	M_io_error_t          err;
+	int                   family;
+
+	if (io_out == NULL || port == 0)
+		return M_IO_ERROR_INVALID;
+
+	*io_out = NULL;
+
+	M_mem_set(&dgram, 0, sizeof(dgram));
+	dgram.port = port;
+	if (!M_io_net_ipaddr_to_bin(dgram.ipaddr, sizeof(dgram.ipaddr), ipaddr, &dgram.ipaddr_len))
+		return M_IO_ERROR_INVALID;
+
+	if ((type == M_IO_NET_IPV4 && dgram.ipaddr_len != 4) || (type == M_IO_NET_IPV6 && dgram.ipaddr_len != 16))
+		return M_IO_ERROR_INVALID;
+
+	M_io_net_init_system();
+
+	handle = M_io_net_udp_handle_create((dgram.ipaddr_len == 4)?M_IO_NET_IPV4:M_IO_NET_IPV6);
+#ifdef AF_INET6
+	family = (dgram.ipaddr_len == 16)?AF_INET6:AF_INET;
+#else
+	family = AF_INET;
+#endif
+
+	err = M_io_net_udp_socket(handle, family);
+	if (err != M_IO_ERROR_SUCCESS) {
+		M_free(handle);
+		return err;
+	}
+
+	/* Connecting a datagram socket only sets the default destination and filters
+	 * received datagrams, it completes immediately */
+	addrlen = M_io_net_udp_dgram_to_addr(handle, &dgram, &addr);
+	if (addrlen == 0 || connect(handle->sock, &addr.sa, addrlen) != 0) {
+		err = M_IO_ERROR_INVALID;
+		if (addrlen != 0) {
+			M_io_net_udp_resolve_error(handle);
+			err = handle->last_error;
+		}
+		M_io_net_udp_close(handle);
+		M_free(handle);
+		return err;
+	}
+
+	handle->connected = M_TRUE;
+	M_io_net_udp_ready(handle);
+
+	*io_out = M_io_net_udp_io_create(handle);
+	return M_IO_ERROR_SUCCESS;
+}
+
+
+unsigned short M_io_net_udp_get_port(M_io_t *io)
+{
+	M_io_layer_t  *layer  = M_io_layer_acquire(io, 0, M_IO_NET_UDP_NAME);
+	M_io_handle_t *handle = M_io_layer_get_handle(layer);
+	unsigned short port;
+
+	if (layer == NULL || handle == NULL)
+		return 0;
+
+	port = handle->port;
+
+	M_io_layer_release(layer);
+	return port;
+}
+
+
+M_bool M_io_net_udp_set_gro(M_io_t *io, M_bool enable)
+{
+	M_io_layer_t  *layer  = M_io_layer_acquire(io, 0, M_IO_NET_UDP_NAME);
+	M_io_handle_t *handle = M_io_layer_get_handle(layer);
+	M_bool         ret    = M_FALSE;
+
+	if (layer == NULL || handle == NULL)
+		return M_FALSE;
+
+#ifdef M_IO_NET_UDP_GRO
+	if (handle->sock != M_EVENT_INVALID_SOCKET) {
+		int val = enable?1:0;
+		if (setsockopt(handle->sock, SOL_UDP, UDP_GRO, &val, sizeof(val)) == 0) {
+			handle->gro = enable;
+			ret         = M_TRUE;
+		}
+	}
+#else
+	(void)enable;
+#endif
+
+	M_io_layer_release(layer);
+	return ret;
+}
+
+
+M_io_error_t M_io_net_udp_read_batch(M_io_t *io, M_io_net_udp_dgram_t *dgrams, size_t cnt, size_t *cnt_out)
+{
+	M_io_layer_t *layer;
+	M_io_error_t  err;
+	size_t        i;
+
+	if (cnt_out != NULL)
+		*cnt_out = 0;
+
+	if (io == NULL || dgrams == NULL || cnt == 0 || cnt_out == NULL)
+		return M_IO_ERROR_INVALID;
+
+	for (i=0; i<cnt; i++) {
+		if (dgrams[i].buf == NULL || dgrams[i].buf_size == 0)
+			return M_IO_ERROR_INVALID;
+	}
+
+	layer = M_io_layer_acquire(io, 0, M_IO_NET_UDP_NAME);
+	if (layer == NULL)
+		return M_IO_ERROR_INVALID;
+
+	err = M_io_net_udp_recv(layer, dgrams, cnt, cnt_out);
+	/* Reads through M_io_read() get this from the io object, do the same here */
+	if (M_io_error_is_critical(err))
+		M_io_layer_softevent_add(layer, M_FALSE, M_EVENT_TYPE_ERROR, err);
+
+	M_io_layer_release(layer);
+	return err;
+}
+
+
+M_io_error_t M_io_net_udp_write_batch(M_io_t *io, const M_io_net_udp_dgram_t *dgrams, size_t cnt, size_t *cnt_out)
+{
+	M_io_layer_t *layer;
+	M_io_error_t  err;
+	size_t        i;
+
+	if (cnt_out != NULL)
+		*cnt_out = 0;
+
+	if (io == NULL || dgrams == NULL || cnt == 0 || cnt_out == NULL)
+		return M_IO_ERROR_INVALID;
+
+	for (i=0; i<cnt; i++) {
+		if (dgrams[i].buf == NULL || dgrams[i].len == 0)
+			return M_IO_ERROR_INVALID;
+	}
+
+	layer = M_io_layer_acquire(io, 0, M_IO_NET_UDP_NAME);
+	if (layer == NULL)
+		return M_IO_ERROR_INVALID;
+
+	err = M_io_net_udp_send(layer, dgrams, cnt, cnt_out);
+	if (M_io_error_is_critical(err) && err != M_IO_ERROR_NOTIMPL)
+		M_io_layer_softevent_add(layer, M_FALSE, M_EVENT_TYPE_ERROR, err);
+
+	M_io_layer_release(layer);
+	return err;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+const char *M_io_net_udp_meta_get_ipaddr(M_io_t *io, M_io_meta_t *meta)
+{
+	M_io_layer_t            *layer;
+	M_io_net_udp_metadata_t *md;
+	const char              *ret = NULL;
+
+	if (io == NULL || meta == NULL)
+		return NULL;
+
+	layer = M_io_layer_acquire(io, 0, M_IO_NET_UDP_NAME);
+	if (layer == NULL)
+		return NULL;
+
+	md = M_io_net_udp_meta_data(meta, layer, M_FALSE);
+	if (md != NULL && md->peer.ipaddr_len != 0) {
+		if (md->ipaddr[0] == '\0')
+			M_io_net_bin_to_ipaddr(md->ipaddr, sizeof(md->ipaddr), md->peer.ipaddr, md->peer.ipaddr_len);
+		ret = md->ipaddr;
+	}
+
+	M_io_layer_release(layer);
+	return ret;
+}
+
+
+unsigned short M_io_net_udp_meta_get_port(M_io_t *io, M_io_meta_t *meta)
+{
+	M_io_layer_t            *layer;
+	M_io_net_udp_metadata_t *md;
+	unsigned short           port = 0;
+
+	if (io == NULL || meta == NULL)
+		return 0;
+
+	layer = M_io_layer_acquire(io, 0, M_IO_NET_UDP_NAME);
+	if (layer == NULL)
+		return 0;
+
+	md = M_io_net_udp_meta_data(meta, layer, M_FALSE);
+	if (md != NULL)
+		port = md->peer.port;
+
+	M_io_layer_release(layer);
+	return port;
+}
+
+
+size_t M_io_net_udp_meta_get_segment_size(M_io_t *io, M_io_meta_t *meta)
+{
+	M_io_layer_t            *layer;
+	M_io_net_udp_metadata_t *md;
+	size_t                   segment_size = 0;
+
+	if (io == NULL || meta == NULL)
+		return 0;
+
+	layer = M_io_layer_acquire(io, 0, M_IO_NET_UDP_NAME);
+	if (layer == NULL)
+		return 0;
+
+	md = M_io_net_udp_meta_data(meta, layer, M_FALSE);
+	if (md != NULL)
+		segment_size = md->peer.segment_size;
+
+	M_io_layer_release(layer);
+	return segment_size;
+}
+
+
+M_bool M_io_net_udp_meta_get_truncated(M_io_t *io, M_io_meta_t *meta)
+{
+	M_io_layer_t            *layer;
+	M_io_net_udp_metadata_t *md;
+	M_bool                   truncated = M_FALSE;
+
+	if (io == NULL || meta == NULL)
+		return M_FALSE;
+
+	layer = M_io_layer_acquire(io, 0, M_IO_NET_UDP_NAME);
+	if (layer == NULL)
+		return M_FALSE;
+
+	md = M_io_net_udp_meta_data(meta, layer, M_FALSE);
+	if (md != NULL)
+		truncated = md->peer.truncated;
+
+	M_io_layer_release(layer);
+	return truncated;
+}
+
+
+M_bool M_io_net_udp_meta_set_peer(M_io_t *io, M_io_meta_t *meta, const char *ipaddr, unsigned short port)
+{
+	M_io_layer_t            *layer;
+	M_io_net_udp_metadata_t *md;
+	unsigned char            ip[16];
+	size_t                   ip_len = 0;
+
+	if (io == NULL || meta == NULL || port == 0)
+		return M_FALSE;
+
+	if (!M_io_net_ipaddr_to_bin(ip, sizeof(ip), ipaddr, &ip_len))
+		return M_FALSE;
+
+	layer = M_io_layer_acquire(io, 0, M_IO_NET_UDP_NAME);
+	if (layer == NULL)
+		return M_FALSE;
+
+	md                  = M_io_net_udp_meta_data(meta, layer, M_TRUE);
+	M_mem_copy(md->peer.ipaddr, ip, ip_len);
+	md->peer.ipaddr_len = ip_len;
+	md->peer.port       = port;
+	md->ipaddr[0]       = '\0';
+
+	M_io_layer_release(layer);
+	return M_TRUE;
+}
+
+
+void M_io_net_udp_meta_set_segment_size(M_io_t *io, M_io_meta_t *meta, size_t segment_size)
+{
+	M_io_layer_t            *layer;
+	M_io_net_udp_metadata_t *md;
+
+	if (io == NULL || meta == NULL)
+		return;
+
+	layer = M_io_layer_acquire(io, 0, M_IO_NET_UDP_NAME);
+	if (layer == NULL)
+		return;
+
+	md                    = M_io_net_udp_meta_data(meta, layer, M_TRUE);
+	md->peer.segment_size = segment_size;
+
+	M_io_layer_release(layer);
+}
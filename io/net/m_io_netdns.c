@@ -87,6 +87,64 @@ static M_io_error_t M_io_netdns_write_cb(M_io_layer_t *layer, const unsigned cha
 }
 
 
+static M_io_error_t M_io_netdns_writev_cb(M_io_layer_t *layer, const M_iovec_t *iov, size_t iov_cnt, size_t *write_len, M_io_meta_t *meta)
+{
+	M_io_handle_t *handle = M_io_layer_get_handle(layer);
+	M_io_error_t   err;
+
+	if (handle->data.netdns.io == NULL)
+		return M_IO_ERROR_INVALID;
+
+	if (handle->state != M_IO_NET_STATE_CONNECTED && handle->state != M_IO_NET_STATE_DISCONNECTING) {
+		if (handle->state == M_IO_NET_STATE_DISCONNECTED)
+			return M_IO_ERROR_DISCONNECT;
+		return M_IO_ERROR_ERROR;
+	}
+
+	/* Relay to io object */
+	err = M_io_writev_meta(handle->data.netdns.io, iov, iov_cnt, write_len, meta);
+	if (err != M_IO_ERROR_SUCCESS && err != M_IO_ERROR_WOULDBLOCK) {
+		handle->hard_down = M_TRUE;
+		if (err == M_IO_ERROR_DISCONNECT) {
+			handle->state = M_IO_NET_STATE_DISCONNECTED;
+		} else {
+			handle->state = M_IO_NET_STATE_ERROR;
+		}
+	}
+
+	return err;
+}
+
+
+static M_io_error_t M_io_netdns_sendfile_cb(M_io_layer_t *layer, M_intptr fd, M_int64 offset, size_t len, size_t *write_len)
+{
+	M_io_handle_t *handle = M_io_layer_get_handle(layer);
+	M_io_error_t   err;
+
+	if (handle->data.netdns.io == NULL)
+		return M_IO_ERROR_INVALID;
+
+	if (handle->state != M_IO_NET_STATE_CONNECTED && handle->state != M_IO_NET_STATE_DISCONNECTING) {
+		if (handle->state == M_IO_NET_STATE_DISCONNECTED)
+			return M_IO_ERROR_DISCONNECT;
+		return M_IO_ERROR_ERROR;
+	}
+
+	/* Relay to io object */
+	err = M_io_write_sendfile(handle->data.netdns.io, fd, offset, len, write_len);
+	if (err != M_IO_ERROR_SUCCESS && err != M_IO_ERROR_WOULDBLOCK && err != M_IO_ERROR_NOTIMPL) {
+		handle->hard_down = M_TRUE;
+		if (err == M_IO_ERROR_DISCONNECT) {
+			handle->state = M_IO_NET_STATE_DISCONNECTED;
+		} else {
+			handle->state = M_IO_NET_STATE_ERROR;
+		}
+	}
+
+	return err;
+}
+
+
 static M_bool M_io_netdns_process_cb(M_io_layer_t *layer, M_event_type_t *type)
 {
 	M_io_handle_t *handle = M_io_layer_get_handle(layer);
@@ -633,6 +691,8 @@ M_io_error_t M_io_net_client_create(M_io_t **io_out, M_dns_t *dns, const char *h
 	M_io_callbacks_reg_init(callbacks, M_io_netdns_init_cb);
 	M_io_callbacks_reg_read(callbacks, M_io_netdns_read_cb);
 	M_io_callbacks_reg_write(callbacks, M_io_netdns_write_cb);
+	M_io_callbacks_reg_writev(callbacks, M_io_netdns_writev_cb);
+	M_io_callbacks_reg_sendfile(callbacks, M_io_netdns_sendfile_cb);
 	M_io_callbacks_reg_processevent(callbacks, M_io_netdns_process_cb);
 	M_io_callbacks_reg_unregister(callbacks, M_io_netdns_unregister_cb);
 	M_io_callbacks_reg_disconnect(callbacks, M_io_netdns_disconnect_cb);
@@ -112,6 +112,155 @@ START_TEST(check_change_size_shrink)
 }
 END_TEST
 
+START_TEST(check_weight)
+{
+	M_cache_strvp_t *cache;
+	M_cache_stats_t  stats;
+
+	cache = M_cache_strvp_create(100, M_CACHE_STRVP_NONE, M_free);
+	M_cache_strvp_set_max_weight(cache, 10);
+
+	M_cache_strvp_insert_ext(cache, "key1", M_strdup("val1"), 4, 0);
+	M_cache_strvp_insert_ext(cache, "key2", M_strdup("val2"), 4, 0);
+	ck_assert(M_cache_strvp_weight(cache) == 8);
+
+	/* Weight limit evicts the coldest entry even though the size limit wasn't reached. */
+	M_cache_strvp_get(cache, "key1", NULL);
+	M_cache_strvp_insert_ext(cache, "key3", M_strdup("val3"), 4, 0);
+	ck_assert(M_cache_strvp_size(cache) == 2);
+	ck_assert(M_cache_strvp_weight(cache) == 8);
+	ck_assert(M_cache_strvp_get_direct(cache, "key2") == NULL);
+	ck_assert(M_str_eq(M_cache_strvp_get_direct(cache, "key1"), "val1"));
+
+	/* Replacing a value updates the weight. */
+	M_cache_strvp_insert_ext(cache, "key1", M_strdup("val1b"), 6, 0);
+	ck_assert(M_cache_strvp_weight(cache) == 10);
+	ck_assert(M_cache_strvp_size(cache) == 2);
+
+	/* Too heavy to ever fit. */
+	ck_assert(M_cache_strvp_insert_ext(cache, "key4", M_strdup("val4"), 11, 0));
+	ck_assert(M_cache_strvp_get_direct(cache, "key4") == NULL);
+
+	M_cache_strvp_stats(cache, &stats);
+	ck_assert(stats.evictions == 1);
+	ck_assert(stats.rejections == 1);
+
+	M_cache_strvp_set_max_weight(cache, 6);
+	ck_assert(M_cache_strvp_size(cache) == 1);
+	ck_assert(M_cache_strvp_weight(cache) == 6);
+
+	M_cache_strvp_destroy(cache);
+}
+END_TEST
+
+START_TEST(check_ttl)
+{
+	M_cache_strvp_t *cache;
+	M_cache_stats_t  stats;
+	M_timeval_t      tv;
+
+	cache = M_cache_strvp_create(10, M_CACHE_STRVP_NONE, M_free);
+	M_cache_strvp_set_ttl(cache, 50);
+	ck_assert(M_cache_strvp_ttl(cache) == 50);
+
+	M_cache_strvp_insert(cache, "key1", M_strdup("val1"));
+	M_cache_strvp_insert(cache, "key2", M_strdup("val2"));
+	M_cache_strvp_insert_ext(cache, "key3", M_strdup("val3"), 0, 60000);
+	ck_assert(M_str_eq(M_cache_strvp_get_direct(cache, "key1"), "val1"));
+
+	M_time_elapsed_start(&tv);
+	while (M_time_elapsed(&tv) < 100)
+		;
+
+	ck_assert(M_cache_strvp_get_direct(cache, "key1") == NULL);
+	ck_assert(M_cache_strvp_expire(cache) == 1);
+	ck_assert(M_cache_strvp_size(cache) == 1);
+	ck_assert(M_str_eq(M_cache_strvp_get_direct(cache, "key3"), "val3"));
+
+	M_cache_strvp_stats(cache, &stats);
+	ck_assert(stats.expirations == 2);
+	ck_assert(stats.hits == 2);
+	ck_assert(stats.misses == 1);
+
+	M_cache_strvp_destroy(cache);
+}
+END_TEST
+
+START_TEST(check_tinylfu)
+{
+	M_cache_strvp_t *cache;
+	M_cache_stats_t  stats;
+	char             key[32];
+	size_t           i;
+	size_t           j;
+
+	cache = M_cache_strvp_create(8, M_CACHE_STRVP_TINYLFU, M_free);
+
+	/* Build up a popular working set. */
+	for (i=0; i<8; i++) {
+		M_snprintf(key, sizeof(key), "hot%zu", i);
+		M_cache_strvp_insert(cache, key, M_strdup(key));
+		for (j=0; j<4; j++) {
+			ck_assert(M_cache_strvp_get(cache, key, NULL));
+		}
+	}
+
+	/* A scan of keys that are only seen once must not push out the popular ones. */
+	for (i=0; i<100; i++) {
+		M_snprintf(key, sizeof(key), "scan%zu", i);
+		ck_assert(M_cache_strvp_insert(cache, key, M_strdup(key)));
+	}
+
+	for (i=0; i<8; i++) {
+		M_snprintf(key, sizeof(key), "hot%zu", i);
+		ck_assert_msg(M_str_eq(M_cache_strvp_get_direct(cache, key), key), "%s was evicted", key);
+	}
+
+	M_cache_strvp_stats(cache, &stats);
+	ck_assert(stats.rejections == 100);
+	ck_assert(stats.evictions == 0);
+
+	/* Once a new key is requested often enough it gets in. */
+	for (j=0; j<8; j++)
+		M_cache_strvp_get(cache, "new", NULL);
+	M_cache_strvp_insert(cache, "new", M_strdup("new"));
+	ck_assert(M_str_eq(M_cache_strvp_get_direct(cache, "new"), "new"));
+	ck_assert(M_cache_strvp_size(cache) == 8);
+
+	M_cache_strvp_destroy(cache);
+}
+END_TEST
+
+START_TEST(check_reject_duplicated)
+{
+	M_cache_t               *cache;
+	M_cache_stats_t          stats;
+	char                     val[]     = "val";
+	struct M_cache_callbacks callbacks = {
+		M_hash_void_strdup,
+		M_free,
+		M_hash_void_strdup,
+		M_free
+	};
+
+	cache = M_cache_create(8, M_hash_func_default_str(M_FALSE), M_sort_compar_str, M_CACHE_NONE, &callbacks);
+	M_cache_set_max_weight(cache, 10);
+
+	/* The cache duplicates values so a rejected one still belongs to the caller. */
+	ck_assert(M_cache_insert_ext(cache, "key1", val, 11, 0));
+	ck_assert(M_cache_size(cache) == 0);
+	ck_assert(M_str_eq(val, "val"));
+
+	ck_assert(M_cache_insert_ext(cache, "key1", val, 4, 0));
+	ck_assert(M_cache_size(cache) == 1);
+
+	M_cache_stats(cache, &stats);
+	ck_assert(stats.rejections == 1);
+
+	M_cache_destroy(cache);
+}
+END_TEST
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static Suite *M_cache_strvp_suite(void)
@@ -127,6 +276,22 @@ static Suite *M_cache_strvp_suite(void)
 	tcase_add_test(tc, check_change_size_shrink);
 	suite_add_tcase(suite, tc);
 
+	tc = tcase_create("check_weight");
+	tcase_add_test(tc, check_weight);
+	suite_add_tcase(suite, tc);
+
+	tc = tcase_create("check_ttl");
+	tcase_add_test(tc, check_ttl);
+	suite_add_tcase(suite, tc);
+
+	tc = tcase_create("check_tinylfu");
+	tcase_add_test(tc, check_tinylfu);
+	suite_add_tcase(suite, tc);
+
+	tc = tcase_create("check_reject_duplicated");
+	tcase_add_test(tc, check_reject_duplicated);
+	suite_add_tcase(suite, tc);
+
 	return suite;
 }
 
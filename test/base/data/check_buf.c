@@ -349,6 +349,121 @@ START_TEST(check_buf_trim)
 }
 END_TEST
 
+START_TEST(check_buf_inline)
+{
+	unsigned char  mem[32 + M_BUF_INLINE_OVERHEAD];
+	M_buf_t       *buf;
+	char          *out;
+	size_t         len;
+
+	/* Fits in the caller's memory. */
+	buf = M_buf_create_inline(mem, sizeof(mem));
+	ck_assert((unsigned char *)buf >= mem && (unsigned char *)buf < mem + sizeof(mem));
+	M_buf_add_str(buf, "inline");
+	ck_assert((const unsigned char *)M_buf_peek(buf) > mem && (const unsigned char *)M_buf_peek(buf) < mem + sizeof(mem));
+	out = M_buf_finish_str(buf, &len);
+	ck_assert((unsigned char *)out < mem || (unsigned char *)out >= mem + sizeof(mem));
+	ck_assert(len == 6);
+	ck_assert_str_eq(out, "inline");
+	M_free(out);
+
+	/* Spills to the heap. */
+	buf = M_buf_create_inline(mem, sizeof(mem));
+	M_buf_add_str(buf, "0123456789");
+	M_buf_drop(buf, 5);
+	M_buf_add_fill(buf, 'x', 100);
+	ck_assert(M_buf_len(buf) == 105);
+	ck_assert((const unsigned char *)M_buf_peek(buf) < mem || (const unsigned char *)M_buf_peek(buf) >= mem + sizeof(mem));
+	ck_assert(M_str_eq_start(M_buf_peek(buf), "56789xxx"));
+	M_buf_cancel(buf);
+
+	/* Too small to use. */
+	buf = M_buf_create_inline(mem, 8);
+	M_buf_add_str(buf, "heap");
+	ck_assert_str_eq(M_buf_peek(buf), "heap");
+	M_buf_cancel(buf);
+}
+END_TEST
+
+START_TEST(check_buf_pooled)
+{
+	M_buf_t *buf;
+	M_buf_t *buf2;
+	char    *out;
+
+	buf = M_buf_create_pooled();
+	M_buf_add_str(buf, "pooled");
+	M_buf_drop(buf, 2);
+	M_buf_cancel(buf);
+
+	/* Same buffer comes back empty with its capacity kept. */
+	buf2 = M_buf_create_pooled();
+	ck_assert(buf2 == buf);
+	ck_assert(M_buf_len(buf2) == 0);
+	ck_assert(M_buf_alloc_size(buf2) == 1024);
+	M_buf_add_str(buf2, "again");
+	ck_assert_str_eq(M_buf_peek(buf2), "again");
+	out = M_buf_finish_str(buf2, NULL);
+	ck_assert_str_eq(out, "again");
+	M_free(out);
+
+	/* Finished buffers are still reused, without data. */
+	buf = M_buf_create_pooled();
+	ck_assert(buf == buf2);
+	ck_assert(M_buf_peek(buf) == NULL);
+
+	/* Reset keeps capacity. */
+	M_buf_add_str(buf, "reset");
+	M_buf_reset(buf);
+	ck_assert(M_buf_len(buf) == 0);
+	ck_assert_str_eq(M_buf_peek(buf), "");
+	M_buf_cancel(buf);
+
+	M_buf_pool_thread_flush();
+}
+END_TEST
+
+START_TEST(check_buf_pooled_arena)
+{
+	M_arena_t *arena;
+	M_buf_t   *buf;
+	char      *out;
+	char      *out2;
+
+	M_buf_pool_thread_flush();
+
+	arena = M_arena_create(0);
+	ck_assert(M_arena_push(arena));
+	out = NULL;
+	M_asprintf(&out, "%s", "arena");
+	ck_assert_str_eq(out, "arena");
+	ck_assert(M_arena_pop() == arena);
+	M_arena_reset(arena);
+
+	/* Nothing from the arena may have been kept for reuse. */
+	out = NULL;
+	M_asprintf(&out, "%s", "heap");
+	ck_assert_str_eq(out, "heap");
+	M_free(out);
+
+	/* A heap buffer that grows while an arena is active. */
+	buf = M_buf_create_pooled();
+	ck_assert(M_arena_push(arena));
+	M_buf_add_fill(buf, 'a', 4096);
+	ck_assert(M_arena_pop() == arena);
+	M_buf_cancel(buf);
+	M_arena_destroy(arena);
+
+	buf = M_buf_create_pooled();
+	M_buf_add_str(buf, "heap");
+	out2 = M_buf_finish_str(buf, NULL);
+	ck_assert_str_eq(out2, "heap");
+	M_free(out2);
+
+	M_buf_pool_thread_flush();
+}
+END_TEST
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 int main(void)
@@ -369,6 +484,9 @@ int main(void)
 	add_test(suite, check_buf_strbin);
 	add_test(suite, check_buf_uintbcd);
 	add_test(suite, check_buf_trim);
+	add_test(suite, check_buf_inline);
+	add_test(suite, check_buf_pooled);
+	add_test(suite, check_buf_pooled_arena);
 
 	sr = srunner_create(suite);
 	if (getenv("CK_LOG_FILE_NAME")==NULL) srunner_set_log(sr, "check_buf.log");
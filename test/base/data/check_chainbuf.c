@@ -0,0 +1,162 @@
+#include "m_config.h"
+#include <stdlib.h> /* EXIT_SUCCESS, EXIT_FAILURE, srand, rand */
+#include <check.h>
+
+#include <mstdlib/mstdlib.h>
+
+#define add_test(SUITENAME, TESTNAME)\
+do {\
+	TCase *tc;\
+	tc = tcase_create(#TESTNAME);\
+	tcase_add_test(tc, TESTNAME);\
+	suite_add_tcase(SUITENAME, tc);\
+} while (0)
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+START_TEST(check_chainbuf_add)
+{
+	M_chainbuf_t  *cb = M_chainbuf_create(8);
+	unsigned char *out;
+	size_t         len;
+
+	M_chainbuf_add_str(cb, "abcdef");
+	ck_assert(M_chainbuf_num_chunks(cb) == 1);
+	M_chainbuf_add_str(cb, "ghijklmnop");
+	ck_assert_msg(M_chainbuf_len(cb) == 16, "len %zu != 16", M_chainbuf_len(cb));
+	/* First chunk is filled, the rest is in a chunk sized to fit the remainder. */
+	ck_assert_msg(M_chainbuf_num_chunks(cb) == 2, "chunks %zu != 2", M_chainbuf_num_chunks(cb));
+
+	out = M_chainbuf_finish(cb, &len);
+	ck_assert(len == 16);
+	ck_assert_str_eq((const char *)out, "abcdefghijklmnop");
+	M_free(out);
+}
+END_TEST
+
+START_TEST(check_chainbuf_zero_copy)
+{
+	M_chainbuf_t  *cb = M_chainbuf_create(0);
+	M_buf_t       *buf;
+	M_parser_t    *parser;
+	M_iovec_t      iov[8];
+	size_t         cnt;
+	const char    *ref = "static ";
+
+	parser = M_parser_create_const((const unsigned char *)"parser ", 7, M_PARSER_FLAG_NONE);
+	buf    = M_buf_create();
+	M_buf_add_str(buf, "buf ");
+
+	M_chainbuf_add_str(cb, "copy ");
+	M_chainbuf_add_buf(cb, buf);
+	M_chainbuf_add_bytes_ref(cb, ref, M_str_len(ref), NULL);
+	M_chainbuf_add_parser(cb, parser);
+	M_chainbuf_add_bytes_ref(cb, M_strdup("owned"), 5, M_free);
+
+	cnt = M_chainbuf_iovec(cb, iov, sizeof(iov)/sizeof(*iov));
+	ck_assert_msg(cnt == 5, "iovec count %zu != 5", cnt);
+	ck_assert(iov[2].data == (const unsigned char *)ref);
+	ck_assert(iov[3].data == M_parser_peek(parser));
+
+	/* Limited iovec count returns the leading chunks. */
+	ck_assert(M_chainbuf_iovec(cb, iov, 2) == 2);
+	ck_assert(iov[1].len == 4 && M_mem_eq(iov[1].data, "buf ", 4));
+
+	buf = M_buf_create();
+	M_chainbuf_to_buf(cb, buf);
+	ck_assert_str_eq(M_buf_peek(buf), "copy buf static parser owned");
+	M_buf_cancel(buf);
+
+	M_chainbuf_destroy(cb);
+	M_parser_destroy(parser);
+}
+END_TEST
+
+START_TEST(check_chainbuf_read_drop)
+{
+	M_chainbuf_t        *cb = M_chainbuf_create(4);
+	unsigned char        out[16];
+	const unsigned char *data;
+	size_t               len;
+
+	M_chainbuf_add_str(cb, "abcd");
+	M_chainbuf_add_str(cb, "efgh");
+	M_chainbuf_add_str(cb, "ij");
+	ck_assert(M_chainbuf_num_chunks(cb) == 3);
+
+	/* Reading across a chunk boundary releases the consumed chunk. */
+	ck_assert(M_chainbuf_read(cb, out, 6) == 6);
+	ck_assert(M_mem_eq(out, "abcdef", 6));
+	ck_assert(M_chainbuf_num_chunks(cb) == 2);
+
+	data = M_chainbuf_peek(cb, &len);
+	ck_assert(len == 2 && M_mem_eq(data, "gh", 2));
+
+	M_chainbuf_drop(cb, 3);
+	ck_assert(M_chainbuf_len(cb) == 1);
+	data = M_chainbuf_peek(cb, &len);
+	ck_assert(len == 1 && data[0] == 'j');
+
+	/* Tail still has room so it's kept for writing. */
+	M_chainbuf_drop(cb, 1);
+	ck_assert(M_chainbuf_len(cb) == 0);
+	ck_assert(M_chainbuf_peek(cb, &len) == NULL && len == 0);
+	M_chainbuf_add_str(cb, "k");
+	ck_assert(M_chainbuf_num_chunks(cb) == 1);
+	ck_assert(M_chainbuf_read(cb, out, sizeof(out)) == 1 && out[0] == 'k');
+
+	M_chainbuf_destroy(cb);
+}
+END_TEST
+
+START_TEST(check_chainbuf_direct_write_merge)
+{
+	M_chainbuf_t  *cb  = M_chainbuf_create(16);
+	M_chainbuf_t  *cb2 = M_chainbuf_create(16);
+	unsigned char *ptr;
+	unsigned char *out;
+	size_t         len;
+
+	ptr = M_chainbuf_direct_write_start(cb, &len);
+	ck_assert(ptr != NULL && len == 16);
+	M_mem_copy(ptr, "direct", 6);
+	M_chainbuf_direct_write_end(cb, 6);
+
+	ptr = M_chainbuf_direct_write_start(cb, &len);
+	ck_assert(len == 10);
+	M_chainbuf_direct_write_end(cb, 0);
+
+	M_chainbuf_add_str(cb2, " merged");
+	M_chainbuf_merge(cb, cb2);
+	ck_assert(M_chainbuf_len(cb) == 13);
+
+	out = M_chainbuf_finish(cb, &len);
+	ck_assert_str_eq((const char *)out, "direct merged");
+	M_free(out);
+}
+END_TEST
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+int main(void)
+{
+	Suite   *suite;
+	SRunner *sr;
+	int      nf;
+
+	suite = suite_create("chainbuf");
+
+	add_test(suite, check_chainbuf_add);
+	add_test(suite, check_chainbuf_zero_copy);
+	add_test(suite, check_chainbuf_read_drop);
+	add_test(suite, check_chainbuf_direct_write_merge);
+
+	sr = srunner_create(suite);
+	if (getenv("CK_LOG_FILE_NAME")==NULL) srunner_set_log(sr, "check_chainbuf.log");
+
+	srunner_run_all(sr, CK_NORMAL);
+	nf = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return nf == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -101,6 +101,179 @@ START_TEST(check_ordered_sort)
 }
 END_TEST
 
+START_TEST(check_ordered_insert_open_addressing)
+{
+	check_ordered("A000000003A000000004A000000005A000000025A000000152A000000324A000000333A000000065A000000277A0000000031010A0000000032010A0000000032020A0000000038010A0000000041010A0000000049999A0000000043060A0000000046000A0000000050001A00000002501  A0000000651010A0000001523010A0000002771010A0000003241010A000000333010101A000000333010102A000000333010103A000000333010106", M_HASH_STRVP_KEYS_ORDERED|M_HASH_STRVP_OPEN_ADDRESSING);
+}
+END_TEST
+
+START_TEST(check_open_addressing)
+{
+	M_hash_strvp_t      *d;
+	M_hash_strvp_enum_t *d_enum;
+	const char          *key;
+	void                *val;
+	char                 buf[32];
+	size_t               i;
+	size_t               cnt;
+
+	/* No fill percentage so we'll only grow when completely full. */
+	d = M_hash_strvp_create(4, 0, M_HASH_STRVP_OPEN_ADDRESSING, NULL);
+
+	for (i=0; i<5000; i++) {
+		M_snprintf(buf, sizeof(buf), "key%zu", i);
+		ck_assert_msg(M_hash_strvp_insert(d, buf, (void *)(i+1)), "%zu: insert failed", i);
+	}
+	ck_assert_msg(M_hash_strvp_num_keys(d) == 5000, "num keys %zu != 5000", M_hash_strvp_num_keys(d));
+	ck_assert_msg(M_hash_strvp_size(d) >= 5000, "size %u < 5000", M_hash_strvp_size(d));
+
+	/* Remove every other key which will shift entries back. */
+	for (i=0; i<5000; i+=2) {
+		M_snprintf(buf, sizeof(buf), "key%zu", i);
+		ck_assert_msg(M_hash_strvp_remove(d, buf, M_FALSE), "%zu: remove failed", i);
+	}
+
+	for (i=0; i<5000; i++) {
+		M_snprintf(buf, sizeof(buf), "key%zu", i);
+		if (i % 2 == 0) {
+			ck_assert_msg(!M_hash_strvp_get(d, buf, NULL), "%zu: removed key found", i);
+		} else {
+			ck_assert_msg(M_hash_strvp_get_direct(d, buf) == (void *)(i+1), "%zu: get failed", i);
+		}
+	}
+
+	cnt = 0;
+	M_hash_strvp_enumerate(d, &d_enum);
+	while (M_hash_strvp_enumerate_next(d, d_enum, &key, &val)) {
+		ck_assert_msg(M_hash_strvp_get_direct(d, key) == val, "%s: enumerated value mismatch", key);
+		cnt++;
+	}
+	M_hash_strvp_enumerate_free(d_enum);
+	ck_assert_msg(cnt == 2500, "enumerated %zu != 2500", cnt);
+
+	M_hash_strvp_destroy(d, M_FALSE);
+}
+END_TEST
+
+START_TEST(check_incremental_rehash)
+{
+	M_hash_strvp_t      *d;
+	M_hash_strvp_enum_t *hashenum;
+	M_hash_strvp_t      *seen;
+	const char          *key;
+	void                *val;
+	char                 temp[32];
+	size_t               i;
+	size_t               j;
+	size_t               cnt;
+
+	d = M_hash_strvp_create(16, 75, M_HASH_STRVP_INCREMENTAL_REHASH, NULL);
+
+	for (i=0; i<2000; i++) {
+		M_snprintf(temp, sizeof(temp), "key%zu", i);
+		ck_assert(M_hash_strvp_insert(d, temp, (void *)(i+1)));
+
+		/* Remove every third key so removal happens while buckets are being moved. */
+		if (i % 3 == 2) {
+			M_snprintf(temp, sizeof(temp), "key%zu", i-1);
+			ck_assert_msg(M_hash_strvp_remove(d, temp, M_FALSE), "%s not removed", temp);
+		}
+
+		/* Every key must be reachable no matter which bucket list it's in. */
+		for (j=0; j<=i; j++) {
+			M_snprintf(temp, sizeof(temp), "key%zu", j);
+			if (j % 3 == 1 && j < i) {
+				ck_assert_msg(!M_hash_strvp_get(d, temp, NULL), "%zu: %s found after remove", i, temp);
+			} else {
+				ck_assert_msg(M_hash_strvp_get(d, temp, &val) && val == (void *)(j+1), "%zu: %s not found", i, temp);
+			}
+		}
+
+		/* Enumeration covers both bucket lists and returns each key once. */
+		seen = M_hash_strvp_create(16, 75, M_HASH_STRVP_NONE, NULL);
+		cnt  = 0;
+		M_hash_strvp_enumerate(d, &hashenum);
+		while (M_hash_strvp_enumerate_next(d, hashenum, &key, NULL)) {
+			ck_assert_msg(!M_hash_strvp_get(seen, key, NULL), "%zu: %s enumerated twice", i, key);
+			M_hash_strvp_insert(seen, key, NULL);
+			cnt++;
+		}
+		M_hash_strvp_enumerate_free(hashenum);
+		M_hash_strvp_destroy(seen, M_FALSE);
+		ck_assert_msg(cnt == M_hash_strvp_num_keys(d), "%zu: enumerated %zu != %zu", i, cnt, M_hash_strvp_num_keys(d));
+	}
+
+	ck_assert_msg(M_hash_strvp_num_expansions(d) == 7, "expansions %zu != 7", M_hash_strvp_num_expansions(d));
+
+	M_hash_strvp_destroy(d, M_FALSE);
+}
+END_TEST
+
+START_TEST(check_many)
+{
+	M_hash_strvp_t  *d;
+	char           **keys;
+	void           **vals;
+	M_bool          *found;
+	M_uint32         flags[] = { M_HASH_STRVP_NONE, M_HASH_STRVP_OPEN_ADDRESSING, M_HASH_STRVP_CASECMP|M_HASH_STRVP_KEYS_ORDERED };
+	size_t           i;
+	size_t           j;
+
+	keys  = M_malloc(sizeof(*keys) * 5000);
+	vals  = M_malloc(sizeof(*vals) * 5000);
+	found = M_malloc(sizeof(*found) * 5000);
+	for (i=0; i<5000; i++) {
+		M_asprintf(&keys[i], "key%zu", i);
+		vals[i] = (void *)(i+1);
+	}
+
+	for (j=0; j<sizeof(flags)/sizeof(*flags); j++) {
+		d = M_hash_strvp_create(16, 75, flags[j], NULL);
+
+		/* Bulk load only grows the table once. */
+		ck_assert_msg(M_hash_strvp_insert_many(d, (const char * const *)keys, vals, 4000) == 4000, "%zu: insert_many failed", j);
+		ck_assert_msg(M_hash_strvp_num_expansions(d) == 1, "%zu: expansions %zu != 1", j, M_hash_strvp_num_expansions(d));
+		ck_assert_msg(M_hash_strvp_num_keys(d) == 4000, "%zu: num keys %zu != 4000", j, M_hash_strvp_num_keys(d));
+
+		/* Looking up includes keys that were never inserted. */
+		ck_assert_msg(M_hash_strvp_get_many(d, (const char * const *)keys, 5000, vals, found) == 4000, "%zu: get_many count wrong", j);
+		for (i=0; i<5000; i++) {
+			if (i < 4000) {
+				ck_assert_msg(found[i] && vals[i] == (void *)(i+1), "%zu: %s not found", j, keys[i]);
+				ck_assert_msg(M_hash_strvp_get_direct(d, keys[i]) == (void *)(i+1), "%zu: %s get failed", j, keys[i]);
+			} else {
+				ck_assert_msg(!found[i] && vals[i] == NULL, "%zu: %s found", j, keys[i]);
+			}
+		}
+
+		ck_assert_msg(M_hash_strvp_remove_many(d, (const char * const *)keys, 5000, M_FALSE) == 4000, "%zu: remove_many count wrong", j);
+		ck_assert_msg(M_hash_strvp_num_keys(d) == 0, "%zu: keys left after remove_many", j);
+		ck_assert_msg(M_hash_strvp_get_many(d, (const char * const *)keys, 5000, NULL, NULL) == 0, "%zu: keys found after remove_many", j);
+
+		M_hash_strvp_destroy(d, M_FALSE);
+
+		for (i=0; i<5000; i++)
+			vals[i] = (void *)(i+1);
+	}
+
+	/* Empty and NULL keys are skipped. */
+	d          = M_hash_strvp_create(16, 75, M_HASH_STRVP_NONE, NULL);
+	keys[0][0] = '\0';
+	M_free(keys[1]);
+	keys[1] = NULL;
+	ck_assert(M_hash_strvp_insert_many(d, (const char * const *)keys, NULL, 10) == 8);
+	ck_assert(M_hash_strvp_get(d, "key2", &vals[0]) && vals[0] == NULL);
+	ck_assert(!M_hash_strvp_get(d, "", NULL));
+	M_hash_strvp_destroy(d, M_FALSE);
+
+	for (i=0; i<5000; i++)
+		M_free(keys[i]);
+	M_free(keys);
+	M_free(vals);
+	M_free(found);
+}
+END_TEST
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 Suite *M_hash_strvp_suite(void)
@@ -108,6 +281,10 @@ Suite *M_hash_strvp_suite(void)
 	Suite *suite = suite_create("hash_strvp");
 	TCase *tc_ordered_insert;
 	TCase *tc_ordered_sort;
+	TCase *tc_ordered_insert_open_addressing;
+	TCase *tc_open_addressing;
+	TCase *tc_many;
+	TCase *tc_incremental_rehash;
 
 	tc_ordered_insert = tcase_create("hash_strvp_ordered_insert");
 	tcase_add_unchecked_fixture(tc_ordered_insert, NULL, NULL);
@@ -119,6 +296,26 @@ Suite *M_hash_strvp_suite(void)
 	tcase_add_test(tc_ordered_sort, check_ordered_sort);
 	suite_add_tcase(suite, tc_ordered_sort);
 
+	tc_ordered_insert_open_addressing = tcase_create("hash_strvp_ordered_insert_open_addressing");
+	tcase_add_unchecked_fixture(tc_ordered_insert_open_addressing, NULL, NULL);
+	tcase_add_test(tc_ordered_insert_open_addressing, check_ordered_insert_open_addressing);
+	suite_add_tcase(suite, tc_ordered_insert_open_addressing);
+
+	tc_open_addressing = tcase_create("hash_strvp_open_addressing");
+	tcase_add_unchecked_fixture(tc_open_addressing, NULL, NULL);
+	tcase_add_test(tc_open_addressing, check_open_addressing);
+	suite_add_tcase(suite, tc_open_addressing);
+
+	tc_many = tcase_create("hash_strvp_many");
+	tcase_add_unchecked_fixture(tc_many, NULL, NULL);
+	tcase_add_test(tc_many, check_many);
+	suite_add_tcase(suite, tc_many);
+
+	tc_incremental_rehash = tcase_create("hash_strvp_incremental_rehash");
+	tcase_add_unchecked_fixture(tc_incremental_rehash, NULL, NULL);
+	tcase_add_test(tc_incremental_rehash, check_incremental_rehash);
+	suite_add_tcase(suite, tc_incremental_rehash);
+
 	return suite;
 }
 
@@ -0,0 +1,299 @@
+#include "m_config.h"
+#include <stdlib.h>
+#include <check.h>
+
+#include <mstdlib/mstdlib.h>
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define NUM_KEYS   4096
+#define NUM_ROUNDS 200
+
+static const char *key_prefixes[] = {
+	"Content-Type",
+	"X-Forwarded-For-Original-Client-Address",
+	"transaction_reference_identifier_for_settlement_batch_reconciliation",
+	NULL
+};
+
+typedef struct {
+	const char            *name;
+	M_hashtable_hash_func  str_hash;
+	M_hashtable_hash_func  u64_hash;
+} hash_type_t;
+
+static const hash_type_t hash_types[] = {
+	{ "FNV1a",  M_hash_func_hash_str,        M_hash_func_hash_u64        },
+	{ "wyhash", M_hash_func_hash_str_wyhash, M_hash_func_hash_u64_wyhash },
+	{ NULL, NULL, NULL }
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+START_TEST(check_wyhash_casecmp)
+{
+	const char *keys[][2] = {
+		{ "",                                                      ""                                                      },
+		{ "A",                                                     "a"                                                     },
+		{ "AbC",                                                   "abc"                                                   },
+		{ "Content-Type",                                          "content-type"                                          },
+		{ "X-FORWARDED-FOR",                                       "x-forwarded-for"                                       },
+		{ "Some[Key]@With`Symbols{Z}",                             "some[key]@with`symbols{z}"                             },
+		{ "A_VERY_LONG_KEY_THAT_GOES_PAST_THE_48_BYTE_BLOCK_SIZE", "a_very_long_key_that_goes_past_the_48_byte_block_size" },
+		{ NULL, NULL }
+	};
+	size_t i;
+
+	for (i=0; keys[i][0] != NULL; i++) {
+		ck_assert_msg(M_hash_func_hash_str_casecmp_wyhash(keys[i][0], 1234) == M_hash_func_hash_str_wyhash(keys[i][1], 1234),
+			"%s: casecmp hash does not match lower case hash", keys[i][0]);
+		ck_assert_msg(M_hash_func_hash_str_casecmp_wyhash(keys[i][0], 1234) == M_hash_func_hash_str_casecmp_wyhash(keys[i][1], 1234),
+			"%s: casecmp hash does not match", keys[i][0]);
+	}
+
+	/* Symbols next to the letter ranges must not be folded. */
+	ck_assert_msg(M_hash_func_hash_str_casecmp_wyhash("@[", 1) != M_hash_func_hash_str_casecmp_wyhash("`{", 1), "@[ and `{ hashed the same");
+}
+END_TEST
+
+START_TEST(check_wyhash_bulk)
+{
+	M_uint64     ukeys[64];
+	const void  *pkeys[64];
+	M_uint32     hashes[64];
+	size_t       i;
+
+	for (i=0; i<64; i++) {
+		ukeys[i] = (M_uint64)i * 0x9E3779B97F4A7C15ULL;
+		pkeys[i] = &ukeys[i];
+	}
+
+	M_hash_func_hash_u64_bulk_wyhash(ukeys, 64, 99, hashes);
+	for (i=0; i<64; i++)
+		ck_assert_msg(hashes[i] == M_hash_func_hash_u64_wyhash(&ukeys[i], 99), "%zu: u64 bulk hash mismatch", i);
+
+	M_hash_func_hash_bulk(M_hash_func_hash_u64_wyhash, pkeys, 64, 99, hashes);
+	for (i=0; i<64; i++)
+		ck_assert_msg(hashes[i] == M_hash_func_hash_u64_wyhash(&ukeys[i], 99), "%zu: bulk hash mismatch", i);
+
+	M_hash_func_hash_bulk(M_hash_func_hash_vp_wyhash, pkeys, 64, 99, hashes);
+	for (i=0; i<64; i++)
+		ck_assert_msg(hashes[i] == M_hash_func_hash_vp_wyhash(pkeys[i], 99), "%zu: vp bulk hash mismatch", i);
+
+	M_hash_func_hash_bulk(M_hash_func_hash_u64, pkeys, 64, 99, hashes);
+	for (i=0; i<64; i++)
+		ck_assert_msg(hashes[i] == M_hash_func_hash_u64(&ukeys[i], 99), "%zu: FNV1a bulk hash mismatch", i);
+}
+END_TEST
+
+START_TEST(check_default_type)
+{
+	M_hash_strvp_t *h;
+	char            buf[32];
+	size_t          i;
+
+	ck_assert_msg(M_hash_func_get_default_type() == M_HASH_FUNC_TYPE_FNV1A, "FNV1a is not the default");
+	ck_assert_msg(M_hash_func_default_str(M_FALSE) == M_hash_func_hash_str, "wrong default str hash");
+
+	M_hash_func_set_default_type(M_HASH_FUNC_TYPE_WYHASH);
+	ck_assert_msg(M_hash_func_default_str(M_TRUE) == M_hash_func_hash_str_casecmp_wyhash, "wrong default casecmp str hash");
+	ck_assert_msg(M_hash_func_default_u64() == M_hash_func_hash_u64_wyhash, "wrong default u64 hash");
+
+	h = M_hash_strvp_create(8, 75, M_HASH_STRVP_CASECMP, NULL);
+	M_hash_func_set_default_type(M_HASH_FUNC_TYPE_FNV1A);
+
+	/* Changing the default must not affect an existing table. */
+	for (i=0; i<500; i++) {
+		M_snprintf(buf, sizeof(buf), "Key%zu", i);
+		M_hash_strvp_insert(h, buf, (void *)(i+1));
+	}
+	for (i=0; i<500; i++) {
+		M_snprintf(buf, sizeof(buf), "KEY%zu", i);
+		ck_assert_msg(M_hash_strvp_get_direct(h, buf) == (void *)(i+1), "%s: get failed", buf);
+	}
+
+	M_hash_strvp_destroy(h, M_FALSE);
+}
+END_TEST
+
+START_TEST(check_hashspeed)
+{
+	char          **str_keys;
+	M_uint64       *u64_keys;
+	const void    **u64_key_ptrs;
+	M_uint32       *hashes;
+	M_timeval_t     tv;
+	M_uint64        elapsed;
+	M_uint32        sum;
+	size_t          i;
+	size_t          j;
+	size_t          r;
+
+	str_keys     = M_malloc_zero(sizeof(*str_keys) * NUM_KEYS);
+	u64_keys     = M_malloc_zero(sizeof(*u64_keys) * NUM_KEYS);
+	u64_key_ptrs = M_malloc_zero(sizeof(*u64_key_ptrs) * NUM_KEYS);
+	hashes       = M_malloc_zero(sizeof(*hashes) * NUM_KEYS);
+
+	for (i=0; i<NUM_KEYS; i++) {
+		u64_keys[i]     = M_rand_range(NULL, 0, M_UINT64_MAX);
+		u64_key_ptrs[i] = &u64_keys[i];
+	}
+
+	for (j=0; key_prefixes[j] != NULL; j++) {
+		for (i=0; i<NUM_KEYS; i++) {
+			M_free(str_keys[i]);
+			M_asprintf(&str_keys[i], "%s-%zu", key_prefixes[j], i);
+		}
+
+		for (i=0; hash_types[i].name != NULL; i++) {
+			sum = 0;
+			M_time_elapsed_start(&tv);
+			for (r=0; r<NUM_ROUNDS; r++) {
+				M_hash_func_hash_bulk(hash_types[i].str_hash, (const void * const *)str_keys, NUM_KEYS, (M_uint32)r, hashes);
+				sum ^= hashes[r % NUM_KEYS];
+			}
+			elapsed = M_time_elapsed(&tv);
+			M_printf("%-6s str  (%3zu bytes): %llu ms (%08x)\n", hash_types[i].name, M_str_len(str_keys[0]), elapsed, sum);
+		}
+	}
+
+	for (i=0; hash_types[i].name != NULL; i++) {
+		sum = 0;
+		M_time_elapsed_start(&tv);
+		for (r=0; r<NUM_ROUNDS*10; r++) {
+			M_hash_func_hash_bulk(hash_types[i].u64_hash, u64_key_ptrs, NUM_KEYS, (M_uint32)r, hashes);
+			sum ^= hashes[r % NUM_KEYS];
+		}
+		elapsed = M_time_elapsed(&tv);
+		M_printf("%-6s u64            : %llu ms (%08x)\n", hash_types[i].name, elapsed, sum);
+	}
+
+	sum = 0;
+	M_time_elapsed_start(&tv);
+	for (r=0; r<NUM_ROUNDS*10; r++) {
+		M_hash_func_hash_u64_bulk_wyhash(u64_keys, NUM_KEYS, (M_uint32)r, hashes);
+		sum ^= hashes[r % NUM_KEYS];
+	}
+	elapsed = M_time_elapsed(&tv);
+	M_printf("wyhash u64 array      : %llu ms (%08x)\n", elapsed, sum);
+
+	for (i=0; i<NUM_KEYS; i++)
+		M_free(str_keys[i]);
+	M_free(str_keys);
+	M_free(u64_keys);
+	M_free(u64_key_ptrs);
+	M_free(hashes);
+}
+END_TEST
+
+START_TEST(check_u64vp_many)
+{
+	M_hash_u64vp_t  *h;
+	M_rand_t        *rand;
+	M_uint64        *keys;
+	void           **vals;
+	M_timeval_t      tv;
+	M_uint64         elapsed;
+	size_t           num_keys = 1000000;
+	size_t           i;
+
+	rand = M_rand_create(0);
+	keys = M_malloc(sizeof(*keys) * num_keys);
+	vals = M_malloc(sizeof(*vals) * num_keys);
+	for (i=0; i<num_keys; i++) {
+		/* Odd multiplier keeps the keys unique. */
+		keys[i] = (M_uint64)(i+1) * 0x9E3779B97F4A7C15ULL;
+		vals[i] = (void *)(i+1);
+	}
+
+	h = M_hash_u64vp_create(16, 75, M_HASH_U64VP_NONE, NULL);
+	M_time_elapsed_start(&tv);
+	ck_assert(M_hash_u64vp_insert_many(h, keys, vals, num_keys) == num_keys);
+	elapsed = M_time_elapsed(&tv);
+	ck_assert_msg(M_hash_u64vp_num_expansions(h) == 1, "expansions %zu != 1", M_hash_u64vp_num_expansions(h));
+	M_printf("u64vp insert_many    : %llu ms\n", elapsed);
+
+	/* Shuffle the lookup order so each lookup is a cache miss. */
+	for (i=num_keys-1; i>0; i--) {
+		size_t   j   = (size_t)M_rand_range(rand, 0, i+1);
+		M_uint64 tmp = keys[i];
+		keys[i]      = keys[j];
+		keys[j]      = tmp;
+	}
+
+	M_time_elapsed_start(&tv);
+	for (i=0; i<num_keys; i++)
+		ck_assert(M_hash_u64vp_get(h, keys[i], NULL));
+	elapsed = M_time_elapsed(&tv);
+	M_printf("u64vp get            : %llu ms\n", elapsed);
+
+	M_time_elapsed_start(&tv);
+	ck_assert(M_hash_u64vp_get_many(h, keys, num_keys, vals, NULL) == num_keys);
+	elapsed = M_time_elapsed(&tv);
+	M_printf("u64vp get_many       : %llu ms\n", elapsed);
+
+	for (i=0; i<num_keys; i++)
+		ck_assert(M_hash_u64vp_get_direct(h, keys[i]) == vals[i]);
+
+	ck_assert(M_hash_u64vp_remove_many(h, keys, num_keys/2, M_FALSE) == num_keys/2);
+	ck_assert(M_hash_u64vp_num_keys(h) == num_keys - num_keys/2);
+	ck_assert(M_hash_u64vp_get_many(h, keys, num_keys, NULL, NULL) == num_keys - num_keys/2);
+
+	M_hash_u64vp_destroy(h, M_FALSE);
+	M_rand_destroy(rand);
+	M_free(keys);
+	M_free(vals);
+}
+END_TEST
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static Suite *hashspeed_suite(void)
+{
+	Suite *suite;
+	TCase *tc;
+
+	suite = suite_create("hashspeed");
+
+	tc = tcase_create("wyhash_casecmp");
+	tcase_add_test(tc, check_wyhash_casecmp);
+	suite_add_tcase(suite, tc);
+
+	tc = tcase_create("wyhash_bulk");
+	tcase_add_test(tc, check_wyhash_bulk);
+	suite_add_tcase(suite, tc);
+
+	tc = tcase_create("default_type");
+	tcase_add_test(tc, check_default_type);
+	suite_add_tcase(suite, tc);
+
+	tc = tcase_create("u64vp_many");
+	tcase_add_test(tc, check_u64vp_many);
+	tcase_set_timeout(tc, 60);
+	suite_add_tcase(suite, tc);
+
+	tc = tcase_create("hashspeed");
+	tcase_add_test(tc, check_hashspeed);
+	tcase_set_timeout(tc, 60);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
+
+int main(int argc, char **argv)
+{
+	SRunner *sr;
+	int      nf;
+
+	(void)argc;
+	(void)argv;
+
+	sr = srunner_create(hashspeed_suite());
+	if (getenv("CK_LOG_FILE_NAME")==NULL) srunner_set_log(sr, "check_hashspeed.log");
+
+	srunner_run_all(sr, CK_NORMAL);
+	nf = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return nf == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,200 @@
+#include "m_config.h"
+#include <stdlib.h>
+#include <check.h>
+
+#include <mstdlib/mstdlib.h>
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+START_TEST(check_arena_alloc)
+{
+	M_arena_t *arena;
+	char      *ptrs[256];
+	size_t     mark;
+	size_t     i;
+
+	arena = M_arena_create(1024);
+	ck_assert(M_arena_alloc(arena, 0) == NULL);
+
+	for (i=0; i<256; i++) {
+		ptrs[i] = M_arena_alloc(arena, i+1);
+		ck_assert_msg(ptrs[i] != NULL, "%zu: alloc failed", i);
+		ck_assert_msg(((size_t)ptrs[i] & (sizeof(void *)-1)) == 0, "%zu: pointer not aligned", i);
+		M_mem_set(ptrs[i], (int)i, i+1);
+	}
+	for (i=0; i<256; i++) {
+		ck_assert_msg(M_mem_count(ptrs[i], i+1, (M_uint8)i) == i+1, "%zu: data overwritten", i);
+	}
+	ck_assert(M_arena_used(arena) <= M_arena_capacity(arena));
+
+	/* Freeing arena memory does nothing. */
+	for (i=0; i<256; i++)
+		M_free(ptrs[i]);
+
+	/* Larger than a block. */
+	ptrs[0] = M_arena_alloc(arena, 4096);
+	ck_assert(ptrs[0] != NULL);
+	M_mem_set(ptrs[0], 'a', 4096);
+
+	mark    = M_arena_mark(arena);
+	ptrs[1] = M_arena_alloc(arena, 100);
+	for (i=0; i<100; i++)
+		M_arena_alloc(arena, 100);
+	ck_assert(M_arena_mark(arena) > mark);
+	M_arena_reset_mark(arena, mark);
+	ck_assert(M_arena_mark(arena) == mark);
+	ck_assert(M_mem_count(ptrs[0], 4096, 'a') == 4096);
+	ck_assert(M_arena_alloc(arena, 100) == ptrs[1]);
+
+	M_arena_reset(arena);
+	ck_assert(M_arena_used(arena) == 0);
+	ck_assert(M_arena_mark(arena) == 0);
+	ck_assert(M_arena_alloc(arena, 16) != NULL);
+
+	M_arena_destroy(arena);
+}
+END_TEST
+
+START_TEST(check_arena_realloc)
+{
+	M_arena_t *arena;
+	char      *ptr;
+	char      *ptr2;
+	char      *other;
+
+	arena = M_arena_create(0);
+
+	/* Most recent allocation grows in place. */
+	ptr = M_arena_alloc(arena, 8);
+	M_mem_copy(ptr, "abcdefg", 8);
+	ptr2 = M_realloc_zero(ptr, 100);
+	ck_assert(ptr2 == ptr);
+	ck_assert_str_eq(ptr2, "abcdefg");
+	ck_assert(M_mem_count(ptr2+8, 92, 0) == 92);
+
+	/* Not the most recent allocation so it must move, but stay in the arena. */
+	other = M_arena_alloc(arena, 8);
+	ptr   = M_realloc(ptr2, 200);
+	ck_assert(ptr != ptr2);
+	ck_assert_str_eq(ptr, "abcdefg");
+	ck_assert(M_arena_mark(arena) > 200);
+
+	/* Grow past the block size. */
+	ptr2 = M_realloc(ptr, 256*1024);
+	ck_assert(ptr2 != NULL);
+	ck_assert_str_eq(ptr2, "abcdefg");
+
+	ck_assert(M_realloc(other, 0) == NULL);
+
+	M_arena_destroy(arena);
+}
+END_TEST
+
+START_TEST(check_arena_push)
+{
+	M_arena_t      *arena;
+	M_arena_t      *arena2;
+	M_buf_t        *buf;
+	M_list_str_t   *list;
+	M_hash_strvp_t *hash;
+	M_hash_dict_t  *dict;
+	char           *str;
+	char            key[32];
+	size_t          mark;
+	size_t          i;
+
+	arena  = M_arena_create(4096);
+	arena2 = M_arena_create(0);
+
+	ck_assert(M_arena_active() == NULL);
+	ck_assert(M_arena_pop() == NULL);
+	ck_assert(M_arena_push(arena));
+	ck_assert(!M_arena_push(arena));
+	ck_assert(M_arena_active() == arena);
+
+	buf  = M_buf_create();
+	list = M_list_str_create(M_LIST_STR_SORTASC);
+	hash = M_hash_strvp_create(8, 75, M_HASH_STRVP_NONE, NULL);
+	dict = M_hash_dict_create(8, 75, M_HASH_DICT_NONE);
+	for (i=0; i<2000; i++) {
+		M_snprintf(key, sizeof(key), "key%zu", i);
+		M_buf_add_str(buf, key);
+		M_list_str_insert(list, key);
+		M_hash_strvp_insert(hash, key, buf);
+		M_hash_dict_insert(dict, key, key);
+	}
+
+	/* Nested arenas. */
+	ck_assert(M_arena_push(arena2));
+	str = M_strdup("arena2");
+	ck_assert(M_arena_pop() == arena2);
+	ck_assert(M_arena_mark(arena2) > 0);
+	ck_assert_str_eq(str, "arena2");
+
+	ck_assert(M_arena_pop() == arena);
+	ck_assert(M_arena_active() == NULL);
+
+	/* Objects created inside the arena are still usable after popping. */
+	ck_assert(M_buf_len(buf) > 2000);
+	ck_assert(M_list_str_len(list) == 2000);
+	ck_assert(M_hash_strvp_get_direct(hash, "key1999") == buf);
+	ck_assert_str_eq(M_hash_dict_get_direct(dict, "key10"), "key10");
+
+	/* Destroying an object is allowed, everything else is released with the arena. */
+	M_list_str_destroy(list);
+	M_arena_destroy(arena);
+
+	/* Memory allocated while no arena is pushed comes from the heap. */
+	mark = M_arena_mark(arena2);
+	str  = M_strdup("heap");
+	ck_assert(M_arena_mark(arena2) == mark);
+	M_free(str);
+
+	/* Destroying a pushed arena pops it. */
+	M_arena_push(arena2);
+	M_arena_destroy(arena2);
+	ck_assert(M_arena_active() == NULL);
+}
+END_TEST
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static Suite *arena_suite(void)
+{
+	Suite *suite;
+	TCase *tc;
+
+	suite = suite_create("arena");
+
+	tc = tcase_create("arena_alloc");
+	tcase_add_test(tc, check_arena_alloc);
+	suite_add_tcase(suite, tc);
+
+	tc = tcase_create("arena_realloc");
+	tcase_add_test(tc, check_arena_realloc);
+	suite_add_tcase(suite, tc);
+
+	tc = tcase_create("arena_push");
+	tcase_add_test(tc, check_arena_push);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
+
+int main(int argc, char **argv)
+{
+	SRunner *sr;
+	int      nf;
+
+	(void)argc;
+	(void)argv;
+
+	sr = srunner_create(arena_suite());
+	if (getenv("CK_LOG_FILE_NAME")==NULL) srunner_set_log(sr, "check_arena.log");
+
+	srunner_run_all(sr, CK_NORMAL);
+	nf = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return nf == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,159 @@
+#include "m_config.h"
+#include <stdlib.h>
+#include <check.h>
+
+#include <mstdlib/mstdlib.h>
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+START_TEST(check_mempool_reuse)
+{
+	M_mempool_stats_t  stats;
+	M_mempool_stats_t  stats2;
+	char              *ptrs[64];
+	char              *ptr;
+	size_t             i;
+
+	M_mempool_thread_flush();
+	M_mempool_thread_stats(&stats);
+	ck_assert(stats.resident_bytes == 0);
+
+	for (i=0; i<64; i++) {
+		ptrs[i] = M_mempool_malloc(24);
+		ck_assert(ptrs[i] != NULL);
+		M_mem_set(ptrs[i], 'a', 24);
+	}
+	for (i=0; i<64; i++)
+		M_free(ptrs[i]);
+
+	M_mempool_thread_stats(&stats2);
+	ck_assert(stats2.misses - stats.misses == 64);
+	ck_assert(stats2.resident_bytes >= 64 * 24);
+
+	/* Same size class is served from the free list. */
+	ptr = M_mempool_malloc_zero(20);
+	ck_assert(M_mem_count(ptr, 20, 0) == 20);
+	M_mempool_thread_stats(&stats);
+	ck_assert(stats.hits - stats2.hits == 1);
+
+	/* Pool memory can be reallocated like any other. */
+	M_mem_copy(ptr, "abc", 4);
+	ptr = M_realloc(ptr, 1024);
+	ck_assert_str_eq(ptr, "abc");
+	M_free(ptr);
+
+	/* Larger than the pool handles. */
+	ptr = M_mempool_malloc(M_MEMPOOL_MAX_SIZE+1);
+	ck_assert(ptr != NULL);
+	M_free(ptr);
+	ck_assert(M_mempool_malloc(0) == NULL);
+
+	M_mempool_thread_flush();
+	M_mempool_thread_stats(&stats);
+	ck_assert(stats.resident_bytes == 0);
+	ck_assert(stats.released > 0);
+}
+END_TEST
+
+START_TEST(check_mempool_trim)
+{
+	M_mempool_stats_t   stats;
+	void              **ptrs;
+	size_t              i;
+
+	M_mempool_thread_flush();
+
+	ptrs = M_malloc(sizeof(*ptrs) * 10000);
+	for (i=0; i<10000; i++)
+		ptrs[i] = M_mempool_malloc(64);
+	for (i=0; i<10000; i++)
+		M_free(ptrs[i]);
+	M_free(ptrs);
+
+	/* A thread only holds on to a limited number of free objects. */
+	M_mempool_thread_stats(&stats);
+	ck_assert(stats.resident_bytes < 10000 * 64);
+
+	M_mempool_thread_flush();
+}
+END_TEST
+
+START_TEST(check_mempool_containers)
+{
+	M_mempool_stats_t  stats;
+	M_mempool_stats_t  stats2;
+	M_llist_str_t     *list;
+	M_hash_u64str_t   *hash;
+	M_arena_t         *arena;
+	size_t             i;
+
+	M_mempool_thread_stats(&stats);
+	list = M_llist_str_create(M_LLIST_STR_NONE);
+	hash = M_hash_u64str_create(16, 75, M_HASH_U64STR_NONE);
+	for (i=0; i<100; i++) {
+		M_llist_str_insert(list, "a");
+		M_hash_u64str_insert(hash, i, "a");
+	}
+	M_llist_str_destroy(list);
+	M_hash_u64str_destroy(hash);
+
+	/* Nodes were returned to the pool. */
+	M_mempool_thread_stats(&stats2);
+	ck_assert(stats2.resident_bytes > stats.resident_bytes);
+
+	/* Pool allocations come from the arena while one is pushed. */
+	arena = M_arena_create(0);
+	M_arena_push(arena);
+	list = M_llist_str_create(M_LLIST_STR_NONE);
+	M_llist_str_insert(list, "a");
+	M_arena_pop();
+	M_mempool_thread_stats(&stats);
+	ck_assert(stats.hits == stats2.hits);
+	ck_assert(stats.misses == stats2.misses);
+	M_arena_destroy(arena);
+
+	M_mempool_thread_flush();
+}
+END_TEST
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static Suite *mempool_suite(void)
+{
+	Suite *suite;
+	TCase *tc;
+
+	suite = suite_create("mempool");
+
+	tc = tcase_create("mempool_reuse");
+	tcase_add_test(tc, check_mempool_reuse);
+	suite_add_tcase(suite, tc);
+
+	tc = tcase_create("mempool_trim");
+	tcase_add_test(tc, check_mempool_trim);
+	suite_add_tcase(suite, tc);
+
+	tc = tcase_create("mempool_containers");
+	tcase_add_test(tc, check_mempool_containers);
+	suite_add_tcase(suite, tc);
+
+	return suite;
+}
+
+int main(int argc, char **argv)
+{
+	SRunner *sr;
+	int      nf;
+
+	(void)argc;
+	(void)argv;
+
+	sr = srunner_create(mempool_suite());
+	if (getenv("CK_LOG_FILE_NAME")==NULL) srunner_set_log(sr, "check_mempool.log");
+
+	srunner_run_all(sr, CK_NORMAL);
+	nf = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return nf == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
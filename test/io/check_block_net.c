@@ -226,10 +226,97 @@ END_TEST
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+#define WRITEV_SEGMENTS 40
+
+/* Loop 0 writes directly to the net layer, loop 1 goes through a layer without
+ * vectored write support. */
+START_TEST(check_block_net_writev)
+{
+	M_io_t         *netserver = NULL;
+	M_io_t         *client    = NULL;
+	M_io_t         *conn      = NULL;
+	M_chainbuf_t   *cb;
+	M_buf_t        *expected;
+	M_buf_t        *received;
+	unsigned char   big[20000];
+	unsigned char   buf[4096];
+	char            seg[32];
+	M_iovec_t       iov[3];
+	size_t          len;
+	size_t          i;
+	M_io_error_t    err;
+	M_timeval_t     tv;
+
+	dns = M_dns_create(NULL);
+	ck_assert(M_io_net_server_create(&netserver, 0, "127.0.0.1", M_IO_NET_ANY) == M_IO_ERROR_SUCCESS);
+	ck_assert(M_io_net_client_create(&client, dns, "127.0.0.1", M_io_net_get_port(netserver), M_IO_NET_ANY) == M_IO_ERROR_SUCCESS);
+	if (_i == 1)
+		ck_assert(M_io_add_bwshaping(client, NULL) == M_IO_ERROR_SUCCESS);
+	ck_assert(M_io_block_connect(client) == M_IO_ERROR_SUCCESS);
+	ck_assert(M_io_block_accept(&conn, netserver, 5000) == M_IO_ERROR_SUCCESS);
+
+	expected = M_buf_create();
+	received = M_buf_create();
+
+	/* Empty segments are skipped */
+	iov[0].data = (const unsigned char *)"";
+	iov[0].len  = 0;
+	iov[1].data = (const unsigned char *)"hello ";
+	iov[1].len  = 6;
+	iov[2].data = (const unsigned char *)"world";
+	iov[2].len  = 5;
+	ck_assert(M_io_writev(client, iov, 3, &len) == M_IO_ERROR_SUCCESS);
+	ck_assert_msg(len == 11, "wrote %zu", len);
+	M_buf_add_str(expected, "hello world");
+	ck_assert(M_io_writev(client, iov, 1, &len) == M_IO_ERROR_INVALID);
+
+	/* Many small segments plus one larger than the coalescing buffer */
+	cb = M_chainbuf_create(16);
+	for (i=0; i<WRITEV_SEGMENTS; i++) {
+		M_snprintf(seg, sizeof(seg), "segment %zu;", i);
+		M_chainbuf_add_str(cb, seg);
+		M_buf_add_str(expected, seg);
+	}
+	M_mem_set(big, 'B', sizeof(big));
+	M_chainbuf_add_bytes_ref(cb, big, sizeof(big), NULL);
+	M_buf_add_bytes(expected, big, sizeof(big));
+
+	M_time_elapsed_start(&tv);
+	while (M_chainbuf_len(cb) != 0 && M_time_elapsed(&tv) < 5000) {
+		err = M_io_write_from_chainbuf(client, cb);
+		ck_assert_msg(err == M_IO_ERROR_SUCCESS || err == M_IO_ERROR_WOULDBLOCK, "write failed: %s", M_io_error_string(err));
+
+		/* Drain the server side so the client never stalls on a full socket */
+		if (M_io_block_read(conn, buf, sizeof(buf), &len, 10) == M_IO_ERROR_SUCCESS)
+			M_buf_add_bytes(received, buf, len);
+	}
+	ck_assert_msg(M_chainbuf_len(cb) == 0, "%zu bytes left unwritten", M_chainbuf_len(cb));
+
+	while (M_buf_len(received) < M_buf_len(expected) && M_time_elapsed(&tv) < 5000) {
+		if (M_io_block_read(conn, buf, sizeof(buf), &len, 100) == M_IO_ERROR_SUCCESS)
+			M_buf_add_bytes(received, buf, len);
+	}
+	ck_assert_msg(M_buf_len(received) == M_buf_len(expected), "received %zu of %zu bytes", M_buf_len(received), M_buf_len(expected));
+	ck_assert_msg(M_mem_eq(M_buf_peek(received), M_buf_peek(expected), M_buf_len(expected)), "data mismatch");
+
+	M_chainbuf_destroy(cb);
+	M_buf_cancel(received);
+	M_buf_cancel(expected);
+	M_io_destroy(conn);
+	M_io_destroy(client);
+	M_io_destroy(netserver);
+	M_dns_destroy(dns);
+	M_library_cleanup();
+}
+END_TEST
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
 static Suite *block_net_suite(void)
 {
 	Suite *suite;
 	TCase *tc_block_net;
+	TCase *tc_block_net_writev;
 
 	suite = suite_create("block_net");
 
@@ -238,6 +325,10 @@ static Suite *block_net_suite(void)
 	tcase_add_test(tc_block_net, check_block_net);
 	suite_add_tcase(suite, tc_block_net);
 
+	tc_block_net_writev = tcase_create("block_net_writev");
+	tcase_add_loop_test(tc_block_net_writev, check_block_net_writev, 0, 2);
+	suite_add_tcase(suite, tc_block_net_writev);
+
 	return suite;
 }
 
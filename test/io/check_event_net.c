@@ -272,9 +272,20 @@ typedef struct {
 	M_uint64 runtime_ms;
 } stats_t;
 
-static M_event_err_t check_event_net_test(M_uint64 num_connections, M_uint64 delay_ms, M_bool use_pool, M_bool nonscalable, stats_t *stats)
+/* Zeroed options are a single loop with no flags. Placement and distribution
+ * only apply when use_pool is set. */
+typedef struct {
+	M_uint64                 num_connections;
+	M_uint64                 delay_ms;
+	M_bool                   use_pool;
+	M_event_pool_placement_t placement;
+	M_event_distribute_t     distribute;
+	M_uint32                 event_flags;
+} net_test_opts_t;
+
+static M_event_err_t check_event_net_test(const net_test_opts_t *opts, stats_t *stats)
 {
-	M_event_t         *event = use_pool?M_event_pool_create(0):M_event_create(nonscalable?M_EVENT_FLAG_NON_SCALABLE:M_EVENT_FLAG_NONE);
+	M_event_t         *event = opts->use_pool?M_event_pool_create_placement(0, opts->placement, NULL, 0):M_event_create(opts->event_flags);
 	M_io_t            *netclient;
 	size_t             i;
 	M_event_err_t      err;
@@ -282,17 +293,20 @@ static M_event_err_t check_event_net_test(M_uint64 num_connections, M_uint64 del
 	M_io_error_t       ioerr;
 	M_uint16           port = 0;
 
-	expected_connections      = num_connections;
+	expected_connections      = opts->num_connections;
 	active_client_connections = 0;
 	active_server_connections = 0;
 	client_connection_count   = 0;
 	server_connection_count   = 0;
-	delay_response_ms         = delay_ms;
+	delay_response_ms         = opts->delay_ms;
 	debug_lock                = M_thread_mutex_create(M_THREAD_MUTEXATTR_NONE);
 	dns                       = M_dns_create(event);
 
+	/* Not a pool on single core systems */
+	M_event_pool_set_distribution(event, opts->distribute);
+
 	net_output_stats(event);
-	event_debug("starting %llu connection test", num_connections);
+	event_debug("starting %llu connection test", opts->num_connections);
 
 	ioerr = M_io_net_server_create(&netserver, 0 /* any port */, NULL, M_IO_NET_ANY);
 
@@ -313,7 +327,7 @@ static M_event_err_t check_event_net_test(M_uint64 num_connections, M_uint64 del
 	}
 	event_debug("listener added to event");
 	net_output_stats(event);
-	for (i=0; i<num_connections; i++) {
+	for (i=0; i<opts->num_connections; i++) {
 		if (M_io_net_client_create(&netclient, dns, "localhost", port, M_IO_NET_ANY) != M_IO_ERROR_SUCCESS) {
 			event_debug("failed to create net client");
 			return M_EVENT_ERR_RETURN;
@@ -364,49 +378,86 @@ static M_event_err_t check_event_net_test(M_uint64 num_connections, M_uint64 del
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+static const struct {
+	M_event_pool_placement_t placement;
+	M_event_distribute_t     distribute;
+} pool_tests[] = {
+	{ M_EVENT_POOL_PLACEMENT_CORE,    M_EVENT_DISTRIBUTE_PROCESS_TIME  },
+	{ M_EVENT_POOL_PLACEMENT_NONE,    M_EVENT_DISTRIBUTE_PROCESS_TIME  },
+	{ M_EVENT_POOL_PLACEMENT_COMPACT, M_EVENT_DISTRIBUTE_PROCESS_TIME  },
+	{ M_EVENT_POOL_PLACEMENT_SCATTER, M_EVENT_DISTRIBUTE_PROCESS_TIME  },
+	{ M_EVENT_POOL_PLACEMENT_CORE,    M_EVENT_DISTRIBUTE_ROUND_ROBIN   },
+	{ M_EVENT_POOL_PLACEMENT_CORE,    M_EVENT_DISTRIBUTE_LEAST_OBJECTS },
+	{ M_EVENT_POOL_PLACEMENT_CORE,    M_EVENT_DISTRIBUTE_LOAD          }
+};
+
 START_TEST(check_event_net_pool)
 {
-	M_uint64 tests[] = { 1, 5, 25, 50, /* 100, */ 0 };
-	size_t   i;
+	M_uint64        tests[] = { 1, 5, 25, 50, /* 100, */ 0 };
+	net_test_opts_t opts;
+	size_t          i;
+
+	M_mem_set(&opts, 0, sizeof(opts));
+	opts.use_pool   = M_TRUE;
+	opts.placement  = pool_tests[_i].placement;
+	opts.distribute = pool_tests[_i].distribute;
 
 	for (i=0; tests[i] != 0; i++) {
-		M_event_err_t err = check_event_net_test(tests[i], 0, M_TRUE, M_FALSE, NULL);
-		ck_assert_msg(err == M_EVENT_ERR_DONE, "%d cnt%d expected M_EVENT_ERR_DONE got %s", (int)i, (int)tests[i], event_err_msg(err));
+		M_event_err_t err;
+		opts.num_connections = tests[i];
+		err = check_event_net_test(&opts, NULL);
+		ck_assert_msg(err == M_EVENT_ERR_DONE, "%d cnt%d placement%d distribute%d expected M_EVENT_ERR_DONE got %s", (int)i, (int)tests[i], (int)pool_tests[_i].placement, (int)pool_tests[_i].distribute, event_err_msg(err));
 	}
 }
 END_TEST
 
 START_TEST(check_event_net_stat)
 {
-	M_event_err_t err;
-	size_t        i;
-	size_t        cnt;
-	stats_t      *stats;
+	M_event_err_t   err;
+	size_t          i;
+	size_t          cnt;
+	stats_t        *stats;
+	net_test_opts_t opts;
 
 	struct {
 		const char *name;
 		M_uint64    num_conns;
 		M_uint64    delay_response_ms;
-		M_bool      nonscalable;
+		M_uint32    event_flags;
 	} tests[] = {
-		{ "non-scalable 1 conn no delay   ", 1,   0, M_TRUE  },
-		{ "non-scalable 1 conn 15ms delay ", 1,  15, M_TRUE  },
-		{ "non-scalable 1 conn 300ms delay", 1, 300, M_TRUE  },
-		{ "normal 1 conn no delay   ",       1,   0, M_FALSE },
-		{ "normal 1 conn 15ms delay ",       1,  15, M_FALSE },
-		{ "normal 1 conn 300ms delay",       1, 300, M_FALSE },
-		{ "non-scalable 2 conn no delay   ", 2,   0, M_TRUE  },
-		{ "non-scalable 2 conn 15ms delay ", 2,  15, M_TRUE  },
-		{ "non-scalable 2 conn 300ms delay", 2, 300, M_TRUE  },
-		{ "normal 2 conn no delay   ",       2,   0, M_FALSE },
-		{ "normal 2 conn 15ms delay ",       2,  15, M_FALSE },
-		{ "normal 2 conn 300ms delay",       2, 300, M_FALSE },
-		{ "non-scalable 5 conn no delay   ", 5,   0, M_TRUE  },
-		{ "non-scalable 5 conn 15ms delay ", 5,  15, M_TRUE  },
-		{ "non-scalable 5 conn 300ms delay", 5, 300, M_TRUE  },
-		{ "normal 5 conn no delay   ",       5,   0, M_FALSE },
-		{ "normal 5 conn 15ms delay ",       5,  15, M_FALSE },
-		{ "normal 5 conn 300ms delay",       5, 300, M_FALSE },
+		{ "non-scalable 1 conn no delay   ", 1,   0, M_EVENT_FLAG_NON_SCALABLE },
+		{ "non-scalable 1 conn 15ms delay ", 1,  15, M_EVENT_FLAG_NON_SCALABLE },
+		{ "non-scalable 1 conn 300ms delay", 1, 300, M_EVENT_FLAG_NON_SCALABLE },
+		{ "normal 1 conn no delay   ",       1,   0, M_EVENT_FLAG_NONE         },
+		{ "normal 1 conn 15ms delay ",       1,  15, M_EVENT_FLAG_NONE         },
+		{ "normal 1 conn 300ms delay",       1, 300, M_EVENT_FLAG_NONE         },
+		{ "io_uring 1 conn no delay   ",     1,   0, M_EVENT_FLAG_IO_URING     },
+		{ "io_uring 1 conn 15ms delay ",     1,  15, M_EVENT_FLAG_IO_URING     },
+		{ "io_uring 1 conn 300ms delay",     1, 300, M_EVENT_FLAG_IO_URING     },
+		{ "busy-poll 1 conn no delay   ",    1,   0, M_EVENT_FLAG_BUSY_POLL    },
+		{ "busy-poll 1 conn 15ms delay ",    1,  15, M_EVENT_FLAG_BUSY_POLL    },
+		{ "busy-poll 1 conn 300ms delay",    1, 300, M_EVENT_FLAG_BUSY_POLL    },
+		{ "non-scalable 2 conn no delay   ", 2,   0, M_EVENT_FLAG_NON_SCALABLE },
+		{ "non-scalable 2 conn 15ms delay ", 2,  15, M_EVENT_FLAG_NON_SCALABLE },
+		{ "non-scalable 2 conn 300ms delay", 2, 300, M_EVENT_FLAG_NON_SCALABLE },
+		{ "normal 2 conn no delay   ",       2,   0, M_EVENT_FLAG_NONE         },
+		{ "normal 2 conn 15ms delay ",       2,  15, M_EVENT_FLAG_NONE         },
+		{ "normal 2 conn 300ms delay",       2, 300, M_EVENT_FLAG_NONE         },
+		{ "io_uring 2 conn no delay   ",     2,   0, M_EVENT_FLAG_IO_URING     },
+		{ "io_uring 2 conn 15ms delay ",     2,  15, M_EVENT_FLAG_IO_URING     },
+		{ "io_uring 2 conn 300ms delay",     2, 300, M_EVENT_FLAG_IO_URING     },
+		{ "non-scalable 5 conn no delay   ", 5,   0, M_EVENT_FLAG_NON_SCALABLE },
+		{ "non-scalable 5 conn 15ms delay ", 5,  15, M_EVENT_FLAG_NON_SCALABLE },
+		{ "non-scalable 5 conn 300ms delay", 5, 300, M_EVENT_FLAG_NON_SCALABLE },
+		{ "normal 5 conn no delay   ",       5,   0, M_EVENT_FLAG_NONE         },
+		{ "normal 5 conn 15ms delay ",       5,  15, M_EVENT_FLAG_NONE         },
+		{ "normal 5 conn 300ms delay",       5, 300, M_EVENT_FLAG_NONE         },
+		{ "io_uring 5 conn no delay   ",     5,   0, M_EVENT_FLAG_IO_URING     },
+		{ "io_uring 5 conn 15ms delay ",     5,  15, M_EVENT_FLAG_IO_URING     },
+		{ "io_uring 5 conn 300ms delay",     5, 300, M_EVENT_FLAG_IO_URING     },
+		{ "busy-poll 5 conn no delay   ",    5,   0, M_EVENT_FLAG_BUSY_POLL    },
+		{ "busy-poll 5 conn 15ms delay ",    5,  15, M_EVENT_FLAG_BUSY_POLL    },
+		{ "busy-poll 5 conn 300ms delay",    5, 300, M_EVENT_FLAG_BUSY_POLL    },
 	};
 
 	cnt   = sizeof(tests) / sizeof(*tests);
@@ -414,8 +465,13 @@ START_TEST(check_event_net_stat)
 
 	for (i=0; i < cnt; i++) {
 		M_timeval_t starttv;
+		M_mem_set(&opts, 0, sizeof(opts));
+		opts.num_connections = tests[i].num_conns;
+		opts.delay_ms        = tests[i].delay_response_ms;
+		opts.event_flags     = tests[i].event_flags;
+
 		M_time_elapsed_start(&starttv);
-		err = check_event_net_test(tests[i].num_conns, tests[i].delay_response_ms, M_FALSE, tests[i].nonscalable, &stats[i]);
+		err = check_event_net_test(&opts, &stats[i]);
 		ck_assert_msg(err == M_EVENT_ERR_DONE, "%s expected M_EVENT_ERR_DONE got %s", tests[i].name, event_err_msg(err));
 		stats[i].runtime_ms = M_time_elapsed(&starttv);
 	}
@@ -453,6 +509,206 @@ START_TEST(check_event_net_addrinuse)
 }
 END_TEST
 
+#define SHARDED_CONNECTIONS 64
+
+static M_thread_mutex_t *sharded_lock;
+static size_t            sharded_accepted;
+static size_t            sharded_same_loop;
+
+static void sharded_serverconn_cb(M_event_t *event, M_event_type_t type, M_io_t *comm, void *data)
+{
+	(void)event;
+	(void)data;
+
+	if (type == M_EVENT_TYPE_CONNECTED || type == M_EVENT_TYPE_DISCONNECTED || type == M_EVENT_TYPE_ERROR)
+		M_io_destroy(comm);
+}
+
+static void sharded_server_cb(M_event_t *event, M_event_type_t type, M_io_t *comm, void *data)
+{
+	M_io_t *newcomm;
+	(void)data;
+
+	if (type != M_EVENT_TYPE_ACCEPT)
+		return;
+
+	while (M_io_accept(&newcomm, comm) == M_IO_ERROR_SUCCESS) {
+		/* Add to the loop the listener runs on, not the pool */
+		M_event_add(event, newcomm, sharded_serverconn_cb, NULL);
+
+		M_thread_mutex_lock(sharded_lock);
+		sharded_accepted++;
+		if (M_io_get_event(newcomm) == M_io_get_event(comm))
+			sharded_same_loop++;
+		if (sharded_accepted == SHARDED_CONNECTIONS)
+			M_event_done(M_event_get_pool(event));
+		M_thread_mutex_unlock(sharded_lock);
+	}
+}
+
+static void sharded_client_cb(M_event_t *event, M_event_type_t type, M_io_t *comm, void *data)
+{
+	(void)event;
+	(void)comm;
+	(void)data;
+	(void)type;
+}
+
+START_TEST(check_event_net_sharded)
+{
+	M_event_t     *event   = M_event_pool_create(0);
+	M_io_t        *clients[SHARDED_CONNECTIONS];
+	M_io_t       **servers = NULL;
+	size_t         num_servers;
+	M_io_error_t   ioerr;
+	M_event_err_t  err;
+	M_uint16       port;
+	size_t         i;
+
+	sharded_lock      = M_thread_mutex_create(M_THREAD_MUTEXATTR_NONE);
+	sharded_accepted  = 0;
+	sharded_same_loop = 0;
+	dns               = M_dns_create(event);
+
+	ioerr = M_io_net_server_create_sharded(&servers, &num_servers, event, 0, "127.0.0.1", M_IO_NET_IPV4, sharded_server_cb, NULL);
+	ck_assert_msg(ioerr == M_IO_ERROR_SUCCESS, "server_create_sharded returned %s", M_io_error_string(ioerr));
+	ck_assert_msg(num_servers >= 1, "no listeners created");
+
+	/* All listeners share the port */
+	port = M_io_net_get_port(servers[0]);
+	for (i=1; i<num_servers; i++) {
+		ck_assert_msg(M_io_net_get_port(servers[i]) == port, "listener %zu port %u != %u", i, M_io_net_get_port(servers[i]), port);
+	}
+
+	for (i=0; i<SHARDED_CONNECTIONS; i++) {
+		ioerr = M_io_net_client_create(&clients[i], dns, "127.0.0.1", port, M_IO_NET_IPV4);
+		ck_assert_msg(ioerr == M_IO_ERROR_SUCCESS, "client_create returned %s", M_io_error_string(ioerr));
+		ck_assert_msg(M_event_add(event, clients[i], sharded_client_cb, NULL), "failed to add client %zu", i);
+	}
+
+	err = M_event_loop(event, 5000);
+	ck_assert_msg(err == M_EVENT_ERR_DONE, "expected M_EVENT_ERR_DONE got %s", event_err_msg(err));
+	ck_assert_msg(sharded_accepted == SHARDED_CONNECTIONS, "accepted %zu of %d connections", sharded_accepted, SHARDED_CONNECTIONS);
+	ck_assert_msg(sharded_same_loop == SHARDED_CONNECTIONS, "%zu of %zu connections moved off the accepting loop", sharded_accepted - sharded_same_loop, sharded_accepted);
+
+	for (i=0; i<SHARDED_CONNECTIONS; i++) {
+		M_io_destroy(clients[i]);
+	}
+	for (i=0; i<num_servers; i++) {
+		M_io_destroy(servers[i]);
+	}
+	M_free(servers);
+	M_dns_destroy(dns);
+	M_event_destroy(event);
+	M_thread_mutex_destroy(sharded_lock);
+	M_library_cleanup();
+}
+END_TEST
+
+#define WRITEV_SEGMENTS 200
+#define WRITEV_SEG_LEN  100
+
+static M_iovec_t      writev_iov[WRITEV_SEGMENTS];
+static unsigned char  writev_data[WRITEV_SEGMENTS][WRITEV_SEG_LEN];
+static size_t         writev_sent;
+static size_t         writev_recv;
+static M_io_t        *writev_client;
+static M_io_t        *writev_conn;
+
+static void writev_client_cb(M_event_t *event, M_event_type_t type, M_io_t *comm, void *data)
+{
+	M_iovec_t iov[WRITEV_SEGMENTS];
+	size_t    idx;
+	size_t    len;
+	(void)event;
+	(void)data;
+
+	if ((type != M_EVENT_TYPE_CONNECTED && type != M_EVENT_TYPE_WRITE) || writev_sent == sizeof(writev_data))
+		return;
+
+	/* Pass everything not yet written, more segments and bytes than any layer takes at
+	 * once. Only one write per event so anything left has to wait for the next write event. */
+	idx = writev_sent / WRITEV_SEG_LEN;
+	M_mem_copy(iov, writev_iov + idx, sizeof(*iov) * (WRITEV_SEGMENTS - idx));
+	iov[0].data += writev_sent % WRITEV_SEG_LEN;
+	iov[0].len  -= writev_sent % WRITEV_SEG_LEN;
+	if (M_io_writev(comm, iov, WRITEV_SEGMENTS - idx, &len) == M_IO_ERROR_SUCCESS)
+		writev_sent += len;
+}
+
+static void writev_serverconn_cb(M_event_t *event, M_event_type_t type, M_io_t *comm, void *data)
+{
+	unsigned char buf[4096];
+	size_t        len;
+	(void)data;
+
+	if (type != M_EVENT_TYPE_READ)
+		return;
+
+	while (M_io_read(comm, buf, sizeof(buf), &len) == M_IO_ERROR_SUCCESS)
+		writev_recv += len;
+
+	if (writev_recv == sizeof(writev_data))
+		M_event_done(event);
+}
+
+static void writev_server_cb(M_event_t *event, M_event_type_t type, M_io_t *comm, void *data)
+{
+	M_io_t *newcomm;
+	(void)data;
+
+	if (type != M_EVENT_TYPE_ACCEPT)
+		return;
+
+	while (M_io_accept(&newcomm, comm) == M_IO_ERROR_SUCCESS) {
+		writev_conn = newcomm;
+		M_event_add(event, newcomm, writev_serverconn_cb, NULL);
+	}
+}
+
+START_TEST(check_event_net_writev)
+{
+	M_event_t     *event  = M_event_create(M_EVENT_FLAG_NONE);
+	M_io_t        *server = NULL;
+	M_io_error_t   ioerr;
+	M_event_err_t  err;
+	size_t         i;
+
+	writev_sent   = 0;
+	writev_recv   = 0;
+	writev_client = NULL;
+	writev_conn   = NULL;
+	for (i=0; i<WRITEV_SEGMENTS; i++) {
+		M_mem_set(writev_data[i], (int)('a' + (i % 26)), WRITEV_SEG_LEN);
+		writev_iov[i].data = writev_data[i];
+		writev_iov[i].len  = WRITEV_SEG_LEN;
+	}
+	dns = M_dns_create(event);
+
+	ioerr = M_io_net_server_create(&server, 0, "127.0.0.1", M_IO_NET_IPV4);
+	ck_assert_msg(ioerr == M_IO_ERROR_SUCCESS, "server_create returned %s", M_io_error_string(ioerr));
+	ck_assert(M_event_add(event, server, writev_server_cb, NULL));
+
+	ioerr = M_io_net_client_create(&writev_client, dns, "127.0.0.1", M_io_net_get_port(server), M_IO_NET_IPV4);
+	ck_assert_msg(ioerr == M_IO_ERROR_SUCCESS, "client_create returned %s", M_io_error_string(ioerr));
+	/* Bandwidth shaping only takes single buffers so segments are coalesced for it */
+	if (_i == 1)
+		ck_assert(M_io_add_bwshaping(writev_client, NULL) == M_IO_ERROR_SUCCESS);
+	ck_assert(M_event_add(event, writev_client, writev_client_cb, NULL));
+
+	err = M_event_loop(event, 5000);
+	ck_assert_msg(err == M_EVENT_ERR_DONE, "expected M_EVENT_ERR_DONE got %s", event_err_msg(err));
+	ck_assert_msg(writev_recv == sizeof(writev_data), "received %zu of %zu bytes", writev_recv, sizeof(writev_data));
+
+	M_io_destroy(writev_conn);
+	M_io_destroy(writev_client);
+	M_io_destroy(server);
+	M_dns_destroy(dns);
+	M_event_destroy(event);
+	M_library_cleanup();
+}
+END_TEST
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static Suite *event_net_suite(void)
@@ -463,7 +719,7 @@ static Suite *event_net_suite(void)
 	suite = suite_create("event_net_pool");
 
 	tc    = tcase_create("event_net_pool");
-	tcase_add_test(tc, check_event_net_pool);
+	tcase_add_loop_test(tc, check_event_net_pool, 0, sizeof(pool_tests) / sizeof(*pool_tests));
 	tcase_set_timeout(tc, 20);
 	suite_add_tcase(suite, tc);
 
@@ -472,6 +728,16 @@ static Suite *event_net_suite(void)
 	tcase_set_timeout(tc, 20);
 	suite_add_tcase(suite, tc);
 
+	tc    = tcase_create("event_net_sharded");
+	tcase_add_test(tc, check_event_net_sharded);
+	tcase_set_timeout(tc, 10);
+	suite_add_tcase(suite, tc);
+
+	tc    = tcase_create("event_net_writev");
+	tcase_add_loop_test(tc, check_event_net_writev, 0, 2);
+	tcase_set_timeout(tc, 10);
+	suite_add_tcase(suite, tc);
+
 	tc    = tcase_create("event_net_addrinuse");
 	tcase_add_test(tc, check_event_net_addrinuse);
 	tcase_set_timeout(tc, 2);
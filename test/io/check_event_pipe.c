@@ -168,9 +168,9 @@ static const char *event_err_msg(M_event_err_t err)
 }
 
 
-static M_event_err_t check_event_pipe_test(M_uint64 num_connections)
+static M_event_err_t check_event_pipe_test(M_uint64 num_connections, M_uint32 event_flags)
 {
-	M_event_t         *event = M_event_create(M_EVENT_FLAG_NONE);
+	M_event_t         *event = M_event_create(event_flags);
 //	M_event_t         *event = M_event_pool_create(0);
 	M_io_t            *pipereader;
 	M_io_t            *pipewriter;
@@ -223,18 +223,58 @@ static M_event_err_t check_event_pipe_test(M_uint64 num_connections)
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+static const M_uint32 pipe_event_flags[] = { M_EVENT_FLAG_NONE, M_EVENT_FLAG_IO_URING, M_EVENT_FLAG_BUSY_POLL };
+
 START_TEST(check_event_pipe)
 {
 	M_uint64 tests[] = { 1,  25, 50, /* 100,  200, -- disable because of mac */ 0 };
 	size_t   i;
 
 	for (i=0; tests[i] != 0; i++) {
-		M_event_err_t err = check_event_pipe_test(tests[i]);
-		ck_assert_msg(err == M_EVENT_ERR_DONE, "%d cnt%d expected M_EVENT_ERR_DONE got %s", (int)i, (int)tests[i], event_err_msg(err));
+		M_event_err_t err = check_event_pipe_test(tests[i], pipe_event_flags[_i]);
+		ck_assert_msg(err == M_EVENT_ERR_DONE, "%d cnt%d flags%u expected M_EVENT_ERR_DONE got %s", (int)i, (int)tests[i], (unsigned int)pipe_event_flags[_i], event_err_msg(err));
 	}
 }
 END_TEST
 
+START_TEST(check_event_pipe_migrate)
+{
+	M_event_t     *event_src = M_event_create(M_EVENT_FLAG_NONE);
+	M_event_t     *event_dst = M_event_create(M_EVENT_FLAG_NONE);
+	M_io_t        *pipereader;
+	M_io_t        *pipewriter;
+	M_event_err_t  err;
+
+	expected_connections      = 1;
+	active_client_connections = 0;
+	active_server_connections = 0;
+	client_connection_count   = 0;
+	server_connection_count   = 0;
+
+	ck_assert_msg(M_io_pipe_create(M_IO_PIPE_NONE, &pipereader, &pipewriter) == M_IO_ERROR_SUCCESS, "failed to create pipe");
+	ck_assert_msg(!M_event_migrate(pipereader, event_dst), "migrate of unregistered io should fail");
+	ck_assert_msg(M_event_add(event_src, pipereader, pipe_reader_cb, NULL), "failed to add pipe reader");
+
+	/* Deliver the connect on the source loop */
+	err = M_event_loop(event_src, 50);
+	ck_assert_msg(err == M_EVENT_ERR_TIMEOUT, "source loop expected M_EVENT_ERR_TIMEOUT got %s", event_err_msg(err));
+	ck_assert_msg(server_connection_count == 1, "reader never connected");
+
+	ck_assert_msg(M_event_migrate(pipereader, event_dst), "failed to migrate pipe reader");
+	ck_assert_msg(M_io_get_event(pipereader) == event_dst, "pipe reader not on destination loop");
+	ck_assert_msg(M_event_num_objects(event_src) == 0, "source loop still has objects");
+
+	ck_assert_msg(M_event_add(event_dst, pipewriter, pipe_writer_cb, NULL), "failed to add pipe writer");
+	err = M_event_loop(event_dst, 2000);
+	ck_assert_msg(err == M_EVENT_ERR_DONE, "destination loop expected M_EVENT_ERR_DONE got %s", event_err_msg(err));
+	ck_assert_msg(server_connection_count == 1, "reader connected %llu times", server_connection_count);
+
+	M_event_destroy(event_dst);
+	M_event_destroy(event_src);
+	M_library_cleanup();
+}
+END_TEST
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static Suite *event_pipe_suite(void)
@@ -245,7 +285,11 @@ static Suite *event_pipe_suite(void)
 	suite = suite_create("event_pipe");
 
 	tc_event_pipe = tcase_create("event_pipe");
-	tcase_add_test(tc_event_pipe, check_event_pipe);
+	tcase_add_loop_test(tc_event_pipe, check_event_pipe, 0, sizeof(pipe_event_flags) / sizeof(*pipe_event_flags));
+	suite_add_tcase(suite, tc_event_pipe);
+
+	tc_event_pipe = tcase_create("event_pipe_migrate");
+	tcase_add_test(tc_event_pipe, check_event_pipe_migrate);
 	suite_add_tcase(suite, tc_event_pipe);
 
 	return suite;
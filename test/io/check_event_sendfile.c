@@ -0,0 +1,354 @@
+#include "m_config.h"
+#include <stdlib.h>
+#include <check.h>
+
+#include <mstdlib/mstdlib.h>
+#include <mstdlib/mstdlib_thread.h>
+#include <mstdlib/mstdlib_io.h>
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define SENDFILE_PATH "./check_event_sendfile.dat"
+#define SENDFILE_SIZE ((3 * 1024 * 1024) + 123)
+/* Large enough that it can't all sit in the socket buffers of a peer that isn't reading */
+#define SENDFILE_DESTROY_SIZE (32 * 1024 * 1024)
+
+typedef struct {
+	M_uint64      offset;
+	M_uint64      len;
+	M_uint32      flags;
+	M_bool        trace;
+} sendfile_test_t;
+
+static const sendfile_test_t sendfile_tests[] = {
+	{ 0,      0,     M_IO_SENDFILE_FLAG_NONE,        M_FALSE }, /* Whole file, zero-copy                */
+	{ 0,      0,     M_IO_SENDFILE_FLAG_NO_ZEROCOPY, M_FALSE }, /* Whole file, buffered                 */
+	{ 0,      0,     M_IO_SENDFILE_FLAG_NONE,        M_TRUE  }, /* Layer above net forces buffering     */
+	{ 70001,  99999, M_IO_SENDFILE_FLAG_NONE,        M_FALSE }, /* Range, zero-copy                     */
+	{ 70001,  99999, M_IO_SENDFILE_FLAG_NO_ZEROCOPY, M_FALSE }, /* Range, buffered                      */
+	{ 0,      SENDFILE_SIZE + 1, M_IO_SENDFILE_FLAG_NONE, M_FALSE } /* Longer than the file fails       */
+};
+
+static const sendfile_test_t *cur_test;
+static M_event_callback_t     server_conn_cb;
+static M_fs_file_t           *sendfile_file;
+static M_io_t                *server_conn;
+static M_buf_t               *received;
+static M_io_error_t           send_result;
+static M_uint64               send_total;
+static size_t                 progress_cnt;
+static M_bool                 send_done;
+static M_bool                 second_start_rejected;
+static M_io_t                *destroyed_io;
+
+static unsigned char sendfile_byte(M_uint64 pos)
+{
+	return (unsigned char)(pos % 251);
+}
+
+static void trace_cb(void *cb_arg, M_io_trace_type_t type, M_event_type_t event_type, const unsigned char *data, size_t data_len)
+{
+	(void)cb_arg;
+	(void)type;
+	(void)event_type;
+	(void)data;
+	(void)data_len;
+}
+
+static void send_cb(M_io_t *io, M_io_error_t err, M_uint64 sent, M_bool done, void *thunk)
+{
+	(void)thunk;
+
+	if (!done) {
+		progress_cnt++;
+		return;
+	}
+
+	send_done   = M_TRUE;
+	send_result = err;
+	send_total  = sent;
+	M_io_disconnect(io);
+}
+
+static void conn_cb(M_event_t *event, M_event_type_t type, M_io_t *io, void *data)
+{
+	(void)event;
+	(void)data;
+
+	switch (type) {
+		case M_EVENT_TYPE_CONNECTED:
+			ck_assert(M_io_send_file(io, sendfile_file, cur_test->offset, cur_test->len, cur_test->flags, send_cb, NULL) == M_IO_ERROR_SUCCESS);
+			second_start_rejected = M_io_send_file(io, sendfile_file, 0, 0, M_IO_SENDFILE_FLAG_NONE, send_cb, NULL) == M_IO_ERROR_NOTPERM;
+			break;
+		case M_EVENT_TYPE_WRITE:
+			/* Only reaches us once the transfer is over */
+			ck_assert(send_done);
+			break;
+		case M_EVENT_TYPE_DISCONNECTED:
+		case M_EVENT_TYPE_ERROR:
+			M_io_destroy(io);
+			server_conn = NULL;
+			break;
+		default:
+			break;
+	}
+}
+
+static void server_cb(M_event_t *event, M_event_type_t type, M_io_t *io, void *data)
+{
+	M_io_t *conn = NULL;
+
+	(void)data;
+
+	if (type != M_EVENT_TYPE_ACCEPT)
+		return;
+
+	while (M_io_accept(&conn, io) == M_IO_ERROR_SUCCESS) {
+		if (cur_test->trace)
+			M_io_add_trace(conn, NULL, trace_cb, NULL, NULL, NULL);
+		server_conn = conn;
+		M_event_add(event, conn, server_conn_cb, NULL);
+	}
+}
+
+static void client_cb(M_event_t *event, M_event_type_t type, M_io_t *io, void *data)
+{
+	(void)data;
+
+	switch (type) {
+		case M_EVENT_TYPE_READ:
+			M_io_read_into_buf(io, received);
+			break;
+		case M_EVENT_TYPE_DISCONNECTED:
+		case M_EVENT_TYPE_ERROR:
+			M_io_read_into_buf(io, received);
+			M_io_destroy(io);
+			M_event_done(event);
+			break;
+		default:
+			break;
+	}
+}
+
+static void sendfile_create_file(M_uint64 size)
+{
+	M_fs_file_t   *fd = NULL;
+	unsigned char  buf[4096];
+	M_uint64       pos;
+	size_t         len;
+	size_t         i;
+
+	(void)M_fs_delete(SENDFILE_PATH, M_FALSE, NULL, M_FS_PROGRESS_NOEXTRA);
+	ck_assert(M_fs_file_open(&fd, SENDFILE_PATH, 0, M_FS_FILE_MODE_WRITE, NULL) == M_FS_ERROR_SUCCESS);
+	for (pos=0; pos<size; pos+=len) {
+		len = (size_t)M_MIN(sizeof(buf), size - pos);
+		for (i=0; i<len; i++)
+			buf[i] = sendfile_byte(pos + i);
+		ck_assert(M_fs_file_write(fd, buf, len, NULL, M_FS_FILE_RW_FULLBUF) == M_FS_ERROR_SUCCESS);
+	}
+	M_fs_file_close(fd);
+}
+
+START_TEST(check_event_sendfile)
+{
+	M_event_t     *event  = M_event_create(M_EVENT_FLAG_NONE);
+	M_dns_t       *dns    = M_dns_create(event);
+	M_io_t        *server = NULL;
+	M_io_t        *client = NULL;
+	M_uint64       expect_len;
+	const unsigned char *data;
+	size_t         i;
+	M_event_err_t  err;
+
+	cur_test              = &sendfile_tests[_i];
+	received              = M_buf_create();
+	send_result           = M_IO_ERROR_ERROR;
+	send_total            = 0;
+	progress_cnt          = 0;
+	send_done             = M_FALSE;
+	second_start_rejected = M_FALSE;
+	server_conn           = NULL;
+
+	server_conn_cb        = conn_cb;
+
+	sendfile_create_file(SENDFILE_SIZE);
+	ck_assert(M_fs_file_open(&sendfile_file, SENDFILE_PATH, 0, M_FS_FILE_MODE_READ|M_FS_FILE_MODE_NOCREATE, NULL) == M_FS_ERROR_SUCCESS);
+
+	ck_assert(M_io_net_server_create(&server, 0, "127.0.0.1", M_IO_NET_ANY) == M_IO_ERROR_SUCCESS);
+	ck_assert(M_io_net_client_create(&client, dns, "127.0.0.1", M_io_net_get_port(server), M_IO_NET_ANY) == M_IO_ERROR_SUCCESS);
+	ck_assert(M_io_send_file(client, sendfile_file, 0, 0, M_IO_SENDFILE_FLAG_NONE, NULL, NULL) == M_IO_ERROR_INVALID);
+	M_event_add(event, server, server_cb, NULL);
+	M_event_add(event, client, client_cb, NULL);
+
+	err = M_event_loop(event, 10000);
+	ck_assert_msg(err == M_EVENT_ERR_DONE, "event loop did not complete (%d)", (int)err);
+	ck_assert_msg(send_done, "transfer never completed");
+	ck_assert_msg(second_start_rejected, "second transfer on the same io was allowed");
+
+	expect_len = (cur_test->len == 0)?SENDFILE_SIZE - cur_test->offset:cur_test->len;
+	if (cur_test->offset + expect_len > SENDFILE_SIZE) {
+		/* File ended early */
+		ck_assert_msg(send_result == M_IO_ERROR_ERROR, "short file reported %s", M_io_error_string(send_result));
+		expect_len = SENDFILE_SIZE - cur_test->offset;
+	} else {
+		ck_assert_msg(send_result == M_IO_ERROR_SUCCESS, "transfer failed: %s", M_io_error_string(send_result));
+	}
+	ck_assert_msg(send_total == expect_len, "sent %llu, expected %llu", send_total, expect_len);
+	if (cur_test->flags & M_IO_SENDFILE_FLAG_NO_ZEROCOPY || cur_test->trace)
+		ck_assert_msg(progress_cnt > 0, "no progress reported");
+	ck_assert_msg(M_buf_len(received) == expect_len, "received %zu, expected %llu", M_buf_len(received), expect_len);
+
+	data = (const unsigned char *)M_buf_peek(received);
+	for (i=0; i<M_buf_len(received); i++) {
+		if (data[i] != sendfile_byte(cur_test->offset + i))
+			ck_abort_msg("data mismatch at %zu", i);
+	}
+
+	/* Loop stops when the client sees the disconnect, the server side may not have yet */
+	M_io_destroy(server_conn);
+	M_io_destroy(server);
+	M_fs_file_close(sendfile_file);
+	(void)M_fs_delete(SENDFILE_PATH, M_FALSE, NULL, M_FS_PROGRESS_NOEXTRA);
+	M_buf_cancel(received);
+	M_dns_destroy(dns);
+	M_event_destroy(event);
+	M_library_cleanup();
+}
+END_TEST
+
+static void destroy_send_cb(M_io_t *io, M_io_error_t err, M_uint64 sent, M_bool done, void *thunk)
+{
+	M_event_t *event = M_io_get_event(io);
+
+	(void)thunk;
+
+	if (!done)
+		return;
+
+	send_done    = M_TRUE;
+	send_result  = err;
+	send_total   = sent;
+	destroyed_io = io;
+	server_conn  = NULL;
+	M_io_destroy(io);
+	M_event_done(event);
+}
+
+static void destroy_conn_cb(M_event_t *event, M_event_type_t type, M_io_t *io, void *data)
+{
+	(void)event;
+	(void)data;
+
+	switch (type) {
+		case M_EVENT_TYPE_CONNECTED:
+			ck_assert(M_io_send_file(io, sendfile_file, 0, 0, M_IO_SENDFILE_FLAG_NONE, destroy_send_cb, NULL) == M_IO_ERROR_SUCCESS);
+			break;
+		case M_EVENT_TYPE_DISCONNECTED:
+		case M_EVENT_TYPE_ERROR:
+			/* The io object is pooled memory so a use after free isn't caught by
+			 * memory checkers, look for it explicitly */
+			ck_assert_msg(io != destroyed_io, "event delivered for an io destroyed by the completion callback");
+			M_io_destroy(io);
+			server_conn = NULL;
+			break;
+		default:
+			break;
+	}
+}
+
+static void destroy_client_timer_cb(M_event_t *event, M_event_type_t type, M_io_t *io, void *data)
+{
+	(void)event;
+	(void)type;
+	(void)io;
+
+	M_io_destroy(data);
+}
+
+static void destroy_client_cb(M_event_t *event, M_event_type_t type, M_io_t *io, void *data)
+{
+	(void)data;
+
+	/* Never read so the transfer stalls, then drop the connection part way through */
+	if (type == M_EVENT_TYPE_CONNECTED)
+		M_event_timer_oneshot(event, 200, M_TRUE, destroy_client_timer_cb, io);
+}
+
+START_TEST(check_event_sendfile_destroy)
+{
+	M_event_t     *event  = M_event_create(M_EVENT_FLAG_NONE);
+	M_dns_t       *dns    = M_dns_create(event);
+	M_io_t        *server = NULL;
+	M_io_t        *client = NULL;
+	M_event_err_t  err;
+
+	cur_test       = &sendfile_tests[0];
+	send_result    = M_IO_ERROR_SUCCESS;
+	send_total     = 0;
+	send_done      = M_FALSE;
+	destroyed_io   = NULL;
+	server_conn    = NULL;
+	server_conn_cb = destroy_conn_cb;
+
+	sendfile_create_file(SENDFILE_DESTROY_SIZE);
+	ck_assert(M_fs_file_open(&sendfile_file, SENDFILE_PATH, 0, M_FS_FILE_MODE_READ|M_FS_FILE_MODE_NOCREATE, NULL) == M_FS_ERROR_SUCCESS);
+
+	ck_assert(M_io_net_server_create(&server, 0, "127.0.0.1", M_IO_NET_ANY) == M_IO_ERROR_SUCCESS);
+	ck_assert(M_io_net_client_create(&client, dns, "127.0.0.1", M_io_net_get_port(server), M_IO_NET_ANY) == M_IO_ERROR_SUCCESS);
+	M_event_add(event, server, server_cb, NULL);
+	M_event_add(event, client, destroy_client_cb, NULL);
+
+	err = M_event_loop(event, 10000);
+	ck_assert_msg(err == M_EVENT_ERR_DONE, "event loop did not complete (%d)", (int)err);
+	ck_assert_msg(send_done, "transfer never completed");
+	ck_assert_msg(send_result != M_IO_ERROR_SUCCESS, "transfer to a closed peer succeeded");
+	ck_assert_msg(send_total < SENDFILE_DESTROY_SIZE, "whole file sent before the peer closed");
+
+	M_io_destroy(server_conn);
+	M_io_destroy(server);
+	M_fs_file_close(sendfile_file);
+	(void)M_fs_delete(SENDFILE_PATH, M_FALSE, NULL, M_FS_PROGRESS_NOEXTRA);
+	M_dns_destroy(dns);
+	M_event_destroy(event);
+	M_library_cleanup();
+}
+END_TEST
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static Suite *event_sendfile_suite(void)
+{
+	Suite *suite;
+	TCase *tc_event_sendfile;
+	TCase *tc_event_sendfile_destroy;
+
+	suite = suite_create("event_sendfile");
+
+	tc_event_sendfile = tcase_create("event_sendfile");
+	tcase_add_loop_test(tc_event_sendfile, check_event_sendfile, 0, (int)(sizeof(sendfile_tests) / sizeof(*sendfile_tests)));
+	suite_add_tcase(suite, tc_event_sendfile);
+
+	tc_event_sendfile_destroy = tcase_create("event_sendfile_destroy");
+	tcase_add_test(tc_event_sendfile_destroy, check_event_sendfile_destroy);
+	suite_add_tcase(suite, tc_event_sendfile_destroy);
+
+	return suite;
+}
+
+int main(int argc, char **argv)
+{
+	SRunner *sr;
+	int      nf;
+
+	(void)argc;
+	(void)argv;
+
+	sr = srunner_create(event_sendfile_suite());
+	if (getenv("CK_LOG_FILE_NAME")==NULL) srunner_set_log(sr, "check_event_sendfile.log");
+
+	srunner_run_all(sr, CK_NORMAL);
+	nf = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return nf == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
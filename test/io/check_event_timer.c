@@ -78,12 +78,14 @@ static void trigger_cb(M_event_t *event, M_event_type_t type, M_io_t *comm, void
  * mode                 = Timer mode M_EVENT_TIMER_MODE_MONOTONIC vs M_EVENT_TIMER_MODE_RELATIVE
  * use_trigger          = Whether or not to fire a trigger to use to keep the event count rather the timer itself
  * first_event_delay_ms = How many milliseconds to delay on first timer event (simulate extended processing time)
+ * event_flags          = Additional flags for the event loop
  * Returns number of events.
  */
 static size_t event_timer_test(M_uint64 start_delay_ms, M_uint64 end_ms, M_uint64 interval_ms, M_uint64 max_runtime_ms,
-                               size_t fire_cnt, M_event_timer_mode_t mode, M_bool use_trigger, M_uint64 first_event_delay_ms)
+                               size_t fire_cnt, M_event_timer_mode_t mode, M_bool use_trigger, M_uint64 first_event_delay_ms,
+                               M_uint32 event_flags)
 {
-	M_event_t         *event = M_event_create(M_EVENT_FLAG_EXITONEMPTY);
+	M_event_t         *event = M_event_create(M_EVENT_FLAG_EXITONEMPTY|event_flags);
 	event_data_t      *data  = M_malloc_zero(sizeof(*data));
 	M_event_timer_t   *timer;
 	size_t             events;
@@ -166,6 +168,8 @@ struct timer_test timer_tests[] = {
 	{       0,    0,    50, 2000,   5,  M_EVENT_TIMER_MODE_RELATIVE,  M_FALSE,     0,       5,  0 },
 };
 
+static const M_uint32 timer_event_flags[] = { M_EVENT_FLAG_NONE, M_EVENT_FLAG_TIMER_WHEEL };
+
 START_TEST(check_event_timer)
 {
 	size_t i;
@@ -173,12 +177,260 @@ START_TEST(check_event_timer)
 		size_t events;
 		events = event_timer_test(timer_tests[i].start_delay_ms, timer_tests[i].end_ms, timer_tests[i].interval_ms,
 		                          timer_tests[i].max_runtime_ms, timer_tests[i].fire_cnt, timer_tests[i].mode,
-		                          timer_tests[i].use_trigger, timer_tests[i].first_event_delay_ms);
+		                          timer_tests[i].use_trigger, timer_tests[i].first_event_delay_ms, timer_event_flags[_i]);
 		ck_assert_msg(events >= timer_tests[i].expected_events - timer_tests[i].tolerance && events <= timer_tests[i].expected_events + timer_tests[i].tolerance, "test %d: expected %d events, got %d", (int)i, (int)timer_tests[i].expected_events, (int)events);
 	}
 }
 END_TEST
 
+
+#define ORDER_TIMERS 2000
+/* Intervals are far enough apart that the time spent starting the timers
+ * doesn't change which one should run first. */
+#define ORDER_INTERVAL(i) ((((i) * 7) % 12 + 1) * 50)
+
+typedef struct {
+	size_t  fired[ORDER_TIMERS];
+	size_t  cnt;
+	size_t  resets;
+	M_event_timer_t *reset_timer;
+	M_bool  reset_fired;
+} order_data_t;
+
+static size_t order_idx[ORDER_TIMERS];
+static order_data_t order_data;
+
+static void order_cb(M_event_t *event, M_event_type_t type, M_io_t *comm, void *data)
+{
+	(void)event;
+	(void)type;
+	(void)comm;
+	order_data.fired[order_data.cnt++] = *((size_t *)data);
+}
+
+static void reset_cb(M_event_t *event, M_event_type_t type, M_io_t *comm, void *data)
+{
+	(void)event;
+	(void)type;
+	(void)comm;
+	(void)data;
+
+	/* Keep pushing the idle timer out, as is done on every read. */
+	if (order_data.resets++ < 20)
+		M_event_timer_reset(order_data.reset_timer, 0);
+}
+
+static void idle_cb(M_event_t *event, M_event_type_t type, M_io_t *comm, void *data)
+{
+	(void)event;
+	(void)type;
+	(void)comm;
+	(void)data;
+	order_data.reset_fired = (order_data.resets > 20);
+}
+
+START_TEST(check_event_timer_wheel_order)
+{
+	M_event_t *event = M_event_create(M_EVENT_FLAG_EXITONEMPTY);
+	size_t     i;
+
+	M_mem_set(&order_data, 0, sizeof(order_data));
+
+	/* Enough timers to switch the loop over to the timer wheel, with intervals
+	 * spanning more than one lap of the first level. */
+	for (i=0; i<ORDER_TIMERS; i++) {
+		order_idx[i] = i;
+		ck_assert(M_event_timer_oneshot(event, ORDER_INTERVAL(i), M_TRUE, order_cb, &order_idx[i]) != NULL);
+	}
+
+	order_data.reset_timer = M_event_timer_oneshot(event, 30, M_TRUE, idle_cb, NULL);
+	M_event_timer_start(M_event_timer_add(event, reset_cb, NULL), 10);
+
+	M_event_loop(event, 2000);
+
+	ck_assert_msg(order_data.cnt == ORDER_TIMERS, "expected %d timers to fire, got %d", ORDER_TIMERS, (int)order_data.cnt);
+	for (i=1; i<ORDER_TIMERS; i++) {
+		size_t prev = order_data.fired[i-1];
+		size_t curr = order_data.fired[i];
+		size_t prev_ms = ORDER_INTERVAL(prev);
+		size_t curr_ms = ORDER_INTERVAL(curr);
+		ck_assert_msg(prev_ms <= curr_ms, "timer %d (%dms) fired after timer %d (%dms)", (int)curr, (int)curr_ms, (int)prev, (int)prev_ms);
+	}
+	ck_assert_msg(order_data.reset_fired, "idle timer fired before resets stopped");
+
+	M_event_destroy(event);
+	M_library_cleanup();
+}
+END_TEST
+
+
+#define TASK_THREADS 4
+#define TASK_COUNT   10000
+
+typedef struct {
+	M_event_t *event;
+	size_t     id;
+	size_t     next[TASK_THREADS];
+	size_t     cnt;
+	M_bool     in_order;
+} task_data_t;
+
+static task_data_t task_data;
+static size_t      task_ids[TASK_THREADS];
+
+static void task_cb(M_event_t *event, M_event_type_t type, M_io_t *comm, void *data)
+{
+	size_t id = (size_t)((M_uintptr)data) / TASK_COUNT;
+	size_t n  = (size_t)((M_uintptr)data) % TASK_COUNT;
+
+	(void)type;
+	(void)comm;
+
+	/* Tasks from each thread must run in the order they were queued. */
+	if (task_data.next[id] != n)
+		task_data.in_order = M_FALSE;
+	task_data.next[id] = n + 1;
+
+	if (++task_data.cnt == TASK_THREADS * TASK_COUNT)
+		M_event_done(event);
+}
+
+static void *task_thread(void *arg)
+{
+	size_t id = *((size_t *)arg);
+	size_t i;
+
+	for (i=0; i<TASK_COUNT; i++) {
+		M_event_queue_task(task_data.event, task_cb, (void *)((M_uintptr)(id * TASK_COUNT + i)));
+	}
+	return NULL;
+}
+
+START_TEST(check_event_queue_task)
+{
+	M_threadid_t threads[TASK_THREADS];
+	size_t       i;
+
+	M_mem_set(&task_data, 0, sizeof(task_data));
+	task_data.event    = M_event_create(M_EVENT_FLAG_NONE);
+	task_data.in_order = M_TRUE;
+
+	for (i=0; i<TASK_THREADS; i++) {
+		task_ids[i] = i;
+		threads[i]  = M_thread_create(NULL, task_thread, &task_ids[i]);
+	}
+
+	ck_assert(M_event_loop(task_data.event, 10000) == M_EVENT_ERR_DONE);
+
+	for (i=0; i<TASK_THREADS; i++) {
+		M_thread_join(threads[i], NULL);
+	}
+
+	ck_assert_msg(task_data.cnt == TASK_THREADS * TASK_COUNT, "expected %d tasks, got %d", TASK_THREADS * TASK_COUNT, (int)task_data.cnt);
+	ck_assert_msg(task_data.in_order, "tasks ran out of order");
+
+	M_event_destroy(task_data.event);
+	M_library_cleanup();
+}
+END_TEST
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct {
+	size_t             slow_cnt;
+	M_event_callback_t slow_callback;
+	M_uint64           slow_us;
+} hist_data_t;
+
+static void hist_slow_cb(M_event_t *event, M_event_type_t type, M_io_t *io, M_event_callback_t callback, M_uint64 elapsed_us, void *cb_arg)
+{
+	hist_data_t *data = cb_arg;
+
+	(void)event;
+	(void)type;
+	(void)io;
+
+	data->slow_cnt++;
+	data->slow_callback = callback;
+	data->slow_us       = elapsed_us;
+}
+
+static void hist_sleep_cb(M_event_t *event, M_event_type_t type, M_io_t *comm, void *data)
+{
+	(void)event;
+	(void)type;
+	(void)comm;
+	(void)data;
+
+	M_thread_sleep(20000);
+}
+
+static void hist_done_cb(M_event_t *event, M_event_type_t type, M_io_t *comm, void *data)
+{
+	(void)type;
+	(void)comm;
+	(void)data;
+
+	M_event_done(event);
+}
+
+START_TEST(check_event_histogram)
+{
+	M_event_t           *event = M_event_create(M_EVENT_FLAG_NONE);
+	M_event_histogram_t  hist;
+	hist_data_t          data;
+	size_t               i;
+	M_uint64             cnt;
+
+	M_mem_set(&data, 0, sizeof(data));
+
+	ck_assert_msg(!M_event_get_histogram(event, M_EVENT_HISTOGRAM_CALLBACK, &hist), "histograms should start disabled");
+
+	M_event_histogram_enable(event, M_TRUE);
+	M_event_set_slow_callback(event, 10000, hist_slow_cb, &data);
+
+	M_event_timer_oneshot(event, 10, M_TRUE, hist_sleep_cb, NULL);
+	M_event_timer_oneshot(event, 50, M_TRUE, hist_done_cb, NULL);
+	M_event_queue_task(event, hist_done_cb, NULL);
+	M_event_queue_task(event, hist_sleep_cb, NULL);
+
+	/* First done from the task, second from the timer */
+	ck_assert(M_event_loop(event, 2000) == M_EVENT_ERR_DONE);
+	ck_assert(M_event_loop(event, 2000) == M_EVENT_ERR_DONE);
+
+	ck_assert_msg(data.slow_cnt == 2, "expected 2 slow callbacks, got %d", (int)data.slow_cnt);
+	ck_assert_msg(data.slow_callback == hist_sleep_cb, "wrong slow callback reported");
+	ck_assert_msg(data.slow_us >= 10000, "slow callback reported %llu us", data.slow_us);
+
+	ck_assert(M_event_get_histogram(event, M_EVENT_HISTOGRAM_CALLBACK, &hist));
+	ck_assert_msg(hist.count == 4, "expected 4 callbacks, got %llu", hist.count);
+	for (cnt=0, i=0; i<M_EVENT_HISTOGRAM_BUCKETS; i++)
+		cnt += hist.buckets[i];
+	ck_assert_msg(cnt == hist.count, "bucket total %llu != count %llu", cnt, hist.count);
+	ck_assert_msg(hist.max_us >= 20000, "max %llu too small", hist.max_us);
+	ck_assert(M_event_histogram_percentile(&hist, 100) == hist.max_us);
+	ck_assert(M_event_histogram_percentile(&hist, 50) < 20000);
+	/* Buckets are within 25% */
+	ck_assert(M_event_histogram_percentile(&hist, 99) * 4 >= hist.max_us * 3);
+
+	ck_assert(M_event_get_histogram(event, M_EVENT_HISTOGRAM_TIMER_LATE, &hist));
+	ck_assert_msg(hist.count == 2, "expected 2 timers, got %llu", hist.count);
+
+	ck_assert(M_event_get_histogram(event, M_EVENT_HISTOGRAM_ITERATION, &hist));
+	ck_assert(hist.count > 0 && hist.max_us >= 20000);
+
+	M_event_histogram_reset(event);
+	ck_assert(M_event_get_histogram(event, M_EVENT_HISTOGRAM_CALLBACK, &hist));
+	ck_assert(hist.count == 0 && M_event_histogram_percentile(&hist, 50) == 0);
+
+	M_event_histogram_enable(event, M_FALSE);
+	ck_assert(!M_event_get_histogram(event, M_EVENT_HISTOGRAM_CALLBACK, &hist));
+
+	M_event_destroy(event);
+	M_library_cleanup();
+}
+END_TEST
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static Suite *event_timer_suite(void)
@@ -189,10 +441,24 @@ static Suite *event_timer_suite(void)
 	suite = suite_create("event_timer");
 
 	tc_event_timer = tcase_create("event_timer");
-	tcase_add_test(tc_event_timer, check_event_timer);
+	tcase_add_loop_test(tc_event_timer, check_event_timer, 0, sizeof(timer_event_flags) / sizeof(*timer_event_flags));
+	tcase_set_timeout(tc_event_timer, 120);
+	suite_add_tcase(suite, tc_event_timer);
+
+	tc_event_timer = tcase_create("event_timer_wheel_order");
+	tcase_add_test(tc_event_timer, check_event_timer_wheel_order);
 	tcase_set_timeout(tc_event_timer, 60);
 	suite_add_tcase(suite, tc_event_timer);
 
+	tc_event_timer = tcase_create("event_queue_task");
+	tcase_add_test(tc_event_timer, check_event_queue_task);
+	tcase_set_timeout(tc_event_timer, 60);
+	suite_add_tcase(suite, tc_event_timer);
+
+	tc_event_timer = tcase_create("event_histogram");
+	tcase_add_test(tc_event_timer, check_event_histogram);
+	suite_add_tcase(suite, tc_event_timer);
+
 	return suite;
 }
 
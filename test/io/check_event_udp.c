@@ -0,0 +1,288 @@
+#include "m_config.h"
+#include <stdlib.h>
+#include <check.h>
+
+#include <mstdlib/mstdlib.h>
+#include <mstdlib/mstdlib_thread.h>
+#include <mstdlib/mstdlib_io.h>
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define UDP_NUM_DGRAMS 50
+
+static unsigned short server_port;
+static size_t         client_sent;
+static size_t         client_recv;
+static size_t         server_recv;
+static M_bool         peer_ok;
+
+static void udp_server_cb(M_event_t *event, M_event_type_t type, M_io_t *io, void *data)
+{
+	unsigned char buf[256];
+	size_t        len;
+	M_io_meta_t  *meta;
+
+	(void)event;
+	(void)data;
+
+	if (type != M_EVENT_TYPE_READ)
+		return;
+
+	meta = M_io_meta_create();
+	while (M_io_read_meta(io, buf, sizeof(buf), &len, meta) == M_IO_ERROR_SUCCESS) {
+		server_recv++;
+		if (!M_str_eq(M_io_net_udp_meta_get_ipaddr(io, meta), "127.0.0.1") || M_io_net_udp_meta_get_port(io, meta) == 0)
+			peer_ok = M_FALSE;
+		if (M_io_net_udp_meta_get_truncated(io, meta))
+			peer_ok = M_FALSE;
+		/* Peer recorded by the read is the destination */
+		M_io_write_meta(io, buf, len, &len, meta);
+	}
+	M_io_meta_destroy(meta);
+}
+
+
+static void udp_client_cb(M_event_t *event, M_event_type_t type, M_io_t *io, void *data)
+{
+	unsigned char buf[256];
+	char          msg[32];
+	size_t        len;
+	M_io_meta_t  *meta;
+
+	(void)data;
+
+	switch (type) {
+		case M_EVENT_TYPE_CONNECTED:
+		case M_EVENT_TYPE_WRITE:
+			while (client_sent < UDP_NUM_DGRAMS) {
+				M_snprintf(msg, sizeof(msg), "ping %zu", client_sent);
+				if (M_io_write(io, (const unsigned char *)msg, M_str_len(msg), &len) != M_IO_ERROR_SUCCESS)
+					break;
+				client_sent++;
+			}
+			break;
+		case M_EVENT_TYPE_READ:
+			meta = M_io_meta_create();
+			while (M_io_read_meta(io, buf, sizeof(buf), &len, meta) == M_IO_ERROR_SUCCESS) {
+				client_recv++;
+				if (M_io_net_udp_meta_get_port(io, meta) != server_port || len < 5 || !M_mem_eq(buf, (const unsigned char *)"ping ", 5))
+					peer_ok = M_FALSE;
+			}
+			M_io_meta_destroy(meta);
+			if (client_recv == UDP_NUM_DGRAMS)
+				M_event_done(event);
+			break;
+		case M_EVENT_TYPE_DISCONNECTED:
+		case M_EVENT_TYPE_ERROR:
+			peer_ok = M_FALSE;
+			M_event_done(event);
+			break;
+		default:
+			break;
+	}
+}
+
+
+START_TEST(check_event_udp)
+{
+	M_event_t    *event = M_event_create(M_EVENT_FLAG_NONE);
+	M_io_t       *server = NULL;
+	M_io_t       *client = NULL;
+	M_io_meta_t  *meta;
+	size_t        len;
+	M_event_err_t err;
+
+	client_sent = 0;
+	client_recv = 0;
+	server_recv = 0;
+	peer_ok     = M_TRUE;
+
+	ck_assert_msg(M_io_net_udp_create(&server, 0, "127.0.0.1", M_IO_NET_ANY) == M_IO_ERROR_SUCCESS, "failed to create udp server");
+	server_port = M_io_net_udp_get_port(server);
+	ck_assert_msg(server_port != 0, "no port assigned");
+	ck_assert_msg(M_io_net_udp_client_create(&client, "127.0.0.1", server_port, M_IO_NET_ANY) == M_IO_ERROR_SUCCESS, "failed to create udp client");
+
+	/* An unassociated socket needs a destination */
+	ck_assert_msg(M_io_write(server, (const unsigned char *)"x", 1, &len) == M_IO_ERROR_INVALID, "write without a peer should fail");
+	meta = M_io_meta_create();
+	ck_assert_msg(!M_io_net_udp_meta_set_peer(server, meta, "not an ip", 1), "invalid peer accepted");
+	M_io_meta_destroy(meta);
+
+	M_event_add(event, server, udp_server_cb, NULL);
+	M_event_add(event, client, udp_client_cb, NULL);
+
+	err = M_event_loop(event, 5000);
+	ck_assert_msg(err == M_EVENT_ERR_DONE, "event loop did not complete (%d), sent %zu, server recv %zu, client recv %zu", (int)err, client_sent, server_recv, client_recv);
+	ck_assert_msg(peer_ok, "peer address mismatch or unexpected data");
+	ck_assert_msg(M_io_get_state(client) == M_IO_STATE_CONNECTED, "client not in connected state");
+
+	M_io_destroy(client);
+	M_io_destroy(server);
+	M_event_destroy(event);
+	M_library_cleanup();
+}
+END_TEST
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define UDP_BATCH_CNT 100
+
+/* Read until cnt datagrams are received or timeout */
+static size_t udp_read_all(M_io_t *io, M_io_net_udp_dgram_t *dgrams, size_t cnt)
+{
+	size_t       total = 0;
+	size_t       num;
+	M_timeval_t  tv;
+	M_io_error_t err;
+
+	M_time_elapsed_start(&tv);
+	while (total < cnt && M_time_elapsed(&tv) < 2000) {
+		err = M_io_net_udp_read_batch(io, dgrams + total, cnt - total, &num);
+		if (err == M_IO_ERROR_WOULDBLOCK) {
+			M_thread_sleep(1000);
+			continue;
+		}
+		if (err != M_IO_ERROR_SUCCESS)
+			break;
+		total += num;
+	}
+	return total;
+}
+
+
+START_TEST(check_event_udp_batch)
+{
+	const char           *bind_ips[] = { "127.0.0.1", NULL };
+	M_io_t               *server     = NULL;
+	M_io_t               *client     = NULL;
+	unsigned char         ip[16];
+	size_t                ip_len;
+	unsigned short        client_port;
+	M_io_net_udp_dgram_t  dgrams[UDP_BATCH_CNT];
+	unsigned char         bufs[UDP_BATCH_CNT][64];
+	char                  msg[64];
+	size_t                num;
+	size_t                i;
+
+	ck_assert(M_io_net_udp_create(&server, 0, bind_ips[_i], M_IO_NET_ANY) == M_IO_ERROR_SUCCESS);
+	ck_assert(M_io_net_udp_create(&client, 0, "127.0.0.1", M_IO_NET_IPV4) == M_IO_ERROR_SUCCESS);
+	client_port = M_io_net_udp_get_port(client);
+	ck_assert(M_io_net_ipaddr_to_bin(ip, sizeof(ip), "127.0.0.1", &ip_len));
+
+	/* Client -> server */
+	M_mem_set(dgrams, 0, sizeof(dgrams));
+	for (i=0; i<UDP_BATCH_CNT; i++) {
+		M_snprintf((char *)bufs[i], sizeof(bufs[i]), "dgram %zu", i);
+		dgrams[i].buf        = bufs[i];
+		dgrams[i].len        = M_str_len((const char *)bufs[i]);
+		M_mem_copy(dgrams[i].ipaddr, ip, ip_len);
+		dgrams[i].ipaddr_len = ip_len;
+		dgrams[i].port       = M_io_net_udp_get_port(server);
+	}
+	ck_assert(M_io_net_udp_write_batch(client, dgrams, UDP_BATCH_CNT, &num) == M_IO_ERROR_SUCCESS);
+	ck_assert_msg(num == UDP_BATCH_CNT, "sent %zu of %d", num, UDP_BATCH_CNT);
+
+	M_mem_set(dgrams, 0, sizeof(dgrams));
+	M_mem_set(bufs, 0, sizeof(bufs));
+	for (i=0; i<UDP_BATCH_CNT; i++) {
+		dgrams[i].buf      = bufs[i];
+		dgrams[i].buf_size = sizeof(bufs[i]);
+	}
+	num = udp_read_all(server, dgrams, UDP_BATCH_CNT);
+	ck_assert_msg(num == UDP_BATCH_CNT, "received %zu of %d", num, UDP_BATCH_CNT);
+	for (i=0; i<UDP_BATCH_CNT; i++) {
+		M_snprintf(msg, sizeof(msg), "dgram %zu", i);
+		ck_assert_msg(dgrams[i].len == M_str_len(msg) && M_mem_eq(dgrams[i].buf, msg, dgrams[i].len), "datagram %zu mismatch", i);
+		ck_assert_msg(!dgrams[i].truncated, "datagram %zu reported as truncated", i);
+		/* Dual stack sockets report IPv4 peers as IPv4 */
+		ck_assert_msg(dgrams[i].ipaddr_len == 4 && M_mem_eq(dgrams[i].ipaddr, ip, 4), "datagram %zu peer address wrong", i);
+		ck_assert_msg(dgrams[i].port == client_port, "datagram %zu peer port %u, expected %u", i, dgrams[i].port, client_port);
+	}
+
+	/* Echo back using the received peers */
+	ck_assert(M_io_net_udp_write_batch(server, dgrams, UDP_BATCH_CNT, &num) == M_IO_ERROR_SUCCESS);
+	ck_assert(num == UDP_BATCH_CNT);
+	num = udp_read_all(client, dgrams, UDP_BATCH_CNT);
+	ck_assert_msg(num == UDP_BATCH_CNT, "echo received %zu of %d", num, UDP_BATCH_CNT);
+
+	/* Segmentation offload, split by the kernel into 4 datagrams */
+	M_mem_set(dgrams, 0, sizeof(dgrams));
+	M_mem_set(bufs, 'A', sizeof(bufs));
+	dgrams[0].buf          = bufs[0];
+	dgrams[0].len          = sizeof(bufs[0]) * 4;
+	dgrams[0].segment_size = sizeof(bufs[0]);
+	M_mem_copy(dgrams[0].ipaddr, ip, ip_len);
+	dgrams[0].ipaddr_len   = ip_len;
+	dgrams[0].port         = M_io_net_udp_get_port(server);
+	if (M_io_net_udp_write_batch(client, dgrams, 1, &num) == M_IO_ERROR_SUCCESS) {
+		for (i=0; i<4; i++) {
+			dgrams[i].buf      = bufs[i];
+			dgrams[i].buf_size = sizeof(bufs[i]);
+		}
+		num = udp_read_all(server, dgrams, 4);
+		ck_assert_msg(num == 4, "received %zu segments", num);
+		for (i=0; i<4; i++)
+			ck_assert(dgrams[i].len == sizeof(bufs[i]));
+	}
+
+	/* A datagram larger than the buffer is cut short and flagged */
+	M_mem_set(dgrams, 0, sizeof(dgrams));
+	M_mem_set(bufs, 'B', sizeof(bufs));
+	dgrams[0].buf        = bufs[0];
+	dgrams[0].len        = sizeof(bufs[0]);
+	M_mem_copy(dgrams[0].ipaddr, ip, ip_len);
+	dgrams[0].ipaddr_len = ip_len;
+	dgrams[0].port       = M_io_net_udp_get_port(server);
+	ck_assert(M_io_net_udp_write_batch(client, dgrams, 1, &num) == M_IO_ERROR_SUCCESS);
+	M_mem_set(dgrams, 0, sizeof(dgrams));
+	dgrams[0].buf      = bufs[1];
+	dgrams[0].buf_size = 8;
+	num = udp_read_all(server, dgrams, 1);
+	ck_assert_msg(num == 1, "received %zu truncated datagrams", num);
+	ck_assert_msg(dgrams[0].len == 8 && dgrams[0].truncated, "len %zu, truncated %d", dgrams[0].len, (int)dgrams[0].truncated);
+
+	M_io_destroy(client);
+	M_io_destroy(server);
+	M_library_cleanup();
+}
+END_TEST
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static Suite *event_udp_suite(void)
+{
+	Suite *suite;
+	TCase *tc_event_udp;
+	TCase *tc_event_udp_batch;
+
+	suite = suite_create("event_udp");
+
+	tc_event_udp = tcase_create("event_udp");
+	tcase_add_test(tc_event_udp, check_event_udp);
+	suite_add_tcase(suite, tc_event_udp);
+
+	tc_event_udp_batch = tcase_create("event_udp_batch");
+	tcase_add_loop_test(tc_event_udp_batch, check_event_udp_batch, 0, 2);
+	suite_add_tcase(suite, tc_event_udp_batch);
+
+	return suite;
+}
+
+int main(int argc, char **argv)
+{
+	SRunner *sr;
+	int      nf;
+
+	(void)argc;
+	(void)argv;
+
+	sr = srunner_create(event_udp_suite());
+	if (getenv("CK_LOG_FILE_NAME")==NULL) srunner_set_log(sr, "check_event_udp.log");
+
+	srunner_run_all(sr, CK_NORMAL);
+	nf = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return nf == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,149 @@
+#include "m_config.h"
+#include <stdlib.h> /* EXIT_SUCCESS, EXIT_FAILURE, srand, rand */
+#include <check.h>
+
+#include <mstdlib/mstdlib_thread.h>
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+extern Suite *M_cache_concurrent_suite(void);
+
+#define NUM_THREADS 8
+#define NUM_KEYS    500
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void *copy_str(const void *val)
+{
+	return M_strdup(val);
+}
+
+static void *cache_worker(void *arg)
+{
+	M_cache_concurrent_strvp_t *c = arg;
+	char                        key[32];
+	char                       *val;
+	size_t                      i;
+	size_t                      j;
+
+	/* All threads work on the same keys so entries are replaced and evicted
+	 * while other threads are reading them. */
+	for (j=0; j<4; j++) {
+		for (i=0; i<NUM_KEYS; i++) {
+			M_snprintf(key, sizeof(key), "key%zu", i);
+			M_cache_concurrent_strvp_insert_ext(c, key, M_strdup(key), M_str_len(key), 0);
+			if (M_cache_concurrent_strvp_get_copy(c, key, copy_str, (void **)&val)) {
+				if (!M_str_eq(val, key)) {
+					M_free(val);
+					return (void *)1;
+				}
+				M_free(val);
+			}
+		}
+	}
+	return NULL;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+START_TEST(check_basic)
+{
+	M_cache_concurrent_strvp_t *c;
+	M_cache_stats_t             stats;
+	char                       *val;
+
+	c = M_cache_concurrent_strvp_create(64, 4, M_CACHE_STRVP_CASECMP, M_free);
+	ck_assert(M_cache_concurrent_num_shards((M_cache_concurrent_t *)c) == 4);
+	ck_assert(M_cache_concurrent_max_size((M_cache_concurrent_t *)c) == 64);
+
+	ck_assert(!M_cache_concurrent_strvp_insert(c, "", NULL));
+	ck_assert(M_cache_concurrent_strvp_insert(c, "key1", M_strdup("val1")));
+	ck_assert(M_cache_concurrent_strvp_get(c, "KEY1", (void **)&val) && M_str_eq(val, "val1"));
+	ck_assert(M_cache_concurrent_strvp_get_copy(c, "key1", copy_str, (void **)&val) && M_str_eq(val, "val1"));
+	M_free(val);
+	ck_assert(!M_cache_concurrent_strvp_get(c, "key2", NULL));
+	ck_assert(M_cache_concurrent_strvp_size(c) == 1);
+
+	ck_assert(M_cache_concurrent_strvp_remove(c, "key1"));
+	ck_assert(M_cache_concurrent_strvp_size(c) == 0);
+
+	M_cache_concurrent_strvp_stats(c, &stats);
+	ck_assert(stats.hits == 2);
+	ck_assert(stats.misses == 1);
+
+	M_cache_concurrent_strvp_destroy(c);
+}
+END_TEST
+
+START_TEST(check_threads)
+{
+	M_cache_concurrent_strvp_t *c;
+	M_thread_attr_t            *tattr;
+	M_threadid_t                threads[NUM_THREADS];
+	M_cache_stats_t             stats;
+	void                       *ret;
+	size_t                      i;
+
+	c = M_cache_concurrent_strvp_create(256, 0, M_CACHE_STRVP_TINYLFU, M_free);
+	M_cache_concurrent_strvp_set_max_weight(c, 1024);
+
+	tattr = M_thread_attr_create();
+	M_thread_attr_set_create_joinable(tattr, M_TRUE);
+	for (i=0; i<NUM_THREADS; i++) {
+		threads[i] = M_thread_create(tattr, cache_worker, c);
+	}
+	for (i=0; i<NUM_THREADS; i++) {
+		ret = NULL;
+		M_thread_join(threads[i], &ret);
+		ck_assert_msg(ret == NULL, "thread %zu failed", i);
+	}
+	M_thread_attr_destroy(tattr);
+
+	/* Limits are per shard so the totals can be slightly over when rounded up. */
+	ck_assert(M_cache_concurrent_strvp_size(c) <= 256 + M_cache_concurrent_num_shards((M_cache_concurrent_t *)c));
+	ck_assert(M_cache_concurrent_weight((M_cache_concurrent_t *)c) <= 1024 + M_cache_concurrent_num_shards((M_cache_concurrent_t *)c));
+
+	M_cache_concurrent_strvp_stats(c, &stats);
+	ck_assert(stats.hits + stats.misses == NUM_THREADS * NUM_KEYS * 4);
+
+	M_cache_concurrent_strvp_destroy(c);
+}
+END_TEST
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+Suite *M_cache_concurrent_suite(void)
+{
+	Suite *suite = suite_create("cache_concurrent");
+	TCase *tc_basic;
+	TCase *tc_threads;
+
+	tc_basic = tcase_create("cache_concurrent_basic");
+	tcase_add_unchecked_fixture(tc_basic, NULL, NULL);
+	tcase_add_test(tc_basic, check_basic);
+	suite_add_tcase(suite, tc_basic);
+
+	tc_threads = tcase_create("cache_concurrent_threads");
+	tcase_add_unchecked_fixture(tc_threads, NULL, NULL);
+	tcase_add_test(tc_threads, check_threads);
+	suite_add_tcase(suite, tc_threads);
+
+	return suite;
+}
+
+int main(void)
+{
+	SRunner *sr;
+	int      nf;
+
+	sr = srunner_create(M_cache_concurrent_suite());
+	if (getenv("CK_LOG_FILE_NAME")==NULL) srunner_set_log(sr, "check_cache_concurrent.log");
+
+	srunner_run_all(sr, CK_NORMAL);
+	nf = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	M_library_cleanup();
+
+	return nf == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,214 @@
+#include "m_config.h"
+#include <stdlib.h> /* EXIT_SUCCESS, EXIT_FAILURE, srand, rand */
+#include <check.h>
+
+#include <mstdlib/mstdlib_thread.h>
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+extern Suite *M_hash_concurrent_suite(void);
+
+#define NUM_THREADS 8
+#define NUM_KEYS    2000
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct {
+	M_hash_concurrent_u64vp_t *h;
+	M_uint64                   id;
+	volatile M_uint32         *created;
+} worker_data_t;
+
+static void *create_val(const void *key, void *thunk)
+{
+	M_atomic_inc_u32(thunk);
+	return (void *)(M_uintptr)(*((const M_uint64 *)key) + 1);
+}
+
+static void *create_str(const void *key, void *thunk)
+{
+	(void)thunk;
+	return M_strdup(key);
+}
+
+static void *compute_worker(void *arg)
+{
+	worker_data_t *data = arg;
+	M_uint64       i;
+
+	for (i=0; i<NUM_KEYS; i++) {
+		if (M_hash_concurrent_u64vp_compute_if_absent(data->h, i, create_val, M_CAST_OFF_CONST(M_uint32 *, data->created)) != (void *)(M_uintptr)(i+1)) {
+			return (void *)1;
+		}
+	}
+	return NULL;
+}
+
+static void *modify_worker(void *arg)
+{
+	worker_data_t *data = arg;
+	M_uint64       base = data->id * NUM_KEYS;
+	M_uint64       i;
+	void          *val;
+
+	/* Each thread owns its own range of keys so the results are predictable. */
+	for (i=base; i<base+NUM_KEYS; i++) {
+		if (!M_hash_concurrent_u64vp_insert(data->h, i, (void *)(M_uintptr)(i+1)))
+			return (void *)1;
+	}
+	for (i=base; i<base+NUM_KEYS; i++) {
+		if (!M_hash_concurrent_u64vp_get(data->h, i, &val) || val != (void *)(M_uintptr)(i+1))
+			return (void *)1;
+		if (i % 2 == 0 && !M_hash_concurrent_u64vp_remove(data->h, i, M_FALSE))
+			return (void *)1;
+	}
+	return NULL;
+}
+
+static void run_workers(M_hash_concurrent_u64vp_t *h, void *(*func)(void *), volatile M_uint32 *created)
+{
+	M_thread_attr_t *tattr;
+	M_threadid_t     threads[NUM_THREADS];
+	worker_data_t    data[NUM_THREADS];
+	void            *ret;
+	size_t           i;
+
+	tattr = M_thread_attr_create();
+	M_thread_attr_set_create_joinable(tattr, M_TRUE);
+	for (i=0; i<NUM_THREADS; i++) {
+		data[i].h       = h;
+		data[i].id      = i;
+		data[i].created = created;
+		threads[i]      = M_thread_create(tattr, func, &data[i]);
+	}
+	for (i=0; i<NUM_THREADS; i++) {
+		ret = NULL;
+		M_thread_join(threads[i], &ret);
+		ck_assert_msg(ret == NULL, "thread %zu failed", i);
+	}
+	M_thread_attr_destroy(tattr);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+START_TEST(check_strvp)
+{
+	M_hash_concurrent_strvp_t *h;
+	M_hash_concurrent_enum_t  *hashenum;
+	const char                *key;
+	void                      *val;
+	size_t                     cnt = 0;
+
+	h = M_hash_concurrent_strvp_create(8, 75, 4, M_HASH_STRVP_CASECMP, M_free);
+	ck_assert(h != NULL);
+	ck_assert(M_hash_concurrent_num_shards((M_hash_concurrent_t *)h) == 4);
+
+	ck_assert(!M_hash_concurrent_strvp_insert(h, "", NULL));
+	ck_assert(M_hash_concurrent_strvp_insert(h, "a", M_strdup("1")));
+	ck_assert(M_hash_concurrent_strvp_insert(h, "b", M_strdup("2")));
+	ck_assert(M_hash_concurrent_strvp_get(h, "A", &val) && M_str_eq(val, "1"));
+
+	/* Existing value is returned instead of creating a new one. */
+	ck_assert(M_str_eq(M_hash_concurrent_strvp_compute_if_absent(h, "B", create_str, NULL), "2"));
+	ck_assert(M_str_eq(M_hash_concurrent_strvp_compute_if_absent(h, "c", create_str, NULL), "c"));
+	ck_assert(M_hash_concurrent_strvp_num_keys(h) == 3);
+
+	/* Snapshot isn't affected by later changes. */
+	ck_assert(M_hash_concurrent_strvp_enumerate(h, &hashenum) == 3);
+	ck_assert(M_hash_concurrent_strvp_remove(h, "a", M_TRUE));
+	ck_assert(!M_hash_concurrent_strvp_get(h, "a", NULL));
+	while (M_hash_concurrent_strvp_enumerate_next(hashenum, &key, NULL)) {
+		ck_assert(M_str_eq(key, "a") || M_str_eq(key, "b") || M_str_eq(key, "c"));
+		cnt++;
+	}
+	ck_assert(cnt == 3);
+	M_hash_concurrent_enumerate_free(hashenum);
+
+	M_hash_concurrent_strvp_destroy(h, M_TRUE);
+}
+END_TEST
+
+START_TEST(check_compute_if_absent)
+{
+	M_hash_concurrent_u64vp_t *h;
+	volatile M_uint32          created = 0;
+
+	h = M_hash_concurrent_u64vp_create(16, 75, 0, M_HASH_U64VP_NONE, NULL);
+
+	/* Every thread races for the same keys but each value must only be created once. */
+	run_workers(h, compute_worker, &created);
+	ck_assert_msg(created == NUM_KEYS, "created %u != %u", created, NUM_KEYS);
+	ck_assert(M_hash_concurrent_u64vp_num_keys(h) == NUM_KEYS);
+
+	M_hash_concurrent_u64vp_destroy(h, M_FALSE);
+}
+END_TEST
+
+START_TEST(check_modify)
+{
+	M_hash_concurrent_u64vp_t *h;
+	M_hash_concurrent_enum_t  *hashenum;
+	M_uint64                   key;
+	void                      *val;
+	size_t                     cnt = 0;
+
+	h = M_hash_concurrent_u64vp_create(16, 75, 16, M_HASH_U64VP_INCREMENTAL_REHASH, NULL);
+
+	run_workers(h, modify_worker, NULL);
+	ck_assert(M_hash_concurrent_u64vp_num_keys(h) == NUM_THREADS * NUM_KEYS / 2);
+
+	ck_assert(M_hash_concurrent_u64vp_enumerate(h, &hashenum) == NUM_THREADS * NUM_KEYS / 2);
+	while (M_hash_concurrent_u64vp_enumerate_next(hashenum, &key, &val)) {
+		ck_assert(key % 2 == 1 && val == (void *)(M_uintptr)(key+1));
+		cnt++;
+	}
+	ck_assert(cnt == NUM_THREADS * NUM_KEYS / 2);
+	M_hash_concurrent_enumerate_free(hashenum);
+
+	M_hash_concurrent_u64vp_destroy(h, M_FALSE);
+}
+END_TEST
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+Suite *M_hash_concurrent_suite(void)
+{
+	Suite *suite = suite_create("hash_concurrent");
+	TCase *tc_strvp;
+	TCase *tc_compute_if_absent;
+	TCase *tc_modify;
+
+	tc_strvp = tcase_create("hash_concurrent_strvp");
+	tcase_add_unchecked_fixture(tc_strvp, NULL, NULL);
+	tcase_add_test(tc_strvp, check_strvp);
+	suite_add_tcase(suite, tc_strvp);
+
+	tc_compute_if_absent = tcase_create("hash_concurrent_compute_if_absent");
+	tcase_add_unchecked_fixture(tc_compute_if_absent, NULL, NULL);
+	tcase_add_test(tc_compute_if_absent, check_compute_if_absent);
+	suite_add_tcase(suite, tc_compute_if_absent);
+
+	tc_modify = tcase_create("hash_concurrent_modify");
+	tcase_add_unchecked_fixture(tc_modify, NULL, NULL);
+	tcase_add_test(tc_modify, check_modify);
+	suite_add_tcase(suite, tc_modify);
+
+	return suite;
+}
+
+int main(void)
+{
+	SRunner *sr;
+	int      nf;
+
+	sr = srunner_create(M_hash_concurrent_suite());
+	if (getenv("CK_LOG_FILE_NAME")==NULL) srunner_set_log(sr, "check_hash_concurrent.log");
+
+	srunner_run_all(sr, CK_NORMAL);
+	nf = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	M_library_cleanup();
+
+	return nf == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
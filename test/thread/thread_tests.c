@@ -257,6 +257,24 @@ START_TEST(check_cpu_cores)
 }
 END_TEST
 
+START_TEST(check_cpu_topology)
+{
+	M_thread_cpu_topology_t topo;
+	size_t                  num_cores = M_thread_num_cpu_cores();
+	size_t                  i;
+
+	ck_assert_msg(!M_thread_get_processor_topology(-1, &topo), "Topology returned for processor -1");
+	ck_assert_msg(!M_thread_get_processor_topology((int)num_cores, &topo), "Topology returned for processor past last core");
+	ck_assert_msg(topo.socket == 0 && topo.core == 0 && topo.numa_node == 0, "Topology not cleared on failure");
+	ck_assert_msg(!M_thread_get_processor_topology(0, NULL), "Topology succeeded without output");
+
+	/* Not all systems can report placement, only check that each processor can be queried */
+	for (i=0; i<num_cores; i++) {
+		M_thread_get_processor_topology((int)i, &topo);
+	}
+}
+END_TEST
+
 START_TEST(check_sleeper)
 {
 #define NUM_SLEEPER_THREADS 100
@@ -1067,6 +1085,26 @@ START_TEST(check_pipeline)
 }
 END_TEST
 
+START_TEST(check_library_cleanup)
+{
+	M_mempool_stats_t  stats;
+	void              *ptrs[16];
+	size_t             i;
+
+	for (i=0; i<16; i++)
+		ptrs[i] = M_mempool_malloc(32);
+	for (i=0; i<16; i++)
+		M_free(ptrs[i]);
+	M_mempool_thread_stats(&stats);
+	ck_assert(stats.resident_bytes > 0);
+
+	/* This thread wasn't created by M_thread_create so cleanup has to release its pool. */
+	M_library_cleanup();
+	M_mempool_thread_stats(&stats);
+	ck_assert_msg(stats.resident_bytes == 0, "%zu bytes still held after cleanup", stats.resident_bytes);
+}
+END_TEST
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static Suite *M_thread_suite(M_thread_model_t model, const char *name)
@@ -1091,6 +1129,10 @@ static Suite *M_thread_suite(M_thread_model_t model, const char *name)
 	tcase_add_test(tc, check_cpu_cores);
 	suite_add_tcase(suite, tc);
 
+	tc = tcase_create("check_cpu_topology");
+	tcase_add_test(tc, check_cpu_topology);
+	suite_add_tcase(suite, tc);
+
 	tc = tcase_create("check_sleeper");
 	tcase_add_test(tc, check_sleeper);
 	tcase_set_timeout(tc, 10);
@@ -1162,5 +1204,10 @@ static Suite *M_thread_suite(M_thread_model_t model, const char *name)
 	tcase_add_test(tc, check_pipeline);
 	suite_add_tcase(suite, tc);
 
+	/* Must be last, it tears down the thread model. */
+	tc = tcase_create("check_library_cleanup");
+	tcase_add_test(tc, check_library_cleanup);
+	suite_add_tcase(suite, tc);
+
 	return suite;
 }
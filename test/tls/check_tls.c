@@ -341,7 +341,7 @@ static const char *event_err_msg(M_event_err_t err)
 }
 
 
-static M_event_err_t check_tls_test(M_uint64 num_connections)
+static M_event_err_t check_tls_test(M_uint64 num_connections, M_bool offload)
 {
 	M_event_t          *event = M_event_pool_create(0);
 	//M_event_t        *event = M_event_create(M_EVENT_FLAG_NONE);
@@ -359,6 +359,7 @@ static M_event_err_t check_tls_test(M_uint64 num_connections)
 	M_list_str_t       *applist;
 	M_io_error_t        ioerr;
 	M_uint16            port = 0;
+	M_threadpool_t     *pool = NULL;
 	const char * const hosts[] = { "localhost"
 #ifdef RANDOMIZE_HOSTS
 	, "127.0.0.1", "::1"
@@ -470,6 +471,15 @@ static M_event_err_t check_tls_test(M_uint64 num_connections)
 	//M_tls_clientctx_set_protocols(clientctx, M_TLS_PROTOCOL_TLSv1_2);
 	M_tls_clientctx_set_applications(clientctx, applist);
 
+	/* Small queue so some steps run inline when it's full */
+	if (offload)
+		pool = M_threadpool_create(2, 2, 0, 2);
+
+	if (pool != NULL && !M_tls_clientctx_set_handshake_pool(clientctx, pool)) {
+		event_debug("failed to set clientctx handshake pool");
+		return M_EVENT_ERR_RETURN;
+	}
+
 	/* GENERATE SERVER CTX */
 	M_list_str_remove_first(applist); /* Alter app list */
 
@@ -493,6 +503,18 @@ static M_event_err_t check_tls_test(M_uint64 num_connections)
 		return M_EVENT_ERR_RETURN;
 	}
 
+	if (pool != NULL) {
+		if (!M_tls_serverctx_set_handshake_pool(serverctx, pool)) {
+			event_debug("failed to set serverctx handshake pool");
+			return M_EVENT_ERR_RETURN;
+		}
+		/* SNI children use the parent's pool */
+		if (M_tls_serverctx_set_handshake_pool(child_serverctx, pool)) {
+			event_debug("handshake pool allowed on child serverctx");
+			return M_EVENT_ERR_RETURN;
+		}
+	}
+
 	/* CLEAN UP */
 	M_list_str_destroy(applist);
 	M_free(boguskey);
@@ -557,6 +579,8 @@ static M_event_err_t check_tls_test(M_uint64 num_connections)
 	event_debug("%zu remaining objects", M_event_num_objects(event));
 	/* Cleanup */
 
+	/* Pool first, a finished step may still be telling the event loop about it */
+	M_threadpool_destroy(pool);
 	M_event_destroy(event);
 
 	M_tls_clientctx_destroy(clientctx);
@@ -577,8 +601,9 @@ START_TEST(check_tls)
 	M_uint64 tests[] = {  1,  25, 50, /*  100,  200, -- disable because of mac */ 0 };
 	size_t   i;
 
+	/* Second run offloads handshakes to a thread pool */
 	for (i=0; tests[i] != 0; i++) {
-		M_event_err_t err = check_tls_test(tests[i]);
+		M_event_err_t err = check_tls_test(tests[i], (_i == 1)?M_TRUE:M_FALSE);
 		ck_assert_msg(err == M_EVENT_ERR_DONE, "%d cnt%d expected M_EVENT_ERR_DONE got %s", (int)i, (int)tests[i], event_err_msg(err));
 	}
 
@@ -602,12 +627,13 @@ static void net_serverconn_sad_cb(M_event_t *event, M_event_type_t type, M_io_t
 	event_debug("net serverconn %p event %s triggered", comm, event_type_str(type));
 	switch (type) {
 		case M_EVENT_TYPE_CONNECTED:
-			event_debug("net serverconn Connected %s [%s]:%u:%u, (TLS: %llums %s %s %s)",
+			event_debug("net serverconn Connected %s [%s]:%u:%u, (TLS: %llums %s %s %s, ktls %d)",
 				net_type(M_io_net_get_type(comm)), M_io_net_get_ipaddr(comm), M_io_net_get_port(comm), M_io_net_get_ephemeral_port(comm),
 				M_tls_get_negotiation_time_ms(comm, M_IO_LAYER_FIND_FIRST_ID),
 				tls_protocol_name(M_tls_get_protocol(comm, M_IO_LAYER_FIND_FIRST_ID)),
 				M_tls_get_cipher(comm, M_IO_LAYER_FIND_FIRST_ID),
-				M_tls_get_sessionreused(comm, M_IO_LAYER_FIND_FIRST_ID)?"session reused":"session not reused");
+				M_tls_get_sessionreused(comm, M_IO_LAYER_FIND_FIRST_ID)?"session reused":"session not reused",
+				(int)M_tls_get_ktls(comm, M_IO_LAYER_FIND_FIRST_ID));
 
 			/* Populate send buffer (as efficiently as possible otherwise valgrind might puke) */
 			wbuf   = M_buf_create();
@@ -740,7 +766,7 @@ static void net_client_sad_cb(M_event_t *event, M_event_type_t type, M_io_t *com
 	}
 }
 
-static M_event_err_t check_tls_sendanddisconnect_test(void)
+static M_event_err_t check_tls_sendanddisconnect_test(M_bool ktls)
 {
 	M_event_t          *event = M_event_pool_create(0);
 	//M_event_t        *event = M_event_create(M_EVENT_FLAG_NONE);
@@ -826,6 +852,12 @@ static M_event_err_t check_tls_sendanddisconnect_test(void)
 	}
 
 
+	/* Falls back to user space records if the kernel can't do it */
+	if (ktls && (!M_tls_clientctx_set_ktls(clientctx, M_TRUE) || !M_tls_serverctx_set_ktls(serverctx, M_TRUE))) {
+		event_debug("failed to enable ktls");
+		return M_EVENT_ERR_RETURN;
+	}
+
 	/* CLEAN UP */
 	M_free(realkey);
 	M_free(realcert);
@@ -895,12 +927,240 @@ static M_event_err_t check_tls_sendanddisconnect_test(void)
 
 START_TEST(check_tls_sendanddisconnect)
 {
-	M_event_err_t err = check_tls_sendanddisconnect_test();
+	M_event_err_t err = check_tls_sendanddisconnect_test(_i == 1?M_TRUE:M_FALSE);
 	ck_assert_msg(err == M_EVENT_ERR_DONE, "expected M_EVENT_ERR_DONE got %s", event_err_msg(err));
 }
 END_TEST
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef enum {
+	SESSION_TEST_STORE         = 0, /* Session ids, shared through an external store */
+	SESSION_TEST_TICKET_SECRET = 1, /* Tickets, keys derived from a shared secret    */
+	SESSION_TEST_TICKET_RANDOM = 2  /* Tickets, random keys known to one context     */
+} session_test_t;
+
+static M_hash_strbin_t *session_store;
+static size_t           session_store_cnt;
+static M_io_t          *session_serverconn;
+static int              session_reused;
+
+static char *session_store_key(const unsigned char *id, size_t id_len)
+{
+	return M_bincodec_encode_alloc(id, id_len, 0, M_BINCODEC_HEX);
+}
+
+static M_bool session_store_cb(const unsigned char *id, size_t id_len, const unsigned char *data, size_t data_len, M_time_t expire, void *thunk)
+{
+	char *key = session_store_key(id, id_len);
+
+	(void)thunk;
+
+	ck_assert(expire > M_time());
+	M_hash_strbin_insert(session_store, key, data, data_len);
+	session_store_cnt++;
+	M_free(key);
+	return M_TRUE;
+}
+
+static unsigned char *session_fetch_cb(const unsigned char *id, size_t id_len, size_t *data_len, void *thunk)
+{
+	char                *key  = session_store_key(id, id_len);
+	const unsigned char *data;
+
+	(void)thunk;
+
+	data = M_hash_strbin_get_direct(session_store, key, data_len);
+	M_free(key);
+	if (data == NULL)
+		return NULL;
+	return M_memdup(data, *data_len);
+}
+
+static void session_remove_cb(const unsigned char *id, size_t id_len, void *thunk)
+{
+	char *key = session_store_key(id, id_len);
+
+	(void)thunk;
+
+	M_hash_strbin_remove(session_store, key);
+	M_free(key);
+}
+
+static void session_serverconn_cb(M_event_t *event, M_event_type_t type, M_io_t *comm, void *data)
+{
+	size_t mysize;
+
+	(void)event;
+	(void)data;
+
+	switch (type) {
+		case M_EVENT_TYPE_CONNECTED:
+			/* Client reads this after any tickets */
+			M_io_write(comm, (const unsigned char *)"Hello", 5, &mysize);
+			break;
+		case M_EVENT_TYPE_DISCONNECTED:
+		case M_EVENT_TYPE_ERROR:
+			M_io_destroy(comm);
+			session_serverconn = NULL;
+			break;
+		default:
+			break;
+	}
+}
+
+static void session_server_cb(M_event_t *event, M_event_type_t type, M_io_t *comm, void *data)
+{
+	M_io_t *newcomm;
+
+	(void)data;
+
+	if (type != M_EVENT_TYPE_ACCEPT)
+		return;
+
+	while (M_io_accept(&newcomm, comm) == M_IO_ERROR_SUCCESS) {
+		session_serverconn = newcomm;
+		M_event_add(event, newcomm, session_serverconn_cb, NULL);
+	}
+}
+
+static void session_client_cb(M_event_t *event, M_event_type_t type, M_io_t *comm, void *data)
+{
+	unsigned char buf[64];
+	size_t        mysize;
+
+	(void)data;
+
+	switch (type) {
+		case M_EVENT_TYPE_CONNECTED:
+			session_reused = M_tls_get_sessionreused(comm, M_IO_LAYER_FIND_FIRST_ID)?1:0;
+			break;
+		case M_EVENT_TYPE_READ:
+			M_io_read(comm, buf, sizeof(buf), &mysize);
+			M_io_disconnect(comm);
+			break;
+		case M_EVENT_TYPE_DISCONNECTED:
+		case M_EVENT_TYPE_ERROR:
+			M_io_destroy(comm);
+			M_event_done(event);
+			break;
+		default:
+			break;
+	}
+}
+
+/* Each round uses a new server context, as if the certificate was reloaded */
+static M_tls_serverctx_t *session_serverctx(session_test_t test, const char *key, const char *cert)
+{
+	static const struct M_tls_session_store_callbacks store_cbs = {
+		session_store_cb,
+		session_fetch_cb,
+		session_remove_cb
+	};
+	const unsigned char secret[] = "0123456789abcdef0123456789abcdef";
+	M_tls_serverctx_t  *serverctx;
+
+	serverctx = M_tls_serverctx_create((const M_uint8 *)key, M_str_len(key), (const M_uint8 *)cert, M_str_len(cert), NULL, 0);
+	ck_assert(serverctx != NULL);
+
+	switch (test) {
+		case SESSION_TEST_STORE:
+			ck_assert(M_tls_serverctx_set_session_store(serverctx, &store_cbs, NULL));
+			ck_assert(M_tls_serverctx_set_session_tickets(serverctx, M_FALSE));
+			break;
+		case SESSION_TEST_TICKET_SECRET:
+			ck_assert(!M_tls_serverctx_set_ticket_keys(serverctx, secret, 16, 3600));
+			ck_assert(M_tls_serverctx_set_ticket_keys(serverctx, secret, sizeof(secret) - 1, 3600));
+			break;
+		case SESSION_TEST_TICKET_RANDOM:
+			ck_assert(M_tls_serverctx_set_ticket_keys(serverctx, NULL, 0, 3600));
+			break;
+	}
+
+	return serverctx;
+}
+
+START_TEST(check_tls_session_resume)
+{
+	session_test_t     test = (session_test_t)_i;
+	M_event_t         *event;
+	M_dns_t           *mydns;
+	M_io_t            *server;
+	M_io_t            *client;
+	M_tls_x509_t      *x509;
+	M_tls_clientctx_t *clientctx;
+	M_tls_serverctx_t *serverctx;
+	char              *key;
+	char              *cert;
+	M_event_err_t      err;
+	M_uint16           port = 0;
+	size_t             round;
+
+	session_store     = M_hash_strbin_create(16, 75, M_HASH_STRBIN_NONE);
+	session_store_cnt = 0;
+
+	key  = M_tls_rsa_generate_key(2048);
+	ck_assert(key != NULL);
+	x509 = M_tls_x509_new(key);
+	ck_assert(x509 != NULL);
+	ck_assert(M_tls_x509_txt_add(x509, M_TLS_X509_TXT_COMMONNAME, "localhost", M_FALSE));
+	ck_assert(M_tls_x509_txt_SAN_add(x509, M_TLS_X509_SAN_TYPE_IP, "127.0.0.1", M_TRUE));
+	cert = M_tls_x509_selfsign(x509, 365 * 24 * 60 * 60 /* 1 year */);
+	ck_assert(cert != NULL);
+	M_tls_x509_destroy(x509);
+
+	clientctx = M_tls_clientctx_create();
+	ck_assert(clientctx != NULL);
+	ck_assert(M_tls_clientctx_set_trust_cert(clientctx, (const M_uint8 *)cert, M_str_len(cert)));
+	ck_assert(M_tls_clientctx_set_session_cache(clientctx, 4, 600));
+
+	for (round=0; round<2; round++) {
+		event              = M_event_create(M_EVENT_FLAG_NONE);
+		mydns              = M_dns_create(event);
+		serverctx          = session_serverctx(test, key, cert);
+		session_serverconn = NULL;
+		session_reused     = -1;
+
+		/* Sessions are cached per host and port */
+		ck_assert(M_io_net_server_create(&server, port, "127.0.0.1", M_IO_NET_ANY) == M_IO_ERROR_SUCCESS);
+		port = M_io_net_get_port(server);
+		ck_assert(M_io_tls_server_add(server, serverctx, NULL) == M_IO_ERROR_SUCCESS);
+		ck_assert(M_io_net_client_create(&client, mydns, "127.0.0.1", port, M_IO_NET_ANY) == M_IO_ERROR_SUCCESS);
+		ck_assert(M_io_tls_client_add(client, clientctx, NULL, NULL) == M_IO_ERROR_SUCCESS);
+		M_event_add(event, server, session_server_cb, NULL);
+		M_event_add(event, client, session_client_cb, NULL);
+
+		err = M_event_loop(event, 10000);
+		ck_assert_msg(err == M_EVENT_ERR_DONE, "round %zu expected M_EVENT_ERR_DONE got %s", round, event_err_msg(err));
+
+		if (round == 0) {
+			ck_assert_msg(session_reused == 0, "first connection reused a session");
+		} else if (test == SESSION_TEST_TICKET_RANDOM) {
+			ck_assert_msg(session_reused == 0, "ticket accepted by a context with different keys");
+		} else {
+			ck_assert_msg(session_reused == 1, "session not resumed by new server context");
+		}
+
+		M_io_destroy(session_serverconn);
+		M_io_destroy(server);
+		M_dns_destroy(mydns);
+		M_event_destroy(event);
+		M_tls_serverctx_destroy(serverctx);
+	}
+
+	if (test == SESSION_TEST_STORE)
+		ck_assert_msg(session_store_cnt > 0, "no sessions stored");
+
+	M_tls_clientctx_destroy(clientctx);
+	M_free(key);
+	M_free(cert);
+	M_hash_strbin_destroy(session_store);
+	M_library_cleanup();
+}
+END_TEST
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static Suite *tls_suite(void)
@@ -911,13 +1171,18 @@ static Suite *tls_suite(void)
 	suite = suite_create("tls");
 
 	tc = tcase_create("tls");
-	tcase_set_timeout(tc, 60);
-	tcase_add_test(tc, check_tls);
+	tcase_set_timeout(tc, 120);
+	tcase_add_loop_test(tc, check_tls, 0, 2);
 	suite_add_tcase(suite, tc);
 
 	tc = tcase_create("tls send and disconnect");
 	tcase_set_timeout(tc, 30);
-	tcase_add_test(tc, check_tls_sendanddisconnect);
+	tcase_add_loop_test(tc, check_tls_sendanddisconnect, 0, 2);
+	suite_add_tcase(suite, tc);
+
+	tc = tcase_create("tls session resume");
+	tcase_set_timeout(tc, 30);
+	tcase_add_loop_test(tc, check_tls_session_resume, 0, 3);
 	suite_add_tcase(suite, tc);
 
 	return suite;
@@ -0,0 +1,436 @@
+/* The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Monetra Technologies, LLC.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "m_config.h"
+
+#include <mstdlib/mstdlib_thread.h>
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+/*! Upper bound on the number of shards. */
+#define M_CACHE_CONCURRENT_MAX_SHARDS      256
+/*! When choosing the number of shards automatically each shard should be able
+ *  to hold at least this many entries so LRU and TinyLFU have something to work with. */
+#define M_CACHE_CONCURRENT_MIN_SHARD_SIZE  16
+
+/*! A portion of the cache. Keys are assigned to a shard by hash. */
+typedef struct {
+	M_thread_mutex_t *lock;  /*!< Protects cache. Lookups modify the cache so a mutex is used. */
+	M_cache_t        *cache; /*!< Entries belonging to this shard. */
+} M_cache_concurrent_shard_t;
+
+struct M_cache_concurrent {
+	M_cache_concurrent_shard_t *shards;     /*!< Shards. */
+	size_t                      num_shards; /*!< Number of shards. Power of 2. */
+	M_hashtable_hash_func       key_hash;   /*!< Hash used to pick a shard. */
+	M_uint32                    seed;       /*!< Seed for key_hash. */
+	size_t                      max_size;   /*!< Total maximum number of entries. */
+	size_t                      max_weight; /*!< Total maximum weight. */
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static M_cache_concurrent_shard_t *M_cache_concurrent_shard(const M_cache_concurrent_t *c, const void *key)
+{
+	M_uint32 hash;
+
+	hash  = c->key_hash(key, c->seed);
+	hash ^= hash >> 16;
+	return &c->shards[hash & (c->num_shards - 1)];
+}
+
+
+/*! Portion of a total capacity given to each shard. */
+static size_t M_cache_concurrent_shard_capacity(const M_cache_concurrent_t *c, size_t total)
+{
+	if (total == 0)
+		return 0;
+	return (total + c->num_shards - 1) / c->num_shards;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+M_cache_concurrent_t *M_cache_concurrent_create(size_t max_size, size_t num_shards,
+		M_hashtable_hash_func key_hash, M_sort_compar_t key_equality,
+		M_uint32 flags, const struct M_cache_callbacks *callbacks)
+{
+	M_cache_concurrent_t *c;
+	size_t                shards = 1;
+	size_t                i;
+
+	if (num_shards == 0) {
+		num_shards = M_thread_num_cpu_cores() * 4;
+		while (num_shards > 1 && max_size / num_shards < M_CACHE_CONCURRENT_MIN_SHARD_SIZE)
+			num_shards >>= 1;
+	}
+	if (num_shards > M_CACHE_CONCURRENT_MAX_SHARDS)
+		num_shards = M_CACHE_CONCURRENT_MAX_SHARDS;
+	while (shards < num_shards)
+		shards <<= 1;
+
+	c             = M_malloc_zero(sizeof(*c));
+	c->num_shards = shards;
+	c->max_size   = max_size;
+	c->key_hash   = key_hash;
+	if (c->key_hash == NULL)
+		c->key_hash = M_hash_func_default_vp();
+	c->seed       = (M_uint32)M_rand_range(NULL, 1, (M_uint64)(M_UINT32_MAX)+1);
+
+	c->shards = M_malloc_zero(sizeof(*c->shards) * c->num_shards);
+	for (i=0; i<c->num_shards; i++) {
+		c->shards[i].lock  = M_thread_mutex_create(M_THREAD_MUTEXATTR_NONE);
+		c->shards[i].cache = M_cache_create(M_cache_concurrent_shard_capacity(c, max_size), key_hash, key_equality, flags, callbacks);
+		if (c->shards[i].lock == NULL || c->shards[i].cache == NULL) {
+			M_cache_concurrent_destroy(c);
+			return NULL;
+		}
+	}
+
+	return c;
+}
+
+
+void M_cache_concurrent_destroy(M_cache_concurrent_t *c)
+{
+	size_t i;
+
+	if (c == NULL)
+		return;
+
+	for (i=0; i<c->num_shards; i++) {
+		M_cache_destroy(c->shards[i].cache);
+		M_thread_mutex_destroy(c->shards[i].lock);
+	}
+	M_free(c->shards);
+	M_free(c);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+M_bool M_cache_concurrent_insert(M_cache_concurrent_t *c, const void *key, const void *value)
+{
+	return M_cache_concurrent_insert_ext(c, key, value, 0, 0);
+}
+
+
+M_bool M_cache_concurrent_insert_ext(M_cache_concurrent_t *c, const void *key, const void *value, size_t weight, M_uint64 ttl_ms)
+{
+	M_cache_concurrent_shard_t *shard;
+	M_bool                      ret;
+
+	if (c == NULL || key == NULL)
+		return M_FALSE;
+
+	shard = M_cache_concurrent_shard(c, key);
+	M_thread_mutex_lock(shard->lock);
+	ret = M_cache_insert_ext(shard->cache, key, value, weight, ttl_ms);
+	M_thread_mutex_unlock(shard->lock);
+
+	return ret;
+}
+
+
+M_bool M_cache_concurrent_remove(M_cache_concurrent_t *c, const void *key)
+{
+	M_cache_concurrent_shard_t *shard;
+	M_bool                      ret;
+
+	if (c == NULL || key == NULL)
+		return M_FALSE;
+
+	shard = M_cache_concurrent_shard(c, key);
+	M_thread_mutex_lock(shard->lock);
+	ret = M_cache_remove(shard->cache, key);
+	M_thread_mutex_unlock(shard->lock);
+
+	return ret;
+}
+
+
+M_bool M_cache_concurrent_get(M_cache_concurrent_t *c, const void *key, void **value)
+{
+	return M_cache_concurrent_get_copy(c, key, NULL, value);
+}
+
+
+M_bool M_cache_concurrent_get_copy(M_cache_concurrent_t *c, const void *key, M_cache_duplicate_func copy_func, void **value)
+{
+	M_cache_concurrent_shard_t *shard;
+	void                       *myvalue = NULL;
+	M_bool                      ret;
+
+	if (value != NULL)
+		*value = NULL;
+
+	if (c == NULL || key == NULL)
+		return M_FALSE;
+
+	shard = M_cache_concurrent_shard(c, key);
+	M_thread_mutex_lock(shard->lock);
+	ret = M_cache_get(shard->cache, key, &myvalue);
+	if (ret && copy_func != NULL && myvalue != NULL)
+		myvalue = copy_func(myvalue);
+	M_thread_mutex_unlock(shard->lock);
+
+	if (value != NULL)
+		*value = myvalue;
+	return ret;
+}
+
+
+size_t M_cache_concurrent_expire(M_cache_concurrent_t *c)
+{
+	size_t cnt = 0;
+	size_t i;
+
+	if (c == NULL)
+		return 0;
+
+	for (i=0; i<c->num_shards; i++) {
+		M_thread_mutex_lock(c->shards[i].lock);
+		cnt += M_cache_expire(c->shards[i].cache);
+		M_thread_mutex_unlock(c->shards[i].lock);
+	}
+
+	return cnt;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+size_t M_cache_concurrent_size(M_cache_concurrent_t *c)
+{
+	size_t size = 0;
+	size_t i;
+
+	if (c == NULL)
+		return 0;
+
+	for (i=0; i<c->num_shards; i++) {
+		M_thread_mutex_lock(c->shards[i].lock);
+		size += M_cache_size(c->shards[i].cache);
+		M_thread_mutex_unlock(c->shards[i].lock);
+	}
+
+	return size;
+}
+
+
+size_t M_cache_concurrent_max_size(M_cache_concurrent_t *c)
+{
+	if (c == NULL)
+		return 0;
+
+	return c->max_size;
+}
+
+
+M_bool M_cache_concurrent_set_max_size(M_cache_concurrent_t *c, size_t max_size)
+{
+	size_t i;
+
+	if (c == NULL)
+		return M_FALSE;
+
+	c->max_size = max_size;
+	for (i=0; i<c->num_shards; i++) {
+		M_thread_mutex_lock(c->shards[i].lock);
+		M_cache_set_max_size(c->shards[i].cache, M_cache_concurrent_shard_capacity(c, max_size));
+		M_thread_mutex_unlock(c->shards[i].lock);
+	}
+
+	return M_TRUE;
+}
+
+
+size_t M_cache_concurrent_weight(M_cache_concurrent_t *c)
+{
+	size_t weight = 0;
+	size_t i;
+
+	if (c == NULL)
+		return 0;
+
+	for (i=0; i<c->num_shards; i++) {
+		M_thread_mutex_lock(c->shards[i].lock);
+		weight += M_cache_weight(c->shards[i].cache);
+		M_thread_mutex_unlock(c->shards[i].lock);
+	}
+
+	return weight;
+}
+
+
+M_bool M_cache_concurrent_set_max_weight(M_cache_concurrent_t *c, size_t max_weight)
+{
+	size_t i;
+
+	if (c == NULL)
+		return M_FALSE;
+
+	c->max_weight = max_weight;
+	for (i=0; i<c->num_shards; i++) {
+		M_thread_mutex_lock(c->shards[i].lock);
+		M_cache_set_max_weight(c->shards[i].cache, M_cache_concurrent_shard_capacity(c, max_weight));
+		M_thread_mutex_unlock(c->shards[i].lock);
+	}
+
+	return M_TRUE;
+}
+
+
+void M_cache_concurrent_set_ttl(M_cache_concurrent_t *c, M_uint64 ttl_ms)
+{
+	size_t i;
+
+	if (c == NULL)
+		return;
+
+	for (i=0; i<c->num_shards; i++) {
+		M_thread_mutex_lock(c->shards[i].lock);
+		M_cache_set_ttl(c->shards[i].cache, ttl_ms);
+		M_thread_mutex_unlock(c->shards[i].lock);
+	}
+}
+
+
+void M_cache_concurrent_stats(M_cache_concurrent_t *c, M_cache_stats_t *stats)
+{
+	M_cache_stats_t shard_stats;
+	size_t          i;
+
+	if (stats == NULL)
+		return;
+
+	M_mem_set(stats, 0, sizeof(*stats));
+	if (c == NULL)
+		return;
+
+	for (i=0; i<c->num_shards; i++) {
+		M_thread_mutex_lock(c->shards[i].lock);
+		M_cache_stats(c->shards[i].cache, &shard_stats);
+		M_thread_mutex_unlock(c->shards[i].lock);
+
+		stats->hits        += shard_stats.hits;
+		stats->misses      += shard_stats.misses;
+		stats->evictions   += shard_stats.evictions;
+		stats->expirations += shard_stats.expirations;
+		stats->rejections  += shard_stats.rejections;
+	}
+}
+
+
+size_t M_cache_concurrent_num_shards(const M_cache_concurrent_t *c)
+{
+	if (c == NULL)
+		return 0;
+	return c->num_shards;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+M_cache_concurrent_strvp_t *M_cache_concurrent_strvp_create(size_t max_size, size_t num_shards, M_uint32 flags, void (*destroy_func)(void *))
+{
+	M_hashtable_hash_func    key_hash     = M_hash_func_default_str(M_FALSE);
+	M_sort_compar_t          key_equality = M_sort_compar_str;
+	M_uint32                 cache_flags  = M_CACHE_NONE;
+	struct M_cache_callbacks callbacks = {
+		M_hash_void_strdup,
+		M_free,
+		NULL,
+		destroy_func
+	};
+
+	if (flags & M_CACHE_STRVP_CASECMP) {
+		key_hash     = M_hash_func_default_str(M_TRUE);
+		key_equality = M_sort_compar_str_casecmp;
+	}
+	if (flags & M_CACHE_STRVP_TINYLFU) {
+		cache_flags |= M_CACHE_TINYLFU;
+	}
+
+	return (M_cache_concurrent_strvp_t *)M_cache_concurrent_create(max_size, num_shards, key_hash, key_equality, cache_flags, &callbacks);
+}
+
+void M_cache_concurrent_strvp_destroy(M_cache_concurrent_strvp_t *c)
+{
+	M_cache_concurrent_destroy((M_cache_concurrent_t *)c);
+}
+
+M_bool M_cache_concurrent_strvp_insert(M_cache_concurrent_strvp_t *c, const char *key, const void *value)
+{
+	if (M_str_isempty(key))
+		return M_FALSE;
+	return M_cache_concurrent_insert((M_cache_concurrent_t *)c, key, value);
+}
+
+M_bool M_cache_concurrent_strvp_insert_ext(M_cache_concurrent_strvp_t *c, const char *key, const void *value, size_t weight, M_uint64 ttl_ms)
+{
+	if (M_str_isempty(key))
+		return M_FALSE;
+	return M_cache_concurrent_insert_ext((M_cache_concurrent_t *)c, key, value, weight, ttl_ms);
+}
+
+M_bool M_cache_concurrent_strvp_remove(M_cache_concurrent_strvp_t *c, const char *key)
+{
+	return M_cache_concurrent_remove((M_cache_concurrent_t *)c, key);
+}
+
+M_bool M_cache_concurrent_strvp_get(M_cache_concurrent_strvp_t *c, const char *key, void **value)
+{
+	return M_cache_concurrent_get((M_cache_concurrent_t *)c, key, value);
+}
+
+M_bool M_cache_concurrent_strvp_get_copy(M_cache_concurrent_strvp_t *c, const char *key, M_cache_duplicate_func copy_func, void **value)
+{
+	return M_cache_concurrent_get_copy((M_cache_concurrent_t *)c, key, copy_func, value);
+}
+
+size_t M_cache_concurrent_strvp_expire(M_cache_concurrent_strvp_t *c)
+{
+	return M_cache_concurrent_expire((M_cache_concurrent_t *)c);
+}
+
+size_t M_cache_concurrent_strvp_size(M_cache_concurrent_strvp_t *c)
+{
+	return M_cache_concurrent_size((M_cache_concurrent_t *)c);
+}
+
+M_bool M_cache_concurrent_strvp_set_max_size(M_cache_concurrent_strvp_t *c, size_t max_size)
+{
+	return M_cache_concurrent_set_max_size((M_cache_concurrent_t *)c, max_size);
+}
+
+M_bool M_cache_concurrent_strvp_set_max_weight(M_cache_concurrent_strvp_t *c, size_t max_weight)
+{
+	return M_cache_concurrent_set_max_weight((M_cache_concurrent_t *)c, max_weight);
+}
+
+void M_cache_concurrent_strvp_set_ttl(M_cache_concurrent_strvp_t *c, M_uint64 ttl_ms)
+{
+	M_cache_concurrent_set_ttl((M_cache_concurrent_t *)c, ttl_ms);
+}
+
+void M_cache_concurrent_strvp_stats(M_cache_concurrent_strvp_t *c, M_cache_stats_t *stats)
+{
+	M_cache_concurrent_stats((M_cache_concurrent_t *)c, stats);
+}
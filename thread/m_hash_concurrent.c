@@ -0,0 +1,523 @@
+/* The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Monetra Technologies, LLC.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "m_config.h"
+
+#include <mstdlib/mstdlib_thread.h>
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+/*! Upper bound on the number of shards. */
+#define M_HASH_CONCURRENT_MAX_SHARDS 1024
+
+/*! A portion of the table. Keys are assigned to a shard by hash. */
+typedef struct {
+	M_thread_rwlock_t *lock;  /*!< Protects table. */
+	M_hashtable_t     *table; /*!< Entries belonging to this shard. */
+} M_hash_concurrent_shard_t;
+
+struct M_hash_concurrent {
+	M_hash_concurrent_shard_t  *shards;     /*!< Shards. */
+	size_t                      num_shards; /*!< Number of shards. Power of 2. */
+	M_hashtable_hash_func       key_hash;   /*!< Hash used to pick a shard. */
+	M_uint32                    seed;       /*!< Seed for key_hash. */
+	M_hashtable_duplicate_func  key_dup;    /*!< Duplicates keys for enumeration snapshots. */
+	M_hashtable_free_func       key_free;   /*!< Frees keys from enumeration snapshots. */
+};
+
+struct M_hash_concurrent_enum {
+	void                  **keys;     /*!< Snapshot of keys. */
+	void                  **values;   /*!< Snapshot of values. */
+	size_t                  len;      /*!< Number of entries in the snapshot. */
+	size_t                  idx;      /*!< Next entry to return. */
+	M_hashtable_free_func   key_free; /*!< Frees keys in the snapshot. */
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void *M_hash_concurrent_duplicate_func_default(const void *arg)
+{
+	return M_CAST_OFF_CONST(void *, arg);
+}
+
+
+static void M_hash_concurrent_free_func_default(void *arg)
+{
+	(void)arg;
+}
+
+
+static M_hash_concurrent_shard_t *M_hash_concurrent_shard(const M_hash_concurrent_t *h, const void *key)
+{
+	M_uint32 hash;
+
+	/* The shard's table uses the low bits of its own hash to pick a bucket. Mix
+	 * in the high bits so a poor hash still spreads keys across shards. */
+	hash  = h->key_hash(key, h->seed);
+	hash ^= hash >> 16;
+	return &h->shards[hash & (h->num_shards - 1)];
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+M_hash_concurrent_t *M_hash_concurrent_create(size_t size, M_uint8 fillpct, size_t num_shards,
+	M_hashtable_hash_func key_hash, M_sort_compar_t key_equality, M_uint32 flags,
+	const struct M_hashtable_callbacks *callbacks)
+{
+	M_hash_concurrent_t *h;
+	size_t               shards = 1;
+	size_t               i;
+
+	if (size == 0 || fillpct >= 100 || key_hash == NULL || key_equality == NULL)
+		return NULL;
+
+	/* Enough shards that threads rarely contend on the same lock. */
+	if (num_shards == 0)
+		num_shards = M_thread_num_cpu_cores() * 4;
+	if (num_shards > M_HASH_CONCURRENT_MAX_SHARDS)
+		num_shards = M_HASH_CONCURRENT_MAX_SHARDS;
+	while (shards < num_shards)
+		shards <<= 1;
+
+	h             = M_malloc_zero(sizeof(*h));
+	h->num_shards = shards;
+	h->key_hash   = key_hash;
+	h->key_dup    = M_hash_concurrent_duplicate_func_default;
+	h->key_free   = M_hash_concurrent_free_func_default;
+	if (callbacks != NULL) {
+		if (callbacks->key_duplicate_copy != NULL)
+			h->key_dup  = callbacks->key_duplicate_copy;
+		if (callbacks->key_free != NULL)
+			h->key_free = callbacks->key_free;
+	}
+	if (flags & M_HASHTABLE_STATIC_SEED) {
+		h->seed = 2166136261U;
+	} else {
+		h->seed = (M_uint32)M_rand_range(NULL, 1, (M_uint64)(M_UINT32_MAX)+1);
+	}
+
+	h->shards = M_malloc_zero(sizeof(*h->shards) * h->num_shards);
+	for (i=0; i<h->num_shards; i++) {
+		h->shards[i].lock  = M_thread_rwlock_create();
+		h->shards[i].table = M_hashtable_create(size, fillpct, key_hash, key_equality, flags, callbacks);
+		if (h->shards[i].lock == NULL || h->shards[i].table == NULL) {
+			M_hash_concurrent_destroy(h, M_FALSE);
+			return NULL;
+		}
+	}
+
+	return h;
+}
+
+
+void M_hash_concurrent_destroy(M_hash_concurrent_t *h, M_bool destroy_vals)
+{
+	size_t i;
+
+	if (h == NULL)
+		return;
+
+	for (i=0; i<h->num_shards; i++) {
+		M_hashtable_destroy(h->shards[i].table, destroy_vals);
+		M_thread_rwlock_destroy(h->shards[i].lock);
+	}
+	M_free(h->shards);
+	M_free(h);
+}
+
+
+M_bool M_hash_concurrent_insert(M_hash_concurrent_t *h, const void *key, const void *value)
+{
+	M_hash_concurrent_shard_t *shard;
+	M_bool                     ret;
+
+	if (h == NULL || key == NULL)
+		return M_FALSE;
+
+	shard = M_hash_concurrent_shard(h, key);
+	M_thread_rwlock_lock(shard->lock, M_THREAD_RWLOCK_TYPE_WRITE);
+	ret = M_hashtable_insert(shard->table, key, value);
+	M_thread_rwlock_unlock(shard->lock);
+
+	return ret;
+}
+
+
+M_bool M_hash_concurrent_remove(M_hash_concurrent_t *h, const void *key, M_bool destroy_vals)
+{
+	M_hash_concurrent_shard_t *shard;
+	M_bool                     ret;
+
+	if (h == NULL || key == NULL)
+		return M_FALSE;
+
+	shard = M_hash_concurrent_shard(h, key);
+	M_thread_rwlock_lock(shard->lock, M_THREAD_RWLOCK_TYPE_WRITE);
+	ret = M_hashtable_remove(shard->table, key, destroy_vals);
+	M_thread_rwlock_unlock(shard->lock);
+
+	return ret;
+}
+
+
+M_bool M_hash_concurrent_get(M_hash_concurrent_t *h, const void *key, void **value)
+{
+	M_hash_concurrent_shard_t *shard;
+	M_bool                     ret;
+
+	if (value != NULL)
+		*value = NULL;
+
+	if (h == NULL || key == NULL)
+		return M_FALSE;
+
+	shard = M_hash_concurrent_shard(h, key);
+	M_thread_rwlock_lock(shard->lock, M_THREAD_RWLOCK_TYPE_READ);
+	ret = M_hashtable_get(shard->table, key, value);
+	M_thread_rwlock_unlock(shard->lock);
+
+	return ret;
+}
+
+
+void *M_hash_concurrent_compute_if_absent(M_hash_concurrent_t *h, const void *key, M_hash_concurrent_create_func create_func, void *thunk)
+{
+	M_hash_concurrent_shard_t *shard;
+	void                      *value = NULL;
+
+	if (h == NULL || key == NULL || create_func == NULL)
+		return NULL;
+
+	shard = M_hash_concurrent_shard(h, key);
+
+	/* Most calls find the key so try with a shared lock first. */
+	M_thread_rwlock_lock(shard->lock, M_THREAD_RWLOCK_TYPE_READ);
+	if (M_hashtable_get(shard->table, key, &value)) {
+		M_thread_rwlock_unlock(shard->lock);
+		return value;
+	}
+	M_thread_rwlock_unlock(shard->lock);
+
+	/* Another thread could have added the key before we got the write lock. */
+	M_thread_rwlock_lock(shard->lock, M_THREAD_RWLOCK_TYPE_WRITE);
+	if (!M_hashtable_get(shard->table, key, &value)) {
+		value = create_func(key, thunk);
+		if (value != NULL) {
+			M_hashtable_insert(shard->table, key, value);
+			/* The table may have duplicated the value. */
+			M_hashtable_get(shard->table, key, &value);
+		}
+	}
+	M_thread_rwlock_unlock(shard->lock);
+
+	return value;
+}
+
+
+size_t M_hash_concurrent_num_keys(M_hash_concurrent_t *h)
+{
+	size_t num_keys = 0;
+	size_t i;
+
+	if (h == NULL)
+		return 0;
+
+	for (i=0; i<h->num_shards; i++) {
+		M_thread_rwlock_lock(h->shards[i].lock, M_THREAD_RWLOCK_TYPE_READ);
+		num_keys += M_hashtable_num_keys(h->shards[i].table);
+		M_thread_rwlock_unlock(h->shards[i].lock);
+	}
+
+	return num_keys;
+}
+
+
+size_t M_hash_concurrent_num_shards(const M_hash_concurrent_t *h)
+{
+	if (h == NULL)
+		return 0;
+	return h->num_shards;
+}
+
+
+size_t M_hash_concurrent_enumerate(M_hash_concurrent_t *h, M_hash_concurrent_enum_t **hashenum)
+{
+	M_hash_concurrent_enum_t *myenum;
+	M_hashtable_enum_t        tenum;
+	const void               *key;
+	const void               *value;
+	size_t                    len = 0;
+	size_t                    i;
+
+	if (h == NULL || hashenum == NULL)
+		return 0;
+
+	/* Hold every shard at once so the snapshot is consistent. Shards are always
+	 * locked in the same order and writers only ever hold one lock so this can't
+	 * deadlock. */
+	for (i=0; i<h->num_shards; i++) {
+		M_thread_rwlock_lock(h->shards[i].lock, M_THREAD_RWLOCK_TYPE_READ);
+		len += M_hashtable_enumerate(h->shards[i].table, &tenum);
+	}
+
+	myenum           = M_malloc_zero(sizeof(*myenum));
+	myenum->key_free = h->key_free;
+	if (len > 0) {
+		myenum->keys   = M_malloc(sizeof(*myenum->keys) * len);
+		myenum->values = M_malloc(sizeof(*myenum->values) * len);
+	}
+
+	for (i=0; i<h->num_shards; i++) {
+		M_hashtable_enumerate(h->shards[i].table, &tenum);
+		while (myenum->len < len && M_hashtable_enumerate_next(h->shards[i].table, &tenum, &key, &value)) {
+			myenum->keys[myenum->len]   = h->key_dup(key);
+			myenum->values[myenum->len] = M_CAST_OFF_CONST(void *, value);
+			myenum->len++;
+		}
+	}
+
+	for (i=h->num_shards; i-->0; ) {
+		M_thread_rwlock_unlock(h->shards[i].lock);
+	}
+
+	*hashenum = myenum;
+	return myenum->len;
+}
+
+
+M_bool M_hash_concurrent_enumerate_next(M_hash_concurrent_enum_t *hashenum, const void **key, void **value)
+{
+	if (key != NULL)
+		*key = NULL;
+	if (value != NULL)
+		*value = NULL;
+
+	if (hashenum == NULL || hashenum->idx >= hashenum->len)
+		return M_FALSE;
+
+	if (key != NULL)
+		*key = hashenum->keys[hashenum->idx];
+	if (value != NULL)
+		*value = hashenum->values[hashenum->idx];
+	hashenum->idx++;
+
+	return M_TRUE;
+}
+
+
+void M_hash_concurrent_enumerate_free(M_hash_concurrent_enum_t *hashenum)
+{
+	size_t i;
+
+	if (hashenum == NULL)
+		return;
+
+	for (i=0; i<hashenum->len; i++)
+		hashenum->key_free(hashenum->keys[i]);
+	M_free(hashenum->keys);
+	M_free(hashenum->values);
+	M_free(hashenum);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+M_hash_concurrent_strvp_t *M_hash_concurrent_strvp_create(size_t size, M_uint8 fillpct, size_t num_shards, M_uint32 flags, M_hashtable_free_func destroy_func)
+{
+	M_hashtable_hash_func        key_hash     = M_hash_func_default_str(M_FALSE);
+	M_sort_compar_t              key_equality = M_sort_compar_str;
+	M_hashtable_flags_t          hash_flags   = M_HASHTABLE_NONE;
+	struct M_hashtable_callbacks callbacks    = {
+		M_hash_void_strdup,
+		M_hash_void_strdup,
+		M_free,
+		NULL,
+		NULL,
+		NULL,
+		destroy_func
+	};
+
+	if (flags & M_HASH_STRVP_CASECMP) {
+		key_hash     = M_hash_func_default_str(M_TRUE);
+		key_equality = M_sort_compar_str_casecmp;
+	}
+	if (flags & M_HASH_STRVP_KEYS_UPPER) {
+		callbacks.key_duplicate_insert = (M_hashtable_duplicate_func)M_strdup_upper;
+		callbacks.key_duplicate_copy   = (M_hashtable_duplicate_func)M_strdup_upper;
+	}
+	if (flags & M_HASH_STRVP_KEYS_LOWER) {
+		callbacks.key_duplicate_insert = (M_hashtable_duplicate_func)M_strdup_lower;
+		callbacks.key_duplicate_copy   = (M_hashtable_duplicate_func)M_strdup_lower;
+	}
+	if (flags & M_HASH_STRVP_STATIC_SEED) {
+		hash_flags |= M_HASHTABLE_STATIC_SEED;
+	}
+	if (flags & M_HASH_STRVP_OPEN_ADDRESSING) {
+		hash_flags |= M_HASHTABLE_OPEN_ADDRESSING;
+	}
+	if (flags & M_HASH_STRVP_INCREMENTAL_REHASH) {
+		hash_flags |= M_HASHTABLE_INCREMENTAL_REHASH;
+	}
+
+	return (M_hash_concurrent_strvp_t *)M_hash_concurrent_create(size, fillpct, num_shards, key_hash, key_equality, hash_flags, &callbacks);
+}
+
+
+void M_hash_concurrent_strvp_destroy(M_hash_concurrent_strvp_t *h, M_bool destroy_vals)
+{
+	M_hash_concurrent_destroy((M_hash_concurrent_t *)h, destroy_vals);
+}
+
+
+M_bool M_hash_concurrent_strvp_insert(M_hash_concurrent_strvp_t *h, const char *key, void *value)
+{
+	/* Can't insert empty keys. */
+	if (M_str_isempty(key))
+		return M_FALSE;
+	return M_hash_concurrent_insert((M_hash_concurrent_t *)h, key, value);
+}
+
+
+M_bool M_hash_concurrent_strvp_remove(M_hash_concurrent_strvp_t *h, const char *key, M_bool destroy_vals)
+{
+	return M_hash_concurrent_remove((M_hash_concurrent_t *)h, key, destroy_vals);
+}
+
+
+M_bool M_hash_concurrent_strvp_get(M_hash_concurrent_strvp_t *h, const char *key, void **value)
+{
+	return M_hash_concurrent_get((M_hash_concurrent_t *)h, key, value);
+}
+
+
+void *M_hash_concurrent_strvp_compute_if_absent(M_hash_concurrent_strvp_t *h, const char *key, M_hash_concurrent_create_func create_func, void *thunk)
+{
+	if (M_str_isempty(key))
+		return NULL;
+	return M_hash_concurrent_compute_if_absent((M_hash_concurrent_t *)h, key, create_func, thunk);
+}
+
+
+size_t M_hash_concurrent_strvp_num_keys(M_hash_concurrent_strvp_t *h)
+{
+	return M_hash_concurrent_num_keys((M_hash_concurrent_t *)h);
+}
+
+
+size_t M_hash_concurrent_strvp_enumerate(M_hash_concurrent_strvp_t *h, M_hash_concurrent_enum_t **hashenum)
+{
+	return M_hash_concurrent_enumerate((M_hash_concurrent_t *)h, hashenum);
+}
+
+
+M_bool M_hash_concurrent_strvp_enumerate_next(M_hash_concurrent_enum_t *hashenum, const char **key, void **value)
+{
+	const void *mykey = NULL;
+	M_bool      ret;
+
+	ret = M_hash_concurrent_enumerate_next(hashenum, &mykey, value);
+	if (key != NULL)
+		*key = mykey;
+	return ret;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+M_hash_concurrent_u64vp_t *M_hash_concurrent_u64vp_create(size_t size, M_uint8 fillpct, size_t num_shards, M_uint32 flags, M_hashtable_free_func destroy_func)
+{
+	M_hashtable_flags_t          hash_flags = M_HASHTABLE_NONE;
+	struct M_hashtable_callbacks callbacks  = {
+		M_hash_func_u64dup,
+		M_hash_func_u64dup,
+		M_free,
+		NULL,
+		NULL,
+		NULL,
+		destroy_func
+	};
+
+	if (flags & M_HASH_U64VP_STATIC_SEED) {
+		hash_flags |= M_HASHTABLE_STATIC_SEED;
+	}
+	if (flags & M_HASH_U64VP_OPEN_ADDRESSING) {
+		hash_flags |= M_HASHTABLE_OPEN_ADDRESSING;
+	}
+	if (flags & M_HASH_U64VP_INCREMENTAL_REHASH) {
+		hash_flags |= M_HASHTABLE_INCREMENTAL_REHASH;
+	}
+
+	return (M_hash_concurrent_u64vp_t *)M_hash_concurrent_create(size, fillpct, num_shards, M_hash_func_default_u64(), M_sort_compar_u64, hash_flags, &callbacks);
+}
+
+
+void M_hash_concurrent_u64vp_destroy(M_hash_concurrent_u64vp_t *h, M_bool destroy_vals)
+{
+	M_hash_concurrent_destroy((M_hash_concurrent_t *)h, destroy_vals);
+}
+
+
+M_bool M_hash_concurrent_u64vp_insert(M_hash_concurrent_u64vp_t *h, M_uint64 key, void *value)
+{
+	return M_hash_concurrent_insert((M_hash_concurrent_t *)h, &key, value);
+}
+
+
+M_bool M_hash_concurrent_u64vp_remove(M_hash_concurrent_u64vp_t *h, M_uint64 key, M_bool destroy_vals)
+{
+	return M_hash_concurrent_remove((M_hash_concurrent_t *)h, &key, destroy_vals);
+}
+
+
+M_bool M_hash_concurrent_u64vp_get(M_hash_concurrent_u64vp_t *h, M_uint64 key, void **value)
+{
+	return M_hash_concurrent_get((M_hash_concurrent_t *)h, &key, value);
+}
+
+
+void *M_hash_concurrent_u64vp_compute_if_absent(M_hash_concurrent_u64vp_t *h, M_uint64 key, M_hash_concurrent_create_func create_func, void *thunk)
+{
+	return M_hash_concurrent_compute_if_absent((M_hash_concurrent_t *)h, &key, create_func, thunk);
+}
+
+
+size_t M_hash_concurrent_u64vp_num_keys(M_hash_concurrent_u64vp_t *h)
+{
+	return M_hash_concurrent_num_keys((M_hash_concurrent_t *)h);
+}
+
+
+size_t M_hash_concurrent_u64vp_enumerate(M_hash_concurrent_u64vp_t *h, M_hash_concurrent_enum_t **hashenum)
+{
+	return M_hash_concurrent_enumerate((M_hash_concurrent_t *)h, hashenum);
+}
+
+
+M_bool M_hash_concurrent_u64vp_enumerate_next(M_hash_concurrent_enum_t *hashenum, M_uint64 *key, void **value)
+{
+	const void *mykey = NULL;
+	M_bool      ret;
+
+	ret = M_hash_concurrent_enumerate_next(hashenum, &mykey, value);
+	if (key != NULL)
+		*key = (mykey != NULL) ? *((const M_uint64 *)mykey) : 0;
+	return ret;
+}
@@ -145,6 +145,10 @@ static void *M_thread_wrapfunc(void *arg)
 
 	M_free(data);
 
+	/* Return anything this thread is holding onto for reuse. */
+	M_mempool_thread_flush();
+	M_buf_pool_thread_flush();
+
 	return ret;
 }
 
@@ -366,8 +370,101 @@ void M_thread_linux_cpu_set(cpu_set_t *set, int cpu)
 	int real_cpu = (int)M_list_u64_at(thread_cpus, (size_t)cpu);
 	CPU_SET(real_cpu, set);
 }
+
+
+static M_bool M_thread_linux_sysfs_num(const char *path, size_t *num)
+{
+	unsigned char *buf = NULL;
+	size_t         len = 0;
+	M_bool         rv  = M_FALSE;
+	M_int64        val;
+
+	if (M_fs_file_read_bytes(path, 32, &buf, &len) != M_FS_ERROR_SUCCESS)
+		return M_FALSE;
+
+	if (M_str_to_int64_ex((const char *)buf, len, 10, &val, NULL) == M_STR_INT_SUCCESS && val >= 0) {
+		*num = (size_t)val;
+		rv   = M_TRUE;
+	}
+
+	M_free(buf);
+	return rv;
+}
+
+
+/* Highest possible NUMA node id, from a range list such as "0-3" or "0,2". */
+static size_t M_thread_linux_max_numa_node(void)
+{
+	unsigned char *buf = NULL;
+	size_t         len = 0;
+	size_t         start;
+	M_int64        val = 0;
+
+	if (M_fs_file_read_bytes("/sys/devices/system/node/possible", 64, &buf, &len) != M_FS_ERROR_SUCCESS)
+		return 0;
+
+	while (len > 0 && !M_chr_isdigit((char)buf[len-1]))
+		len--;
+	start = len;
+	while (start > 0 && M_chr_isdigit((char)buf[start-1]))
+		start--;
+
+	if (M_str_to_int64_ex((const char *)buf+start, len-start, 10, &val, NULL) != M_STR_INT_SUCCESS || val < 0)
+		val = 0;
+
+	M_free(buf);
+	return (size_t)val;
+}
 #endif
 
+
+M_bool M_thread_get_processor_topology(int processor_id, M_thread_cpu_topology_t *topology)
+{
+#ifdef __linux__
+	char   path[256];
+	int    real_cpu;
+	size_t node;
+	size_t max_node;
+#endif
+
+	if (topology == NULL)
+		return M_FALSE;
+
+	M_mem_set(topology, 0, sizeof(*topology));
+
+	if (processor_id < 0 || processor_id >= (int)M_thread_num_cpu_cores())
+		return M_FALSE;
+
+#ifdef __linux__
+	if (thread_cpus == NULL)
+		return M_FALSE;
+
+	real_cpu = (int)M_list_u64_at(thread_cpus, (size_t)processor_id);
+
+	M_snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", real_cpu);
+	if (!M_thread_linux_sysfs_num(path, &topology->socket))
+		return M_FALSE;
+
+	M_snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/core_id", real_cpu);
+	M_thread_linux_sysfs_num(path, &topology->core);
+
+	/* The cpu directory has a nodeN link for the node it belongs to, without
+	 * NUMA support there is no link and everything is node 0. */
+	max_node = M_thread_linux_max_numa_node();
+	for (node=0; node<=max_node; node++) {
+		M_snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/node%zu", real_cpu, node);
+		if (M_fs_perms_can_access(path, M_FS_PERMS_MODE_NONE) == M_FS_ERROR_SUCCESS) {
+			topology->numa_node = node;
+			break;
+		}
+	}
+
+	return M_TRUE;
+#else
+	return M_FALSE;
+#endif
+}
+
 M_bool M_thread_destructor_insert(void (*destructor)(void))
 {
 	M_bool ret = M_FALSE;
@@ -944,7 +1041,7 @@ void M_library_cleanup_register(void (*cleanup_cb)(void *arg), void *arg)
 }
 
 
-void M_library_cleanup(void)
+static void M_library_cleanup_registered(void)
 {
 	M_library_cleanup_member_t *member;
 
@@ -966,3 +1063,14 @@ void M_library_cleanup(void)
 
 	M_library_cleanup_list = NULL;
 }
+
+
+void M_library_cleanup(void)
+{
+	M_library_cleanup_registered();
+
+	/* Only threads created by M_thread_create() release these on their own. This
+	 * is usually the main thread which would otherwise leak them at exit. */
+	M_mempool_thread_flush();
+	M_buf_pool_thread_flush();
+}
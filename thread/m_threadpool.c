@@ -39,7 +39,7 @@ typedef struct M_threadpool_queue_st {
 	void                 (*task)(void *);     /*!< Task callback */
 	void                  *task_arg;          /*!< Argument for task callback */
 	void                 (*finished)(void *); /*!< Optional callback to be called on task completion */
-	M_threadpool_parent_t *parent;            /*!< Handle of threadpool user */
+	M_threadpool_parent_t *parent;            /*!< Handle of threadpool user, NULL if detached */
 } M_threadpool_queue_t;
 
 /*! Main structure holding metadata for threadpool */
@@ -216,6 +216,10 @@ static void *M_threadpool_thread(void *arg)
 		if (task.finished)
 			task.finished(task.task_arg);
 
+		/* Nobody is tracking detached tasks */
+		if (task.parent == NULL)
+			continue;
+
 		/* Tell the parent the task is done, and wake them up if we were the
 		 * last task left */
 		M_thread_mutex_lock(task.parent->lock);
@@ -273,7 +277,7 @@ static void M_threadpool_queue_insert(M_threadpool_parent_t *parent, void (*task
 
 		if (pool->queue_waiters == 0 || i_just_woke_up) {
 			if (pool->queue_max_size > M_llist_len(pool->queue)) {
-				M_threadpool_queue_t *q = M_malloc_zero(sizeof(*q));
+				M_threadpool_queue_t *q = M_mempool_malloc_zero(sizeof(*q));
 				q->parent   = parent;
 				q->task     = task;
 				q->finished = finished;
@@ -482,6 +486,37 @@ void M_threadpool_dispatch(M_threadpool_parent_t *parent, void (*task)(void *),
 	M_threadpool_dispatch_notify(parent, task, task_args, num_tasks, NULL);
 }
 
+M_bool M_threadpool_dispatch_detached(M_threadpool_t *pool, void (*task)(void *), void *task_arg)
+{
+	M_threadpool_queue_t *q;
+
+	if (pool == NULL || task == NULL)
+		return M_FALSE;
+
+	M_thread_mutex_lock(pool->queue_lock);
+
+	/* Spawn a new thread on demand if needed */
+	if (pool->num_idle_threads <= M_llist_len(pool->queue) && pool->num_threads < pool->max_threads)
+		M_threadpool_thread_spawn(pool);
+
+	/* Don't jump ahead of anyone waiting for a slot */
+	if (pool->queue_waiters != 0 || pool->queue_max_size <= M_llist_len(pool->queue)) {
+		M_thread_mutex_unlock(pool->queue_lock);
+		return M_FALSE;
+	}
+
+	q           = M_mempool_malloc_zero(sizeof(*q));
+	q->task     = task;
+	q->task_arg = task_arg;
+	M_llist_insert(pool->queue, q);
+
+	/* Wake up a thread waiting for things to be queued */
+	M_thread_cond_signal(pool->queue_ocond);
+
+	M_thread_mutex_unlock(pool->queue_lock);
+	return M_TRUE;
+}
+
 void M_threadpool_parent_wait(M_threadpool_parent_t *parent)
 {
 	if (parent == NULL)
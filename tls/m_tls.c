@@ -43,6 +43,16 @@
 /* If this is defined, writes will be buffered rather than written directly to the underlying io object */
 //#define TLS_BUFFER_WRITES
 
+/* Kernel TLS offload. OpenSSL only hands the keys to the kernel when it's using
+ * a socket BIO, so with this the TLS layer reads and writes the socket itself. */
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L && !defined(LIBRESSL_VERSION_NUMBER) && !defined(OPENSSL_NO_KTLS) && \
+    defined(HAVE_PTHREAD) && defined(HAVE_SIGTIMEDWAIT)
+#  define M_TLS_KTLS
+#  include <errno.h>
+#  include <signal.h>
+#  include <pthread.h>
+#endif
+
 
 typedef enum {
 	M_TLS_STATE_INIT         = 0,
@@ -60,12 +70,46 @@ typedef enum {
 } M_tls_stateflags_t;
 
 
+/* Handshake steps running on a thread pool. While offloaded OpenSSL reads and
+ * writes memory BIOs so a pool thread never touches the io object, the event loop
+ * moves data between them and the layer below. A finished step queues a task to
+ * the event loop. If the connection goes away while a step is running or its task
+ * is queued, whichever of the two finishes last cleans up. The members shared
+ * with the pool thread are protected by the lock. */
+typedef struct {
+	M_thread_mutex_t      *lock;
+	M_threadpool_t        *pool;
+	M_event_t             *event;        /*!< Event loop the connection runs on                     */
+	M_io_t                *io;
+	size_t                 layer_idx;
+	M_tls_clientctx_t     *clientctx;    /*!< Reference kept for OpenSSL callbacks made by a step   */
+	M_tls_serverctx_t     *serverctx;
+	SSL                   *ssl;
+	BIO                   *rbio;         /*!< Memory BIOs OpenSSL uses while offloaded              */
+	BIO                   *wbio;
+	M_buf_t               *in;           /*!< Read past the end of the handshake, for our BIO       */
+	M_buf_t               *out;          /*!< Not yet written to the layer below                    */
+	M_bool                 is_client;
+	M_bool                 started;
+	M_bool                 busy;         /*!< Step queued or running                                */
+	M_bool                 orphaned;     /*!< Connection is gone, we own the SSL object             */
+	size_t                 tasks;        /*!< Finished steps queued to the event loop, not yet run  */
+	M_bool                 have_result;
+	int                    rv;
+	int                    err;
+	char                   error[256];
+} M_io_tls_handshake_t;
+
+
 struct M_io_handle {
 	M_tls_clientctx_t *clientctx;
 	M_tls_serverctx_t *serverctx;
 	char              *hostname;
 	SSL               *ssl;
 	BIO               *bio_glue;
+	M_bool             ktls;        /*!< Offload to the kernel requested                   */
+	M_bool             sock_bio;    /*!< OpenSSL is using the socket directly, not our BIO */
+	M_io_tls_handshake_t *hs;       /*!< Handshake offload, NULL if run on the event loop  */
 #ifdef TLS_BUFFER_WRITES
 	M_buf_t           *write_buf;
 #endif
@@ -99,6 +143,7 @@ static int BIO_get_shutdown(BIO *a)
 
 
 static void M_tls_bio_method_new(void);
+static BIO *M_tls_bio_new(M_io_layer_t *layer);
 
 static M_uint64 M_tls_get_negotiation_timeout_ms(M_io_handle_t *handle)
 {
@@ -287,6 +332,115 @@ void M_tls_init(M_tls_init_t type)
 }
 
 
+#ifdef M_TLS_KTLS
+/* OpenSSL writes to the socket without MSG_NOSIGNAL. Block SIGPIPE around calls
+ * that may write and throw away any we caused, same as the network layer. */
+static M_bool M_io_tls_sigpipe_block(const M_io_handle_t *handle)
+{
+	sigset_t pending;
+	sigset_t mask;
+	sigset_t old_mask;
+
+	if (!handle->sock_bio)
+		return M_FALSE;
+
+	sigemptyset(&pending);
+	sigpending(&pending);
+	if (sigismember(&pending, SIGPIPE))
+		return M_FALSE;
+
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGPIPE);
+	sigemptyset(&old_mask);
+	pthread_sigmask(SIG_BLOCK, &mask, &old_mask);
+
+	return sigismember(&old_mask, SIGPIPE)?M_FALSE:M_TRUE;
+}
+
+
+static void M_io_tls_sigpipe_unblock(M_bool blocked)
+{
+	const struct timespec timeout  = { 0, 0 };
+	int                   save_err = errno;
+	sigset_t              pending;
+	sigset_t              mask;
+
+	if (!blocked)
+		return;
+
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGPIPE);
+	sigemptyset(&pending);
+	sigpending(&pending);
+	if (sigismember(&pending, SIGPIPE)) {
+		while (sigtimedwait(&mask, NULL, &timeout) == -1 && errno == EINTR)
+			;
+	}
+
+	pthread_sigmask(SIG_UNBLOCK, &mask, NULL);
+	errno = save_err;
+}
+#else
+#  define M_io_tls_sigpipe_block(handle) M_FALSE
+#  define M_io_tls_sigpipe_unblock(blocked) (void)(blocked)
+#endif
+
+
+/* With kernel offload requested and nothing between us and the socket, give
+ * OpenSSL the socket. Must happen before the handshake starts. Otherwise, or if
+ * OpenSSL can't enable offload, records are handled in user space as usual. */
+static void M_io_tls_ktls_setup(M_io_layer_t *layer)
+{
+#ifdef M_TLS_KTLS
+	M_io_handle_t *handle = M_io_layer_get_handle(layer);
+	M_io_t        *io     = M_io_layer_get_io(layer);
+	M_intptr       sock;
+	BIO           *bio;
+
+	if (!handle->ktls || handle->sock_bio || handle->ssl == NULL)
+		return;
+
+	if (M_io_layer_get_index(layer) != 1 || !M_str_eq(M_io_layer_name(io, 0), "NET"))
+		return;
+
+	sock = M_io_net_get_socket(io);
+	if (sock == -1)
+		return;
+
+	bio = BIO_new_socket((int)sock, BIO_NOCLOSE);
+	if (bio == NULL)
+		return;
+
+	SSL_set_options(handle->ssl, SSL_OP_ENABLE_KTLS);
+	/* Frees our BIO */
+	SSL_set_bio(handle->ssl, bio, bio);
+	handle->bio_glue = bio;
+	handle->sock_bio = M_TRUE;
+#else
+	(void)layer;
+#endif
+}
+
+
+static M_bool M_io_tls_is_disconnect(const M_io_handle_t *handle, int sslerr)
+{
+	if (sslerr == SSL_ERROR_ZERO_RETURN)
+		return M_TRUE;
+
+	if (sslerr != SSL_ERROR_SYSCALL)
+		return M_FALSE;
+
+#ifdef M_TLS_KTLS
+	/* No io error to go by when OpenSSL is using the socket */
+	if (handle->sock_bio)
+		return (errno == 0 || errno == ECONNRESET || errno == EPIPE)?M_TRUE:M_FALSE;
+#endif
+
+	/* OpenSSL doesn't appear to relay disconnect vs error up the chain for syscalls, manage that ourselves */
+	return (handle->last_io_err == M_IO_ERROR_DISCONNECT)?M_TRUE:M_FALSE;
+}
+
+
 static void M_tls_op_timeout_cb(M_event_t *event, M_event_type_t type, M_io_t *io_dummy, void *cb_data)
 {
 	M_io_layer_t  *layer  = cb_data;
@@ -312,6 +466,53 @@ static void M_tls_op_timeout_cb(M_event_t *event, M_event_type_t type, M_io_t *i
 
 }
 
+/* Move everything pending in a memory BIO into a buffer */
+static void M_io_tls_handshake_drain(BIO *bio, M_buf_t *buf)
+{
+	unsigned char *ptr;
+	size_t         len;
+	int            rv;
+
+	if (bio == NULL)
+		return;
+
+	while ((len = BIO_ctrl_pending(bio)) > 0) {
+		if (len > 16 * 1024)
+			len = 16 * 1024;
+		ptr = M_buf_direct_write_start(buf, &len);
+		rv  = BIO_read(bio, ptr, (int)len);
+		M_buf_direct_write_end(buf, (rv > 0)?(size_t)rv:0);
+		if (rv <= 0)
+			break;
+	}
+}
+
+
+/* Write handshake data produced by an offloaded step to the layer below.
+ * Returns M_FALSE if some is still waiting to be written. */
+static M_bool M_io_tls_handshake_flush(M_io_layer_t *layer)
+{
+	M_io_handle_t *handle = M_io_layer_get_handle(layer);
+	M_buf_t       *out    = handle->hs->out;
+	M_io_error_t   err;
+	size_t         write_len;
+
+	M_io_tls_handshake_drain(handle->hs->wbio, out);
+
+	if (M_buf_len(out) == 0)
+		return M_TRUE;
+
+	write_len           = M_buf_len(out);
+	err                 = M_io_layer_write(M_io_layer_get_io(layer), M_io_layer_get_index(layer)-1, (const unsigned char *)M_buf_peek(out), &write_len, NULL);
+	handle->last_io_err = err;
+	if (err != M_IO_ERROR_SUCCESS)
+		return M_FALSE;
+
+	M_buf_drop(out, write_len);
+	return (M_buf_len(out) == 0)?M_TRUE:M_FALSE;
+}
+
+
 /*! Flush the write buffer to the underlying IO object.
  *
  *  We are buffering all writes to try to aggregate multiple writes into larger
@@ -327,11 +528,17 @@ static void M_tls_op_timeout_cb(M_event_t *event, M_event_type_t type, M_io_t *i
  */
 static void M_io_tls_flush_write_buf(M_io_layer_t *layer)
 {
-#ifdef TLS_BUFFER_WRITES
 	M_io_handle_t *handle = M_io_layer_get_handle(layer);
+#ifdef TLS_BUFFER_WRITES
 	M_io_error_t   err;
 	size_t         write_len;
+#endif
+
+	/* Handshake data written while a step was offloaded goes first */
+	if (handle->hs != NULL && !M_io_tls_handshake_flush(layer))
+		return;
 
+#ifdef TLS_BUFFER_WRITES
 	if (M_buf_len(handle->write_buf) == 0)
 		return;
 
@@ -354,31 +561,10 @@ static void M_io_tls_flush_write_buf(M_io_layer_t *layer)
 	if (M_buf_len(handle->write_buf) == 0) {
 		M_io_layer_softevent_add(layer, M_FALSE, M_EVENT_TYPE_WRITE, M_IO_ERROR_SUCCESS);
 	}
-#else
-	(void)layer;
 #endif
 }
 
 
-static M_bool M_io_tls_process_state_init(M_io_layer_t *layer, M_event_type_t *type)
-{
-	M_io_handle_t *handle = M_io_layer_get_handle(layer);
-	M_io_t        *io     = M_io_layer_get_io(layer);
-	M_event_t     *event  = M_io_get_event(io);
-
-	if (*type == M_EVENT_TYPE_CONNECTED) {
-		handle->timer = M_event_timer_oneshot(event, M_tls_get_negotiation_timeout_ms(handle), M_FALSE, M_tls_op_timeout_cb, layer);
-		M_time_elapsed_start(&handle->negotiation_start);
-		if (handle->is_client) {
-			handle->state = M_TLS_STATE_CONNECTING;
-		} else {
-			handle->state = M_TLS_STATE_ACCEPTING;
-		}
-	}
-	return M_FALSE;
-}
-
-
 static void M_io_tls_error_string(int sslerr, char *error, size_t errlen)
 {
 	unsigned long e;
@@ -413,6 +599,376 @@ static void M_io_tls_error_string(int sslerr, char *error, size_t errlen)
 	}
 }
 
+
+/* Run one SSL_connect() or SSL_accept() step against the memory BIOs. The error
+ * queue is per thread so the error string has to be made here. */
+static void M_io_tls_handshake_step(M_io_tls_handshake_t *hs, int *rv, int *err, char *error, size_t errlen)
+{
+	ERR_clear_error();
+	*rv  = hs->is_client?SSL_connect(hs->ssl):SSL_accept(hs->ssl);
+	*err = SSL_ERROR_NONE;
+	if (*rv != 1) {
+		*err = SSL_get_error(hs->ssl, *rv);
+		if (*err != SSL_ERROR_WANT_READ && *err != SSL_ERROR_WANT_WRITE) {
+			M_io_tls_error_string(*err, error, errlen);
+		}
+	}
+	ERR_clear_error();
+}
+
+
+static void M_io_tls_handshake_free(M_io_tls_handshake_t *hs)
+{
+	if (hs == NULL)
+		return;
+
+	/* Otherwise the SSL object, and the memory BIOs with it, belong to the connection */
+	if (hs->orphaned && hs->ssl != NULL)
+		SSL_free(hs->ssl);
+	M_tls_clientctx_destroy(hs->clientctx);
+	M_tls_serverctx_destroy(hs->serverctx);
+	M_buf_cancel(hs->in);
+	M_buf_cancel(hs->out);
+	M_thread_mutex_destroy(hs->lock);
+	M_free(hs);
+}
+
+
+static void M_io_tls_handshake_done_cb(M_event_t *event, M_event_type_t type, M_io_t *io_dummy, void *cb_data)
+{
+	M_io_tls_handshake_t *hs = cb_data;
+	M_io_layer_t         *layer;
+	M_io_handle_t        *handle;
+	M_bool                orphaned;
+	M_bool                done;
+
+	(void)event;
+	(void)type;
+	(void)io_dummy;
+
+	M_thread_mutex_lock(hs->lock);
+	hs->tasks--;
+	orphaned = hs->orphaned;
+	done     = (!hs->busy && hs->tasks == 0)?M_TRUE:M_FALSE;
+	M_thread_mutex_unlock(hs->lock);
+
+	if (orphaned) {
+		if (done)
+			M_io_tls_handshake_free(hs);
+		return;
+	}
+
+	layer = M_io_layer_acquire(hs->io, hs->layer_idx, "TLS");
+	if (layer == NULL)
+		return;
+
+	/* Send ourselves an event to pick up the result and continue */
+	handle = M_io_layer_get_handle(layer);
+	if (handle->state == M_TLS_STATE_CONNECTING || handle->state == M_TLS_STATE_ACCEPTING)
+		M_io_layer_softevent_add(layer, M_FALSE, M_EVENT_TYPE_WRITE, M_IO_ERROR_SUCCESS);
+
+	M_io_layer_release(layer);
+}
+
+
+static void M_io_tls_handshake_task(void *arg)
+{
+	M_io_tls_handshake_t *hs    = arg;
+	int                   rv    = -1;
+	int                   err   = SSL_ERROR_SSL;
+	char                  error[256];
+	M_event_t            *event = NULL;
+	M_bool                orphaned;
+	M_bool                done  = M_FALSE;
+
+	*error = '\0';
+
+	M_thread_mutex_lock(hs->lock);
+	orphaned = hs->orphaned;
+	M_thread_mutex_unlock(hs->lock);
+
+	if (!orphaned)
+		M_io_tls_handshake_step(hs, &rv, &err, error, sizeof(error));
+
+	M_thread_mutex_lock(hs->lock);
+	hs->busy = M_FALSE;
+	orphaned = hs->orphaned;
+	if (orphaned) {
+		/* Nobody is waiting for the result, the event loop may be gone too.
+		 * Clean up unless a queued task still will. */
+		done = (hs->tasks == 0)?M_TRUE:M_FALSE;
+	} else {
+		hs->rv          = rv;
+		hs->err         = err;
+		M_str_cpy(hs->error, sizeof(hs->error), error);
+		hs->have_result = M_TRUE;
+		hs->tasks++;
+		event           = hs->event;
+	}
+	M_thread_mutex_unlock(hs->lock);
+
+	if (orphaned) {
+		if (done)
+			M_io_tls_handshake_free(hs);
+		return;
+	}
+
+	/* hs isn't freed before this task has run */
+	M_event_queue_task(event, M_io_tls_handshake_done_cb, hs);
+}
+
+
+static void M_io_tls_handshake_create(M_io_layer_t *layer)
+{
+	M_io_handle_t        *handle = M_io_layer_get_handle(layer);
+	M_io_tls_handshake_t *hs;
+	M_threadpool_t       *pool;
+
+	/* OpenSSL does its own socket i/o, can't be moved off the event loop */
+	if (handle->sock_bio)
+		return;
+
+	if (handle->is_client) {
+		M_thread_mutex_lock(handle->clientctx->lock);
+		pool = handle->clientctx->handshake_pool;
+		M_thread_mutex_unlock(handle->clientctx->lock);
+	} else {
+		M_thread_mutex_lock(handle->serverctx->lock);
+		pool = handle->serverctx->handshake_pool;
+		M_thread_mutex_unlock(handle->serverctx->lock);
+	}
+
+	if (pool == NULL)
+		return;
+
+	hs            = M_malloc_zero(sizeof(*hs));
+	hs->lock      = M_thread_mutex_create(M_THREAD_MUTEXATTR_NONE);
+	hs->pool      = pool;
+	hs->event     = M_io_get_event(M_io_layer_get_io(layer));
+	hs->io        = M_io_layer_get_io(layer);
+	hs->layer_idx = M_io_layer_get_index(layer);
+	hs->ssl       = handle->ssl;
+	hs->is_client = handle->is_client;
+	hs->rbio      = BIO_new(BIO_s_mem());
+	hs->wbio      = BIO_new(BIO_s_mem());
+	hs->in        = M_buf_create();
+	hs->out       = M_buf_create();
+
+	if (handle->is_client) {
+		M_tls_clientctx_upref(handle->clientctx);
+		hs->clientctx = handle->clientctx;
+	} else {
+		M_tls_serverctx_upref(handle->serverctx);
+		hs->serverctx = handle->serverctx;
+	}
+
+	if (hs->rbio == NULL || hs->wbio == NULL) {
+		BIO_free(hs->rbio);
+		BIO_free(hs->wbio);
+		hs->rbio = NULL;
+		hs->wbio = NULL;
+		M_io_tls_handshake_free(hs);
+		return;
+	}
+
+	/* Frees our BIO, a new one is put back when the handshake is done */
+	SSL_set_bio(handle->ssl, hs->rbio, hs->wbio);
+	handle->bio_glue = NULL;
+	handle->hs       = hs;
+}
+
+
+/* Must be called before the SSL object is freed. If a step is still running the
+ * SSL object is handed over to hs and handle->ssl is cleared. hs is left for the
+ * step or its queued task to clean up. */
+static void M_io_tls_handshake_destroy(M_io_handle_t *handle)
+{
+	M_io_tls_handshake_t *hs = handle->hs;
+	M_bool                busy;
+	M_bool                in_flight;
+
+	if (hs == NULL)
+		return;
+
+	handle->hs = NULL;
+
+	M_thread_mutex_lock(hs->lock);
+	busy         = hs->busy;
+	in_flight    = (busy || hs->tasks != 0)?M_TRUE:M_FALSE;
+	hs->orphaned = in_flight;
+	if (!busy)
+		hs->ssl  = NULL;
+	M_thread_mutex_unlock(hs->lock);
+
+	if (!in_flight) {
+		M_io_tls_handshake_free(hs);
+		return;
+	}
+
+	if (busy) {
+		handle->ssl      = NULL;
+		handle->bio_glue = NULL;
+	}
+}
+
+
+/* OpenSSL must not be used by the event loop while a step is running, or while
+ * negotiating since that would run handshake steps behind our back. */
+static M_bool M_io_tls_handshake_pending(M_io_handle_t *handle)
+{
+	M_io_tls_handshake_t *hs = handle->hs;
+	M_bool                busy;
+
+	if (hs == NULL)
+		return M_FALSE;
+
+	if (handle->state == M_TLS_STATE_CONNECTING || handle->state == M_TLS_STATE_ACCEPTING)
+		return M_TRUE;
+
+	M_thread_mutex_lock(hs->lock);
+	busy = hs->busy;
+	M_thread_mutex_unlock(hs->lock);
+	return busy;
+}
+
+
+/* Read everything available from the layer below for the next step. Returns
+ * M_TRUE if anything was read. */
+static M_bool M_io_tls_handshake_fill(M_io_layer_t *layer)
+{
+	M_io_handle_t *handle = M_io_layer_get_handle(layer);
+	M_io_t        *io     = M_io_layer_get_io(layer);
+	M_bool         filled = M_FALSE;
+	unsigned char  buf[4096];
+	size_t         len;
+	M_io_error_t   err;
+
+	while (1) {
+		len                 = sizeof(buf);
+		err                 = M_io_layer_read(io, M_io_layer_get_index(layer)-1, buf, &len, NULL);
+		handle->last_io_err = err;
+		if (err != M_IO_ERROR_SUCCESS || len == 0)
+			break;
+
+		BIO_write(handle->hs->rbio, buf, (int)len);
+		filled = M_TRUE;
+	}
+
+	return filled;
+}
+
+
+/* The handshake is done, go back to our BIO. Anything read past the end of the
+ * handshake is kept for it. */
+static void M_io_tls_handshake_finish(M_io_layer_t *layer)
+{
+	M_io_handle_t        *handle = M_io_layer_get_handle(layer);
+	M_io_tls_handshake_t *hs     = handle->hs;
+
+	M_io_tls_handshake_drain(hs->rbio, hs->in);
+	M_io_tls_handshake_drain(hs->wbio, hs->out);
+
+	/* Frees the memory BIOs */
+	handle->bio_glue = M_tls_bio_new(layer);
+	SSL_set_bio(handle->ssl, handle->bio_glue, handle->bio_glue);
+	hs->rbio         = NULL;
+	hs->wbio         = NULL;
+}
+
+
+/* Run the next SSL_connect() or SSL_accept() step. Returns M_FALSE while a step is
+ * running on the thread pool. Otherwise rv and err hold the result and the error
+ * string has been set if it failed. */
+static M_bool M_io_tls_handshake(M_io_layer_t *layer, int *rv, int *err)
+{
+	M_io_handle_t        *handle = M_io_layer_get_handle(layer);
+	M_io_tls_handshake_t *hs     = handle->hs;
+	M_bool                blocked;
+	M_bool                have_result;
+
+	if (hs == NULL) {
+		ERR_clear_error();
+		blocked = M_io_tls_sigpipe_block(handle);
+		*rv     = handle->is_client?SSL_connect(handle->ssl):SSL_accept(handle->ssl);
+		M_io_tls_sigpipe_unblock(blocked);
+		*err    = SSL_ERROR_NONE;
+		if (*rv != 1) {
+			*err = SSL_get_error(handle->ssl, *rv);
+			if (*err != SSL_ERROR_WANT_READ && *err != SSL_ERROR_WANT_WRITE) {
+				M_io_tls_error_string(*err, handle->error, sizeof(handle->error));
+			}
+		}
+		return M_TRUE;
+	}
+
+	M_thread_mutex_lock(hs->lock);
+	if (hs->busy) {
+		M_thread_mutex_unlock(hs->lock);
+		return M_FALSE;
+	}
+	have_result     = hs->have_result;
+	hs->have_result = M_FALSE;
+	*rv             = hs->rv;
+	*err            = hs->err;
+	if (have_result && *rv != 1)
+		M_str_cpy(handle->error, sizeof(handle->error), hs->error);
+	M_thread_mutex_unlock(hs->lock);
+
+	while (1) {
+		/* Send what the last step produced */
+		M_io_tls_flush_write_buf(layer);
+
+		if (have_result && *err != SSL_ERROR_WANT_READ && *err != SSL_ERROR_WANT_WRITE) {
+			M_io_tls_handshake_finish(layer);
+			return M_TRUE;
+		}
+
+		/* A client speaks first, a server waits for the client */
+		if (!M_io_tls_handshake_fill(layer) && (hs->started || !hs->is_client)) {
+			*rv  = -1;
+			*err = SSL_ERROR_WANT_READ;
+			return M_TRUE;
+		}
+		hs->started = M_TRUE;
+
+		M_thread_mutex_lock(hs->lock);
+		hs->busy = M_TRUE;
+		M_thread_mutex_unlock(hs->lock);
+		if (M_threadpool_dispatch_detached(hs->pool, M_io_tls_handshake_task, hs))
+			return M_FALSE;
+
+		/* No queue slot, waiting for one would hold up the event loop so it's no
+		 * worse to do the work here */
+		M_thread_mutex_lock(hs->lock);
+		hs->busy = M_FALSE;
+		M_thread_mutex_unlock(hs->lock);
+		M_io_tls_handshake_step(hs, rv, err, handle->error, sizeof(handle->error));
+		have_result = M_TRUE;
+	}
+}
+
+
+static M_bool M_io_tls_process_state_init(M_io_layer_t *layer, M_event_type_t *type)
+{
+	M_io_handle_t *handle = M_io_layer_get_handle(layer);
+	M_io_t        *io     = M_io_layer_get_io(layer);
+	M_event_t     *event  = M_io_get_event(io);
+
+	if (*type == M_EVENT_TYPE_CONNECTED) {
+		M_io_tls_ktls_setup(layer);
+		M_io_tls_handshake_create(layer);
+		handle->timer = M_event_timer_oneshot(event, M_tls_get_negotiation_timeout_ms(handle), M_FALSE, M_tls_op_timeout_cb, layer);
+		M_time_elapsed_start(&handle->negotiation_start);
+		if (handle->is_client) {
+			handle->state = M_TLS_STATE_CONNECTING;
+		} else {
+			handle->state = M_TLS_STATE_ACCEPTING;
+		}
+	}
+	return M_FALSE;
+}
+
+
 static M_bool M_io_tls_process_state_connecting(M_io_layer_t *layer, M_event_type_t *type)
 {
 	M_io_handle_t *handle   = M_io_layer_get_handle(layer);
@@ -423,7 +979,8 @@ static M_bool M_io_tls_process_state_connecting(M_io_layer_t *layer, M_event_typ
 		case M_EVENT_TYPE_CONNECTED:
 		case M_EVENT_TYPE_READ:
 		case M_EVENT_TYPE_WRITE:
-			rv = SSL_connect(handle->ssl);
+			if (!M_io_tls_handshake(layer, &rv, &err))
+				return M_TRUE; /* Step running on the thread pool */
 			if (rv == 1) {
 				/* Verify peer */
 				if (handle->clientctx->verify_level != M_TLS_VERIFY_NONE) {
@@ -475,7 +1032,6 @@ cert_err:
 				M_io_set_error(M_io_layer_get_io(layer), M_IO_ERROR_BADCERTIFICATE);
 				return M_FALSE; /* Not consumed, relay rewritten error message */
 			}
-			err = SSL_get_error(handle->ssl, rv);
 			if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
 				M_io_tls_flush_write_buf(layer);
 
@@ -486,7 +1042,6 @@ cert_err:
 			handle->state            = M_TLS_STATE_ERROR;
 			*type                    = M_EVENT_TYPE_ERROR;
 			handle->negotiation_time = M_time_elapsed(&handle->negotiation_start);
-			M_io_tls_error_string(err, handle->error, sizeof(handle->error));
 			return M_FALSE; /* Not consumed, relay rewritten error message */
 		case M_EVENT_TYPE_DISCONNECTED:
 		case M_EVENT_TYPE_ERROR:
@@ -511,8 +1066,8 @@ static M_bool M_io_tls_process_state_accepting(M_io_layer_t *layer, M_event_type
 		case M_EVENT_TYPE_CONNECTED:
 		case M_EVENT_TYPE_READ:
 		case M_EVENT_TYPE_WRITE:
-			ERR_clear_error();
-			rv = SSL_accept(handle->ssl);
+			if (!M_io_tls_handshake(layer, &rv, &err))
+				return M_TRUE; /* Step running on the thread pool */
 			if (rv == 1) {
 //M_printf("SSL_accept(%p) successful\n", M_io_layer_get_io(layer));
 				handle->state = M_TLS_STATE_CONNECTED;
@@ -531,7 +1086,6 @@ static M_bool M_io_tls_process_state_accepting(M_io_layer_t *layer, M_event_type
 
 				return M_FALSE; /* Not consumed, relay rewritten connect message */
 			}
-			err = SSL_get_error(handle->ssl, rv);
 			if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
 				M_io_tls_flush_write_buf(layer);
 
@@ -542,8 +1096,6 @@ static M_bool M_io_tls_process_state_accepting(M_io_layer_t *layer, M_event_type
 			handle->state            = M_TLS_STATE_ERROR;
 			*type                    = M_EVENT_TYPE_ERROR;
 			handle->negotiation_time = M_time_elapsed(&handle->negotiation_start);
-
-			M_io_tls_error_string(err, handle->error, sizeof(handle->error));
 			return M_FALSE; /* Not consumed, relay rewritten error message */
 		case M_EVENT_TYPE_DISCONNECTED:
 		case M_EVENT_TYPE_ERROR:
@@ -615,13 +1167,16 @@ static M_bool M_io_tls_process_state_shutdown(M_io_layer_t *layer, M_event_type_
 	M_io_handle_t *handle   = M_io_layer_get_handle(layer);
 	int            rv;
 	int            err;
+	M_bool         blocked;
 
 	switch (*type) {
 		case M_EVENT_TYPE_CONNECTED:
 		case M_EVENT_TYPE_READ:
 		case M_EVENT_TYPE_WRITE:
 			ERR_clear_error();
-			rv = SSL_shutdown(handle->ssl);
+			blocked = M_io_tls_sigpipe_block(handle);
+			rv      = SSL_shutdown(handle->ssl);
+			M_io_tls_sigpipe_unblock(blocked);
 			if (rv == 1) {
 //M_printf("SSL_shutdown() successful\n");
 				handle->state = M_TLS_STATE_DISCONNECTED;
@@ -738,6 +1293,15 @@ static int M_tls_bio_read(BIO *b, char *buf, int len)
 	if (buf == NULL || len <= 0 || layer == NULL)
 		return 0;
 
+	/* Read past the end of an offloaded handshake */
+	if (handle->hs != NULL && M_buf_len(handle->hs->in) != 0) {
+		BIO_clear_retry_flags(b);
+		read_len = M_MIN((size_t)len, M_buf_len(handle->hs->in));
+		M_mem_copy(buf, M_buf_peek(handle->hs->in), read_len);
+		M_buf_drop(handle->hs->in, read_len);
+		return (int)read_len;
+	}
+
 	/* Report cached error conditions appropriately */
 	if (handle->last_io_err == M_IO_ERROR_DISCONNECT) {
 		return 0;
@@ -786,6 +1350,12 @@ static int M_tls_bio_write(BIO *b, const char *buf, int len)
 		return -1;
 	}
 
+	/* Handshake data from an offloaded step has to go out first */
+	if (handle->hs != NULL && M_buf_len(handle->hs->out) != 0) {
+		BIO_set_retry_write(b);
+		return -1;
+	}
+
 #ifdef TLS_BUFFER_WRITES
 	write_len  = 2 * 1024 * 1024; /* 2MB buffer */
 	write_len -= M_buf_len(handle->write_buf);
@@ -913,14 +1483,12 @@ static M_bool M_io_tls_init_cb(M_io_layer_t *layer)
 		M_asprintf(&hostport, "%s:%u", handle->hostname, (unsigned int)M_io_net_get_port(io));
 
 		/* Attempt to resume session */
-		M_thread_mutex_lock(handle->clientctx->lock);
-		session = M_hash_strvp_multi_get_direct(handle->clientctx->sessions, hostport, 0);
+		session = M_tls_clientctx_session_take(handle->clientctx, hostport);
 		if (session) {
 			SSL_set_session(handle->ssl, session);
-			/* This will also reduce the reference count on that session */
-			M_hash_strvp_multi_remove(handle->clientctx->sessions, hostport, 0, M_TRUE);
+			/* SSL handle holds its own reference */
+			SSL_SESSION_free(session);
 		}
-		M_thread_mutex_unlock(handle->clientctx->lock);
 		M_free(hostport);
 	}
 
@@ -948,12 +1516,16 @@ static M_io_error_t M_io_tls_read_cb(M_io_layer_t *layer, unsigned char *buf, si
 	int            err;
 	size_t         request_len = *read_len;
 	M_io_error_t   ioerr;
+	M_bool         blocked;
 
 	(void)meta;
 
 	if (layer == NULL || handle == NULL || handle->ssl == NULL)
 		return M_IO_ERROR_INVALID;
 
+	if (M_io_tls_handshake_pending(handle))
+		return M_IO_ERROR_WOULDBLOCK;
+
 	/* Clear READ_WANT_WRITE flag */
 	handle->state_flags &= (M_tls_stateflags_t)~(M_TLS_STATEFLAG_READ_WANT_WRITE);
 
@@ -961,6 +1533,7 @@ static M_io_error_t M_io_tls_read_cb(M_io_layer_t *layer, unsigned char *buf, si
 
 	/* We need to consume all data, SSL_read() may not do this, so since we need to
 	 * act in a edge-triggered manner, do this in a loop */
+	blocked = M_io_tls_sigpipe_block(handle);
 	while (1) {
 		ERR_clear_error();
 		rv = SSL_read(handle->ssl, buf+(*read_len), (int)(request_len - *read_len));
@@ -970,10 +1543,12 @@ static M_io_error_t M_io_tls_read_cb(M_io_layer_t *layer, unsigned char *buf, si
 		*read_len += (size_t)rv;
 
 		if (request_len == *read_len) {
+			M_io_tls_sigpipe_unblock(blocked);
 			M_io_tls_flush_write_buf(layer);
 			return M_IO_ERROR_SUCCESS;
 		}
 	}
+	M_io_tls_sigpipe_unblock(blocked);
 
 	ioerr = M_IO_ERROR_ERROR;
 	err   = SSL_get_error(handle->ssl, rv);
@@ -985,8 +1560,7 @@ static M_io_error_t M_io_tls_read_cb(M_io_layer_t *layer, unsigned char *buf, si
 
 		ioerr = M_IO_ERROR_WOULDBLOCK;
 	} else {
-		/* OpenSSL doesn't appear to relay disconnect vs error up the chain for syscalls, manage that ourselves */
-		if (err == SSL_ERROR_ZERO_RETURN || (err == SSL_ERROR_SYSCALL && handle->last_io_err == M_IO_ERROR_DISCONNECT)) {
+		if (M_io_tls_is_disconnect(handle, err)) {
 //M_printf("%s(): err == SSL_ERROR_ZERO_RETURN\n", __FUNCTION__);
 			handle->state = M_TLS_STATE_DISCONNECTED;
 			ioerr         = M_IO_ERROR_DISCONNECT;
@@ -1016,12 +1590,16 @@ static M_io_error_t M_io_tls_write_cb(M_io_layer_t *layer, const unsigned char *
 	int            err;
 	size_t         request_len = *write_len;
 	M_io_error_t   ioerr;
+	M_bool         blocked;
 
 	(void)meta;
 
 	if (layer == NULL || handle == NULL || handle->ssl == NULL)
 		return M_IO_ERROR_INVALID;
 
+	if (M_io_tls_handshake_pending(handle))
+		return M_IO_ERROR_WOULDBLOCK;
+
 	/* Clear WRITE_WANT_READ flag */
 	handle->state_flags &= (M_tls_stateflags_t)~(M_TLS_STATEFLAG_WRITE_WANT_READ);
 
@@ -1029,6 +1607,7 @@ static M_io_error_t M_io_tls_write_cb(M_io_layer_t *layer, const unsigned char *
 
 	/* We need to write as much data as possible, SSL_write() may not do this, so since
 	 * we need to act in a edge-triggered manner, do this in a loop */
+	blocked = M_io_tls_sigpipe_block(handle);
 	while (1) {
 		ERR_clear_error();
 		rv = SSL_write(handle->ssl, buf+(*write_len), (int)(request_len - *write_len));
@@ -1038,11 +1617,13 @@ static M_io_error_t M_io_tls_write_cb(M_io_layer_t *layer, const unsigned char *
 		*write_len += (size_t)rv;
 
 		if (request_len == *write_len) {
+			M_io_tls_sigpipe_unblock(blocked);
 			/* Only write once all queued */
 			M_io_tls_flush_write_buf(layer);
 			return M_IO_ERROR_SUCCESS;
 		}
 	}
+	M_io_tls_sigpipe_unblock(blocked);
 
 	ioerr = M_IO_ERROR_ERROR;
 	err   = SSL_get_error(handle->ssl, rv);
@@ -1055,8 +1636,7 @@ static M_io_error_t M_io_tls_write_cb(M_io_layer_t *layer, const unsigned char *
 
 		ioerr = M_IO_ERROR_WOULDBLOCK;
 	} else {
-		/* OpenSSL doesn't appear to relay disconnect vs error up the chain for syscalls, manage that ourselves */
-		if (err == SSL_ERROR_ZERO_RETURN || (err == SSL_ERROR_SYSCALL && handle->last_io_err == M_IO_ERROR_DISCONNECT)) {
+		if (M_io_tls_is_disconnect(handle, err)) {
 //M_printf("%s(): err == SSL_ERROR_ZERO_RETURN\n", __FUNCTION__);
 			handle->state = M_TLS_STATE_DISCONNECTED;
 			ioerr         = M_IO_ERROR_DISCONNECT;
@@ -1079,6 +1659,59 @@ static M_io_error_t M_io_tls_write_cb(M_io_layer_t *layer, const unsigned char *
 }
 
 
+#ifdef M_TLS_KTLS
+/* Only possible once the kernel is encrypting, otherwise the file is sent with SSL_write() */
+static M_io_error_t M_io_tls_sendfile_cb(M_io_layer_t *layer, M_intptr fd, M_int64 offset, size_t len, size_t *write_len)
+{
+	M_io_handle_t *handle = M_io_layer_get_handle(layer);
+	ossl_ssize_t   rv;
+	int            err;
+	M_bool         blocked;
+
+	if (layer == NULL || handle == NULL || handle->ssl == NULL || write_len == NULL)
+		return M_IO_ERROR_INVALID;
+
+	if (handle->state != M_TLS_STATE_CONNECTED)
+		return M_IO_ERROR_NOTCONNECTED;
+
+	if (!handle->sock_bio || offset < 0 || !BIO_get_ktls_send(SSL_get_wbio(handle->ssl)))
+		return M_IO_ERROR_NOTIMPL;
+
+	*write_len = 0;
+
+	ERR_clear_error();
+	errno   = 0;
+	blocked = M_io_tls_sigpipe_block(handle);
+	rv      = SSL_sendfile(handle->ssl, (int)fd, (off_t)offset, len, 0);
+	M_io_tls_sigpipe_unblock(blocked);
+
+	if (rv >= 0) {
+		/* 0 is end of file */
+		*write_len = (size_t)rv;
+		return M_IO_ERROR_SUCCESS;
+	}
+
+	err = SSL_get_error(handle->ssl, -1);
+	if (err == SSL_ERROR_WANT_WRITE || err == SSL_ERROR_WANT_READ)
+		return M_IO_ERROR_WOULDBLOCK;
+
+	/* File can't be used this way, caller falls back to read and write */
+	if (errno == EINVAL || errno == ENOSYS || errno == EOVERFLOW || errno == ESPIPE)
+		return M_IO_ERROR_NOTIMPL;
+
+	if (M_io_tls_is_disconnect(handle, err)) {
+		handle->state = M_TLS_STATE_DISCONNECTED;
+		M_io_tls_error_string(err, handle->error, sizeof(handle->error));
+		return M_IO_ERROR_DISCONNECT;
+	}
+
+	handle->state = M_TLS_STATE_ERROR;
+	M_io_tls_error_string(err, handle->error, sizeof(handle->error));
+	return M_IO_ERROR_ERROR;
+}
+#endif
+
+
 static M_bool M_io_tls_disconnect_cb(M_io_layer_t *layer)
 {
 	M_io_handle_t *handle = M_io_layer_get_handle(layer);
@@ -1086,6 +1719,7 @@ static M_bool M_io_tls_disconnect_cb(M_io_layer_t *layer)
 	M_event_t     *event  = M_io_get_event(io);
 	int            rv;
 	int            err;
+	M_bool         blocked;
 
 	if (handle->state != M_TLS_STATE_CONNECTED) {
 		/* Already started shutdown, ignore */
@@ -1097,7 +1731,9 @@ static M_bool M_io_tls_disconnect_cb(M_io_layer_t *layer)
 	handle->state = M_TLS_STATE_SHUTDOWN;
 
 	ERR_clear_error();
-	rv = SSL_shutdown(handle->ssl);
+	blocked = M_io_tls_sigpipe_block(handle);
+	rv      = SSL_shutdown(handle->ssl);
+	M_io_tls_sigpipe_unblock(blocked);
 //M_printf("SSL_shutdown returned %d\n", rv);
 	if (rv == 1) {
 		handle->state = M_TLS_STATE_DISCONNECTED;
@@ -1150,9 +1786,7 @@ static void M_io_tls_save_client_session(M_io_handle_t *handle, unsigned int por
 	if (session != NULL) {
 		M_asprintf(&hostport, "%s:%u", handle->hostname, port);
 
-		M_thread_mutex_lock(handle->clientctx->lock);
-		M_hash_strvp_insert(handle->clientctx->sessions, hostport, session);
-		M_thread_mutex_unlock(handle->clientctx->lock);
+		M_tls_clientctx_session_put(handle->clientctx, hostport, session);
 
 		M_free(hostport);
 	}
@@ -1167,8 +1801,11 @@ static M_bool M_io_tls_reset_cb(M_io_layer_t *layer)
 	if (handle == NULL)
 		return M_FALSE;
 
+	/* Clears handle->ssl if a handshake step still running on the thread pool is using it */
+	M_io_tls_handshake_destroy(handle);
+
 	/* Save session */
-	if (handle->state == M_TLS_STATE_CONNECTED || handle->state == M_TLS_STATE_SHUTDOWN || handle->state == M_TLS_STATE_DISCONNECTED) {
+	if (handle->ssl != NULL && (handle->state == M_TLS_STATE_CONNECTED || handle->state == M_TLS_STATE_SHUTDOWN || handle->state == M_TLS_STATE_DISCONNECTED)) {
 		/* Tell OpenSSL that shutdown was successful otherwise it may not mark the session as resumable */
 		SSL_set_shutdown(handle->ssl, SSL_SENT_SHUTDOWN|SSL_RECEIVED_SHUTDOWN);
 	}
@@ -1197,6 +1834,7 @@ static M_bool M_io_tls_reset_cb(M_io_layer_t *layer)
 	handle->ssl              = NULL;
 	/* SSL_free() auto-frees the bio BIO_free(handle->bio_glue); */
 	handle->bio_glue         = NULL;
+	handle->sock_bio         = M_FALSE;
 #ifdef TLS_BUFFER_WRITES
 	M_buf_cancel(handle->write_buf);
 	handle->write_buf        = NULL;
@@ -1222,6 +1860,7 @@ static void M_io_tls_destroy_cb(M_io_layer_t *layer)
 		return;
 
 	/* reset_cb() will be called to clean up most things */
+	M_io_tls_handshake_destroy(handle);
 
 	if (handle->is_client) {
 		M_tls_clientctx_destroy(handle->clientctx);
@@ -1293,6 +1932,10 @@ M_io_error_t M_io_tls_client_add(M_io_t *io, M_tls_clientctx_t *ctx, const char
 	handle->is_client   = M_TRUE; /* To know if we are accepting (server) or connecting (client) */
 	handle->clientctx   = ctx;
 
+	M_thread_mutex_lock(ctx->lock);
+	handle->ktls        = ctx->ktls_enabled;
+	M_thread_mutex_unlock(ctx->lock);
+
 	/* If a hostname wasn't provided, see if the underlying object is a network connection, if so,
 	 * get the hostname from there */
 	if (M_str_isempty(hostname)) {
@@ -1301,13 +1944,18 @@ M_io_error_t M_io_tls_client_add(M_io_t *io, M_tls_clientctx_t *ctx, const char
 
 	handle->hostname = M_strdup(hostname);
 
-	/* Add buffer layer to improve performance */
-	M_io_add_buffer(io, NULL, 16 * 1024 * 1024, 16 * 1024 * 1024);
+	/* Add buffer layer to improve performance. Not with kernel offload, it needs
+	 * to be directly on the network layer. */
+	if (!handle->ktls)
+		M_io_add_buffer(io, NULL, 16 * 1024 * 1024, 16 * 1024 * 1024);
 
 	callbacks = M_io_callbacks_create();
 	M_io_callbacks_reg_init(callbacks, M_io_tls_init_cb);
 	M_io_callbacks_reg_read(callbacks, M_io_tls_read_cb);
 	M_io_callbacks_reg_write(callbacks, M_io_tls_write_cb);
+#ifdef M_TLS_KTLS
+	M_io_callbacks_reg_sendfile(callbacks, M_io_tls_sendfile_cb);
+#endif
 	M_io_callbacks_reg_processevent(callbacks, M_io_tls_process_cb);
 	//M_io_callbacks_reg_unregister(callbacks, M_io_tls_unregister_cb);
 	M_io_callbacks_reg_disconnect(callbacks, M_io_tls_disconnect_cb);
@@ -1376,15 +2024,24 @@ M_io_error_t M_io_tls_server_add(M_io_t *io, M_tls_serverctx_t *ctx, size_t *lay
 	M_tls_serverctx_upref(ctx);
 	handle->serverctx   = ctx;
 
+	M_thread_mutex_lock(ctx->lock);
+	handle->ktls        = ctx->ktls_enabled;
+	M_thread_mutex_unlock(ctx->lock);
+
 	callbacks = M_io_callbacks_create();
 	M_io_callbacks_reg_init(callbacks, M_io_tls_init_cb);
 	if (M_io_get_type(io) == M_IO_TYPE_LISTENER) {
 		M_io_callbacks_reg_accept(callbacks, M_io_tls_accept_cb);
-		/* Add buffer layer to improve performance */
-		M_io_add_buffer(io, NULL, 16 * 1024 * 1024, 16 * 1024 * 1024);
+		/* Add buffer layer to improve performance. Not with kernel offload, it needs
+		 * to be directly on the network layer. */
+		if (!handle->ktls)
+			M_io_add_buffer(io, NULL, 16 * 1024 * 1024, 16 * 1024 * 1024);
 	}
 	M_io_callbacks_reg_read(callbacks, M_io_tls_read_cb);
 	M_io_callbacks_reg_write(callbacks, M_io_tls_write_cb);
+#ifdef M_TLS_KTLS
+	M_io_callbacks_reg_sendfile(callbacks, M_io_tls_sendfile_cb);
+#endif
 	M_io_callbacks_reg_processevent(callbacks, M_io_tls_process_cb);
 	//M_io_callbacks_reg_unregister(callbacks, M_io_tls_unregister_cb);
 	M_io_callbacks_reg_disconnect(callbacks, M_io_tls_disconnect_cb);
@@ -1680,3 +2337,29 @@ M_uint64 M_tls_get_negotiation_time_ms(M_io_t *io, size_t id)
 
 	return ret;
 }
+
+
+M_tls_ktls_t M_tls_get_ktls(M_io_t *io, size_t id)
+{
+	M_io_layer_t  *layer  = M_io_layer_acquire(io, id, "TLS");
+	M_io_handle_t *handle = M_io_layer_get_handle(layer);
+	M_tls_ktls_t   ret    = M_TLS_KTLS_NONE;
+
+	if (layer == NULL)
+		return M_TLS_KTLS_NONE;
+
+#ifdef M_TLS_KTLS
+	if (handle->ssl != NULL && handle->sock_bio) {
+		if (BIO_get_ktls_send(SSL_get_wbio(handle->ssl)))
+			ret |= M_TLS_KTLS_SEND;
+		if (BIO_get_ktls_recv(SSL_get_rbio(handle->ssl)))
+			ret |= M_TLS_KTLS_RECV;
+	}
+#else
+	(void)handle;
+#endif
+
+	M_io_layer_release(layer);
+
+	return ret;
+}
@@ -34,17 +34,122 @@
 #include "m_tls_clientctx_int.h"
 
 
-/*! Used when destroying the hashtable */
-static void M_tls_clientctx_session_destroy(void *session)
+typedef struct {
+	char           *hostport;
+	SSL_SESSION    *session;
+	M_time_t        expire;
+	M_llist_node_t *node;
+} M_tls_clientctx_session_t;
+
+
+/*! Used when destroying the lru list */
+static void M_tls_clientctx_session_destroy(void *arg)
+{
+	M_tls_clientctx_session_t *entry = arg;
+
+	if (entry == NULL)
+		return;
+
+	if (entry->session != NULL)
+		SSL_SESSION_free(entry->session);
+	M_free(entry->hostport);
+	M_free(entry);
+}
+
+
+/* Must be called locked */
+static void M_tls_clientctx_session_remove(M_tls_clientctx_t *ctx, M_tls_clientctx_session_t *entry)
 {
-	if (session != NULL)
-		SSL_SESSION_free(session);
+	size_t len = 0;
+	size_t i;
+
+	M_hash_strvp_multi_len(ctx->sessions, entry->hostport, &len);
+	for (i=0; i<len; i++) {
+		if (M_hash_strvp_multi_get_direct(ctx->sessions, entry->hostport, i) == entry) {
+			M_hash_strvp_multi_remove(ctx->sessions, entry->hostport, i, M_FALSE);
+			break;
+		}
+	}
+
+	M_llist_remove_node(entry->node);
+}
+
+
+/* Must be called locked */
+static void M_tls_clientctx_session_expire(M_tls_clientctx_t *ctx, size_t max)
+{
+	M_time_t                   now = M_time();
+	M_tls_clientctx_session_t *entry;
+
+	while (M_llist_len(ctx->sessions_lru) > 0) {
+		entry = M_llist_node_val(M_llist_first(ctx->sessions_lru));
+		if ((max == 0 || M_llist_len(ctx->sessions_lru) <= max) && entry->expire > now)
+			break;
+		M_tls_clientctx_session_remove(ctx, entry);
+	}
+}
+
+
+SSL_SESSION *M_tls_clientctx_session_take(M_tls_clientctx_t *ctx, const char *hostport)
+{
+	M_tls_clientctx_session_t *entry;
+	SSL_SESSION               *session = NULL;
+	M_time_t                   now     = M_time();
+	size_t                     len     = 0;
+
+	M_thread_mutex_lock(ctx->lock);
+
+	/* Newest first, it has the most time left */
+	M_hash_strvp_multi_len(ctx->sessions, hostport, &len);
+	while (len > 0 && session == NULL) {
+		len--;
+		entry = M_hash_strvp_multi_get_direct(ctx->sessions, hostport, len);
+		if (entry->expire > now) {
+			/* Sessions are only used once */
+			session        = entry->session;
+			entry->session = NULL;
+		}
+		M_tls_clientctx_session_remove(ctx, entry);
+	}
+
+	M_thread_mutex_unlock(ctx->lock);
+	return session;
+}
+
+
+void M_tls_clientctx_session_put(M_tls_clientctx_t *ctx, const char *hostport, SSL_SESSION *session)
+{
+	M_tls_clientctx_session_t *entry;
+	M_time_t                   now = M_time();
+
+	entry           = M_malloc_zero(sizeof(*entry));
+	entry->hostport = M_strdup(hostport);
+	entry->session  = session;
+	entry->expire   = (M_time_t)SSL_SESSION_get_time(session) + (M_time_t)SSL_SESSION_get_timeout(session);
+
+	M_thread_mutex_lock(ctx->lock);
+
+	if (ctx->sessions_max_age_s != 0 && entry->expire > now + (M_time_t)ctx->sessions_max_age_s)
+		entry->expire = now + (M_time_t)ctx->sessions_max_age_s;
+
+	entry->node = M_llist_insert(ctx->sessions_lru, entry);
+	M_hash_strvp_insert(ctx->sessions, hostport, entry);
+
+	M_tls_clientctx_session_expire(ctx, ctx->sessions_max);
+
+	M_thread_mutex_unlock(ctx->lock);
 }
 
 
 M_tls_clientctx_t *M_tls_clientctx_create(void)
 {
-	M_tls_clientctx_t *ctx;
+	M_tls_clientctx_t        *ctx;
+	struct M_llist_callbacks  session_cbs = {
+		NULL,
+		NULL,
+		NULL,
+		M_tls_clientctx_session_destroy
+	};
 
 	M_tls_init(M_TLS_INIT_NORMAL);
 
@@ -57,7 +162,9 @@ M_tls_clientctx_t *M_tls_clientctx_create(void)
 	ctx->lock                   = M_thread_mutex_create(M_THREAD_MUTEXATTR_NONE);
 
 	/* Session support */
-	ctx->sessions               = M_hash_strvp_create(16, 75, M_HASH_STRVP_MULTI_VALUE, M_tls_clientctx_session_destroy);
+	ctx->sessions               = M_hash_strvp_create(16, 75, M_HASH_STRVP_MULTI_VALUE, NULL);
+	ctx->sessions_lru           = M_llist_create(&session_cbs, M_LLIST_NONE);
+	ctx->sessions_max           = 1024;
 
 	ctx->verify_level           = M_TLS_VERIFY_FULL;
 
@@ -83,7 +190,8 @@ M_bool M_tls_clientctx_upref(M_tls_clientctx_t *ctx)
 
 static void M_tls_clientctx_destroy_real(M_tls_clientctx_t *ctx)
 {
-	M_hash_strvp_destroy(ctx->sessions, M_TRUE);
+	M_hash_strvp_destroy(ctx->sessions, M_FALSE);
+	M_llist_destroy(ctx->sessions_lru, M_TRUE);
 	M_tls_ctx_destroy(ctx->ctx);
 	/* Locked when we entered */
 	M_thread_mutex_unlock(ctx->lock);
@@ -349,6 +457,55 @@ M_bool M_tls_clientctx_set_session_resumption(M_tls_clientctx_t *ctx, M_bool ena
 	return M_TRUE;
 }
 
+M_bool M_tls_clientctx_set_session_cache(M_tls_clientctx_t *ctx, size_t max_sessions, M_uint64 max_age_s)
+{
+	M_tls_clientctx_session_t *entry;
+	M_llist_node_t            *node;
+	M_time_t                   now = M_time();
+
+	if (ctx == NULL)
+		return M_FALSE;
+
+	M_thread_mutex_lock(ctx->lock);
+	ctx->sessions_max       = max_sessions;
+	ctx->sessions_max_age_s = max_age_s;
+
+	/* Apply the age limit to what's already cached */
+	if (max_age_s != 0) {
+		for (node=M_llist_first(ctx->sessions_lru); node!=NULL; node=M_llist_node_next(node)) {
+			entry = M_llist_node_val(node);
+			if (entry->expire > now + (M_time_t)max_age_s) {
+				entry->expire = now + (M_time_t)max_age_s;
+			}
+		}
+	}
+	M_tls_clientctx_session_expire(ctx, max_sessions);
+	M_thread_mutex_unlock(ctx->lock);
+	return M_TRUE;
+}
+
+M_bool M_tls_clientctx_set_ktls(M_tls_clientctx_t *ctx, M_bool enable)
+{
+	if (ctx == NULL)
+		return M_FALSE;
+
+	M_thread_mutex_lock(ctx->lock);
+	ctx->ktls_enabled = enable;
+	M_thread_mutex_unlock(ctx->lock);
+	return M_TRUE;
+}
+
+M_bool M_tls_clientctx_set_handshake_pool(M_tls_clientctx_t *ctx, M_threadpool_t *pool)
+{
+	if (ctx == NULL)
+		return M_FALSE;
+
+	M_thread_mutex_lock(ctx->lock);
+	ctx->handshake_pool = pool;
+	M_thread_mutex_unlock(ctx->lock);
+	return M_TRUE;
+}
+
 char *M_tls_clientctx_get_cipherlist(M_tls_clientctx_t *ctx)
 {
 	char *ret = NULL;
@@ -31,9 +31,17 @@ struct M_tls_clientctx {
 	SSL_CTX             *ctx;                    /*!< OpenSSL's context                                                  */
 	size_t               ref_cnt;                /*!< Reference count to prevent destroy of CTX while connections active */
 	M_hash_strvp_t      *sessions;               /*!< Storage of session handles for future renegotiation                */
+	M_llist_t           *sessions_lru;           /*!< Sessions from oldest to newest, owns the entries                   */
+	size_t               sessions_max;           /*!< Maximum number of sessions kept, 0 for unlimited                   */
+	M_uint64             sessions_max_age_s;     /*!< Maximum time a session is kept, 0 for the session's lifetime       */
 	M_tls_verify_level_t verify_level;           /*!< Certificate verification level                                     */
 	M_bool               sessions_enabled;       /*!< Whether or not session resumption is desired                       */
 	M_uint64             negotiation_timeout_ms; /*!< Amount of time negotiation can take                                */
+	M_bool               ktls_enabled;           /*!< Whether to try offloading record processing to the kernel          */
+	M_threadpool_t      *handshake_pool;         /*!< Pool handshake steps run on, NULL to run them on the event loop    */
 };
 
+SSL_SESSION *M_tls_clientctx_session_take(M_tls_clientctx_t *ctx, const char *hostport);
+void M_tls_clientctx_session_put(M_tls_clientctx_t *ctx, const char *hostport, SSL_SESSION *session);
+
 #endif
@@ -31,6 +31,8 @@
 #include <openssl/x509v3.h> /* For X509_check_host() */
 #include <openssl/pem.h>
 #include <openssl/err.h>
+#include <openssl/rand.h>
+#include <openssl/hmac.h>
 #if OPENSSL_VERSION_NUMBER >= 0x3000000fL
 #  include <openssl/core_names.h>
 #  include <openssl/param_build.h>
@@ -193,12 +195,16 @@ end:
 	return dh;
 }
 
-static void M_tls_serverctx_set_session_support(SSL_CTX *sslctx, M_bool enable)
+static void M_tls_serverctx_set_session_support(M_tls_serverctx_t *ctx)
 {
-	if (enable) {
-		SSL_CTX_set_session_cache_mode(sslctx, SSL_SESS_CACHE_SERVER);
+	if (!ctx->sessions_enabled) {
+		SSL_CTX_set_session_cache_mode(ctx->ctx, SSL_SESS_CACHE_OFF);
+	} else if (ctx->store.store != NULL) {
+		/* The store is the cache. OpenSSL removes everything in its own cache from
+		 * the store when the context is freed. */
+		SSL_CTX_set_session_cache_mode(ctx->ctx, SSL_SESS_CACHE_SERVER|SSL_SESS_CACHE_NO_INTERNAL_STORE);
 	} else {
-		SSL_CTX_set_session_cache_mode(sslctx, SSL_SESS_CACHE_OFF);
+		SSL_CTX_set_session_cache_mode(ctx->ctx, SSL_SESS_CACHE_SERVER);
 	}
 }
 
@@ -247,7 +253,12 @@ M_tls_serverctx_t *M_tls_serverctx_create(const unsigned char *key, size_t key_l
 	SSL_CTX_set_tlsext_servername_callback(sslctx, M_tls_serverctx_sni_cb);
 	SSL_CTX_set_tlsext_servername_arg(sslctx, ctx);
 
-	M_tls_serverctx_set_session_support(sslctx, ctx->sessions_enabled);
+	/* Session and ticket callbacks only receive OpenSSL objects */
+	SSL_CTX_set_app_data(sslctx, ctx);
+	ctx->ticket_keys[0].epoch = -1;
+	ctx->ticket_keys[1].epoch = -1;
+
+	M_tls_serverctx_set_session_support(ctx);
 
 	return ctx;
 }
@@ -474,9 +485,24 @@ M_bool M_tls_serverctx_upref(M_tls_serverctx_t *ctx)
 }
 
 
+static void M_tls_serverctx_ticket_keys_clear(M_tls_serverctx_t *ctx)
+{
+	if (ctx->ticket_secret != NULL)
+		OPENSSL_cleanse(ctx->ticket_secret, ctx->ticket_secret_len);
+	M_free(ctx->ticket_secret);
+	ctx->ticket_secret     = NULL;
+	ctx->ticket_secret_len = 0;
+
+	OPENSSL_cleanse(ctx->ticket_keys, sizeof(ctx->ticket_keys));
+	ctx->ticket_keys[0].epoch = -1;
+	ctx->ticket_keys[1].epoch = -1;
+}
+
+
 static void M_tls_serverctx_destroy_real(M_tls_serverctx_t *ctx)
 {
 	SSL_CTX_free(ctx->ctx);
+	M_tls_serverctx_ticket_keys_clear(ctx);
 	if (ctx->dh)
 		EVP_PKEY_free(ctx->dh);
 	M_list_destroy(ctx->children, M_TRUE);
@@ -791,8 +817,348 @@ M_bool M_tls_serverctx_set_session_resumption(M_tls_serverctx_t *ctx, M_bool ena
 
 	M_thread_mutex_lock(ctx->lock);
 	ctx->sessions_enabled = enable;
-	M_tls_serverctx_set_session_support(ctx->ctx, enable);
+	M_tls_serverctx_set_session_support(ctx);
+
+	M_thread_mutex_unlock(ctx->lock);
+	return M_TRUE;
+}
+
+
+/* Sessions and tickets belong to the context the connection was accepted with,
+ * which is the parent if SNI switched to a child. */
+static M_tls_serverctx_t *M_tls_serverctx_from_sslctx(SSL_CTX *sslctx)
+{
+	M_tls_serverctx_t *ctx = SSL_CTX_get_app_data(sslctx);
+
+	if (ctx != NULL && ctx->parent != NULL)
+		ctx = ctx->parent;
+	return ctx;
+}
+
+
+static M_tls_serverctx_t *M_tls_serverctx_get_store(SSL_CTX *sslctx, struct M_tls_session_store_callbacks *store, void **thunk)
+{
+	M_tls_serverctx_t *ctx = M_tls_serverctx_from_sslctx(sslctx);
+
+	if (ctx == NULL)
+		return NULL;
+
+	/* Copy so the store isn't called with the lock held */
+	M_thread_mutex_lock(ctx->lock);
+	M_mem_copy(store, &ctx->store, sizeof(*store));
+	*thunk = ctx->store_thunk;
+	M_thread_mutex_unlock(ctx->lock);
+
+	return ctx;
+}
+
+
+static int M_tls_serverctx_store_new_cb(SSL *ssl, SSL_SESSION *session)
+{
+	struct M_tls_session_store_callbacks  store;
+	void                                 *thunk    = NULL;
+	const unsigned char                  *id;
+	unsigned int                          id_len   = 0;
+	unsigned char                        *data;
+	unsigned char                        *ptr;
+	int                                   data_len;
+
+	if (M_tls_serverctx_get_store(SSL_get_SSL_CTX(ssl), &store, &thunk) == NULL || store.store == NULL)
+		return 0;
+
+	data_len = i2d_SSL_SESSION(session, NULL);
+	if (data_len <= 0)
+		return 0;
+
+	data = M_malloc((size_t)data_len);
+	ptr  = data;
+	if (i2d_SSL_SESSION(session, &ptr) == data_len) {
+		id = SSL_SESSION_get_id(session, &id_len);
+		store.store(id, id_len, data, (size_t)data_len, (M_time_t)SSL_SESSION_get_time(session) + (M_time_t)SSL_SESSION_get_timeout(session), thunk);
+	}
+
+	OPENSSL_cleanse(data, (size_t)data_len);
+	M_free(data);
+
+	/* We don't hold a reference to the session */
+	return 0;
+}
+
+
+#if OPENSSL_VERSION_NUMBER >= 0x1010000fL
+static SSL_SESSION *M_tls_serverctx_store_get_cb(SSL *ssl, const unsigned char *id, int id_len, int *copy)
+#else
+static SSL_SESSION *M_tls_serverctx_store_get_cb(SSL *ssl, unsigned char *id, int id_len, int *copy)
+#endif
+{
+	struct M_tls_session_store_callbacks  store;
+	void                                 *thunk    = NULL;
+	unsigned char                        *data;
+	const unsigned char                  *ptr;
+	size_t                                data_len = 0;
+	SSL_SESSION                          *session;
+
+	/* Returned session's reference is given to OpenSSL */
+	*copy = 0;
+
+	if (id_len <= 0 || M_tls_serverctx_get_store(SSL_get_SSL_CTX(ssl), &store, &thunk) == NULL || store.fetch == NULL)
+		return NULL;
+
+	data = store.fetch(id, (size_t)id_len, &data_len, thunk);
+	if (data == NULL)
+		return NULL;
+
+	ptr     = data;
+	session = d2i_SSL_SESSION(NULL, &ptr, (long)data_len);
+
+	OPENSSL_cleanse(data, data_len);
+	M_free(data);
+
+	return session;
+}
+
+
+static void M_tls_serverctx_store_remove_cb(SSL_CTX *sslctx, SSL_SESSION *session)
+{
+	struct M_tls_session_store_callbacks  store;
+	void                                 *thunk  = NULL;
+	const unsigned char                  *id;
+	unsigned int                          id_len = 0;
+
+	if (M_tls_serverctx_get_store(sslctx, &store, &thunk) == NULL || store.remove == NULL)
+		return;
+
+	id = SSL_SESSION_get_id(session, &id_len);
+	store.remove(id, id_len, thunk);
+}
+
+
+M_bool M_tls_serverctx_set_session_store(M_tls_serverctx_t *ctx, const struct M_tls_session_store_callbacks *callbacks, void *thunk)
+{
+	if (ctx == NULL || ctx->parent || (callbacks != NULL && (callbacks->store == NULL || callbacks->fetch == NULL)))
+		return M_FALSE;
+
+	M_thread_mutex_lock(ctx->lock);
+	if (callbacks != NULL) {
+		M_mem_copy(&ctx->store, callbacks, sizeof(ctx->store));
+		ctx->store_thunk = thunk;
+		SSL_CTX_sess_set_new_cb(ctx->ctx, M_tls_serverctx_store_new_cb);
+		SSL_CTX_sess_set_get_cb(ctx->ctx, M_tls_serverctx_store_get_cb);
+		SSL_CTX_sess_set_remove_cb(ctx->ctx, M_tls_serverctx_store_remove_cb);
+	} else {
+		M_mem_set(&ctx->store, 0, sizeof(ctx->store));
+		ctx->store_thunk = NULL;
+		SSL_CTX_sess_set_new_cb(ctx->ctx, NULL);
+		SSL_CTX_sess_set_get_cb(ctx->ctx, NULL);
+		SSL_CTX_sess_set_remove_cb(ctx->ctx, NULL);
+	}
+	M_tls_serverctx_set_session_support(ctx);
+	M_thread_mutex_unlock(ctx->lock);
+
+	return M_TRUE;
+}
+
+
+M_bool M_tls_serverctx_set_session_tickets(M_tls_serverctx_t *ctx, M_bool enable)
+{
+	if (ctx == NULL || ctx->parent)
+		return M_FALSE;
+
+	M_thread_mutex_lock(ctx->lock);
+	if (enable) {
+		SSL_CTX_clear_options(ctx->ctx, SSL_OP_NO_TICKET);
+	} else {
+		SSL_CTX_set_options(ctx->ctx, SSL_OP_NO_TICKET);
+	}
+	M_thread_mutex_unlock(ctx->lock);
+
+	return M_TRUE;
+}
+
+
+static M_bool M_tls_serverctx_ticket_key_generate(const M_tls_serverctx_t *ctx, M_tls_ticket_key_t *key, M_int64 epoch)
+{
+	unsigned char msg[17];
+	unsigned char md[EVP_MAX_MD_SIZE];
+	unsigned int  md_len = 0;
+	M_bool        retval = M_FALSE;
+	size_t        i;
+
+	key->epoch = -1;
+
+	if (ctx->ticket_secret == NULL) {
+		if (RAND_bytes(key->name, (int)sizeof(key->name)) != 1 ||
+				RAND_bytes(key->aes_key, (int)sizeof(key->aes_key)) != 1 ||
+				RAND_bytes(key->hmac_key, (int)sizeof(key->hmac_key)) != 1)
+		{
+			return M_FALSE;
+		}
+		key->epoch = epoch;
+		return M_TRUE;
+	}
+
+	/* Everyone with the same secret and interval derives the same keys */
+	for (i=0; i<8; i++) {
+		msg[i]     = (unsigned char)(((M_uint64)epoch >> (56 - (i * 8))) & 0xFF);
+		msg[8 + i] = (unsigned char)((ctx->ticket_rotate_s >> (56 - (i * 8))) & 0xFF);
+	}
 
+	msg[16] = 'k';
+	if (HMAC(EVP_sha512(), ctx->ticket_secret, (int)ctx->ticket_secret_len, msg, sizeof(msg), md, &md_len) == NULL || md_len != 64)
+		goto done;
+	M_mem_copy(key->aes_key, md, sizeof(key->aes_key));
+	M_mem_copy(key->hmac_key, md + sizeof(key->aes_key), sizeof(key->hmac_key));
+
+	msg[16] = 'n';
+	if (HMAC(EVP_sha256(), ctx->ticket_secret, (int)ctx->ticket_secret_len, msg, sizeof(msg), md, &md_len) == NULL || md_len < sizeof(key->name))
+		goto done;
+	M_mem_copy(key->name, md, sizeof(key->name));
+
+	key->epoch = epoch;
+	retval     = M_TRUE;
+
+done:
+	OPENSSL_cleanse(md, sizeof(md));
+	return retval;
+}
+
+
+/* Must be called locked */
+static void M_tls_serverctx_ticket_keys_update(M_tls_serverctx_t *ctx)
+{
+	M_int64 epoch = M_time() / (M_int64)ctx->ticket_rotate_s;
+
+	if (ctx->ticket_keys[0].epoch == epoch)
+		return;
+
+	if (ctx->ticket_keys[0].epoch != -1 && ctx->ticket_keys[0].epoch == epoch - 1) {
+		M_mem_copy(&ctx->ticket_keys[1], &ctx->ticket_keys[0], sizeof(ctx->ticket_keys[1]));
+	} else if (ctx->ticket_secret == NULL || !M_tls_serverctx_ticket_key_generate(ctx, &ctx->ticket_keys[1], epoch - 1)) {
+		/* Random keys older than the last interval are gone */
+		OPENSSL_cleanse(&ctx->ticket_keys[1], sizeof(ctx->ticket_keys[1]));
+		ctx->ticket_keys[1].epoch = -1;
+	}
+
+	if (!M_tls_serverctx_ticket_key_generate(ctx, &ctx->ticket_keys[0], epoch)) {
+		OPENSSL_cleanse(&ctx->ticket_keys[0], sizeof(ctx->ticket_keys[0]));
+		ctx->ticket_keys[0].epoch = -1;
+	}
+}
+
+
+#if OPENSSL_VERSION_NUMBER >= 0x3000000fL
+static int M_tls_serverctx_ticket_cb(SSL *ssl, unsigned char *key_name, unsigned char *iv, EVP_CIPHER_CTX *cipher_ctx, EVP_MAC_CTX *mac_ctx, int enc)
+#else
+static int M_tls_serverctx_ticket_cb(SSL *ssl, unsigned char *key_name, unsigned char *iv, EVP_CIPHER_CTX *cipher_ctx, HMAC_CTX *mac_ctx, int enc)
+#endif
+{
+	M_tls_serverctx_t  *ctx    = M_tls_serverctx_from_sslctx(SSL_get_SSL_CTX(ssl));
+	M_tls_ticket_key_t  key;
+	int                 retval = 0;
+	size_t              i;
+#if OPENSSL_VERSION_NUMBER >= 0x3000000fL
+	OSSL_PARAM          params[3];
+#endif
+
+	if (ctx == NULL)
+		return 0;
+
+	M_thread_mutex_lock(ctx->lock);
+	if (ctx->ticket_rotate_s != 0) {
+		M_tls_serverctx_ticket_keys_update(ctx);
+		for (i=0; i<2; i++) {
+			if (ctx->ticket_keys[i].epoch == -1)
+				continue;
+			/* New tickets always use the current key */
+			if ((enc && i == 0) || (!enc && M_mem_eq(key_name, ctx->ticket_keys[i].name, sizeof(ctx->ticket_keys[i].name)))) {
+				M_mem_copy(&key, &ctx->ticket_keys[i], sizeof(key));
+				/* 2 has OpenSSL replace tickets using the previous key */
+				retval = (i == 0)?1:2;
+				break;
+			}
+		}
+	}
+	M_thread_mutex_unlock(ctx->lock);
+
+	/* Unknown key, do a full handshake */
+	if (retval == 0)
+		return 0;
+
+	if (enc) {
+		M_mem_copy(key_name, key.name, sizeof(key.name));
+		if (RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) != 1 ||
+				!EVP_EncryptInit_ex(cipher_ctx, EVP_aes_256_cbc(), NULL, key.aes_key, iv))
+		{
+			retval = -1;
+		}
+	} else {
+		if (!EVP_DecryptInit_ex(cipher_ctx, EVP_aes_256_cbc(), NULL, key.aes_key, iv))
+			retval = -1;
+	}
+
+#if OPENSSL_VERSION_NUMBER >= 0x3000000fL
+	params[0] = OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, key.hmac_key, sizeof(key.hmac_key));
+	params[1] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, (char *)"SHA256", 0);
+	params[2] = OSSL_PARAM_construct_end();
+	if (retval > 0 && !EVP_MAC_CTX_set_params(mac_ctx, params))
+		retval = -1;
+#else
+	if (retval > 0 && !HMAC_Init_ex(mac_ctx, key.hmac_key, (int)sizeof(key.hmac_key), EVP_sha256(), NULL))
+		retval = -1;
+#endif
+
+	OPENSSL_cleanse(&key, sizeof(key));
+	return retval;
+}
+
+
+M_bool M_tls_serverctx_set_ticket_keys(M_tls_serverctx_t *ctx, const unsigned char *secret, size_t secret_len, M_uint64 rotate_s)
+{
+	if (ctx == NULL || ctx->parent || rotate_s > M_INT32_MAX)
+		return M_FALSE;
+
+	if (secret != NULL && (secret_len < 32 || secret_len > M_INT32_MAX || rotate_s == 0))
+		return M_FALSE;
+
+	M_thread_mutex_lock(ctx->lock);
+
+	M_tls_serverctx_ticket_keys_clear(ctx);
+	ctx->ticket_rotate_s = rotate_s;
+	if (secret != NULL) {
+		ctx->ticket_secret     = M_memdup(secret, secret_len);
+		ctx->ticket_secret_len = secret_len;
+	}
+
+#if OPENSSL_VERSION_NUMBER >= 0x3000000fL
+	SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx->ctx, (rotate_s != 0)?M_tls_serverctx_ticket_cb:NULL);
+#else
+	SSL_CTX_set_tlsext_ticket_key_cb(ctx->ctx, (rotate_s != 0)?M_tls_serverctx_ticket_cb:NULL);
+#endif
+
+	M_thread_mutex_unlock(ctx->lock);
+	return M_TRUE;
+}
+
+
+M_bool M_tls_serverctx_set_ktls(M_tls_serverctx_t *ctx, M_bool enable)
+{
+	if (ctx == NULL || ctx->parent)
+		return M_FALSE;
+
+	M_thread_mutex_lock(ctx->lock);
+	ctx->ktls_enabled = enable;
+	M_thread_mutex_unlock(ctx->lock);
+	return M_TRUE;
+}
+
+
+M_bool M_tls_serverctx_set_handshake_pool(M_tls_serverctx_t *ctx, M_threadpool_t *pool)
+{
+	if (ctx == NULL || ctx->parent)
+		return M_FALSE;
+
+	M_thread_mutex_lock(ctx->lock);
+	ctx->handshake_pool = pool;
 	M_thread_mutex_unlock(ctx->lock);
 	return M_TRUE;
 }
@@ -27,6 +27,13 @@
 #include <openssl/ssl.h>
 #include "m_tls_ctx_common.h"
 
+typedef struct {
+	M_int64             epoch;                  /*!< Rotation interval the key belongs to, -1 if unset                  */
+	unsigned char       name[16];               /*!< Identifies the key in tickets                                      */
+	unsigned char       aes_key[32];            /*!< Ticket encryption key                                              */
+	unsigned char       hmac_key[32];           /*!< Ticket authentication key                                          */
+} M_tls_ticket_key_t;
+
 struct M_tls_serverctx {
 	M_thread_mutex_t   *lock;                   /*!< Mutex to protect concurrent access                                 */
 	M_list_t           *children;               /*!< List of M_tls_serverctx_t children for SNI                         */
@@ -39,8 +46,16 @@ struct M_tls_serverctx {
 	size_t              ref_cnt;                /*!< Reference count to prevent destroy of CTX while connections active */
 	M_uint64            negotiation_timeout_ms; /*!< Amount of time negotiation can take                                */
 	M_bool              sessions_enabled;       /*!< Whether or not to enable session resumption support                */
+	M_bool              ktls_enabled;           /*!< Whether to try offloading record processing to the kernel          */
+	M_threadpool_t     *handshake_pool;         /*!< Pool handshake steps run on, NULL to run them on the event loop    */
 	unsigned char      *alpn_apps;              /*!< ALPN supported applications                                        */
 	size_t              alpn_apps_len;          /*!< ALPN supported applications length                                 */
+	struct M_tls_session_store_callbacks store; /*!< External session store                                             */
+	void               *store_thunk;            /*!< Thunk passed to the session store callbacks                        */
+	M_uint64            ticket_rotate_s;        /*!< Ticket key lifetime, 0 if OpenSSL manages ticket keys              */
+	unsigned char      *ticket_secret;          /*!< Secret ticket keys are derived from, NULL for random keys          */
+	size_t              ticket_secret_len;      /*!< Length of ticket secret                                            */
+	M_tls_ticket_key_t  ticket_keys[2];         /*!< Current and previous ticket keys                                   */
 };
 
 void M_tls_serverctx_refcnt_decrement(M_tls_serverctx_t *ctx);